@@ -0,0 +1,56 @@
+//==--- snowflake/benchmarks/ecs.cpp ----------------------- -*- C++ -*- ---==//
+//
+//                                  Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  ecs.cpp
+/// \brief This file implements benchmarks for ecs functionality.
+//
+//==------------------------------------------------------------------------==//
+
+#include "ecs/archetype_manager.hpp"
+#include "ecs/component_storage.hpp"
+#include "ecs/entity_manager.hpp"
+#include "ecs/sparse_set.hpp"
+#include <cstring>
+#include <string>
+
+/**
+ * Runs the benchmarks. Unless an output file is given with --benchmark_out,
+ * the results are also written as json to ecs_benchmarks.json, so that they
+ * can be compared across releases and configurations.
+ */
+int main(int argc, char** argv) {
+  std::vector<char*> args(argv, argv + argc);
+  const bool         has_out =
+    std::any_of(args.begin(), args.end(), [](const char* arg) {
+      return std::strncmp(arg, "--benchmark_out=", 16) == 0;
+    });
+  char out[]    = "--benchmark_out=ecs_benchmarks.json";
+  char format[] = "--benchmark_out_format=json";
+  if (!has_out) {
+    args.push_back(out);
+    args.push_back(format);
+  }
+
+  int count = static_cast<int>(args.size());
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+    return 1;
+  }
+
+  // Record the configuration, so that results for different configurations
+  // can be compared.
+  benchmark::AddCustomContext(
+    "sparse_page_size", std::to_string(snowflake::sparse_page_size));
+  benchmark::AddCustomContext(
+    "component_page_size", std::to_string(snowflake::component_page_size));
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
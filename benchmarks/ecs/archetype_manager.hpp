@@ -0,0 +1,96 @@
+//==--- snowflake/benchmarks/ecs/archetype_manager.hpp ----- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  archetype_manager.hpp
+/// \brief This file implements benchmarks which compare the archetype and
+///        sparse set based managers.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_BENCHMARKS_ECS_ARCHETYPE_MANAGER_HPP
+#define SNOWFLAKE_BENCHMARKS_ECS_ARCHETYPE_MANAGER_HPP
+
+#include "entity_manager.hpp"
+
+/**
+ * Component for the backend comparisons, where the \p Tag makes the
+ * components distinct types.
+ */
+template <size_t Tag>
+using Part = Payload<8, Tag>;
+
+template <typename Manager>
+static void backend_join(benchmark::State& state) {
+  // Every entity has the first five components, and half have the sixth, so
+  // half of the entities are visited.
+  Manager                        manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(state.range(0), std::back_inserter(entities));
+  for (size_t i = 0; i < entities.size(); ++i) {
+    const auto& e = entities[i];
+    manager.template emplace<Part<0>>(e);
+    manager.template emplace<Part<1>>(e);
+    manager.template emplace<Part<2>>(e);
+    manager.template emplace<Part<3>>(e);
+    manager.template emplace<Part<4>>(e);
+    if (i % 2 == 0) {
+      manager.template emplace<Part<5>>(e);
+    }
+  }
+  auto view = manager.template view<
+    Part<0>, Part<1>, Part<2>, Part<3>, Part<4>, Part<5>>();
+  size_t visited = 0;
+  for (auto _ : state) {
+    visited = 0;
+    view.each([&](
+                Part<0>&       p0,
+                const Part<1>& p1,
+                const Part<2>& p2,
+                const Part<3>& p3,
+                const Part<4>& p4,
+                const Part<5>& p5) {
+      p0.values[0] += p1.values[0] + p2.values[0] + p3.values[0] +
+                      p4.values[0] + p5.values[0];
+      ++visited;
+    });
+    benchmark::ClobberMemory();
+  }
+  bench_items(state, visited);
+}
+BENCHMARK_TEMPLATE(backend_join, BenchManager)->Apply(entity_counts);
+BENCHMARK_TEMPLATE(backend_join, BenchArchetypes)->Apply(entity_counts);
+
+template <typename Manager>
+static void backend_churn(benchmark::State& state) {
+  // Each entity has four components, and a fifth is added and removed, which
+  // moves the entity between archetypes in the archetype manager.
+  Manager                        manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(state.range(0), std::back_inserter(entities));
+  for (const auto& e : entities) {
+    manager.template emplace<Part<0>>(e);
+    manager.template emplace<Part<1>>(e);
+    manager.template emplace<Part<2>>(e);
+    manager.template emplace<Part<3>>(e);
+  }
+  for (auto _ : state) {
+    for (const auto& e : entities) {
+      manager.template emplace<Part<4>>(e);
+    }
+    for (const auto& e : entities) {
+      manager.template remove<Part<4>>(e);
+    }
+  }
+  bench_items(state, entities.size() * 2);
+}
+BENCHMARK_TEMPLATE(backend_churn, BenchManager)->Apply(entity_counts);
+BENCHMARK_TEMPLATE(backend_churn, BenchArchetypes)->Apply(entity_counts);
+
+#endif // SNOWFLAKE_BENCHMARKS_ECS_ARCHETYPE_MANAGER_HPP
@@ -0,0 +1,75 @@
+//==--- snowflake/benchmarks/ecs/common.hpp ---------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  common.hpp
+/// \brief This file defines functionality shared by the ecs benchmarks.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_BENCHMARKS_ECS_COMMON_HPP
+#define SNOWFLAKE_BENCHMARKS_ECS_COMMON_HPP
+
+#include <snowflake/ecs/entity.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/**
+ * Component with a size of \p Bytes, where the \p Tag makes components of
+ * the same size distinct types.
+ */
+template <size_t Bytes, size_t Tag = 0>
+struct Payload {
+  static_assert(Bytes % sizeof(float) == 0, "Size must be a multiple of 4!");
+
+  float values[Bytes / sizeof(float)] = {};
+};
+
+/**
+ * Sets the entity counts for a benchmark, which are 10k, 100k, 1M and 10M.
+ */
+inline auto entity_counts(benchmark::internal::Benchmark* b) -> void {
+  b->RangeMultiplier(10)->Range(10'000, 10'000'000);
+  b->Unit(benchmark::kMicrosecond);
+}
+
+/**
+ * Creates \p count entities with consecutive ids.
+ */
+inline auto bench_entities(size_t count) -> std::vector<snowflake::Entity> {
+  std::vector<snowflake::Entity> entities;
+  entities.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    entities.emplace_back(static_cast<snowflake::Entity::IdType>(i));
+  }
+  return entities;
+}
+
+/**
+ * Shuffles the \p entities, with a fixed seed so that runs are comparable.
+ */
+inline auto bench_shuffle(std::vector<snowflake::Entity> entities)
+  -> std::vector<snowflake::Entity> {
+  std::shuffle(entities.begin(), entities.end(), std::mt19937{1234});
+  return entities;
+}
+
+/**
+ * Sets the items processed by a benchmark to \p per_iteration items for each
+ * iteration of the \p state.
+ */
+inline auto bench_items(benchmark::State& state, size_t per_iteration)
+  -> void {
+  state.SetItemsProcessed(
+    static_cast<int64_t>(state.iterations() * per_iteration));
+}
+
+#endif // SNOWFLAKE_BENCHMARKS_ECS_COMMON_HPP
@@ -0,0 +1,109 @@
+//==--- snowflake/benchmarks/ecs/component_storage.hpp ----- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  component_storage.hpp
+/// \brief This file implements benchmarks for component storage.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_BENCHMARKS_ECS_COMPONENT_STORAGE_HPP
+#define SNOWFLAKE_BENCHMARKS_ECS_COMPONENT_STORAGE_HPP
+
+#include "common.hpp"
+#include <snowflake/ecs/component_storage.hpp>
+
+template <typename Component>
+using BenchStorage = snowflake::ComponentStorage<snowflake::Entity, Component>;
+
+template <typename Component>
+static void component_storage_emplace_erase(benchmark::State& state) {
+  const auto              entities = bench_entities(state.range(0));
+  BenchStorage<Component> storage;
+  for (auto _ : state) {
+    for (const auto& e : entities) {
+      storage.emplace(e);
+    }
+    for (const auto& e : entities) {
+      storage.erase(e);
+    }
+  }
+  bench_items(state, entities.size());
+}
+BENCHMARK_TEMPLATE(component_storage_emplace_erase, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(component_storage_emplace_erase, Payload<16>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(component_storage_emplace_erase, Payload<64>)
+  ->Apply(entity_counts);
+
+template <typename Component>
+static void component_storage_iterate(benchmark::State& state) {
+  const auto              entities = bench_entities(state.range(0));
+  BenchStorage<Component> storage;
+  storage.insert(entities.begin(), entities.end(), Component{});
+  for (auto _ : state) {
+    for (auto& component : storage) {
+      component.values[0] += 1.0f;
+    }
+    benchmark::ClobberMemory();
+  }
+  bench_items(state, entities.size());
+}
+BENCHMARK_TEMPLATE(component_storage_iterate, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(component_storage_iterate, Payload<16>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(component_storage_iterate, Payload<64>)
+  ->Apply(entity_counts);
+
+template <typename Component>
+static void component_storage_find(benchmark::State& state) {
+  // Every other entity has the component, and lookups are in random order.
+  const auto              entities = bench_entities(state.range(0) * 2);
+  const auto              lookups  = bench_shuffle(entities);
+  BenchStorage<Component> storage;
+  for (size_t i = 0; i < entities.size(); i += 2) {
+    storage.emplace(entities[i]);
+  }
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const auto& e : lookups) {
+      found += storage.find(e) != storage.end();
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  bench_items(state, lookups.size());
+}
+BENCHMARK_TEMPLATE(component_storage_find, Payload<4>)->Apply(entity_counts);
+BENCHMARK_TEMPLATE(component_storage_find, Payload<64>)->Apply(entity_counts);
+
+template <typename Component>
+static void component_storage_random_get(benchmark::State& state) {
+  const auto              entities = bench_entities(state.range(0));
+  const auto              lookups  = bench_shuffle(entities);
+  BenchStorage<Component> storage;
+  storage.insert(entities.begin(), entities.end(), Component{});
+  for (auto _ : state) {
+    float sum = 0.0f;
+    for (const auto& e : lookups) {
+      sum += storage.get(e).values[0];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  bench_items(state, lookups.size());
+}
+BENCHMARK_TEMPLATE(component_storage_random_get, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(component_storage_random_get, Payload<16>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(component_storage_random_get, Payload<64>)
+  ->Apply(entity_counts);
+
+#endif // SNOWFLAKE_BENCHMARKS_ECS_COMPONENT_STORAGE_HPP
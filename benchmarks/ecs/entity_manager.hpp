@@ -0,0 +1,139 @@
+//==--- snowflake/benchmarks/ecs/entity_manager.hpp -------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  entity_manager.hpp
+/// \brief This file implements benchmarks for the entity manager.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_BENCHMARKS_ECS_ENTITY_MANAGER_HPP
+#define SNOWFLAKE_BENCHMARKS_ECS_ENTITY_MANAGER_HPP
+
+#include "common.hpp"
+#include <snowflake/ecs/archetype_manager.hpp>
+#include <snowflake/ecs/entity_manager.hpp>
+
+// Each benchmark runs over both the sparse set and archetype backends.
+using BenchManager    = snowflake::EntityManager<snowflake::Entity>;
+using BenchArchetypes = snowflake::ArchetypeManager<snowflake::Entity>;
+
+template <typename Manager>
+static void entity_manager_create_recycle(benchmark::State& state) {
+  const auto                     count = static_cast<size_t>(state.range(0));
+  Manager                        em;
+  std::vector<snowflake::Entity> entities;
+  entities.reserve(count);
+  for (auto _ : state) {
+    em.create(count, std::back_inserter(entities));
+    em.recycle(entities.begin(), entities.end());
+    entities.clear();
+  }
+  bench_items(state, count);
+}
+BENCHMARK_TEMPLATE(entity_manager_create_recycle, BenchManager)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_create_recycle, BenchArchetypes)
+  ->Apply(entity_counts);
+
+template <typename Manager, typename Component>
+static void entity_manager_emplace_remove(benchmark::State& state) {
+  Manager                        em;
+  std::vector<snowflake::Entity> entities;
+  em.create(state.range(0), std::back_inserter(entities));
+  for (auto _ : state) {
+    for (const auto& e : entities) {
+      em.template emplace<Component>(e);
+    }
+    for (const auto& e : entities) {
+      em.template remove<Component>(e);
+    }
+  }
+  bench_items(state, entities.size());
+}
+BENCHMARK_TEMPLATE(entity_manager_emplace_remove, BenchManager, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_emplace_remove, BenchManager, Payload<64>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_emplace_remove, BenchArchetypes, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_emplace_remove, BenchArchetypes, Payload<64>)
+  ->Apply(entity_counts);
+
+template <typename Manager, typename Component>
+static void entity_manager_random_get(benchmark::State& state) {
+  Manager                        em;
+  std::vector<snowflake::Entity> entities;
+  em.create(state.range(0), std::back_inserter(entities));
+  for (const auto& e : entities) {
+    em.template emplace<Component>(e);
+  }
+  const auto lookups = bench_shuffle(entities);
+  for (auto _ : state) {
+    float sum = 0.0f;
+    for (const auto& e : lookups) {
+      sum += em.template get<Component>(e).values[0];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  bench_items(state, lookups.size());
+}
+BENCHMARK_TEMPLATE(entity_manager_random_get, BenchManager, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_random_get, BenchManager, Payload<64>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_random_get, BenchArchetypes, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_random_get, BenchArchetypes, Payload<64>)
+  ->Apply(entity_counts);
+
+template <typename Manager, typename Component>
+static void entity_manager_join(benchmark::State& state) {
+  // Every entity has A, half have B, and a quarter have C, so a quarter of
+  // the entities are visited.
+  using A = Payload<sizeof(Component), 1>;
+  using B = Payload<sizeof(Component), 2>;
+  using C = Payload<sizeof(Component), 3>;
+  Manager                        em;
+  std::vector<snowflake::Entity> entities;
+  em.create(state.range(0), std::back_inserter(entities));
+  for (size_t i = 0; i < entities.size(); ++i) {
+    em.template emplace<A>(entities[i]);
+    if (i % 2 == 0) {
+      em.template emplace<B>(entities[i]);
+    }
+    if (i % 4 == 0) {
+      em.template emplace<C>(entities[i]);
+    }
+  }
+  size_t visited = 0;
+  for (auto _ : state) {
+    visited = 0;
+    em.template view<A, B, C>().each([&](A& a, const B& b, const C& c) {
+      a.values[0] += b.values[0] * c.values[0];
+      ++visited;
+    });
+    benchmark::ClobberMemory();
+  }
+  bench_items(state, visited);
+}
+BENCHMARK_TEMPLATE(entity_manager_join, BenchManager, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_join, BenchManager, Payload<16>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_join, BenchManager, Payload<64>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_join, BenchArchetypes, Payload<4>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_join, BenchArchetypes, Payload<16>)
+  ->Apply(entity_counts);
+BENCHMARK_TEMPLATE(entity_manager_join, BenchArchetypes, Payload<64>)
+  ->Apply(entity_counts);
+
+#endif // SNOWFLAKE_BENCHMARKS_ECS_ENTITY_MANAGER_HPP
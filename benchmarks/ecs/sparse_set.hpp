@@ -0,0 +1,75 @@
+//==--- snowflake/benchmarks/ecs/sparse_set.hpp ------------ -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  sparse_set.hpp
+/// \brief This file implements benchmarks for the sparse set.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_BENCHMARKS_ECS_SPARSE_SET_HPP
+#define SNOWFLAKE_BENCHMARKS_ECS_SPARSE_SET_HPP
+
+#include "common.hpp"
+#include <snowflake/ecs/sparse_set.hpp>
+
+using BenchSparseSet = snowflake::SparseSet<snowflake::Entity>;
+
+static void sparse_set_emplace_erase(benchmark::State& state) {
+  const auto     entities = bench_entities(state.range(0));
+  BenchSparseSet set;
+  for (auto _ : state) {
+    for (const auto& e : entities) {
+      set.emplace(e);
+    }
+    for (const auto& e : entities) {
+      set.erase(e);
+    }
+  }
+  bench_items(state, entities.size());
+}
+BENCHMARK(sparse_set_emplace_erase)->Apply(entity_counts);
+
+static void sparse_set_iterate(benchmark::State& state) {
+  const auto     entities = bench_entities(state.range(0));
+  BenchSparseSet set;
+  for (const auto& e : entities) {
+    set.emplace(e);
+  }
+  for (auto _ : state) {
+    size_t sum = 0;
+    for (const auto& e : set) {
+      sum += e.id();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  bench_items(state, entities.size());
+}
+BENCHMARK(sparse_set_iterate)->Apply(entity_counts);
+
+static void sparse_set_find(benchmark::State& state) {
+  // Every other entity is in the set, and lookups are in random order.
+  const auto     entities = bench_entities(state.range(0) * 2);
+  const auto     lookups  = bench_shuffle(entities);
+  BenchSparseSet set;
+  for (size_t i = 0; i < entities.size(); i += 2) {
+    set.emplace(entities[i]);
+  }
+  for (auto _ : state) {
+    size_t found = 0;
+    for (const auto& e : lookups) {
+      found += set.exists(e);
+    }
+    benchmark::DoNotOptimize(found);
+  }
+  bench_items(state, lookups.size());
+}
+BENCHMARK(sparse_set_find)->Apply(entity_counts);
+
+#endif // SNOWFLAKE_BENCHMARKS_ECS_SPARSE_SET_HPP
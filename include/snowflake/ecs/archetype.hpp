@@ -0,0 +1,434 @@
+//==--- snowflake/ecs/archetype.hpp ------------------------ -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  archetype.hpp
+/// \brief This file defines an archetype, which stores all the entities with
+///        the same set of components in chunked tables.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_ARCHETYPE_HPP
+#define SNOWFLAKE_ECS_ARCHETYPE_HPP
+
+#include <snowflake/util/thread_pool.hpp>
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Defines the size of the chunks for archetypes, in bytes.
+ */
+static constexpr size_t archetype_chunk_size =
+#if defined(SNOWFLAKE_ARCHETYPE_CHUNK_SIZE)
+  SNOWFLAKE_ARCHETYPE_CHUNK_SIZE;
+#else
+  16 * 1024;
+#endif
+
+/**
+ * Defines the maximum number of component types for a manager which uses
+ * archetypes.
+ */
+static constexpr size_t archetype_max_components =
+#if defined(SNOWFLAKE_ARCHETYPE_MAX_COMPONENTS)
+  SNOWFLAKE_ARCHETYPE_MAX_COMPONENTS;
+#else
+  128;
+#endif
+
+/** Defines the type of the mask of the components in an archetype. */
+using ArchetypeMask = std::bitset<archetype_max_components>;
+
+/**
+ * Type-erased information for a component, which is required to store the
+ * component in an archetype.
+ */
+struct ComponentInfo {
+  // clang-format off
+  /** Defines the type of the function to move construct a component. */
+  using MoveFn    = void (*)(void*, void*);
+  /** Defines the type of the function to destroy a component. */
+  using DestroyFn = void (*)(void*);
+  // clang-format on
+
+  /**
+   * Makes the info for the \p Component.
+   * \tparam Component The type of the component.
+   * \return The info for the component.
+   */
+  template <typename Component>
+  static auto make() noexcept -> ComponentInfo {
+    return ComponentInfo{
+      sizeof(Component),
+      alignof(Component),
+      [](void* dst, void* src) {
+        new (dst) Component(std::move(*static_cast<Component*>(src)));
+      },
+      [](void* p) { static_cast<Component*>(p)->~Component(); }};
+  }
+
+  size_t    size    = 0;       //!< Size of the component.
+  size_t    align   = 0;       //!< Alignment of the component.
+  MoveFn    move    = nullptr; //!< Move constructs the component.
+  DestroyFn destroy = nullptr; //!< Destroys the component.
+};
+
+/**
+ * An archetype stores all entities which have exactly the same set of
+ * components.
+ *
+ * The entities are stored in fixed-size chunks, and each chunk is a table
+ * with a column for the entities and a column for each of the components, so
+ * that iteration over any subset of the components is a linear walk over
+ * contiguous arrays. Each column is aligned to a cache line, or to the
+ * alignment of the component if it is larger, and the chunks are allocated
+ * with the largest alignment of the columns.
+ *
+ * The rows are kept packed, so erasing a row moves the last row in the
+ * archetype into the hole.
+ *
+ * \tparam Entity The type of the entities.
+ */
+template <typename Entity>
+class Archetype {
+  /**
+   * Column in the chunks.
+   */
+  struct Column {
+    ComponentInfo info   = {}; //!< Info for the component in the column.
+    size_t        offset = 0;  //!< Offset of the column in a chunk.
+  };
+
+  /**
+   * Deleter for the chunks.
+   */
+  struct ChunkDeleter {
+    size_t align = cache_line_size; //!< Alignment of the chunk.
+
+    /**
+     * Frees the chunk.
+     * \param data The data for the chunk.
+     */
+    auto operator()(std::byte* data) const noexcept -> void {
+      ::operator delete(data, std::align_val_t{align});
+    }
+  };
+
+  // clang-format off
+  /** Defines the type of a pointer to a chunk. */
+  using ChunkPtr = std::unique_ptr<std::byte[], ChunkDeleter>;
+  /** Defines the type of the container for columns. */
+  using Columns  = std::vector<Column>;
+  /** Defines the type of the edges to other archetypes. */
+  using Edges    = std::unordered_map<uint32_t, Archetype*>;
+  // clang-format on
+
+  /** Defines the value for a component which is not in the archetype. */
+  static constexpr int16_t no_column = -1;
+
+ public:
+  /** Defines the size type for the archetype. */
+  using SizeType = size_t;
+
+  /**
+   * Location of a row in the archetype.
+   */
+  struct Row {
+    uint32_t chunk = 0; //!< Index of the chunk.
+    uint32_t row   = 0; //!< Index of the row in the chunk.
+  };
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Creates the archetype for the components in the \p mask.
+   *
+   * \throws std::length_error if a single row of the components does not fit
+   *         in a chunk.
+   *
+   * \param mask  The mask of the components in the archetype.
+   * \param infos The info for all registered components, indexed by the
+   *              position of the component in the mask.
+   */
+  Archetype(const ArchetypeMask& mask, const std::vector<ComponentInfo>& infos)
+  : mask_{mask}, align_{cache_line_size} {
+    size_t row_bytes = sizeof(Entity);
+    for (size_t i = 0; i < infos.size(); ++i) {
+      if (mask_.test(i)) {
+        column_index_.resize(i + 1, no_column);
+        column_index_[i] = static_cast<int16_t>(columns_.size());
+        columns_.push_back(Column{infos[i], 0});
+        row_bytes += infos[i].size;
+        align_ = std::max(align_, infos[i].align);
+      }
+    }
+
+    // Start from the unaligned capacity, and reduce it until the aligned
+    // columns fit in the chunk.
+    capacity_ = archetype_chunk_size / row_bytes;
+    while (capacity_ > 0 && layout(capacity_) > archetype_chunk_size) {
+      --capacity_;
+    }
+    if (capacity_ == 0) {
+      throw std::length_error{"Components are too large for archetype chunk!"};
+    }
+  }
+
+  /**
+   * Destructor, which destroys all the components.
+   */
+  ~Archetype() noexcept {
+    for (uint32_t c = 0; c < chunks_.size(); ++c) {
+      for (auto& column : columns_) {
+        for (uint32_t r = 0; r < counts_[c]; ++r) {
+          column.info.destroy(data(column, Row{c, r}));
+        }
+      }
+    }
+  }
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  // clang-format off
+  /** Copy constructor -- deleted. */
+  Archetype(const Archetype&)      = delete;
+  /** Move constructor -- deleted. */
+  Archetype(Archetype&&)           = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const Archetype&) = delete;
+  /** Move assignment -- deleted. */
+  auto operator=(Archetype&&)      = delete;
+  // clang-format on
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Gets the mask of the components in the archetype.
+   * \return The mask of the components.
+   */
+  snowflake_nodiscard auto mask() const noexcept -> const ArchetypeMask& {
+    return mask_;
+  }
+
+  /**
+   * Gets the number of entities in the archetype.
+   * \return The number of entities.
+   */
+  snowflake_nodiscard auto size() const noexcept -> SizeType {
+    return size_;
+  }
+
+  /**
+   * Gets the number of rows in each chunk.
+   * \return The number of rows in a chunk.
+   */
+  snowflake_nodiscard auto capacity() const noexcept -> SizeType {
+    return capacity_;
+  }
+
+  /**
+   * Gets the number of chunks in the archetype.
+   * \return The number of chunks.
+   */
+  snowflake_nodiscard auto chunks() const noexcept -> SizeType {
+    return chunks_.size();
+  }
+
+  /**
+   * Gets the number of rows in the \p chunk.
+   * \param chunk The index of the chunk.
+   * \return The number of rows in the chunk.
+   */
+  snowflake_nodiscard auto rows(SizeType chunk) const noexcept -> SizeType {
+    return counts_[chunk];
+  }
+
+  /**
+   * Gets the index of the column for the component at \p index in the mask,
+   * or a negative value if the component is not in the archetype.
+   * \param index The index of the component in the mask.
+   * \return The index of the column for the component.
+   */
+  snowflake_nodiscard auto
+  column(SizeType index) const noexcept -> int16_t {
+    return index < column_index_.size() ? column_index_[index] : no_column;
+  }
+
+  /**
+   * Gets a pointer to the entities in the \p chunk.
+   * \param chunk The index of the chunk.
+   * \return A pointer to the entities in the chunk.
+   */
+  snowflake_nodiscard auto
+  entities(SizeType chunk) const noexcept -> Entity* {
+    return reinterpret_cast<Entity*>(chunks_[chunk].get());
+  }
+
+  /**
+   * Gets a pointer to the components in the \p column of the \p chunk.
+   * \param column The index of the column.
+   * \param chunk  The index of the chunk.
+   * \return A pointer to the start of the column in the chunk.
+   */
+  snowflake_nodiscard auto
+  column_data(int16_t column, SizeType chunk) const noexcept -> void* {
+    return chunks_[chunk].get() + columns_[column].offset;
+  }
+
+  /**
+   * Gets a pointer to the component in the \p column for the \p row.
+   * \param column The index of the column.
+   * \param row    The row to get the component for.
+   * \return A pointer to the component.
+   */
+  snowflake_nodiscard auto
+  component(int16_t column, Row row) const noexcept -> void* {
+    return data(columns_[column], row);
+  }
+
+  /**
+   * Appends a row for the \p entity. The components for the row are not
+   * constructed, and must be constructed by the caller.
+   * \param entity The entity to add a row for.
+   * \return The location of the row.
+   */
+  auto push(const Entity& entity) -> Row {
+    if (chunks_.empty() || counts_.back() == capacity_) {
+      chunks_.emplace_back(
+        static_cast<std::byte*>(::operator new(
+          archetype_chunk_size, std::align_val_t{align_})),
+        ChunkDeleter{align_});
+      counts_.push_back(0);
+    }
+    const Row row{
+      static_cast<uint32_t>(chunks_.size() - 1),
+      static_cast<uint32_t>(counts_.back()++)};
+    new (entities(row.chunk) + row.row) Entity{entity};
+    ++size_;
+    return row;
+  }
+
+  /**
+   * Moves the components from the \p row in the \p other archetype into the
+   * \p dst row in this archetype, for all components which are in both
+   * archetypes. The components in the other archetype are left in a
+   * moved-from state.
+   *
+   * \param dst   The row to move the components into.
+   * \param other The other archetype to move the components from.
+   * \param src   The row to move the components from.
+   */
+  auto move_from(Row dst, Archetype& other, Row src) noexcept -> void {
+    for (SizeType i = 0; i < column_index_.size(); ++i) {
+      const int16_t to = column_index_[i], from = other.column(i);
+      if (to != no_column && from != no_column) {
+        columns_[to].info.move(
+          component(to, dst), other.component(from, src));
+      }
+    }
+  }
+
+  /**
+   * Erases the \p row, destroying its components, and moves the last row in
+   * the archetype into its place.
+   *
+   * \param row The row to erase.
+   * \return The entity which was moved into the row, or an invalid entity if
+   *         no entity was moved.
+   */
+  auto erase(Row row) noexcept -> Entity {
+    const Row last{
+      static_cast<uint32_t>(chunks_.size() - 1),
+      static_cast<uint32_t>(counts_.back() - 1)};
+    Entity moved = Entity::null_entity();
+    for (auto& column : columns_) {
+      column.info.destroy(data(column, row));
+    }
+    if (row.chunk != last.chunk || row.row != last.row) {
+      for (auto& column : columns_) {
+        column.info.move(data(column, row), data(column, last));
+        column.info.destroy(data(column, last));
+      }
+      moved                        = entities(last.chunk)[last.row];
+      entities(row.chunk)[row.row] = moved;
+    }
+
+    --size_;
+    if (--counts_.back() == 0) {
+      chunks_.pop_back();
+      counts_.pop_back();
+    }
+    return moved;
+  }
+
+  /**
+   * Gets a reference to the edge to the archetype which has the components
+   * in this archetype, with the component at \p index in the mask added, if
+   * \p add is true, or removed otherwise.
+   * \param index The index of the component in the mask.
+   * \param add   If the edge is for adding the component.
+   * \return A reference to the pointer to the other archetype, which is null
+   *         if the edge has not been set.
+   */
+  auto edge(SizeType index, bool add) -> Archetype*& {
+    return edges_[static_cast<uint32_t>(index << 1 | (add ? 1 : 0))];
+  }
+
+ private:
+  ArchetypeMask         mask_         = {}; //!< Mask of the components.
+  Columns               columns_      = {}; //!< Columns for the components.
+  std::vector<int16_t>  column_index_ = {}; //!< Column for each component.
+  std::vector<ChunkPtr> chunks_       = {}; //!< Chunks of rows.
+  std::vector<SizeType> counts_       = {}; //!< Number of rows in each chunk.
+  Edges                 edges_        = {}; //!< Edges to other archetypes.
+  SizeType              capacity_     = 0;  //!< Number of rows per chunk.
+  SizeType              align_        = 0;  //!< Alignment of the chunks.
+  SizeType              size_         = 0;  //!< Number of rows.
+
+  /**
+   * Computes the offsets of the columns for \p capacity rows.
+   * \param capacity The number of rows in a chunk.
+   * \return The number of bytes required for the chunk.
+   */
+  auto layout(SizeType capacity) noexcept -> SizeType {
+    SizeType offset = sizeof(Entity) * capacity;
+    for (auto& column : columns_) {
+      const SizeType align = std::max(column.info.align, cache_line_size);
+      offset               = (offset + align - 1) / align * align;
+      column.offset        = offset;
+      offset += column.info.size * capacity;
+    }
+    return offset;
+  }
+
+  /**
+   * Gets a pointer to the data for the \p column at the \p row.
+   * \param column The column to get the data for.
+   * \param row    The row to get the data for.
+   * \return A pointer to the data.
+   */
+  auto data(const Column& column, Row row) const noexcept -> void* {
+    return chunks_[row.chunk].get() + column.offset +
+           column.info.size * row.row;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_ARCHETYPE_HPP
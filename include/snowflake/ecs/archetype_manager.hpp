@@ -0,0 +1,648 @@
+//==--- snowflake/ecs/archetype_manager.hpp ---------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  archetype_manager.hpp
+/// \brief This file defines a manager for entities which stores components
+///        in archetypes.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_ARCHETYPE_MANAGER_HPP
+#define SNOWFLAKE_ECS_ARCHETYPE_MANAGER_HPP
+
+#include "archetype.hpp"
+#include "component_id.hpp"
+#include "component_traits.hpp"
+#include "entity.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <tuple>
+
+namespace snowflake {
+
+/**
+ * View over all the archetypes which have *all* of the \p Components.
+ *
+ * Iteration walks the chunks of each matching archetype, and the columns for
+ * the components in each chunk, so it is a linear walk over contiguous arrays
+ * regardless of how many components are in the view.
+ *
+ * \note The matching archetypes are found when the view is created, so
+ *       archetypes which are created after the view are not included.
+ *
+ * \note Adding or removing components while iterating over the view is
+ *       undefined behaviour.
+ *
+ * \tparam Entity     The type of the entities.
+ * \tparam Components The types of the components, which can be const.
+ */
+template <typename Entity, typename... Components>
+class ArchetypeView {
+  /** Defines the type of the archetypes. */
+  using ArchetypeType = Archetype<Entity>;
+  /** Defines the type of the columns for the components in an archetype. */
+  using Columns = std::array<int16_t, sizeof...(Components)>;
+
+  /**
+   * Matching archetype, and the columns for the components in it.
+   */
+  struct Match {
+    const ArchetypeType* archetype = nullptr; //!< The archetype.
+    Columns              columns   = {};      //!< Columns for components.
+  };
+
+ public:
+  /** Defines the size type for the view. */
+  using SizeType = size_t;
+
+  /** Default constructor, which creates an empty view. */
+  ArchetypeView() noexcept = default;
+
+  /**
+   * Adds the \p archetype to the view, with the given \p columns for the
+   * components.
+   * \param archetype The archetype to add.
+   * \param columns   The columns for the components in the archetype.
+   */
+  auto add(const ArchetypeType* archetype, const Columns& columns) -> void {
+    matches_.push_back(Match{archetype, columns});
+  }
+
+  /**
+   * Gets the number of entities in the view.
+   * \return The number of entities in the view.
+   */
+  snowflake_nodiscard auto size() const noexcept -> SizeType {
+    SizeType size = 0;
+    for (const auto& match : matches_) {
+      size += match.archetype->size();
+    }
+    return size;
+  }
+
+  /**
+   * Gets the number of archetypes which match the view.
+   * \return The number of matching archetypes.
+   */
+  snowflake_nodiscard auto archetypes() const noexcept -> SizeType {
+    return matches_.size();
+  }
+
+  /**
+   * Applies the \p functor to each entity in the view, and all of the
+   * components in the view for the entity. The functor can either take the
+   * entity followed by the components, or just the components.
+   *
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each(Functor&& functor) const -> void {
+    for (const auto& match : matches_) {
+      for (SizeType c = 0; c < match.archetype->chunks(); ++c) {
+        each_in_chunk(match, c, functor);
+      }
+    }
+  }
+
+  /**
+   * Applies the \p functor to each entity in the view, and all of the
+   * components in the view for the entity, in parallel, using the threads in
+   * the \p pool. Each chunk is processed by a single thread.
+   *
+   * \note The functor may be invoked concurrently, and must not add or remove
+   *       components.
+   *
+   * \param  pool    The thread pool to execute the functor with.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto parallel_for_each(ThreadPool& pool, Functor&& functor) const -> void {
+    std::vector<std::pair<const Match*, SizeType>> chunks;
+    for (const auto& match : matches_) {
+      for (SizeType c = 0; c < match.archetype->chunks(); ++c) {
+        chunks.emplace_back(&match, c);
+      }
+    }
+    pool.parallel_for(0, chunks.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        each_in_chunk(*chunks[i].first, chunks[i].second, functor);
+      }
+    });
+  }
+
+ private:
+  std::vector<Match> matches_ = {}; //!< Matching archetypes.
+
+  /**
+   * Applies the \p functor to each entity in the \p chunk of the archetype
+   * in the \p match.
+   * \param  match   The matching archetype.
+   * \param  chunk   The index of the chunk.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  static auto
+  each_in_chunk(const Match& match, SizeType chunk, Functor& functor) -> void {
+    each_in_chunk(
+      match, chunk, functor, std::make_index_sequence<sizeof...(Components)>());
+  }
+
+  /**
+   * Implementation of each_in_chunk, with the indices of the components.
+   * \param  match   The matching archetype.
+   * \param  chunk   The index of the chunk.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   * \tparam Is      The indices of the components.
+   */
+  template <typename Functor, size_t... Is>
+  static auto each_in_chunk(
+    const Match& match,
+    SizeType     chunk,
+    Functor&     functor,
+    std::index_sequence<Is...>) -> void {
+    const auto*    archetype = match.archetype;
+    const Entity*  entities  = archetype->entities(chunk);
+    const SizeType rows      = archetype->rows(chunk);
+    auto           columns   = std::make_tuple(static_cast<Components*>(
+      archetype->column_data(match.columns[Is], chunk))...);
+
+    for (SizeType r = 0; r < rows; ++r) {
+      if constexpr (std::is_invocable_v<Functor, Entity, Components&...>) {
+        functor(entities[r], std::get<Is>(columns)[r]...);
+      } else {
+        functor(std::get<Is>(columns)[r]...);
+      }
+    }
+  }
+};
+
+/**
+ * Manager for entities and components which stores components in
+ * archetypes, as an alternative to the sparse set based EntityManager, with
+ * the same interface for creating and recycling entities, adding, removing
+ * and accessing components, and iterating over views.
+ *
+ * All entities with the same set of components are stored in the same
+ * archetype, in chunks with a column for each component, so systems which
+ * access many components of each entity get the best possible locality.
+ * The trade off is that adding or removing a component moves all of the
+ * entity's components to a different archetype.
+ *
+ * Archetypes are matched against views with a bitmask of the components.
+ *
+ * \note Components must be move constructible.
+ *
+ * \tparam Entity The type of the entities to manage.
+ */
+template <typename Entity>
+class ArchetypeManager {
+  // clang-format off
+  /** Defines the type of the archetypes. */
+  using ArchetypeType = Archetype<Entity>;
+  /** Defines the type of a row in an archetype. */
+  using Row           = typename ArchetypeType::Row;
+  /** Defines the type of the container of archetypes. */
+  using Archetypes    = std::vector<std::unique_ptr<ArchetypeType>>;
+  /** Defines the type of the map from masks to archetypes. */
+  using ArchetypeMap  = std::unordered_map<ArchetypeMask, ArchetypeType*>;
+  /** Defines the type of the container for component indices. */
+  using Indices       = std::vector<uint16_t>;
+  /** Defines the type of the entities. */
+  using Entities      = std::vector<Entity>;
+  // clang-format on
+
+  /** Defines the value of an unregistered component index. */
+  static constexpr uint16_t no_index = std::numeric_limits<uint16_t>::max();
+
+  /**
+   * Location of an entity.
+   */
+  struct Location {
+    ArchetypeType* archetype = nullptr; //!< Archetype for the entity.
+    Row            row       = {};      //!< Row of the entity.
+  };
+
+ public:
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Default constructor, which creates the archetype for entities with no
+   * components.
+   */
+  ArchetypeManager() : root_{find_or_create(ArchetypeMask{})} {}
+
+  /*==--- [entities] -------------------------------------------------------==*/
+
+  /**
+   * Creates a new entity.
+   * \return The created entity.
+   */
+  snowflake_nodiscard auto create() -> Entity {
+    Entity entity;
+    create(1, &entity);
+    return entity;
+  }
+
+  /**
+   * Creates \p count entities, writing them to \p out.
+   * \param  count          The number of entities to create.
+   * \param  out            The output iterator to write the entities to.
+   * \tparam OutputIterator The type of the output iterator.
+   * \return The output iterator, one past the last written entity.
+   */
+  template <typename OutputIterator>
+  auto create(size_t count, OutputIterator out) -> OutputIterator {
+    using Id = typename Entity::IdType;
+    for (size_t i = 0; i < count; ++i, ++out) {
+      Entity entity;
+      if (free_ == 0) {
+        entity = entities_.emplace_back(static_cast<Id>(entities_.size()));
+        locations_.emplace_back();
+      } else {
+        entity = Entity{static_cast<Id>(next_)};
+        next_  = entities_[next_];
+        --free_;
+      }
+      locations_[entity] = Location{root_, root_->push(entity)};
+      *out               = entity;
+    }
+    return out;
+  }
+
+  /**
+   * Recycles an entity, and all the components assosciated with it.
+   * \param entity The entity to recycle.
+   */
+  auto recycle(const Entity& entity) -> void {
+    recycle(&entity, &entity + 1);
+  }
+
+  /**
+   * Recycles all the entities in the range [\p first, \p last), and all the
+   * components assosciated with them.
+   * \param  first    An iterator to the first entity to recycle.
+   * \param  last     An iterator to one past the last entity to recycle.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Iterator>
+  auto recycle(Iterator first, Iterator last) -> void {
+    using Id = typename Entity::IdType;
+    for (; first != last; ++first) {
+      const Entity entity = *first;
+      auto&        loc    = locations_[entity];
+      assert(loc.archetype != nullptr && "Entity is not active!");
+      relocate(loc.archetype->erase(loc.row), loc.row);
+      loc = Location{};
+
+      entities_[entity] = Entity{static_cast<Id>(next_)};
+      next_             = static_cast<size_t>(entity);
+      ++free_;
+    }
+  }
+
+  /**
+   * Returns the number of entities that have been created.
+   * \return The number of created entities.
+   */
+  snowflake_nodiscard auto entities_created() const noexcept -> size_t {
+    return entities_.size();
+  }
+
+  /**
+   * Returns the number of active entities.
+   * \return The number of active entities.
+   */
+  snowflake_nodiscard auto entities_active() const noexcept -> size_t {
+    return entities_created() - free_;
+  }
+
+  /**
+   * Gets the number of free entities which can be created without any
+   * allocation.
+   * \return The number of free entities.
+   */
+  snowflake_nodiscard auto entities_free() const noexcept -> size_t {
+    return free_;
+  }
+
+  /*==--- [components] -----------------------------------------------------==*/
+
+  /**
+   * Emplaces a component for the \p entity, which moves the entity to the
+   * archetype with the component.
+   *
+   * \note If the entity already has the component, this will assert in debug,
+   *       and cause undefined behaviour in release.
+   *
+   * \param  entity    The entity to add a component for.
+   * \param  args      Arguments for the construction of the component.
+   * \tparam Component The type of the component.
+   * \tparam Args      The type of the arguments.
+   */
+  template <typename Component, typename... Args>
+  auto emplace(const Entity& entity, Args&&... args) -> void {
+    const uint16_t index = register_component<Component>();
+    auto&          loc   = locations_[entity];
+    assert(loc.archetype->column(index) < 0 && "Entity has component!");
+
+    ArchetypeType* target = neighbour(loc.archetype, index, true);
+    const Row      row    = target->push(entity);
+    new (target->component(target->column(index), row))
+      Component(make_component<Component>(std::forward<Args>(args)...));
+    move_entity(loc, target, row);
+  }
+
+  /**
+   * Removes the component of type \p Component from the \p entity, which
+   * moves the entity to the archetype without the component.
+   *
+   * \note If the entity does not have the component, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \param  entity    The entity to remove the component from.
+   * \tparam Component The type of the component to remove.
+   */
+  template <typename Component>
+  auto remove(const Entity& entity) -> void {
+    const uint16_t index = register_component<Component>();
+    auto&          loc   = locations_[entity];
+    assert(loc.archetype->column(index) >= 0 && "Entity has no component!");
+
+    ArchetypeType* target = neighbour(loc.archetype, index, false);
+    move_entity(loc, target, target->push(entity));
+  }
+
+  /**
+   * Determines if the \p entity has the \p Component.
+   * \param  entity    The entity to check.
+   * \tparam Component The type of the component.
+   * \return __true__ if the entity has the component.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto has(const Entity& entity) const -> bool {
+    const uint16_t index = find_component<Component>();
+    return index != no_index &&
+           locations_[entity].archetype->column(index) >= 0;
+  }
+
+  /**
+   * Gets a reference to the component for the entity.
+   *
+   * \note If the entity does not have the component, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \param  entity    The entity to get the component for.
+   * \tparam Component The type of the component.
+   * \return A reference to the component for the entity.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto get(const Entity& entity) -> Component& {
+    return *static_cast<Component*>(component<Component>(entity));
+  }
+
+  /**
+   * Gets a const reference to the component for the entity.
+   *
+   * \note If the entity does not have the component, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \param  entity    The entity to get the component for.
+   * \tparam Component The type of the component.
+   * \return A const reference to the component for the entity.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto
+  get(const Entity& entity) const -> const Component& {
+    return *static_cast<const Component*>(component<Component>(entity));
+  }
+
+  /**
+   * Returns the number of components of the Component type.
+   * \tparam Component The type of the component to get the size of.
+   * \return The number of component of type Component.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto size() const -> size_t {
+    return view<const Component>().size();
+  }
+
+  /**
+   * Gets the number of archetypes in the manager.
+   * \return The number of archetypes.
+   */
+  snowflake_nodiscard auto archetypes() const noexcept -> size_t {
+    return archetypes_.size();
+  }
+
+  /*==--- [views] ----------------------------------------------------------==*/
+
+  /**
+   * Creates a view over all entities which have *all* of the \p Components.
+   * \tparam Components The types of the components for the view.
+   * \return A view over the entities with all the components.
+   */
+  template <typename... Components>
+  snowflake_nodiscard auto view() -> ArchetypeView<Entity, Components...> {
+    return make_view<Components...>();
+  }
+
+  /**
+   * Creates a const view over all entities which have *all* of the
+   * \p Components.
+   * \tparam Components The types of the components for the view.
+   * \return A view over the entities with all the components.
+   */
+  template <typename... Components>
+  snowflake_nodiscard auto
+  view() const -> ArchetypeView<Entity, const Components...> {
+    return make_view<const Components...>();
+  }
+
+ private:
+  Archetypes                 archetypes_      = {}; //!< All archetypes.
+  ArchetypeMap               archetype_map_   = {}; //!< Archetypes by mask.
+  std::vector<ComponentInfo> infos_           = {}; //!< Component infos.
+  Indices                    static_indices_  = {}; //!< Static components.
+  Indices                    dynamic_indices_ = {}; //!< Dynamic components.
+  Entities                   entities_        = {}; //!< All entities.
+  std::vector<Location>      locations_       = {}; //!< Entity locations.
+  ArchetypeType*             root_            = nullptr; //!< No components.
+  size_t next_ = Entity::null_id; //!< Index of the next entity.
+  size_t free_ = 0;               //!< Number of recycled entities.
+
+  /**
+   * Gets the container of indices for the \p Component.
+   * \tparam Component The type of the component.
+   * \return A reference to the indices for the component.
+   */
+  template <typename Component>
+  auto indices() const noexcept -> const Indices& {
+    return constexpr_component_id_v<Component> ? static_indices_
+                                               : dynamic_indices_;
+  }
+
+  /**
+   * Gets the container of indices for the \p Component.
+   * \tparam Component The type of the component.
+   * \return A reference to the indices for the component.
+   */
+  template <typename Component>
+  auto indices() noexcept -> Indices& {
+    return constexpr_component_id_v<Component> ? static_indices_
+                                               : dynamic_indices_;
+  }
+
+  /**
+   * Finds the index of the \p Component in the archetype masks.
+   * \tparam Component The type of the component.
+   * \return The index of the component, or no_index if the component is not
+   *         registered.
+   */
+  template <typename Component>
+  auto find_component() const -> uint16_t {
+    const auto  id      = component_id<std::decay_t<Component>>();
+    const auto& indices = this->indices<std::decay_t<Component>>();
+    return id < indices.size() ? indices[id] : no_index;
+  }
+
+  /**
+   * Registers the \p Component, if it is not registered.
+   * \tparam Component The type of the component.
+   * \return The index of the component in the archetype masks.
+   */
+  template <typename Component>
+  auto register_component() -> uint16_t {
+    const auto id      = component_id<Component>();
+    auto&      indices = this->indices<Component>();
+    if (id >= indices.size()) {
+      indices.resize(id + 1, no_index);
+    }
+    if (indices[id] == no_index) {
+      assert(
+        infos_.size() < archetype_max_components &&
+        "Too many components for archetypes!");
+      indices[id] = static_cast<uint16_t>(infos_.size());
+      infos_.push_back(ComponentInfo::make<Component>());
+    }
+    return indices[id];
+  }
+
+  /**
+   * Gets a pointer to the \p Component for the \p entity.
+   * \param  entity    The entity to get the component for.
+   * \tparam Component The type of the component.
+   * \return A pointer to the component.
+   */
+  template <typename Component>
+  auto component(const Entity& entity) const -> void* {
+    const auto& loc    = locations_[entity];
+    const auto  column = loc.archetype->column(find_component<Component>());
+    assert(column >= 0 && "Entity does not have component!");
+    return loc.archetype->component(column, loc.row);
+  }
+
+  /**
+   * Finds the archetype for the \p mask, creating it if it does not exist.
+   * \param mask The mask of the components for the archetype.
+   * \return A pointer to the archetype.
+   */
+  auto find_or_create(const ArchetypeMask& mask) -> ArchetypeType* {
+    auto& archetype = archetype_map_[mask];
+    if (archetype == nullptr) {
+      archetypes_.push_back(std::make_unique<ArchetypeType>(mask, infos_));
+      archetype = archetypes_.back().get();
+    }
+    return archetype;
+  }
+
+  /**
+   * Gets the archetype which has the components in the \p archetype, with
+   * the component at \p index added or removed.
+   * \param archetype The archetype to get the neighbour of.
+   * \param index     The index of the component to add or remove.
+   * \param add       If the component is added.
+   * \return A pointer to the neighbouring archetype.
+   */
+  auto neighbour(ArchetypeType* archetype, uint16_t index, bool add)
+    -> ArchetypeType* {
+    auto& edge = archetype->edge(index, add);
+    if (edge == nullptr) {
+      edge = find_or_create(ArchetypeMask{archetype->mask()}.set(index, add));
+      edge->edge(index, !add) = archetype;
+    }
+    return edge;
+  }
+
+  /**
+   * Moves the entity at the location \p loc to the \p row in the
+   * \p target archetype, which must already be pushed.
+   * \param loc    The current location of the entity.
+   * \param target The archetype to move the entity to.
+   * \param row    The row in the target archetype.
+   */
+  auto move_entity(Location& loc, ArchetypeType* target, Row row) -> void {
+    target->move_from(row, *loc.archetype, loc.row);
+    relocate(loc.archetype->erase(loc.row), loc.row);
+    loc = Location{target, row};
+  }
+
+  /**
+   * Updates the location of the \p moved entity, which was moved into the
+   * \p row of its archetype.
+   * \param moved The entity which was moved, which may be invalid.
+   * \param row   The row the entity was moved to.
+   */
+  auto relocate(const Entity& moved, Row row) noexcept -> void {
+    if (!moved.invalid()) {
+      locations_[moved].row = row;
+    }
+  }
+
+  /**
+   * Makes a view over the archetypes which have all the \p Components.
+   * \tparam Components The types of the components for the view.
+   * \return The view over the archetypes.
+   */
+  template <typename... Components>
+  auto make_view() const -> ArchetypeView<Entity, Components...> {
+    ArchetypeView<Entity, Components...> view;
+    const std::array<uint16_t, sizeof...(Components)> indices = {
+      find_component<Components>()...};
+
+    ArchetypeMask mask;
+    for (const auto index : indices) {
+      if (index == no_index) {
+        return view;
+      }
+      mask.set(index);
+    }
+
+    for (const auto& archetype : archetypes_) {
+      if ((archetype->mask() & mask) != mask || archetype->size() == 0) {
+        continue;
+      }
+      std::array<int16_t, sizeof...(Components)> columns;
+      for (size_t i = 0; i < indices.size(); ++i) {
+        columns[i] = archetype->column(indices[i]);
+      }
+      view.add(archetype.get(), columns);
+    }
+    return view;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_ARCHETYPE_MANAGER_HPP
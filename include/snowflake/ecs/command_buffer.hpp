@@ -0,0 +1,480 @@
+//==--- snowflake/ecs/command_buffer.hpp ------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  command_buffer.hpp
+/// \brief This file defines a buffer of deferred structural changes to an
+///        entity manager.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_COMMAND_BUFFER_HPP
+#define SNOWFLAKE_ECS_COMMAND_BUFFER_HPP
+
+#include "entity_manager.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Defines the size of the blocks in the arena for the command buffer, in
+ * bytes.
+ */
+static constexpr size_t command_block_size =
+#if defined(SNOWFLAKE_COMMAND_BLOCK_SIZE)
+  SNOWFLAKE_COMMAND_BLOCK_SIZE;
+#else
+  16 * 1024;
+#endif
+
+/**
+ * Buffer which records structural changes to an entity manager (creation and
+ * destruction of entities, and emplacement and removal of components), so
+ * that they can be applied later, at a sync point.
+ *
+ * The manager is not thread safe, so systems which run in parallel should
+ * each record into their own buffer (i.e one per thread, indexed with
+ * ThreadPool::thread_index()), which requires no synchronization. The buffers
+ * are then applied together, when nothing else is using the manager.
+ *
+ * Components which are emplaced are constructed into a linear arena in the
+ * buffer, which is reused after the buffer is applied, so recording does not
+ * allocate once the buffer has grown to its working size.
+ *
+ * Entities which are created by the buffer are only created when the buffer is
+ * applied, so create() returns a pending entity, which can be used with the
+ * other commands in the *same* buffer, and can be resolved to the created
+ * entity after the buffer is applied.
+ *
+ * When applied, the commands from all buffers are applied in batches, in the
+ * following order:
+ *
+ *   1. Entities are created.
+ *   2. Components are removed, sorted by component and then entity.
+ *   3. Components are emplaced, sorted by component and then entity.
+ *   4. Entities are destroyed, along with all their components.
+ *
+ * so each pool is accessed in a single batch, in order of entity. Removing a
+ * component which the entity doesn't have does nothing, and emplacing a
+ * component which the entity already has replaces it. If the same component
+ * is emplaced multiple times for an entity, the last one which was recorded
+ * is kept.
+ *
+ * \tparam Entity    The type of the entities.
+ * \tparam Allocator The type of the allocator for the manager.
+ */
+template <
+  typename Entity,
+  typename Allocator = wrench::ObjectPoolAllocator<Entity>>
+class CommandBuffer {
+  // clang-format off
+  /** Defines the type of the id for the entities. */
+  using IdType  = typename Entity::IdType;
+  /** Defines the type of the manager. */
+  using Manager = EntityManager<Entity, Allocator>;
+  // clang-format on
+
+  /**
+   * Command to apply to the manager, for an entity, which is either an
+   * existing entity or an entity which is pending creation by the buffer.
+   */
+  struct Command {
+    /** Defines the type of the function to apply a batch of commands. */
+    using BatchFn   = void (*)(Manager&, const Command*, const Command*);
+    /** Defines the type of the function to destroy the payload. */
+    using DestroyFn = void (*)(void*);
+
+    BatchFn   batch   = nullptr; //!< Applies a batch of commands.
+    DestroyFn destroy = nullptr; //!< Destroys the payload, if not applied.
+    void*     payload = nullptr; //!< Component for the command.
+    uint32_t  key     = 0;       //!< Key for the component.
+    IdType    target  = 0;       //!< Entity or pending entity index.
+    bool      pending = false;   //!< If the target is pending creation.
+  };
+
+  /**
+   * Block of memory in the arena.
+   */
+  struct Block {
+    std::unique_ptr<std::byte[]> data = nullptr; //!< Data for the block.
+    size_t                       size = 0;       //!< Size of the block.
+  };
+
+  // clang-format off
+  /** Defines the type of the container for commands. */
+  using Commands = std::vector<Command>;
+  /** Defines the type of the container for arena blocks. */
+  using Blocks   = std::vector<Block>;
+  /** Defines the type of the container for entities. */
+  using Entities = std::vector<Entity>;
+  // clang-format on
+
+ public:
+  /**
+   * Handle to an entity which is pending creation by the buffer.
+   */
+  struct Pending {
+    IdType index = 0; //!< Index of the entity in the created entities.
+  };
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /** Default constructor. */
+  CommandBuffer() noexcept = default;
+
+  /**
+   * Destructor, which destroys any components which were not applied.
+   */
+  ~CommandBuffer() noexcept {
+    clear();
+  }
+
+  /** Move constructor -- defaulted. */
+  CommandBuffer(CommandBuffer&&) noexcept = default;
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  /** Copy constructor -- deleted. */
+  CommandBuffer(const CommandBuffer&) = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const CommandBuffer&) = delete;
+  /** Move assignment -- deleted, since it would leak unapplied commands. */
+  auto operator=(CommandBuffer&&) = delete;
+
+  /*==--- [recording] ------------------------------------------------------==*/
+
+  /**
+   * Records the creation of an entity.
+   * \return A handle to the entity which will be created.
+   */
+  auto create() noexcept -> Pending {
+    return Pending{pending_++};
+  }
+
+  /**
+   * Records the destruction of the \p entity, and all of its components.
+   * \param entity The entity to destroy.
+   */
+  auto destroy(const Entity& entity) -> void {
+    destroys_.push_back(make_command(entity));
+  }
+
+  /**
+   * Records the destruction of the \p entity pending creation.
+   * \param entity The pending entity to destroy.
+   */
+  auto destroy(Pending entity) -> void {
+    destroys_.push_back(make_command(entity));
+  }
+
+  /**
+   * Records the emplacement of a component for the \p entity, which is
+   * constructed from the \p args into the buffer.
+   *
+   * \param  entity    The entity to emplace the component for.
+   * \param  args      The arguments for the construction of the component.
+   * \tparam Component The type of the component.
+   * \tparam Target    The type of the entity, or pending entity.
+   * \tparam Args      The types of the arguments.
+   */
+  template <typename Component, typename Target, typename... Args>
+  auto emplace(const Target& entity, Args&&... args) -> void {
+    void* data = allocate(sizeof(Component), alignof(Component));
+    new (data)
+      Component(make_component<Component>(std::forward<Args>(args)...));
+
+    Command command = make_command(entity);
+    command.batch   = &emplace_batch<Component>;
+    command.payload = data;
+    command.key     = component_key<Component>();
+    if constexpr (!std::is_trivially_destructible_v<Component>) {
+      command.destroy = [](void* p) {
+        static_cast<Component*>(p)->~Component();
+      };
+    }
+    emplaces_.push_back(command);
+  }
+
+  /**
+   * Records the removal of a component from the \p entity.
+   * \param  entity    The entity to remove the component from.
+   * \tparam Component The type of the component.
+   * \tparam Target    The type of the entity, or pending entity.
+   */
+  template <typename Component, typename Target>
+  auto remove(const Target& entity) -> void {
+    Command command = make_command(entity);
+    command.batch   = &remove_batch<Component>;
+    command.key     = component_key<Component>();
+    removes_.push_back(command);
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Determines if the buffer has no commands.
+   * \return __true__ if there are no commands in the buffer.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return pending_ == 0 && destroys_.empty() && emplaces_.empty() &&
+           removes_.empty();
+  }
+
+  /**
+   * Gets the entity which was created for the \p pending entity, the last
+   * time that the buffer was applied.
+   *
+   * \note If the pending entity was not created by the last application of
+   *       the buffer, this will assert in debug, and cause undefined
+   *       behaviour in release.
+   *
+   * \param pending The pending entity to get the created entity for.
+   * \return The entity which was created.
+   */
+  snowflake_nodiscard auto resolve(Pending pending) const noexcept -> Entity {
+    assert(pending.index < created_.size() && "Invalid pending entity!");
+    return created_[pending.index];
+  }
+
+  /**
+   * Removes all the commands from the buffer, without applying them.
+   */
+  auto clear() noexcept -> void {
+    for (auto& command : emplaces_) {
+      if (command.destroy != nullptr) {
+        command.destroy(command.payload);
+      }
+    }
+    reset();
+  }
+
+  /**
+   * Applies the commands in the buffer to the \p manager, and then clears
+   * the buffer.
+   * \param manager The manager to apply the commands to.
+   */
+  auto apply(Manager& manager) -> void {
+    apply(manager, this, this + 1);
+  }
+
+  /**
+   * Applies the commands in all buffers in the range [\p first, \p last) to
+   * the \p manager, in batches, and then clears the buffers.
+   *
+   * \param  manager  The manager to apply the commands to.
+   * \param  first    An iterator to the first buffer to apply.
+   * \param  last     An iterator to one past the last buffer to apply.
+   * \tparam Iterator The type of the iterator over the buffers.
+   */
+  template <typename Iterator>
+  static auto apply(Manager& manager, Iterator first, Iterator last) -> void {
+    Commands removes, emplaces, destroys;
+    for (auto it = first; it != last; ++it) {
+      CommandBuffer& buffer = *it;
+      buffer.created_.resize(buffer.pending_);
+      manager.create(buffer.created_.size(), buffer.created_.begin());
+      buffer.gather(removes, buffer.removes_);
+      buffer.gather(emplaces, buffer.emplaces_);
+      buffer.gather(destroys, buffer.destroys_);
+    }
+
+    apply_batches(manager, removes);
+    apply_batches(manager, emplaces);
+
+    Entities recycled;
+    recycled.reserve(destroys.size());
+    for (const auto& command : destroys) {
+      recycled.emplace_back(command.target);
+    }
+    std::sort(recycled.begin(), recycled.end());
+    recycled.erase(
+      std::unique(recycled.begin(), recycled.end()), recycled.end());
+    manager.recycle(recycled.begin(), recycled.end());
+
+    // The components have been moved from and destroyed, so just reset.
+    for (auto it = first; it != last; ++it) {
+      (*it).reset();
+    }
+  }
+
+ private:
+  Commands removes_  = {}; //!< Commands to remove components.
+  Commands emplaces_ = {}; //!< Commands to emplace components.
+  Commands destroys_ = {}; //!< Commands to destroy entities.
+  Entities created_  = {}; //!< Entities created by the last apply.
+  Blocks   blocks_   = {}; //!< Blocks for the arena.
+  size_t   block_    = 0;  //!< Index of the current block.
+  size_t   offset_   = 0;  //!< Offset into the current block.
+  IdType   pending_  = 0;  //!< Number of pending entities.
+
+  /**
+   * Makes a command for an existing \p entity.
+   * \param entity The entity for the command.
+   * \return The command for the entity.
+   */
+  static auto make_command(const Entity& entity) noexcept -> Command {
+    Command command;
+    command.target = static_cast<IdType>(entity);
+    return command;
+  }
+
+  /**
+   * Makes a command for a pending \p entity.
+   * \param entity The pending entity for the command.
+   * \return The command for the entity.
+   */
+  auto make_command(Pending entity) const noexcept -> Command {
+    assert(entity.index < pending_ && "Invalid pending entity!");
+    Command command;
+    command.target  = entity.index;
+    command.pending = true;
+    return command;
+  }
+
+  /**
+   * Orders commands by component, and then by entity.
+   * \param a The first command to compare.
+   * \param b The second command to compare.
+   * \return __true__ if \p a is ordered before \p b.
+   */
+  static auto less(const Command& a, const Command& b) noexcept -> bool {
+    return a.key != b.key ? a.key < b.key : a.target < b.target;
+  }
+
+  /**
+   * Appends the \p commands to the \p all commands, resolving pending
+   * entities to the created entities.
+   * \param all      The container to append to.
+   * \param commands The commands to append.
+   */
+  auto gather(Commands& all, const Commands& commands) const -> void {
+    for (auto command : commands) {
+      if (command.pending) {
+        command.target  = static_cast<IdType>(created_[command.target]);
+        command.pending = false;
+      }
+      all.push_back(command);
+    }
+  }
+
+  /**
+   * Sorts the \p commands and applies them to the \p manager, with one batch
+   * for each component.
+   * \param manager  The manager to apply the commands to.
+   * \param commands The commands to apply.
+   */
+  static auto apply_batches(Manager& manager, Commands& commands) -> void {
+    // Stable, so that the last command for an entity is applied last.
+    std::stable_sort(commands.begin(), commands.end(), less);
+    for (auto it = commands.begin(); it != commands.end();) {
+      auto end = std::find_if(it, commands.end(), [&](const auto& command) {
+        return command.key != it->key;
+      });
+      it->batch(manager, &*it, &*it + (end - it));
+      it = end;
+    }
+  }
+
+  /**
+   * Emplaces the components for a batch of commands into the pool for the
+   * \p Component.
+   * \param  manager   The manager to emplace the components into.
+   * \param  first     A pointer to the first command in the batch.
+   * \param  last      A pointer to one past the last command in the batch.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto
+  emplace_batch(Manager& manager, const Command* first, const Command* last)
+    -> void {
+    auto& pool = manager.template ensure_component<Component>();
+    pool.reserve(pool.size() + static_cast<size_t>(last - first));
+    for (; first != last; ++first) {
+      auto*        component = static_cast<Component*>(first->payload);
+      const Entity entity{first->target};
+      if (pool.exists(entity)) {
+        pool.replace(manager, entity, std::move(*component));
+      } else {
+        pool.emplace(manager, entity, std::move(*component));
+      }
+      component->~Component();
+    }
+  }
+
+  /**
+   * Removes the components for a batch of commands from the pool for the
+   * \p Component.
+   * \param  manager   The manager to remove the components from.
+   * \param  first     A pointer to the first command in the batch.
+   * \param  last      A pointer to one past the last command in the batch.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto
+  remove_batch(Manager& manager, const Command* first, const Command* last)
+    -> void {
+    auto& pool = manager.template ensure_component<Component>();
+    for (; first != last; ++first) {
+      const Entity entity{first->target};
+      if (pool.exists(entity)) {
+        pool.remove(manager, entity);
+      }
+    }
+  }
+
+  /**
+   * Allocates \p bytes bytes with the given \p alignment from the arena.
+   * \param bytes     The number of bytes to allocate.
+   * \param alignment The alignment of the allocation.
+   * \return A pointer to the allocated memory.
+   */
+  auto allocate(size_t bytes, size_t alignment) -> void* {
+    while (true) {
+      for (; block_ < blocks_.size(); ++block_, offset_ = 0) {
+        auto&           block = blocks_[block_];
+        const uintptr_t base  = reinterpret_cast<uintptr_t>(block.data.get());
+        const uintptr_t start = (base + offset_ + alignment - 1) &
+                                ~uintptr_t{alignment - 1};
+        const size_t offset = static_cast<size_t>(start - base);
+        if (offset + bytes <= block.size) {
+          offset_ = offset + bytes;
+          return block.data.get() + offset;
+        }
+      }
+
+      // Blocks are appended so that earlier blocks are reused first.
+      const size_t size = std::max(command_block_size, bytes + alignment);
+      auto& block = blocks_.emplace_back();
+      block.data.reset(new std::byte[size]);
+      block.size = size;
+      block_ = blocks_.size() - 1;
+    }
+  }
+
+  /**
+   * Resets the buffer, without destroying any components.
+   */
+  auto reset() noexcept -> void {
+    removes_.clear();
+    emplaces_.clear();
+    destroys_.clear();
+    pending_ = 0;
+    block_   = 0;
+    offset_  = 0;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_COMMAND_BUFFER_HPP
@@ -16,6 +16,7 @@
 #ifndef SNOWFLAKE_ECS_COMPONENT_ID_HPP
 #define SNOWFLAKE_ECS_COMPONENT_ID_HPP
 
+#include <atomic>
 #include <cstdint>
 #include <limits>
 #include <snowflake/util/portability.hpp>
@@ -55,8 +56,10 @@ struct ComponentIdDynamic {
    * \return The next valid *runtime* id for a component.
    */
   snowflake_nodiscard static auto next() noexcept -> Type {
-    static Type current{start_id};
-    return current++;
+    // Ids may be requested for the first time from multiple threads, i.e when
+    // recording commands, so this needs to be atomic.
+    static std::atomic<Type> current{start_id};
+    return current.fetch_add(1, std::memory_order_relaxed);
   }
 };
 
@@ -167,6 +170,18 @@ static auto component_id() -> uint16_t {
   return component_id_traits_t<T>::id();
 }
 
+/**
+ * Returns a key for the component which is unique among *all* components,
+ * since static and dynamic component ids can have the same value.
+ * \tparam T The component to get the key for.
+ */
+template <typename T>
+static auto component_key() -> uint32_t {
+  constexpr uint32_t dynamic_bit =
+    component_id_traits_t<T>::is_static ? 0 : 0x10000;
+  return dynamic_bit | uint32_t{component_id<T>()};
+}
+
 /**
  * True if the type T has a constexpr component id value, false otherwise.
  * \tparam T The type to check if has a constexpr compononent id value.
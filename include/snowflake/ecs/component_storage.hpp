@@ -16,10 +16,30 @@
 #ifndef SNOWFLAKE_ECS_COMPONENT_STORAGE_HPP
 #define SNOWFLAKE_ECS_COMPONENT_STORAGE_HPP
 
+#include "component_traits.hpp"
 #include "sparse_set.hpp"
+#include <snowflake/util/paged_vector.hpp>
+#include <snowflake/util/radix_sort.hpp>
+#include <snowflake/util/relocating_vector.hpp>
+#include <snowflake/util/thread_pool.hpp>
+#include <utility>
 
 namespace snowflake {
 
+/**
+ * Defines the size of the pages for components which are stored in pages,
+ * which is the number of components in a page, *not* the byte size of the
+ * page.
+ *
+ * \see PagedStorage
+ */
+static constexpr size_t component_page_size =
+#if defined(SNOWFLAKE_COMPONENT_PAGE_SIZE)
+  SNOWFLAKE_COMPONENT_PAGE_SIZE;
+#else
+  1 << 10;
+#endif
+
 /**
  * Implemenatation of a storage class for components. This is essentially just
  * a wrapper around a SparseSet which stores the entities and components such
@@ -30,7 +50,16 @@ namespace snowflake {
  *
  * \note The order of insertion into the container is not preserved.
  *
- * \see SparseSet
+ * If the component is specialized for PagedStorage, the components are stored
+ * in pages of component_page_size components which are never relocated,
+ * rather than in a single contiguous array. The reverse iterators are then
+ * pointer-like objects which support indexing, rather than pointers.
+ *
+ * Otherwise, if the component is Relocatable, the components are stored in a
+ * RelocatingVector, so that growth, erasure and swaps copy the bytes of the
+ * components rather than moving them one by one.
+ *
+ * \see SparseSet, PagedStorage, Relocatable
  *
  * \tparam Entity The type of the entity.
  * \tparam Component The type of the component.
@@ -45,7 +74,13 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
   /** Storage type for the entities */
   using Entities   = SparseSet<Entity, EntityAllocator>;
   /** Defines the type for the components. */
-  using Components = std::vector<Component>;
+  using Components = std::conditional_t<
+    paged_storage_v<Component>,
+    PagedVector<Component, component_page_size>,
+    std::conditional_t<
+      relocatable_v<Component>,
+      RelocatingVector<Component>,
+      std::vector<Component>>>;
   // clang-format on
 
  public:
@@ -57,9 +92,11 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
   /** The const iterator type for the components. */
   using ConstIterator        = ReverseIterator<Components, true>;
   /** The reverse iterator type for the components. */
-  using ReverseIterator      = Component*;
+  using ReverseIterator      =
+    decltype(std::declval<Components&>().data());
   /** The const reverse iterator type for the components. */
-  using ConstReverseIterator = const Component*;
+  using ConstReverseIterator =
+    decltype(std::declval<const Components&>().data());
   // clang-format on
 
   /** The page size for the storage. */
@@ -101,32 +138,107 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
     // Many components are aggregates, and emplace back doesn't work with
     // aggregates, so we need to differentiate.
     if constexpr (std::is_aggregate_v<Component>) {
-      if constexpr (constexpr_component_id_v<Component>) {
-        components_.push_back(Component{{}, std::forward<Args>(args)...});
-      } else {
-        components_.push_back(Component{std::forward<Args>(args)...});
-      }
+      components_.push_back(
+        make_component<Component>(std::forward<Args>(args)...));
     } else {
       components_.emplace_back(std::forward<Args>(args)...);
     }
     Entities::emplace(entity);
   }
 
+  /**
+   * Inserts components for all the entities in the range [\p first,
+   * \p last).
+   *
+   * If \p source is convertible to the component type then each entity is
+   * given a copy of it, otherwise \p source must be an iterator to the
+   * components for each of the entities, in the same order as the entities.
+   *
+   * The component array is grown once, and for trivially copyable components
+   * with contiguous sources this is a single bulk copy.
+   *
+   * \note If any entity is already assosciated with this component, then this
+   *       will cause undefined behaviour in release, or assert in debug.
+   *
+   * \param  first    An iterator to the first entity to insert.
+   * \param  last     An iterator to one past the last entity to insert.
+   * \param  source   A component to copy, or an iterator to the components.
+   * \tparam Iterator The type of the entity iterator, which must be a forward
+   *                  iterator.
+   * \tparam Source   The type of the component or component iterator.
+   */
+  template <typename Iterator, typename Source>
+  auto insert(Iterator first, Iterator last, Source&& source) -> void {
+    const auto count = static_cast<SizeType>(std::distance(first, last));
+    if constexpr (std::is_same_v<Components, std::vector<Component>>) {
+      if constexpr (std::is_convertible_v<Source, const Component&>) {
+        components_.insert(components_.end(), count, source);
+      } else {
+        components_.insert(
+          components_.end(), source, std::next(source, count));
+      }
+    } else if constexpr (std::is_convertible_v<Source, const Component&>) {
+      components_.append(count, source);
+    } else {
+      components_.append(source, std::next(source, count));
+    }
+    Entities::insert(first, last);
+  }
+
   /**
    * Removes the component assosciated with the entity from the storage.
    *
    * \note If the entity does not exist then this will assert in debug builds,
    *       while in release builds it will cause undefined behaviour.
    *
+   * \note For relocatable components which are stored contiguously, the back
+   *       component is relocated into the place of the removed one with a
+   *       single copy of its bytes.
+   *
    * \param entity The entity to remove.
    */
   auto erase(const Entity& entity) noexcept -> void {
-    auto back                            = std::move(components_.back());
-    components_[Entities::index(entity)] = std::move(back);
-    components_.pop_back();
+    if constexpr (std::is_same_v<Components, RelocatingVector<Component>>) {
+      components_.erase_unordered(Entities::index(entity));
+    } else {
+      auto back                            = std::move(components_.back());
+      components_[Entities::index(entity)] = std::move(back);
+      components_.pop_back();
+    }
     Entities::erase(entity);
   }
 
+  /**
+   * Removes the components assosciated with all the entities in the range
+   * [\p first, \p last) from the storage.
+   *
+   * \note If any of the entities do not exist then this will assert in debug
+   *       builds, while in release builds it will cause undefined behaviour.
+   *
+   * The entities are removed in a single batch, where the remaining
+   * components at the back are moved into the holes left by the removed
+   * components, and the removed components are then destroyed from the back.
+   *
+   * \param  first    An iterator to the first entity to remove.
+   * \param  last     An iterator to one past the last entity to remove.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Iterator>
+  auto erase(Iterator first, Iterator last) noexcept -> void {
+    Entities::erase(first, last, [&](SizeType from, SizeType to) {
+      // Relocatable components are swapped so that the removed component is
+      // destroyed, rather than the moved from one.
+      if constexpr (relocatable_v<Component>) {
+        swap_components(from, to);
+      } else {
+        components_[to] = std::move(components_[from]);
+      }
+    });
+    while (components_.size() > Entities::size()) {
+      components_.pop_back();
+    }
+  }
+
   /**
    * Swaps two components in the storage.
    *
@@ -139,7 +251,7 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
    * \param b A component to swap with.
    */
   auto swap(const Entity& a, const Entity& b) noexcept -> void {
-    std::swap(components_[Entities::index(a)], components_[Entities::index(b)]);
+    swap_components(Entities::index(a), Entities::index(b));
     Entities::swap(a, b);
   }
 
@@ -246,7 +358,7 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
    *
    * \return An iterator to the least recent entity in the sparse set.
    */
-  snowflake_nodiscard auto rbegin() const noexcept -> ReverseIterator {
+  snowflake_nodiscard auto rbegin() noexcept -> ReverseIterator {
     return components_.data();
   }
 
@@ -260,7 +372,7 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
    *
    * \return An iterator to the least recent entity in the sparse set.
    */
-  snowflake_nodiscard auto rend() const noexcept -> ReverseIterator {
+  snowflake_nodiscard auto rend() noexcept -> ReverseIterator {
     return rbegin() + components_.size();
   }
 
@@ -289,7 +401,49 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
    * \return An iterator to the least recent entity in the sparse set.
    */
   snowflake_nodiscard auto crend() const noexcept -> ConstReverseIterator {
-    return rbegin() + components_.size();
+    return crbegin() + components_.size();
+  }
+
+  /**
+   * Applies the \p functor to each component in the storage, in parallel,
+   * using the threads in the \p pool.
+   *
+   * The components are split into chunks whose boundaries are aligned to
+   * cache lines, so that different threads never write to the same cache
+   * line. Paged components are split on page boundaries, which are aligned to
+   * cache lines. The functor can either take the entity and the component, or
+   * just the component, for example:
+   *
+   * ~~~{.cpp}
+   * storage.parallel_for_each(pool, [] (Entity e, Position& p) { ... });
+   * storage.parallel_for_each(pool, [] (Position& p) { ... });
+   * ~~~
+   *
+   * \note The functor may be invoked concurrently, and must not add or remove
+   *       components from the storage.
+   *
+   * \param  pool    The thread pool to execute the functor with.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto parallel_for_each(ThreadPool& pool, Functor&& functor) -> void {
+    const auto    comps = components_.data();
+    const Entity* ents  = Entities::rbegin();
+    auto          apply = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        if constexpr (std::is_invocable_v<Functor, Entity, Component&>) {
+          functor(ents[i], comps[i]);
+        } else {
+          functor(comps[i]);
+        }
+      }
+    };
+    if constexpr (paged_storage_v<Component>) {
+      pool.parallel_for(0, components_.size(), component_page_size, apply);
+    } else {
+      pool.parallel_for_aligned(comps, components_.size(), apply);
+    }
   }
 
   /*==--- [algorithms] -----------------------------------------------------==*/
@@ -323,12 +477,98 @@ class ComponentStorage : public SparseSet<Entity, EntityAllocator> {
   snowflake_nodiscard auto
   find(const Entity& entity) const noexcept -> ConstIterator {
     return Entities::exists(entity)
-             ? --ConstIterator(end() - Entities::index(entity))
-             : end();
+             ? --ConstIterator(cend() - Entities::index(entity))
+             : cend();
+  }
+
+  /**
+   * Sorts the storage by the key returned by the \p key_fn, so that iterating
+   * from begin() to end() visits the components in ascending order of key.
+   *
+   * The key function returns an arithmetic key (integer or floating point),
+   * and can take the entity and the component, or just the component, for
+   * example:
+   *
+   * ~~~{.cpp}
+   * storage.sort([] (const Renderable& r) { return r.depth; });
+   * storage.sort([] (Entity e, const Body& b) { return b.cell; });
+   * ~~~
+   *
+   * Keys which are nearly sorted are sorted in linear time, otherwise the keys
+   * are radix sorted. The sort is stable, and the components are moved into
+   * place with the minimum number of swaps.
+   *
+   * \note This must not be used on the storage for a component which is owned
+   *       by a group, since the group relies on the order of the storage.
+   *
+   * \param  key_fn The function which returns the key to sort by.
+   * \tparam KeyFn  The type of the key function.
+   */
+  template <typename KeyFn>
+  auto sort(KeyFn&& key_fn) -> void {
+    const SizeType size = components_.size();
+    const Entity*  ents = Entities::rbegin();
+    auto           key  = [&](SizeType i) {
+      if constexpr (std::is_invocable_v<KeyFn, Entity, const Component&>) {
+        return key_fn(ents[i], std::as_const(components_[i]));
+      } else {
+        return key_fn(std::as_const(components_[i]));
+      }
+    };
+    using Key = std::decay_t<decltype(key(0))>;
+
+    // Keys are gathered in iteration order, which is from the back.
+    std::vector<Key> keys(size);
+    for (SizeType i = 0; i < size; ++i) {
+      keys[i] = key(size - 1 - i);
+    }
+
+    std::vector<SizeType> order = radix_sort_order(keys.data(), size);
+    std::vector<SizeType> positions(size);
+    for (SizeType i = 0; i < size; ++i) {
+      positions[size - 1 - i] = size - 1 - order[i];
+    }
+    Entities::arrange(positions, [&](SizeType a, SizeType b) {
+      swap_components(a, b);
+    });
+  }
+
+  /**
+   * Sorts the storage so that the components for entities which are also in
+   * the \p other storage are iterated first, in the same order as the
+   * entities are iterated in the \p other storage. This is useful to sort one
+   * storage by a key, and then to sort other storages which are iterated with
+   * it in the same order.
+   *
+   * \note Components for entities which are not in \p other are iterated
+   *       after those which are, in an unspecified order.
+   *
+   * \param  other          The other storage to sort in the order of.
+   * \tparam OtherAllocator The type of the allocator for the other storage.
+   */
+  template <typename OtherAllocator>
+  auto sort_as(const SparseSet<Entity, OtherAllocator>& other) noexcept
+    -> void {
+    Entities::arrange_as(
+      other, [&](SizeType a, SizeType b) { swap_components(a, b); });
   }
 
  private:
   Components components_ = {}; //!< Container of components.
+
+  /**
+   * Swaps the components at positions \p a and \p b in the component array,
+   * by swapping their bytes if the components are relocatable.
+   * \param a The position of a component to swap.
+   * \param b The position of a component to swap.
+   */
+  auto swap_components(SizeType a, SizeType b) noexcept -> void {
+    if constexpr (relocatable_v<Component>) {
+      relocate_swap(components_[a], components_[b]);
+    } else {
+      std::swap(components_[a], components_[b]);
+    }
+  }
 };
 
 } // namespace snowflake
@@ -0,0 +1,200 @@
+//==--- snowflake/ecs/component_traits.hpp ----------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  component_traits.hpp
+/// \brief This file defines traits for components, which can be specialized
+///        to change how the components are stored.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_COMPONENT_TRAITS_HPP
+#define SNOWFLAKE_ECS_COMPONENT_TRAITS_HPP
+
+#include "component_id.hpp"
+#include <tuple>
+#include <type_traits>
+
+namespace snowflake {
+
+/**
+ * Defines the structure-of-arrays layout for a component. By default
+ * components are stored as an array of structures, and this must be
+ * specialized to store a component as a structure of arrays.
+ *
+ * To enable the layout for an aggregate component, specialize this with a
+ * static constexpr tuple of pointers to the members of the component, each of
+ * which will be stored in its own array, for example:
+ *
+ * ~~~{.cpp}
+ * struct Position {
+ *   float x, y, z;
+ * };
+ *
+ * template <>
+ * struct snowflake::SoaLayout<Position> {
+ *   static constexpr auto fields =
+ *     std::make_tuple(&Position::x, &Position::y, &Position::z);
+ * };
+ * ~~~
+ *
+ * \note The fields should contain *all* the members of the component, since
+ *       any members which are not in the fields are not stored.
+ *
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+struct SoaLayout {};
+
+namespace detail {
+
+/**
+ * Determines if the type T has a structure-of-arrays layout. This overload is
+ * for types which don't.
+ * \tparam T The type to determine if has a soa layout.
+ */
+template <typename T, typename = void>
+struct HasSoaLayout : std::false_type {};
+
+/**
+ * Determines if the type T has a structure-of-arrays layout. This overload is
+ * for types which do.
+ * \tparam T The type to determine if has a soa layout.
+ */
+template <typename T>
+struct HasSoaLayout<T, std::void_t<decltype(SoaLayout<T>::fields)>>
+: std::is_aggregate<T> {};
+
+} // namespace detail
+
+/**
+ * True if the Component has a structure-of-arrays layout.
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+static constexpr bool soa_layout_v = detail::HasSoaLayout<Component>::value;
+
+/**
+ * Defines if changes to a component are tracked. By default changes are not
+ * tracked, and this must be specialized to track them, for example:
+ *
+ * ~~~{.cpp}
+ * template <>
+ * struct snowflake::TrackChanges<Transform> : std::true_type {};
+ * ~~~
+ *
+ * Storage for components whose changes are tracked records the version at
+ * which each component was last mutably accessed, so that only the
+ * components which changed since a given version can be iterated.
+ *
+ * \see TrackedComponentStorage
+ *
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+struct TrackChanges : std::false_type {};
+
+/**
+ * True if changes to the Component are tracked.
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+static constexpr bool track_changes_v = TrackChanges<Component>::value;
+
+/**
+ * Defines if a component is stored in pages which are never relocated. By
+ * default components are stored contiguously, and this must be specialized to
+ * store them in pages, for example:
+ *
+ * ~~~{.cpp}
+ * template <>
+ * struct snowflake::PagedStorage<Body> : std::true_type {};
+ * ~~~
+ *
+ * Growing the storage for paged components never moves the existing
+ * components, so growth has no latency spikes, and pointers and references to
+ * the components remain valid when other components are added. Access is
+ * slightly more expensive, since the page must be found for each component.
+ *
+ * \see component_page_size
+ *
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+struct PagedStorage : std::false_type {};
+
+/**
+ * True if the Component is stored in pages.
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+static constexpr bool paged_storage_v = PagedStorage<Component>::value;
+
+/**
+ * Defines if a component can be relocated by copying its bytes, without
+ * moving it and destroying the original. By default this is the case for
+ * trivially copyable components, and this can be specialized for other
+ * components which do not depend on their own address, for example:
+ *
+ * ~~~{.cpp}
+ * template <>
+ * struct snowflake::Relocatable<Emitter> : std::true_type {};
+ * ~~~
+ *
+ * where Emitter owns a buffer through a std::unique_ptr. The storage for
+ * relocatable components grows, erases and swaps components by copying their
+ * bytes, rather than moving them element by element.
+ *
+ * \note This must not be specialized for components which store pointers to
+ *       themselves, or which register their address elsewhere.
+ *
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+struct Relocatable : std::is_trivially_copyable<Component> {};
+
+/**
+ * True if the Component can be relocated by copying its bytes.
+ * \tparam Component The type of the component.
+ */
+template <typename Component>
+static constexpr bool relocatable_v = Relocatable<Component>::value;
+
+/**
+ * Creates a component from the \p args.
+ *
+ * Many components are aggregates, which can't be constructed with
+ * parenthesis, and aggregates which have static ids need to have the id base
+ * initialized, so this differentiates between the cases.
+ *
+ * \param  args      The arguments for the construction of the component.
+ * \tparam Component The type of the component to create.
+ * \tparam Args      The types of the arguments.
+ * \return The created component.
+ */
+template <typename Component, typename... Args>
+auto make_component(Args&&... args) -> Component {
+  if constexpr (
+    sizeof...(Args) == 1 &&
+    (std::is_same_v<std::decay_t<Args>, Component> && ...)) {
+    return Component(std::forward<Args>(args)...);
+  } else if constexpr (std::is_aggregate_v<Component>) {
+    if constexpr (constexpr_component_id_v<Component>) {
+      return Component{{}, std::forward<Args>(args)...};
+    } else {
+      return Component{std::forward<Args>(args)...};
+    }
+  } else {
+    return Component(std::forward<Args>(args)...);
+  }
+}
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_COMPONENT_TRAITS_HPP
@@ -0,0 +1,665 @@
+//==--- snowflake/ecs/delta_snapshot.hpp ------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  delta_snapshot.hpp
+/// \brief This file defines incremental snapshots of entity managers, for
+///        rollback and replay.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_DELTA_SNAPSHOT_HPP
+#define SNOWFLAKE_ECS_DELTA_SNAPSHOT_HPP
+
+#include "entity_manager.hpp"
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Defines the default number of deltas which are kept for rollback.
+ */
+static constexpr size_t delta_history_frames =
+#if defined(SNOWFLAKE_DELTA_HISTORY_FRAMES)
+  SNOWFLAKE_DELTA_HISTORY_FRAMES;
+#else
+  8;
+#endif
+
+/**
+ * Compact binary diff between two states of an entity manager.
+ *
+ * The diff records the entries of the entity array which changed, and the
+ * components which were added, changed, or removed, with both the old and new
+ * values, so that it can be applied to move from the old state to the new
+ * state, or reverted to move back.
+ *
+ * The data is raw native bytes, which can be sent over the network or written
+ * to a replay, and restored with assign(). The buffer is reused when the diff
+ * is recorded again, so recording does not allocate once the buffer has
+ * grown to its working size.
+ */
+class DeltaSnapshot {
+ public:
+  /**
+   * Gets a pointer to the data for the diff.
+   * \return A pointer to the data.
+   */
+  snowflake_nodiscard auto data() const noexcept -> const std::byte* {
+    return data_.data();
+  }
+
+  /**
+   * Gets the number of bytes in the diff.
+   * \return The size of the diff, in bytes.
+   */
+  snowflake_nodiscard auto size() const noexcept -> size_t {
+    return data_.size();
+  }
+
+  /**
+   * Determines if the diff is empty.
+   * \return __true__ if the diff has no data.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return data_.empty();
+  }
+
+  /**
+   * Replaces the diff with \p bytes bytes of \p data.
+   * \param data  The data for the diff.
+   * \param bytes The number of bytes in the data.
+   */
+  auto assign(const std::byte* data, size_t bytes) -> void {
+    data_.assign(data, data + bytes);
+  }
+
+  /**
+   * Clears the diff, without releasing its memory.
+   */
+  auto clear() noexcept -> void {
+    data_.clear();
+  }
+
+  /**
+   * Appends \p bytes bytes from \p data to the diff.
+   * \param data  The data to append.
+   * \param bytes The number of bytes to append.
+   */
+  auto write(const void* data, size_t bytes) -> void {
+    const size_t offset = data_.size();
+    data_.resize(offset + bytes);
+    std::memcpy(data_.data() + offset, data, bytes);
+  }
+
+  /**
+   * Appends the \p value to the diff.
+   * \param  value The value to append.
+   * \tparam T     The type of the value.
+   */
+  template <typename T>
+  auto write(const T& value) -> void {
+    write(&value, sizeof(T));
+  }
+
+  /**
+   * Overwrites the value at \p offset in the diff with \p value.
+   * \param  offset The offset of the value to overwrite.
+   * \param  value  The value to write.
+   * \tparam T      The type of the value.
+   */
+  template <typename T>
+  auto write_at(size_t offset, const T& value) noexcept -> void {
+    std::memcpy(data_.data() + offset, &value, sizeof(T));
+  }
+
+ private:
+  std::vector<std::byte> data_ = {}; //!< Data for the diff.
+};
+
+/**
+ * History of the changes to an entity manager, stored as a ring of delta
+ * snapshots, which supports rolling back to any of the recorded states, and
+ * applying deltas to replay them.
+ *
+ * Each capture() records a delta from the previously captured state, with
+ * the entities which were created or destroyed, and the \p Components which
+ * were added, changed, or removed. To detect changes the history keeps a
+ * shadow copy of the last captured state, which is compared against the
+ * components. For components whose changes are tracked (see TrackChanges),
+ * only the components which have changed since the last capture are
+ * compared, so the cost of capture is proportional to the number of changes.
+ * For other components every component is compared, which is still a linear
+ * scan over the contiguous component array.
+ *
+ * \note Reverting restores the values of the components, and the entity
+ *       free list, so entities are created in the same order after a
+ *       rollback, but it does not restore the order of the components in the
+ *       pools.
+ *
+ * \note Components must be trivially copyable, and must not use the SoA
+ *       layout.
+ *
+ * \tparam Entity     The type of the entities.
+ * \tparam Allocator  The type of the allocator for the manager.
+ * \tparam Components The types of the components to record.
+ */
+template <typename Entity, typename Allocator, typename... Components>
+class DeltaHistory {
+  static_assert(
+    (std::is_trivially_copyable_v<Components> && ...),
+    "Delta snapshot components must be trivially copyable!");
+  static_assert(
+    !(soa_layout_v<Components> || ...),
+    "Delta snapshots are not supported for soa components!");
+
+  // clang-format off
+  /** Defines the type of the manager. */
+  using Manager  = EntityManager<Entity, Allocator>;
+  /** Defines the type of the entity sets. */
+  using Entities = typename Manager::PoolData;
+  /** Defines the type of the index of an entity. */
+  using Index    = typename Entity::IdType;
+  // clang-format on
+
+  /**
+   * Kinds of records for a component in a delta.
+   */
+  enum class Change : uint8_t {
+    added   = 0, //!< Component was added, with the new value.
+    changed = 1, //!< Component was changed, with the old and new values.
+    removed = 2  //!< Component was removed, with the old value.
+  };
+
+  /**
+   * Header for a delta.
+   */
+  struct Header {
+    uint64_t entities_before = 0; //!< Entities created before the delta.
+    uint64_t entities_after  = 0; //!< Entities created after the delta.
+    uint64_t next_before     = 0; //!< Next free entity before the delta.
+    uint64_t next_after      = 0; //!< Next free entity after the delta.
+    uint64_t free_before     = 0; //!< Free entities before the delta.
+    uint64_t free_after      = 0; //!< Free entities after the delta.
+    uint64_t records         = 0; //!< Entity records in the delta.
+  };
+
+  /**
+   * Record for an entry of the entity array which changed.
+   */
+  struct EntityRecord {
+    Index  index  = 0;  //!< Index of the entry.
+    Entity before = {}; //!< Value before the delta.
+    Entity after  = {}; //!< Value after the delta.
+  };
+
+  /**
+   * Shadow copy of a component, for the last captured state.
+   */
+  struct Shadow {
+    std::vector<std::byte> values  = {}; //!< Values, indexed by entity.
+    std::vector<uint8_t>   present = {}; //!< If each entity has a value.
+    size_t                 count   = 0;  //!< Number of present values.
+    uint32_t               version = 0;  //!< Last captured version.
+  };
+
+  /** Defines the type of the shadows for the components. */
+  using Shadows = std::array<Shadow, sizeof...(Components)>;
+
+ public:
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Creates the history for the \p manager, with the current state of the
+   * manager as the initial state.
+   * \param manager The manager to record the history of.
+   * \param frames  The number of deltas to keep for rollback.
+   */
+  explicit DeltaHistory(Manager& manager, size_t frames = delta_history_frames)
+  : manager_{&manager}, ring_(frames) {
+    assert(frames > 0 && "History must have at least one frame!");
+    reset();
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Clears the history, and makes the current state of the manager the
+   * initial state. This copies the whole state, and should be used when the
+   * manager is modified without the history (i.e when a level is loaded).
+   */
+  auto reset() -> void {
+    head_ = count_ = 0;
+    shadow_entities_ = manager_->entities_;
+    shadow_next_     = manager_->next_;
+    shadow_free_     = manager_->free_;
+
+    size_t i = 0;
+    ((reset_component<Components>(shadows_[i++])), ...);
+  }
+
+  /**
+   * Records the changes since the last capture as a delta in the history,
+   * overwriting the oldest delta if the history is full.
+   * \return The recorded delta.
+   */
+  auto capture() -> const DeltaSnapshot& {
+    DeltaSnapshot& delta = ring_[head_];
+    record(delta);
+    head_  = (head_ + 1) % ring_.size();
+    count_ = std::min(count_ + 1, ring_.size());
+    return delta;
+  }
+
+  /**
+   * Rolls the manager back to the state at the \p frames most recent capture,
+   * where 0 is the last capture, and 1 the capture before it. Any changes
+   * since the last capture are discarded.
+   *
+   * \param frames The number of captured deltas to roll back.
+   * \return The number of deltas which were rolled back, which is less than
+   *         \p frames if the history is too short.
+   */
+  auto rollback(size_t frames = 1) -> size_t {
+    record(pending_);
+    revert(pending_);
+
+    frames = std::min(frames, count_);
+    for (size_t i = 0; i < frames; ++i) {
+      head_ = (head_ + ring_.size() - 1) % ring_.size();
+      revert(ring_[head_]);
+    }
+    count_ -= frames;
+    return frames;
+  }
+
+  /**
+   * Applies the \p delta to the manager, moving it from the old state of the
+   * delta to the new state. The manager must be in the old state of the
+   * delta, i.e for replay from the same initial state.
+   *
+   * \note This does not add the delta to the history.
+   *
+   * \param delta The delta to apply.
+   */
+  auto apply(const DeltaSnapshot& delta) -> void {
+    Reader reader{delta.data()};
+    const auto header = reader.template read<Header>();
+    manager_->entities_.resize(header.entities_after);
+    shadow_entities_.resize(header.entities_after);
+    for (uint64_t i = 0; i < header.records; ++i) {
+      const auto record = reader.template read<EntityRecord>();
+      manager_->entities_[record.index] = record.after;
+      shadow_entities_[record.index]    = record.after;
+    }
+    manager_->next_ = shadow_next_ = header.next_after;
+    manager_->free_ = shadow_free_ = header.free_after;
+
+    size_t i = 0;
+    ((apply_component<Components>(reader, shadows_[i++], false)), ...);
+  }
+
+  /**
+   * Reverts the \p delta, moving the manager from the new state of the delta
+   * back to the old state. The manager must be in the new state of the
+   * delta.
+   *
+   * \note This does not remove the delta from the history.
+   *
+   * \param delta The delta to revert.
+   */
+  auto revert(const DeltaSnapshot& delta) -> void {
+    Reader reader{delta.data()};
+    const auto header = reader.template read<Header>();
+    const auto* records = reader.cursor;
+    reader.cursor += sizeof(EntityRecord) * header.records;
+
+    size_t i = 0;
+    ((apply_component<Components>(reader, shadows_[i++], true)), ...);
+
+    reader.cursor = records;
+    for (uint64_t j = 0; j < header.records; ++j) {
+      const auto record = reader.template read<EntityRecord>();
+      if (record.index < header.entities_before) {
+        manager_->entities_[record.index] = record.before;
+        shadow_entities_[record.index]    = record.before;
+      }
+    }
+    manager_->entities_.resize(header.entities_before);
+    shadow_entities_.resize(header.entities_before);
+    manager_->next_ = shadow_next_ = header.next_before;
+    manager_->free_ = shadow_free_ = header.free_before;
+  }
+
+  /**
+   * Gets the number of deltas in the history.
+   * \return The number of deltas which can be rolled back.
+   */
+  snowflake_nodiscard auto frames() const noexcept -> size_t {
+    return count_;
+  }
+
+ private:
+  /**
+   * Reader for the data in a delta.
+   */
+  struct Reader {
+    const std::byte* cursor = nullptr; //!< Current position in the data.
+
+    /**
+     * Reads a value of type \p T, and advances the cursor past it.
+     * \tparam T The type of the value to read.
+     * \return The read value.
+     */
+    template <typename T>
+    auto read() noexcept -> T {
+      cursor += sizeof(T);
+      return load<T>(cursor - sizeof(T));
+    }
+
+    /**
+     * Skips a value of type \p T, and returns a pointer to its data.
+     * \tparam T The type of the value to skip.
+     * \return A pointer to the data for the value.
+     */
+    template <typename T>
+    auto skip() noexcept -> const std::byte* {
+      cursor += sizeof(T);
+      return cursor - sizeof(T);
+    }
+
+    /**
+     * Loads a value of type \p T from the \p data.
+     * \param  data The data to load the value from.
+     * \tparam T    The type of the value to load.
+     * \return The loaded value.
+     */
+    template <typename T>
+    static auto load(const std::byte* data) noexcept -> T {
+      std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+      std::memcpy(&storage, data, sizeof(T));
+      return *reinterpret_cast<T*>(&storage);
+    }
+  };
+
+  Manager*                   manager_         = nullptr; //!< The manager.
+  std::vector<DeltaSnapshot> ring_            = {}; //!< Ring of deltas.
+  DeltaSnapshot              pending_         = {}; //!< Uncaptured changes.
+  Shadows                    shadows_         = {}; //!< Component shadows.
+  std::vector<Entity>        shadow_entities_ = {}; //!< Shadow entities.
+  size_t                     shadow_next_     = 0;  //!< Shadow next entity.
+  size_t                     shadow_free_     = 0;  //!< Shadow free count.
+  size_t                     head_            = 0;  //!< Next delta index.
+  size_t                     count_           = 0;  //!< Number of deltas.
+
+  /**
+   * Records the changes since the last captured state into the \p delta,
+   * and updates the shadow to the current state.
+   * \param delta The delta to record into.
+   */
+  auto record(DeltaSnapshot& delta) -> void {
+    const auto& entities = manager_->entities_;
+    Header      header;
+    header.entities_before = shadow_entities_.size();
+    header.entities_after  = entities.size();
+    header.next_before     = shadow_next_;
+    header.next_after      = manager_->next_;
+    header.free_before     = shadow_free_;
+    header.free_after      = manager_->free_;
+
+    delta.clear();
+    delta.write(header);
+
+    // The entity array only grows, and the entries are compared as raw ids,
+    // since most of the array is usually unchanged.
+    const size_t shared = std::min(shadow_entities_.size(), entities.size());
+    shadow_entities_.resize(entities.size());
+    for (size_t i = 0; i < entities.size(); ++i) {
+      if (i < shared && shadow_entities_[i].id() == entities[i].id()) {
+        continue;
+      }
+      delta.write(EntityRecord{
+        static_cast<Index>(i), shadow_entities_[i], entities[i]});
+      shadow_entities_[i] = entities[i];
+      ++header.records;
+    }
+    shadow_next_ = manager_->next_;
+    shadow_free_ = manager_->free_;
+    delta.write_at(0, header);
+
+    size_t i = 0;
+    ((record_component<Components>(delta, shadows_[i++])), ...);
+  }
+
+  /**
+   * Gets a pointer to the shadow value for the \p entity.
+   * \param  shadow    The shadow for the component.
+   * \param  entity    The entity to get the value for.
+   * \tparam Component The type of the component.
+   * \return A pointer to the shadow value.
+   */
+  template <typename Component>
+  static auto value(Shadow& shadow, Index entity) noexcept -> std::byte* {
+    return shadow.values.data() + sizeof(Component) * entity;
+  }
+
+  /**
+   * Makes sure the \p shadow has space for the \p entity.
+   * \param  shadow    The shadow for the component.
+   * \param  entity    The entity to make space for.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto grow(Shadow& shadow, Index entity) -> void {
+    if (entity >= shadow.present.size()) {
+      const size_t size =
+        std::max<size_t>(entity + 1, shadow.present.size() * 2);
+      shadow.present.resize(size, 0);
+      shadow.values.resize(sizeof(Component) * size);
+    }
+  }
+
+  /**
+   * Copies the current state of the \p Component into the \p shadow.
+   * \param  shadow    The shadow for the component.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  auto reset_component(Shadow& shadow) -> void {
+    auto& pool = manager_->template ensure_component<Component>();
+    shadow.present.assign(manager_->entities_.size(), 0);
+    shadow.values.assign(sizeof(Component) * shadow.present.size(), {});
+    shadow.count = 0;
+    if constexpr (track_changes_v<Component>) {
+      shadow.version = pool.advance_version();
+    }
+
+    const Entity* entities   = static_cast<const Entities&>(pool).rbegin();
+    const auto    components = std::as_const(pool).crbegin();
+    for (size_t i = 0; i < pool.size(); ++i) {
+      std::memcpy(
+        value<Component>(shadow, entities[i]),
+        &components[i],
+        sizeof(Component));
+      shadow.present[entities[i]] = 1;
+      ++shadow.count;
+    }
+  }
+
+  /**
+   * Records the changes to the \p Component into the \p delta, and updates
+   * the \p shadow.
+   * \param  delta     The delta to record into.
+   * \param  shadow    The shadow for the component.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  auto record_component(DeltaSnapshot& delta, Shadow& shadow) -> void {
+    auto&        pool   = manager_->template ensure_component<Component>();
+    const auto&  cpool  = std::as_const(pool);
+    const size_t offset = delta.size();
+    uint64_t     count  = 0;
+    delta.write(count);
+
+    auto compare = [&](const Entity& entity, const Component& component) {
+      grow<Component>(shadow, entity);
+      std::byte* old = value<Component>(shadow, entity);
+      if (!shadow.present[entity]) {
+        write_record<Component>(
+          delta, Change::added, entity, &component, nullptr);
+        shadow.present[entity] = 1;
+        ++shadow.count;
+      } else if (std::memcmp(old, &component, sizeof(Component)) != 0) {
+        write_record<Component>(
+          delta, Change::changed, entity, &component, old);
+      } else {
+        return;
+      }
+      std::memcpy(old, &component, sizeof(Component));
+      ++count;
+    };
+
+    if constexpr (track_changes_v<Component>) {
+      const auto now = pool.advance_version();
+      for (const auto& entity : cpool.changed_since(shadow.version)) {
+        compare(entity, cpool.get(entity));
+      }
+      shadow.version = now;
+    } else {
+      const Entity* entities   = static_cast<const Entities&>(pool).rbegin();
+      const auto    components = cpool.crbegin();
+      for (size_t i = 0; i < pool.size(); ++i) {
+        compare(entities[i], components[i]);
+      }
+    }
+
+    // Every component in the pool is now in the shadow, so if the shadow has
+    // more components then some were removed.
+    for (Index e = 0; shadow.count > pool.size(); ++e) {
+      if (shadow.present[e] && !pool.exists(Entity{e})) {
+        write_record<Component>(
+          delta,
+          Change::removed,
+          Entity{e},
+          nullptr,
+          value<Component>(shadow, e));
+        shadow.present[e] = 0;
+        --shadow.count;
+        ++count;
+      }
+    }
+    delta.write_at(offset, count);
+  }
+
+  /**
+   * Writes a record for a component into the \p delta.
+   * \param  delta     The delta to write into.
+   * \param  change    The kind of change.
+   * \param  entity    The entity for the component.
+   * \param  after     The new value of the component, if any.
+   * \param  before    The old value of the component, if any.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto write_record(
+    DeltaSnapshot&   delta,
+    Change           change,
+    const Entity&    entity,
+    const void*      after,
+    const std::byte* before) -> void {
+    delta.write(change);
+    delta.write(entity);
+    if (before != nullptr) {
+      delta.write(before, sizeof(Component));
+    }
+    if (after != nullptr) {
+      delta.write(after, sizeof(Component));
+    }
+  }
+
+  /**
+   * Applies or reverts the records for the \p Component from the \p reader,
+   * and updates the \p shadow.
+   * \param  reader    The reader for the delta.
+   * \param  shadow    The shadow for the component.
+   * \param  reverse   If the records are reverted.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  auto apply_component(Reader& reader, Shadow& shadow, bool reverse) -> void {
+    auto&          pool  = manager_->template ensure_component<Component>();
+    const uint64_t count = reader.template read<uint64_t>();
+    for (uint64_t i = 0; i < count; ++i) {
+      const auto change = reader.template read<Change>();
+      const auto entity = reader.template read<Entity>();
+      grow<Component>(shadow, entity);
+
+      const bool       had    = change != Change::added;
+      const bool       has    = change != Change::removed;
+      const std::byte* before = nullptr;
+      const std::byte* after  = nullptr;
+      if (had) {
+        before = reader.template skip<Component>();
+      }
+      if (has) {
+        after = reader.template skip<Component>();
+      }
+      const std::byte* data   = reverse ? before : after;
+      const bool       from   = reverse ? has : had;
+      const bool       to     = reverse ? had : has;
+
+      if (from && to) {
+        pool.replace(
+          *manager_, entity, Reader::template load<Component>(data));
+      } else if (to) {
+        manager_->template emplace<Component>(
+          entity, Reader::template load<Component>(data));
+      } else {
+        manager_->template remove<Component>(entity);
+      }
+
+      if (to) {
+        std::memcpy(value<Component>(shadow, entity), data, sizeof(Component));
+        shadow.count += from ? 0 : 1;
+      } else {
+        --shadow.count;
+      }
+      shadow.present[entity] = to ? 1 : 0;
+    }
+  }
+};
+
+/**
+ * Creates a delta history for the \p Components of the \p manager.
+ *
+ * \see DeltaHistory
+ *
+ * \param  manager    The manager to record the history of.
+ * \param  frames     The number of deltas to keep for rollback.
+ * \tparam Components The types of the components to record.
+ * \tparam Entity     The type of the entities.
+ * \tparam Allocator  The type of the allocator for the manager.
+ * \return The history for the manager.
+ */
+template <typename... Components, typename Entity, typename Allocator>
+auto make_delta_history(
+  EntityManager<Entity, Allocator>& manager,
+  size_t frames = delta_history_frames)
+  -> DeltaHistory<Entity, Allocator, Components...> {
+  return DeltaHistory<Entity, Allocator, Components...>{manager, frames};
+}
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_DELTA_SNAPSHOT_HPP
@@ -17,11 +17,111 @@
 #define SNOWFLAKE_ECS_ENTITY_MANAGER_HPP
 
 #include "entity.hpp"
-#include "component_storage.hpp"
-#include <wrench/memory/unique_ptr.hpp>
+#include "component_id.hpp"
+#include "group.hpp"
+#include "query.hpp"
+#include "storage.hpp"
+#include "view.hpp"
+#include <snowflake/util/signal.hpp>
+#include <algorithm>
+#include <memory>
+#include <tuple>
 
 namespace snowflake {
 
+/**
+ * List of the components for an entity manager which knows all of its
+ * components at compile time, which is used in place of the allocator for
+ * the manager, for example:
+ *
+ * ~~~{.cpp}
+ * using Manager = EntityManager<Entity, ComponentList<Position, Velocity>>;
+ * ~~~
+ *
+ * \tparam Components The types of the components.
+ */
+template <typename... Components>
+struct ComponentList {};
+
+namespace detail {
+
+/**
+ * Defines the configuration of an entity manager from the \p Allocator
+ * argument of the manager. This specialization is for managers whose
+ * components are not known at compile time.
+ *
+ * \tparam Entity    The type of the entities.
+ * \tparam Allocator The type of the allocator for the entities.
+ */
+template <typename Entity, typename Allocator>
+struct ManagerConfig {
+  // clang-format off
+  /** The type of the allocator for the entities. */
+  using EntityAllocator = Allocator;
+  /** The type of the pools stored directly in the manager. */
+  template <template <typename> typename Pool>
+  using StaticPools     = std::tuple<>;
+  // clang-format on
+
+  /** True if the components are known at compile time. */
+  static constexpr bool static_components = false;
+
+  /**
+   * True if the \p Component is stored directly in the manager.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static constexpr bool contains = false;
+};
+
+/**
+ * Defines the configuration of an entity manager from the \p Allocator
+ * argument of the manager. This specialization is for managers whose
+ * \p Components are known at compile time.
+ *
+ * \tparam Entity     The type of the entities.
+ * \tparam Components The types of the components.
+ */
+template <typename Entity, typename... Components>
+struct ManagerConfig<Entity, ComponentList<Components...>> {
+  // clang-format off
+  /** The type of the allocator for the entities. */
+  using EntityAllocator = wrench::ObjectPoolAllocator<Entity>;
+  /** The type of the pools stored directly in the manager. */
+  template <template <typename> typename Pool>
+  using StaticPools     = std::tuple<Pool<Components>...>;
+  // clang-format on
+
+  /** True if the components are known at compile time. */
+  static constexpr bool static_components = true;
+
+  /**
+   * True if the \p Component is stored directly in the manager.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static constexpr bool contains =
+    (std::is_same_v<Component, Components> || ...);
+};
+
+} // namespace detail
+
+/** Forward declaration of the command buffer for a manager. */
+template <typename Entity, typename Allocator>
+class CommandBuffer;
+
+/** Forward declaration of the snapshot for a manager. */
+template <typename Entity, typename Allocator>
+class Snapshot;
+
+/** Forward declaration of the delta history for a manager. */
+template <typename Entity, typename Allocator, typename... Components>
+class DeltaHistory;
+
+/** Forward declaration of the transform hierarchy system. */
+template <typename Entity, typename Local, typename World, typename CombineFn>
+class TransformHierarchy;
+
 /**
  * Manager class for entites and the components that are assosciated with the
  * entities.
@@ -35,17 +135,47 @@ namespace snowflake {
  * for the most part, *unless* a page needs to be allocated for an entity. This
  * overhead can be removed by preallocating enough space.
  *
+ * By default the pools for the components are created on demand, and are
+ * found by the id of the component. If the \p Allocator is a ComponentList
+ * then the components are known at compile time, and the pools for them are
+ * stored directly in the manager, so finding a pool is a member access, with
+ * no id lookup or allocation. Such a manager can only be used with the
+ * components in the list, and must not be moved once groups have been
+ * created, since groups refer to its pools.
+ *
  * \todo Add thread safety information.
  *
  * \tparam Entity    The type of the entities to manage.
- * \tparam Allocator The type of the allocator for the enitites.
+ * \tparam Allocator The type of the allocator for the enitites, or a
+ *                   ComponentList of the components for the manager.
  */
 template <
   typename Entity,
   typename Allocator = wrench::ObjectPoolAllocator<Entity>>
 class EntityManager {
+  /** Command buffers apply commands directly to the pools. */
+  friend class CommandBuffer<Entity, Allocator>;
+  /** Snapshots read and write the entities and pools directly. */
+  friend class Snapshot<Entity, Allocator>;
+  /** Delta histories record and restore the entities directly. */
+  template <typename E, typename A, typename... Components>
+  friend class DeltaHistory;
+  /** Transform hierarchies sort and propagate through the pools directly. */
+  template <typename E, typename L, typename W, typename C>
+  friend class TransformHierarchy;
+
+  /** Defines the configuration of the manager. */
+  using Config          = detail::ManagerConfig<Entity, Allocator>;
+  /** Defines the type of the allocator for the entities. */
+  using EntityAllocator = typename Config::EntityAllocator;
   /** Defines the type of the pool data. */
-  using PoolData = SparseSet<Entity, Allocator>;
+  using PoolData        = SparseSet<Entity, EntityAllocator>;
+
+ public:
+  /** Defines the type of the signals for changes to components. */
+  using Signal = snowflake::Signal<EntityManager&, const Entity&>;
+
+ private:
 
   /**
    * Pool for a specific type of component.
@@ -53,9 +183,11 @@ class EntityManager {
    */
   template <typename Component>
   struct ComponentPool final
-  : public ComponentStorage<Entity, Component, Allocator> {
+  : public storage_t<Entity, Component, EntityAllocator> {
     /** Defines the type of the storage. */
-    using Storage = ComponentStorage<Entity, Component, Allocator>;
+    using Storage = storage_t<Entity, Component, EntityAllocator>;
+    /** Defines the type of the callbacks into a group which owns the pool. */
+    using GroupCallback = void (*)(void*, const Entity&);
 
     /**
      * Emplaces a component into the pool for a specific entity.
@@ -67,9 +199,89 @@ class EntityManager {
     template <typename... Args>
     auto emplace(EntityManager& manager, const Entity& entity, Args&&... args)
       -> void {
-      // TODO: Add construction callback to call back into manager ...
-
       Storage::emplace(entity, std::forward<Args>(args)...);
+      if (group != nullptr) {
+        group_construct(group, entity);
+      }
+      on_construct.publish(manager, entity);
+    }
+
+    /**
+     * Inserts components into the pool for all the entities in the range
+     * [\p first, \p last), growing the pool once.
+     *
+     * \note Components with a structure-of-arrays layout are emplaced one at a
+     *       time.
+     *
+     * \see ComponentStorage::insert
+     *
+     * \param  manager  The manager for the entities.
+     * \param  first    An iterator to the first entity to insert.
+     * \param  last     An iterator to one past the last entity to insert.
+     * \param  source   A component to copy, or an iterator to the components.
+     * \tparam Iterator The type of the entity iterator.
+     * \tparam Source   The type of the component or component iterator.
+     */
+    template <typename Iterator, typename Source>
+    auto insert(
+      EntityManager& manager, Iterator first, Iterator last, Source&& source)
+      -> void {
+      if constexpr (soa_layout_v<Component>) {
+        if constexpr (std::is_convertible_v<Source, const Component&>) {
+          for (auto it = first; it != last; ++it) {
+            Storage::emplace(*it, source);
+          }
+        } else {
+          auto component = source;
+          for (auto it = first; it != last; ++it, ++component) {
+            Storage::emplace(*it, *component);
+          }
+        }
+      } else {
+        Storage::insert(first, last, source);
+      }
+      if (group != nullptr) {
+        for (auto it = first; it != last; ++it) {
+          group_construct(group, *it);
+        }
+      }
+      if (!on_construct.empty()) {
+        for (auto it = first; it != last; ++it) {
+          on_construct.publish(manager, *it);
+        }
+      }
+    }
+
+    /**
+     * Replaces the component for the \p entity with a component constructed
+     * from the \p args.
+     * \param  manager The manager for the entities.
+     * \param  entity  The entity to replace the component for.
+     * \param  args    Arguments for the construction of the component.
+     * \tparam Args    Type of the arguments.
+     */
+    template <typename... Args>
+    auto replace(EntityManager& manager, const Entity& entity, Args&&... args)
+      -> void {
+      Storage::get(entity) =
+        make_component<Component>(std::forward<Args>(args)...);
+      on_update.publish(manager, entity);
+    }
+
+    /**
+     * Applies the \p functors to the component for the \p entity.
+     * \param  manager  The manager for the entities.
+     * \param  entity   The entity to patch the component for.
+     * \param  functors The functors to apply to the component.
+     * \tparam Functors The types of the functors.
+     */
+    template <typename... Functors>
+    auto patch(
+      EntityManager& manager, const Entity& entity, Functors&&... functors)
+      -> void {
+      decltype(auto) component = Storage::get(entity);
+      (std::forward<Functors>(functors)(component), ...);
+      on_update.publish(manager, entity);
     }
 
     /**
@@ -78,12 +290,19 @@ class EntityManager {
      * \param entity  The entity to remove from the pool.
      */
     auto remove(EntityManager& manager, const Entity& entity) -> void {
-      // TODO: Add destruction callback to notify manager ...
-
-      Storage::remove(entity);
+      on_destroy.publish(manager, entity);
+      if (group != nullptr) {
+        group_destroy(group, entity);
+      }
+      Storage::erase(entity);
     }
 
-    /* \todo sources and sinnks to the pool. */
+    Signal on_construct = {}; //!< Published after a component is added.
+    Signal on_update    = {}; //!< Published after a component is updated.
+    Signal on_destroy   = {}; //!< Published before a component is removed.
+    void*         group           = nullptr; //!< Group which owns the pool.
+    GroupCallback group_construct = nullptr; //!< Group construct callback.
+    GroupCallback group_destroy   = nullptr; //!< Group destroy callback.
   };
 
   /**
@@ -95,27 +314,41 @@ class EntityManager {
    */
   struct ComponentPoolHandle {
     /** Type of the pointer to the pool. */
-    using PoolPtr = wrench::UniquePtr<PoolData>;
+    using PoolPtr = std::unique_ptr<PoolData>;
     /** Type of the id for the pool. */
     using IdType = typename ComponentIdDynamic::Type;
+    /** Type of the function to remove an entity from the pool. */
+    using RemoveFn = void (*)(EntityManager&, PoolData&, const Entity&);
 
     /**
-     * Initializes the data for the pool.
-     * \param id_value The value of the id for the pool.
+     * Initializes the data for the pool, if it has not been initialized.
+     * \param  id_value The value of the id for the pool.
+     * \tparam Pool     The type of the pool to create.
      */
+    template <typename Pool>
     auto initialize(IdType id_value) -> void {
       if (pool == nullptr) {
-        pool = wrench::make_unique<PoolData>();
-        id   = id_value;
+        pool   = std::make_unique<Pool>();
+        id     = id_value;
+        remove = [](EntityManager& manager, PoolData& p, const Entity& e) {
+          static_cast<Pool&>(p).remove(manager, e);
+        };
       }
     }
 
-    PoolPtr pool = nullptr;                     //!< Pointer to the pool.
-    IdType  id   = ComponentIdDynamic::null_id; //!< Id of the component.
+    PoolPtr  pool   = nullptr;                     //!< Pointer to the pool.
+    IdType   id     = ComponentIdDynamic::null_id; //!< Id of the component.
+    RemoveFn remove = nullptr; //!< Removes an entity from the pool.
   };
 
   /** Defines the type of the pool for static component ids. */
   using Pools = std::vector<ComponentPoolHandle>;
+  /** Defines the type of the pools for components known at compile time. */
+  using StaticPools = typename Config::template StaticPools<ComponentPool>;
+  /** Defines the type of the container for groups. */
+  using Groups = std::vector<std::shared_ptr<void>>;
+  /** Defines the type of the container for queries, keyed by type. */
+  using Queries = std::vector<std::pair<const void*, std::shared_ptr<void>>>;
   /** Defines the type of the entities. */
   using Entities = std::vector<Entity>;
 
@@ -131,20 +364,94 @@ class EntityManager {
     } else {
       entity = Entity{static_cast<typename Entity::IdType>(next_)};
       next_  = entities_[next_];
+      --free_;
     }
     return entity;
   }
 
+  /**
+   * Creates \p count entities, writing them to \p out.
+   *
+   * Recycled entities are reused first, by walking the chain of recycled
+   * entities once, and then the remaining entities are created with a single
+   * allocation.
+   *
+   * \param  count          The number of entities to create.
+   * \param  out            The output iterator to write the entities to.
+   * \tparam OutputIterator The type of the output iterator.
+   * \return The output iterator, one past the last written entity.
+   */
+  template <typename OutputIterator>
+  auto create(size_t count, OutputIterator out) -> OutputIterator {
+    using Id            = typename Entity::IdType;
+    const size_t reused = std::min(count, free_);
+    for (size_t i = 0; i < reused; ++i, ++out) {
+      *out  = Entity{static_cast<Id>(next_)};
+      next_ = entities_[next_];
+    }
+    free_ -= reused;
+
+    const size_t start = entities_.size();
+    entities_.resize(start + count - reused);
+    for (size_t i = start; i < entities_.size(); ++i, ++out) {
+      entities_[i] = Entity{static_cast<Id>(i)};
+      *out         = entities_[i];
+    }
+    return out;
+  }
+
   /**
    * Recycles an entity, and all the components assosciated with it.
    * \param entity The entity to recycle.
    */
   auto recycle(const Entity& entity) -> void {
+    recycle(&entity, &entity + 1);
+  }
+
+  /**
+   * Recycles all the entities in the range [\p first, \p last), and all the
+   * components assosciated with them. The components are removed one pool at
+   * a time, and the entities are added to the chain of recycled entities in a
+   * single pass.
+   *
+   * \note If any entity is recycled more than once, this causes undefined
+   *       behaviour.
+   *
+   * \param  first    An iterator to the first entity to recycle.
+   * \param  last     An iterator to one past the last entity to recycle.
+   * \tparam Iterator The type of the iterator, which must be a forward
+   *                  iterator.
+   */
+  template <typename Iterator>
+  auto recycle(Iterator first, Iterator last) -> void {
+    if constexpr (Config::static_components) {
+      std::apply(
+        [&](auto&... pools) { (remove_all(pools, first, last), ...); },
+        static_pools_);
+    } else {
+      for (auto* pools : {&static_id_pools_, &dynamic_id_pools_}) {
+        for (auto& handle : *pools) {
+          if (handle.pool == nullptr || handle.pool->empty()) {
+            continue;
+          }
+          for (auto it = first; it != last; ++it) {
+            if (handle.pool->exists(*it)) {
+              handle.remove(*this, *handle.pool, *it);
+            }
+          }
+        }
+      }
+    }
+
     using Id = typename Entity::IdType;
-    // The entity is recycled by setting the value to the current next value,
-    // which forms a chain of recycled entites.
-    entities_[static_cast<size_t>(entity)] = Entity{static_cast<Id>(next_)};
-    next_                                  = static_cast<size_t>(entity);
+    // The entities are recycled by setting the value to the current next
+    // value, which forms a chain of recycled entites.
+    for (; first != last; ++first) {
+      const auto index = static_cast<size_t>(*first);
+      entities_[index] = Entity{static_cast<Id>(next_)};
+      next_            = index;
+      ++free_;
+    }
   }
 
   /**
@@ -160,28 +467,437 @@ class EntityManager {
       *this, entity, std::forward<Args>(args)...);
   }
 
+  /**
+   * Inserts components of type \p Component for all the entities in the
+   * range [\p first, \p last), growing the pool for the component once,
+   * rather than emplacing one component at a time.
+   *
+   * If \p source is convertible to the component type then each entity is
+   * given a copy of it, otherwise \p source must be an iterator to the
+   * components for each of the entities, in the same order as the entities.
+   *
+   * \note If any entity already has the component, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \param  first     An iterator to the first entity to insert.
+   * \param  last      An iterator to one past the last entity to insert.
+   * \param  source    A component to copy, or an iterator to the components.
+   * \tparam Component The type of the component to insert.
+   * \tparam Iterator  The type of the entity iterator.
+   * \tparam Source    The type of the component or component iterator.
+   */
+  template <typename Component, typename Iterator, typename Source>
+  auto insert(Iterator first, Iterator last, Source&& source) -> void {
+    ensure_component<Component>().insert(
+      *this, first, last, std::forward<Source>(source));
+  }
+
+  /**
+   * Removes the component of type \p Component from the \p entity.
+   *
+   * \note If the entity does not have the component, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \param  entity    The entity to remove the component from.
+   * \tparam Component The type of the component to remove.
+   */
+  template <typename Component>
+  auto remove(const Entity& entity) -> void {
+    ensure_component<Component>().remove(*this, entity);
+  }
+
+  /**
+   * Replaces the component of type \p Component for the \p entity with a
+   * component constructed from the \p args, and publishes the update signal
+   * for the component.
+   *
+   * \note If the entity does not have the component, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \param  entity    The entity to replace the component for.
+   * \param  args      Arguments for the construction of the component.
+   * \tparam Component The type of the component to replace.
+   * \tparam Args      The type of the arguments.
+   */
+  template <typename Component, typename... Args>
+  auto replace(const Entity& entity, Args&&... args) -> void {
+    ensure_component<Component>().replace(
+      *this, entity, std::forward<Args>(args)...);
+  }
+
+  /**
+   * Applies the \p functors, in order, to the component of type
+   * \p Component for the \p entity, and publishes the update signal for the
+   * component. The functors are passed a reference to the component.
+   *
+   * \note If the entity does not have the component, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \param  entity    The entity to patch the component for.
+   * \param  functors  The functors to apply to the component.
+   * \tparam Component The type of the component to patch.
+   * \tparam Functors  The types of the functors.
+   */
+  template <typename Component, typename... Functors>
+  auto patch(const Entity& entity, Functors&&... functors) -> void {
+    ensure_component<Component>().patch(
+      *this, entity, std::forward<Functors>(functors)...);
+  }
+
+  /**
+   * Gets the signal which is published after a \p Component is added to an
+   * entity.
+   *
+   * \note Listeners are called with the manager and the entity, and must not
+   *       add or remove components of the same type.
+   *
+   * \tparam Component The type of the component.
+   * \return A reference to the signal.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto on_construct() -> Signal& {
+    return ensure_component<Component>().on_construct;
+  }
+
+  /**
+   * Gets the signal which is published after a \p Component is updated
+   * through replace() or patch().
+   *
+   * \note Modifications through get() or views do not publish the signal.
+   *
+   * \tparam Component The type of the component.
+   * \return A reference to the signal.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto on_update() -> Signal& {
+    return ensure_component<Component>().on_update;
+  }
+
+  /**
+   * Gets the signal which is published before a \p Component is removed
+   * from an entity, including when the entity is recycled, so that the
+   * component can still be accessed by listeners.
+   *
+   * \note Listeners are called with the manager and the entity, and must not
+   *       add or remove components of the same type.
+   *
+   * \tparam Component The type of the component.
+   * \return A reference to the signal.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto on_destroy() -> Signal& {
+    return ensure_component<Component>().on_destroy;
+  }
+
   /**
    * Gets a reference to the component for the entity.
+   *
+   * \note For components which are stored with a structure-of-arrays layout,
+   *       this returns a proxy reference to the component.
+   *
    * \param  entity    The entity to get the component for.
    * \tparam Component The type of the component.
    * \return A reference to the component for the entity.
    */
   template <typename Component>
-  snowflake_nodiscard auto get(const Entity& entity) -> Component& {
+  snowflake_nodiscard decltype(auto) get(const Entity& entity) {
     return ensure_component<Component>().get(entity);
   }
 
   /**
    * Gets a const reference to the component for the entity.
+   *
+   * \note For components which are stored with a structure-of-arrays layout,
+   *       this returns a const proxy reference to the component.
+   *
    * \param  entity    The entity to get the component for.
    * \tparam Component The type of the component.
    * \return A const reference to the component for the entity.
    */
   template <typename Component>
-  snowflake_nodiscard auto get(const Entity& entity) const -> const Component& {
+  snowflake_nodiscard decltype(auto) get(const Entity& entity) const {
     return get_component<Component>().get(entity);
   }
 
+  /**
+   * Creates a view over all entities which have *all* of the \p Components.
+   *
+   * Iteration over the view is driven by the smallest of the component pools,
+   * and each candidate entity is only checked for membership in the other
+   * pools, so the cost of iteration is proportional to the size of the
+   * smallest pool.
+   *
+   * \note Pools for any of the components which do not exist are created.
+   *
+   * \tparam Components The types of the components for the view.
+   * \return A view over the entities with all the components.
+   */
+  template <typename... Components>
+  snowflake_nodiscard auto view()
+    -> View<typename ComponentPool<Components>::Storage...> {
+    return View<typename ComponentPool<Components>::Storage...>{
+      ensure_component<Components>()...};
+  }
+
+  /**
+   * Creates a const view over all entities which have *all* of the
+   * \p Components.
+   *
+   * \note If any of the component pools have not been created, this will
+   *       assert in debug, and cause undefined behaviour in release.
+   *
+   * \tparam Components The types of the components for the view.
+   * \return A view over the entities with all the components.
+   */
+  template <typename... Components>
+  snowflake_nodiscard auto view() const
+    -> View<const typename ComponentPool<Components>::Storage...> {
+    return View<const typename ComponentPool<Components>::Storage...>{
+      get_component<Components>()...};
+  }
+
+  /**
+   * Creates a view over all entities which have *all* of the \p Components,
+   * *none* of the \p Excluded components, and any of the \p Optionals
+   * components, for example:
+   *
+   * ~~~{.cpp}
+   * manager.view<Transform, Renderable>(exclude<Hidden>, optional<Light>)
+   *   .each([] (Transform& t, Renderable& r, Light* light) { ... });
+   * ~~~
+   *
+   * The exclusions are checked against the sparse arrays of the pools, before
+   * any of the components are accessed, and the optional components are
+   * passed to the view's functors as pointers, which are null for entities
+   * without the component.
+   *
+   * \note Pools for any of the components which do not exist are created.
+   *
+   * \tparam Components The types of the required components.
+   * \tparam Excluded   The types of the excluded components.
+   * \tparam Optionals  The types of the optional components.
+   * \return A view over the entities with the components.
+   */
+  template <
+    typename... Components,
+    typename... Excluded,
+    typename... Optionals>
+  snowflake_nodiscard auto
+  view(Exclude<Excluded...>, Optional<Optionals...> = {}) -> BasicView<
+    std::tuple<typename ComponentPool<Components>::Storage...>,
+    std::tuple<typename ComponentPool<Excluded>::Storage...>,
+    std::tuple<typename ComponentPool<Optionals>::Storage...>> {
+    return {
+      ensure_component<Components>()...,
+      &ensure_component<Excluded>()...,
+      &ensure_component<Optionals>()...};
+  }
+
+  /**
+   * Creates a view over all entities which have *all* of the \p Components,
+   * and any of the \p Optionals components.
+   *
+   * \note Pools for any of the components which do not exist are created.
+   *
+   * \tparam Components The types of the required components.
+   * \tparam Optionals  The types of the optional components.
+   * \return A view over the entities with the components.
+   */
+  template <typename... Components, typename... Optionals>
+  snowflake_nodiscard auto view(Optional<Optionals...> optionals) {
+    return view<Components...>(Exclude<>{}, optionals);
+  }
+
+  /**
+   * Creates a const view over all entities which have *all* of the
+   * \p Components, *none* of the \p Excluded components, and any of the
+   * \p Optionals components.
+   *
+   * \note If any of the pools for the required components have not been
+   *       created, this will assert in debug, and cause undefined behaviour
+   *       in release. Pools for the excluded and optional components which
+   *       have not been created are treated as empty.
+   *
+   * \tparam Components The types of the required components.
+   * \tparam Excluded   The types of the excluded components.
+   * \tparam Optionals  The types of the optional components.
+   * \return A view over the entities with the components.
+   */
+  template <
+    typename... Components,
+    typename... Excluded,
+    typename... Optionals>
+  snowflake_nodiscard auto
+  view(Exclude<Excluded...>, Optional<Optionals...> = {}) const -> BasicView<
+    std::tuple<const typename ComponentPool<Components>::Storage...>,
+    std::tuple<const typename ComponentPool<Excluded>::Storage...>,
+    std::tuple<const typename ComponentPool<Optionals>::Storage...>> {
+    return {
+      get_component<Components>()...,
+      find_component<Excluded>()...,
+      find_component<Optionals>()...};
+  }
+
+  /**
+   * Creates a const view over all entities which have *all* of the
+   * \p Components, and any of the \p Optionals components.
+   *
+   * \note If any of the pools for the required components have not been
+   *       created, this will assert in debug, and cause undefined behaviour
+   *       in release. Pools for the optional components which have not been
+   *       created are treated as empty.
+   *
+   * \tparam Components The types of the required components.
+   * \tparam Optionals  The types of the optional components.
+   * \return A view over the entities with the components.
+   */
+  template <typename... Components, typename... Optionals>
+  snowflake_nodiscard auto view(Optional<Optionals...> optionals) const {
+    return view<Components...>(Exclude<>{}, optionals);
+  }
+
+  /**
+   * Gets the owning group for the \p Owned components, creating it if it does
+   * not exist.
+   *
+   * The group keeps all entities which have all of the \p Owned components
+   * packed at the front of each of the pools, in the same order, so that
+   * iteration over the group is a linear walk over the pools. The pools are
+   * reordered as components are added and removed through the manager.
+   *
+   * \note A pool can only be owned by a single group, so requesting a group
+   *       which owns a pool which is owned by a different group will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \tparam Owned The types of the components owned by the group.
+   * \return A reference to the group.
+   */
+  template <typename... Owned>
+  auto group() -> Group<typename ComponentPool<Owned>::Storage...>& {
+    using GroupType = Group<typename ComponentPool<Owned>::Storage...>;
+    using Front     = std::tuple_element_t<0, std::tuple<Owned...>>;
+    auto& front     = ensure_component<Front>();
+    if (front.group != nullptr) {
+      assert(
+        front.group_construct == &group_construct<GroupType> &&
+        "Pool is already owned by a different group!");
+      return *static_cast<GroupType*>(front.group);
+    }
+
+    assert(
+      ((ensure_component<Owned>().group == nullptr) && ...) &&
+      "Pool is already owned by a different group!");
+    auto group = std::make_shared<GroupType>(ensure_component<Owned>()...);
+    (own_pool<GroupType>(ensure_component<Owned>(), group.get()), ...);
+    groups_.emplace_back(group);
+    return *group;
+  }
+
+  /**
+   * Gets the persistent query for the \p Components, creating it if it does
+   * not exist.
+   *
+   * The query keeps a dense set of the entities which have all of the
+   * \p Components, which is updated as the components are added and removed
+   * through the manager, so iterating over the query only visits the
+   * matching entities. Unlike a group, a query does not reorder the pools,
+   * so any number of queries can use the same pools.
+   *
+   * \tparam Components The types of the components for the query.
+   * \return A reference to the query.
+   */
+  template <typename... Components>
+  auto query() -> Query<typename ComponentPool<Components>::Storage...>& {
+    using QueryType = Query<typename ComponentPool<Components>::Storage...>;
+    for (const auto& [key, query] : queries_) {
+      if (key == &query_key<QueryType>) {
+        return *static_cast<QueryType*>(query.get());
+      }
+    }
+
+    auto query = std::make_shared<QueryType>(ensure_component<Components>()...);
+    (ensure_component<Components>()
+       .on_construct.template connect<&query_construct<QueryType>>(*query),
+     ...);
+    (ensure_component<Components>()
+       .on_destroy.template connect<&query_destroy<QueryType>>(*query),
+     ...);
+    queries_.emplace_back(&query_key<QueryType>, query);
+    return *query;
+  }
+
+  /**
+   * Sorts the pool for the \p Component by the key returned by the
+   * \p key_fn, so that iteration over the pool visits the components in
+   * ascending order of key.
+   *
+   * \note The pool must not be owned by a group. If it is, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \see ComponentStorage::sort
+   *
+   * \param  key_fn    The function which returns the key to sort by.
+   * \tparam Component The type of the component to sort.
+   * \tparam KeyFn     The type of the key function.
+   */
+  template <typename Component, typename KeyFn>
+  auto sort(KeyFn&& key_fn) -> void {
+    auto& pool = ensure_component<Component>();
+    assert(pool.group == nullptr && "Can't sort a pool owned by a group!");
+    pool.sort(std::forward<KeyFn>(key_fn));
+  }
+
+  /**
+   * Sorts the pool for the \p Component so that the entities which also have
+   * the \p Other component are iterated first, in the same order as in the
+   * pool for the \p Other component.
+   *
+   * \note The pool must not be owned by a group. If it is, this will assert in
+   *       debug, and cause undefined behaviour in release.
+   *
+   * \tparam Component The type of the component to sort.
+   * \tparam Other     The type of the component to sort in the order of.
+   */
+  template <typename Component, typename Other>
+  auto sort_as() -> void {
+    auto& pool = ensure_component<Component>();
+    assert(pool.group == nullptr && "Can't sort a pool owned by a group!");
+    pool.sort_as(ensure_component<Other>());
+  }
+
+  /**
+   * Gets a range over the entities whose \p Component has changed since the
+   * \p version. Changes to the component must be tracked.
+   *
+   * \see TrackedComponentStorage::changed_since
+   *
+   * \param  version   The version to get the changes since.
+   * \tparam Component The type of the component.
+   * \return A range over the entities with changed components.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto changed_since(uint32_t version) {
+    static_assert(
+      track_changes_v<Component>, "Changes to component are not tracked!");
+    return ensure_component<Component>().changed_since(version);
+  }
+
+  /**
+   * Advances the version for changes to the \p Component. Changes to the
+   * component must be tracked.
+   *
+   * \see TrackedComponentStorage::advance_version
+   *
+   * \tparam Component The type of the component.
+   * \return The version before advancing.
+   */
+  template <typename Component>
+  auto advance_version() -> uint32_t {
+    static_assert(
+      track_changes_v<Component>, "Changes to component are not tracked!");
+    return ensure_component<Component>().advance_version();
+  }
+
   /**
    * Returns the number of components of the Component type.
    *
@@ -207,17 +923,10 @@ class EntityManager {
 
   /**
    * Returns the number of active entities.
-   * \note The cost of this linear in the number of entities which have been
-   *       recycled and not recreated.
    * \return The number of active entities.
    */
   snowflake_nodiscard auto entities_active() const noexcept -> size_t {
-    size_t recycled = 0, next = next_;
-    while (next != Entity::null_id && recycled < entities_.size()) {
-      ++recycled;
-      next = entities_[next];
-    }
-    return entities_created() - recycled;
+    return entities_created() - free_;
   }
 
   /**
@@ -226,15 +935,109 @@ class EntityManager {
    * \return The number of free entities.
    */
   snowflake_nodiscard auto entities_free() const noexcept -> size_t {
-    return entities_created() - entities_active();
+    return free_;
   }
 
  private:
-  Entities   entities_         = {};      //!< All entities in the manager.
-  Pools      static_id_pools_  = {};      //!< Pools with compile time ids.
-  Pools      dynamic_id_pools_ = {};      //!< Pools with non compile time ids.
-  Allocator* allocator_        = nullptr; //!< Allocator for the entities.
-  size_t     next_             = Entity::null_id; //!< Index of the next entity.
+  // clang-format off
+  Entities         entities_         = {};      //!< All entities.
+  StaticPools      static_pools_     = {};      //!< Listed component pools.
+  Pools            static_id_pools_  = {};      //!< Pools with static ids.
+  Pools            dynamic_id_pools_ = {};      //!< Pools with dynamic ids.
+  Groups           groups_           = {};      //!< Owning groups of pools.
+  Queries          queries_          = {};      //!< Persistent queries.
+  EntityAllocator* allocator_        = nullptr; //!< Allocator for entities.
+  size_t           next_             = Entity::null_id; //!< Next entity index.
+  size_t           free_             = 0;       //!< Number of free entities.
+  // clang-format on
+
+  /**
+   * Removes the entities in the range [\p first, \p last) which are in the
+   * \p pool from the pool.
+   * \param  pool     The pool to remove the entities from.
+   * \param  first    An iterator to the first entity to remove.
+   * \param  last     An iterator to one past the last entity to remove.
+   * \tparam Pool     The type of the pool.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Pool, typename Iterator>
+  auto remove_all(Pool& pool, Iterator first, Iterator last) -> void {
+    if (pool.empty()) {
+      return;
+    }
+    for (; first != last; ++first) {
+      if (pool.exists(*first)) {
+        pool.remove(*this, *first);
+      }
+    }
+  }
+
+  /**
+   * Callback for a group when a component is added to one of its pools.
+   * \param  group  A pointer to the group.
+   * \param  entity The entity which gained the component.
+   * \tparam GroupType The type of the group.
+   */
+  template <typename GroupType>
+  static auto group_construct(void* group, const Entity& entity) -> void {
+    static_cast<GroupType*>(group)->construct(entity);
+  }
+
+  /**
+   * Callback for a group when a component is removed from one of its pools.
+   * \param  group  A pointer to the group.
+   * \param  entity The entity which will lose the component.
+   * \tparam GroupType The type of the group.
+   */
+  template <typename GroupType>
+  static auto group_destroy(void* group, const Entity& entity) -> void {
+    static_cast<GroupType*>(group)->destroy(entity);
+  }
+
+  /**
+   * Key which identifies the type of a query.
+   * \tparam QueryType The type of the query.
+   */
+  template <typename QueryType>
+  static constexpr char query_key = 0;
+
+  /**
+   * Listener for a query when a component is added to one of its pools.
+   * \param  query     The query.
+   * \param  entity    The entity which gained the component.
+   * \tparam QueryType The type of the query.
+   */
+  template <typename QueryType>
+  static auto query_construct(
+    QueryType& query, EntityManager&, const Entity& entity) -> void {
+    query.construct(entity);
+  }
+
+  /**
+   * Listener for a query when a component is removed from one of its pools.
+   * \param  query     The query.
+   * \param  entity    The entity which will lose the component.
+   * \tparam QueryType The type of the query.
+   */
+  template <typename QueryType>
+  static auto query_destroy(
+    QueryType& query, EntityManager&, const Entity& entity) -> void {
+    query.destroy(entity);
+  }
+
+  /**
+   * Sets the \p group as the owner of the \p pool.
+   * \param  pool      The pool to set the owner of.
+   * \param  group     The group which owns the pool.
+   * \tparam GroupType The type of the group.
+   * \tparam Pool      The type of the pool.
+   */
+  template <typename GroupType, typename Pool>
+  static auto own_pool(Pool& pool, GroupType* group) noexcept -> void {
+    pool.group           = group;
+    pool.group_construct = &group_construct<GroupType>;
+    pool.group_destroy   = &group_destroy<GroupType>;
+  }
 
   /**
    * Fetches the pool for a specific component. If the requested component type
@@ -247,7 +1050,7 @@ class EntityManager {
    */
   template <typename Component, constexpr_component_enable_t<Component> = 0>
   snowflake_nodiscard auto
-  get_component() const -> const ComponentPool<Component>& {
+  get_pool() const -> const ComponentPool<Component>& {
     constexpr auto comp_id = component_id_v<Component>;
     assert(comp_id < static_id_pools_.size() && "Invalid component!");
     auto& pool = static_id_pools_[comp_id];
@@ -268,7 +1071,7 @@ class EntityManager {
    */
   template <typename Component, nonconstexpr_component_enable_t<Component> = 0>
   snowflake_nodiscard auto
-  get_component() const -> const ComponentPool<Component>& {
+  get_pool() const -> const ComponentPool<Component>& {
     const auto comp_id = component_id<Component>();
     assert(comp_id < dynamic_id_pools_.size());
     auto& pool = dynamic_id_pools_[comp_id];
@@ -277,6 +1080,81 @@ class EntityManager {
     return *static_cast<const ComponentPool<Component>*>(pool.pool.get());
   }
 
+  /**
+   * Finds the pool for a specific component, without creating it.
+   * \tparam Component The type of the component to find the pool for.
+   * \return A pointer to the pool, or nullptr if the pool does not exist.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto
+  find_component() const -> const ComponentPool<Component>* {
+    if constexpr (Config::static_components) {
+      return &get_component<Component>();
+    } else {
+      return find_pool<Component>();
+    }
+  }
+
+  /**
+   * Gets the pool for a specific component.
+   *
+   * \note For managers whose components are not known at compile time, if the
+   *       pool has not been created, this will assert in debug, and cause
+   *       undefined behaviour in release.
+   *
+   * \tparam Component The type of the component to get the pool for.
+   * \return A reference to the pool.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto
+  get_component() const -> const ComponentPool<Component>& {
+    if constexpr (Config::static_components) {
+      static_assert(
+        Config::template contains<Component>,
+        "Component is not in the component list of the manager!");
+      return std::get<ComponentPool<Component>>(static_pools_);
+    } else {
+      return get_pool<Component>();
+    }
+  }
+
+  /**
+   * Gets the pool for a specific component, creating it if the manager's
+   * components are not known at compile time and it does not exist.
+   * \tparam Component The type of the component to get the pool for.
+   * \return A reference to the pool.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto ensure_component() -> ComponentPool<Component>& {
+    if constexpr (Config::static_components) {
+      static_assert(
+        Config::template contains<Component>,
+        "Component is not in the component list of the manager!");
+      return std::get<ComponentPool<Component>>(static_pools_);
+    } else {
+      return ensure_pool<Component>();
+    }
+  }
+
+  /**
+   * Finds the pool for a specific component, in the pools which are created
+   * on demand, without creating it.
+   * \tparam Component The type of the component to find the pool for.
+   * \return A pointer to the pool, or nullptr if the pool does not exist.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto
+  find_pool() const -> const ComponentPool<Component>* {
+    const auto  comp_id = component_id<Component>();
+    const auto& pools   = constexpr_component_id_v<Component>
+                            ? static_id_pools_
+                            : dynamic_id_pools_;
+    return comp_id < pools.size()
+             ? static_cast<const ComponentPool<Component>*>(
+                 pools[comp_id].pool.get())
+             : nullptr;
+  }
+
   /**
    * Fetches the pool for a specific component. If the requested component
    * type doesn't exist then this will allocate a new pool for the component
@@ -288,13 +1166,13 @@ class EntityManager {
    * \tparam Component The type of the component to fetch the pool for.
    */
   template <typename Component, constexpr_component_enable_t<Component> = 0>
-  snowflake_nodiscard auto ensure_component() -> ComponentPool<Component>& {
+  snowflake_nodiscard auto ensure_pool() -> ComponentPool<Component>& {
     constexpr auto comp_id = component_id_v<Component>;
     while (comp_id >= static_id_pools_.size()) {
       static_id_pools_.emplace_back();
     }
     auto& pool = static_id_pools_[comp_id];
-    pool.initialize(comp_id);
+    pool.template initialize<ComponentPool<Component>>(comp_id);
 
     return *static_cast<ComponentPool<Component>*>(pool.pool.get());
   }
@@ -310,13 +1188,13 @@ class EntityManager {
    * \tparam Component The type of the component to fetch the pool for.
    */
   template <typename Component, nonconstexpr_component_enable_t<Component> = 0>
-  snowflake_nodiscard auto ensure_component() -> ComponentPool<Component>& {
+  snowflake_nodiscard auto ensure_pool() -> ComponentPool<Component>& {
     const auto comp_id = component_id<Component>();
     while (comp_id >= dynamic_id_pools_.size()) {
       dynamic_id_pools_.emplace_back();
     }
     auto& pool = dynamic_id_pools_[comp_id];
-    pool.initialize(comp_id);
+    pool.template initialize<ComponentPool<Component>>(comp_id);
 
     return *static_cast<ComponentPool<Component>*>(pool.pool.get());
   }
@@ -0,0 +1,232 @@
+//==--- snowflake/ecs/group.hpp ---------------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  group.hpp
+/// \brief This file defines an owning group of component storages.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_GROUP_HPP
+#define SNOWFLAKE_ECS_GROUP_HPP
+
+#include "soa_storage.hpp"
+#include "view.hpp"
+
+namespace snowflake {
+
+/**
+ * Owning group of component storages, which keeps all entities which have
+ * *all* of the components in the group packed at the front of the storages,
+ * in the same order in each of the storages.
+ *
+ * This means that iteration over a group is a linear walk over N parallel
+ * arrays, without any indirection through the sparse arrays, which is as
+ * cache-friendly as iteration can be, and allows the iteration to be
+ * vectorised.
+ *
+ * The ordering is maintained by swapping entities within the storages when
+ * they gain or lose one of the components in the group, so the group must be
+ * notified through construct() *after* a component is added to one of the
+ * storages, and through destroy() *before* a component is removed from one of
+ * the storages. The EntityManager does this for groups which it creates.
+ *
+ * \note A storage can be owned by only a single group, since the group
+ *       requires control of the ordering of the storage.
+ *
+ * \note Storages with a structure-of-arrays layout can't be owned by a group,
+ *       since the group iterates over the components as contiguous objects.
+ *
+ * \note Reordering the owned storages by any other means (i.e swapping
+ *       components) will break the group.
+ *
+ * \tparam Storages The types of the owned storages.
+ */
+template <typename... Storages>
+class Group {
+  static_assert(
+    sizeof...(Storages) > 0, "Group requires at least one storage!");
+  static_assert(
+    !(soa_storage_v<Storages> || ...),
+    "Group can't own a storage with a structure-of-arrays layout!");
+
+  // clang-format off
+  /** Defines the type of the sparse set for the storage. */
+  using Set   = detail::sparse_set_t<
+    std::tuple_element_t<0, std::tuple<Storages...>>>;
+  /** Defines the type of the container of the storages. */
+  using Pools = std::tuple<Storages*...>;
+  // clang-format on
+
+ public:
+  // clang-format off
+  /** Defines the type of the entities in the group. */
+  using Entity   = std::decay_t<decltype(*std::declval<Set>().rbegin())>;
+  /** Defines the size type for the group. */
+  using SizeType = typename Set::SizeType;
+  // clang-format on
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Constructor to create the group from the storages. This sorts any
+   * entities which are already in all of the storages into the group.
+   * \param storages The storages owned by the group.
+   */
+  Group(Storages&... storages) noexcept : pools_{&storages...} {
+    const Set* smallest = std::get<0>(pools_);
+    ((smallest = storages.size() < smallest->size() ? &storages : smallest),
+     ...);
+
+    // Iterating from the front of the smallest set is valid since swaps in
+    // the smallest set only ever move entities to positions before the
+    // current one.
+    for (SizeType i = 0; i < smallest->size(); ++i) {
+      construct(smallest->rbegin()[i]);
+    }
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Returns the number of entities in the group.
+   * \return The number of entities in the group.
+   */
+  snowflake_nodiscard auto size() const noexcept -> SizeType {
+    return size_;
+  }
+
+  /**
+   * Determines if the group is empty.
+   * \return __true__ if there are no entities in the group.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return size_ == 0;
+  }
+
+  /**
+   * Determines if the \p entity is in the group.
+   * \param entity The entity to check.
+   * \return __true__ if the entity is in the group.
+   */
+  snowflake_nodiscard auto
+  contains(const Entity& entity) const noexcept -> bool {
+    const auto& front = *std::get<0>(pools_);
+    return front.exists(entity) && front.index(entity) < size_;
+  }
+
+  /**
+   * Notifies the group that a component has been added to the \p entity in
+   * one of the owned storages. If the entity now has all the components in
+   * the group then it is moved into the group.
+   * \param entity The entity which gained a component.
+   */
+  auto construct(const Entity& entity) noexcept -> void {
+    if (!(std::get<Storages*>(pools_)->exists(entity) && ...) ||
+        contains(entity)) {
+      return;
+    }
+    (move_to(*std::get<Storages*>(pools_), entity, size_), ...);
+    ++size_;
+  }
+
+  /**
+   * Notifies the group that a component is *about to be* removed from the
+   * \p entity in one of the owned storages. If the entity is in the group then
+   * it is moved out of the group.
+   * \param entity The entity which will lose a component.
+   */
+  auto destroy(const Entity& entity) noexcept -> void {
+    if (!contains(entity)) {
+      return;
+    }
+    --size_;
+    (move_to(*std::get<Storages*>(pools_), entity, size_), ...);
+  }
+
+  /**
+   * Gets a pointer to the packed data for the group in the \p Storage, for the
+   * first size() elements.
+   * \tparam Storage The type of the storage to get the data for.
+   * \return A pointer to the packed components in the group.
+   */
+  template <typename Storage>
+  snowflake_nodiscard auto data() const noexcept {
+    return std::get<Storage*>(pools_)->rbegin();
+  }
+
+  /**
+   * Gets a pointer to the packed entities in the group, for the first size()
+   * elements.
+   * \return A pointer to the packed entities in the group.
+   */
+  snowflake_nodiscard auto entities() const noexcept -> const Entity* {
+    return static_cast<const Set*>(std::get<0>(pools_))->rbegin();
+  }
+
+  /**
+   * Applies the \p functor to each entity in the group, and all of the
+   * components in the group for the entity.
+   *
+   * The functor can either take the entity followed by the components, or
+   * just the components, for example:
+   *
+   * ~~~{.cpp}
+   * group.each([] (Entity e, Position& p, Velocity& v) { ... });
+   * group.each([] (Position& p, Velocity& v) { ... });
+   * ~~~
+   *
+   * \note This iterates linearly over the packed arrays from the front.
+   *
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each(Functor&& functor) const -> void {
+    const auto* ents = entities();
+    std::apply(
+      [&](auto... comps) {
+        for (SizeType i = 0; i < size_; ++i) {
+          using Invocable =
+            std::is_invocable<Functor, Entity, decltype(*comps)...>;
+          if constexpr (Invocable::value) {
+            functor(ents[i], comps[i]...);
+          } else {
+            functor(comps[i]...);
+          }
+        }
+      },
+      std::make_tuple(data<Storages>()...));
+  }
+
+ private:
+  Pools    pools_ = {}; //!< Storages owned by the group.
+  SizeType size_  = 0;  //!< Number of entities in the group.
+
+  /**
+   * Moves the \p entity to the \p index in the \p storage.
+   * \param  storage The storage to move the entity in.
+   * \param  entity  The entity to move.
+   * \param  index   The index to move the entity to.
+   * \tparam Storage The type of the storage.
+   */
+  template <typename Storage>
+  static auto
+  move_to(Storage& storage, const Entity& entity, SizeType index) noexcept
+    -> void {
+    const Entity other = static_cast<const Set&>(storage).rbegin()[index];
+    if (other != entity) {
+      storage.swap(entity, other);
+    }
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_GROUP_HPP
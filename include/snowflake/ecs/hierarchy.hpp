@@ -0,0 +1,446 @@
+//==--- snowflake/ecs/hierarchy.hpp ------------------------ -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  hierarchy.hpp
+/// \brief This file defines a parent/child hierarchy component, and a system
+///        which propagates transforms through the hierarchy.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_HIERARCHY_HPP
+#define SNOWFLAKE_ECS_HIERARCHY_HPP
+
+#include "entity_manager.hpp"
+#include <snowflake/util/thread_pool.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Component which places an entity in a hierarchy, as the child of the
+ * \p parent entity. Entities with a null parent, or whose parent is not in
+ * the hierarchy, are roots.
+ *
+ * The depth and dirty flag are maintained by the TransformHierarchy, and
+ * should not be modified directly.
+ *
+ * \tparam Entity The type of the entity.
+ */
+template <typename Entity>
+struct HierarchyNode {
+  Entity   parent = {};   //!< The parent of the entity.
+  uint32_t depth  = 0;    //!< The depth of the entity in the hierarchy.
+  bool     dirty  = true; //!< If the local transform has changed.
+};
+
+/**
+ * System which propagates \p Local transforms through a hierarchy of entities
+ * into \p World transforms, where every entity in the hierarchy must have a
+ * HierarchyNode, a \p Local, and a \p World component.
+ *
+ * The pools for the three components are kept sorted by depth, so that
+ * parents are before their children in each of the dense arrays, at the same
+ * index. Propagation is then a single linear pass over the arrays, one depth
+ * level at a time, where each level can be processed in parallel since it
+ * only reads from the levels before it. Nodes whose local transform has not
+ * changed, and which have no changed ancestors, are skipped.
+ *
+ * The \p CombineFn computes world transforms, and must be callable as both
+ * `combine(local)` for roots, and `combine(parent_world, local)` for children,
+ * returning a \p World, for example:
+ *
+ * ~~~{.cpp}
+ * struct Combine {
+ *   auto operator()(const Local& l) const -> World { ... }
+ *   auto operator()(const World& p, const Local& l) const -> World { ... }
+ * };
+ *
+ * TransformHierarchy<Entity, Local, World, Combine> hierarchy;
+ * hierarchy.attach(manager);
+ * hierarchy.set_parent(manager, child, parent);
+ * manager.patch<Local>(child, [] (Local& l) { ... });
+ * hierarchy.propagate(manager, pool);
+ * ~~~
+ *
+ * The system follows the signals for the components once attached to a
+ * manager. Changes to the structure of the hierarchy, or to the membership of
+ * the pools, cause the pools to be re-sorted on the next propagation, after
+ * which all world transforms are recomputed. Updates to \p Local components
+ * (through replace() or patch()) mark the node as dirty.
+ *
+ * \note \p Local components which are modified through get() or views do not
+ *       publish the update signal, so such nodes must be marked with
+ *       mark_dirty().
+ *
+ * \note The pools for the components are sorted, so they must not be owned
+ *       by a group.
+ *
+ * \tparam Entity    The type of the entity.
+ * \tparam Local     The type of the local transform component.
+ * \tparam World     The type of the world transform component.
+ * \tparam CombineFn The type of the function which combines transforms.
+ */
+template <
+  typename Entity,
+  typename Local,
+  typename World,
+  typename CombineFn>
+class TransformHierarchy {
+  static_assert(
+    !soa_layout_v<Local> && !soa_layout_v<World>,
+    "Transform components can't have a structure-of-arrays layout!");
+
+  // clang-format off
+  /** Defines the type of the hierarchy component. */
+  using Node  = HierarchyNode<Entity>;
+  /** Defines the type of the dense parent indices. */
+  using Index = uint32_t;
+  // clang-format on
+
+  /** Defines the index of the parent of a root. */
+  static constexpr Index no_parent = std::numeric_limits<Index>::max();
+
+ public:
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Creates the system.
+   * \param combine The function which combines transforms.
+   */
+  explicit TransformHierarchy(CombineFn combine = {}) noexcept
+  : combine_{std::move(combine)} {}
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  // Attached systems are referenced by the signals of the manager, so the
+  // system can't be copied or moved.
+
+  // clang-format off
+  /** Copy constructor -- deleted. */
+  TransformHierarchy(const TransformHierarchy&) = delete;
+  /** Move constructor -- deleted. */
+  TransformHierarchy(TransformHierarchy&&)      = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const TransformHierarchy&)     = delete;
+  /** Move assignment -- deleted. */
+  auto operator=(TransformHierarchy&&)          = delete;
+  // clang-format on
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Attaches the system to the \p manager, so that it follows changes to the
+   * components in the manager.
+   *
+   * \note The system must be detached before it is destroyed, if the manager
+   *       outlives it.
+   *
+   * \param  manager The manager to attach the system to.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto attach(Manager& manager) -> void {
+    connect<Node, true>(manager);
+    connect<Local, true>(manager);
+    connect<World, true>(manager);
+    manager.template on_update<Node>()
+      .template connect<&TransformHierarchy::restructure_on<Manager>>(*this);
+    manager.template on_update<Local>()
+      .template connect<&TransformHierarchy::dirty_on<Manager>>(*this);
+    restructure_ = true;
+  }
+
+  /**
+   * Detaches the system from the \p manager.
+   * \param  manager The manager to detach the system from.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto detach(Manager& manager) -> void {
+    connect<Node, false>(manager);
+    connect<Local, false>(manager);
+    connect<World, false>(manager);
+    manager.template on_update<Node>()
+      .template disconnect<&TransformHierarchy::restructure_on<Manager>>(
+        *this);
+    manager.template on_update<Local>()
+      .template disconnect<&TransformHierarchy::dirty_on<Manager>>(*this);
+  }
+
+  /**
+   * Sets the parent of the \p child to the \p parent, adding the child to the
+   * hierarchy if it is not already in it. A null \p parent makes the child a
+   * root.
+   *
+   * \note The child must have \p Local and \p World components before the
+   *       next propagation.
+   *
+   * \param  manager The manager for the entities.
+   * \param  child   The entity to set the parent of.
+   * \param  parent  The new parent of the child.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto set_parent(Manager& manager, const Entity& child, const Entity& parent)
+    -> void {
+    auto& nodes = manager.template ensure_component<Node>();
+    if (!nodes.exists(child)) {
+      nodes.emplace(manager, child, parent);
+    } else {
+      nodes.patch(manager, child, [&parent](Node& node) {
+        node.parent = parent;
+        node.dirty  = true;
+      });
+    }
+    restructure_ = true;
+  }
+
+  /**
+   * Marks the \p entity as dirty, so that its world transform, and those of
+   * its descendants, are recomputed by the next propagation.
+   * \param  manager The manager for the entity.
+   * \param  entity  The entity whose local transform has changed.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto mark_dirty(Manager& manager, const Entity& entity) -> void {
+    manager.template ensure_component<Node>().get(entity).dirty = true;
+    dirty_ = true;
+  }
+
+  /**
+   * Propagates the local transforms of the dirty nodes, and their
+   * descendants, into their world transforms.
+   * \param  manager The manager for the entities.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto propagate(Manager& manager) -> void {
+    propagate_with(manager, [](size_t begin, size_t end, auto&& functor) {
+      functor(begin, end);
+    });
+  }
+
+  /**
+   * Propagates the local transforms of the dirty nodes, and their
+   * descendants, into their world transforms, processing the nodes at each
+   * depth in parallel using the threads in the \p pool.
+   * \param  manager The manager for the entities.
+   * \param  pool    The thread pool to propagate with.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto propagate(Manager& manager, ThreadPool& pool) -> void {
+    propagate_with(manager, [&pool](size_t begin, size_t end, auto&& functor) {
+      const size_t grain = std::max(
+        size_t{256}, (end - begin) / (pool.concurrency() * 4));
+      pool.parallel_for(begin, end, grain, functor);
+    });
+  }
+
+  /**
+   * Returns the number of depth levels in the hierarchy, as of the last
+   * propagation.
+   * \return The number of levels in the hierarchy.
+   */
+  snowflake_nodiscard auto levels() const noexcept -> size_t {
+    return levels_.empty() ? 0 : levels_.size() - 1;
+  }
+
+ private:
+  // clang-format off
+  std::vector<Index>   parents_     = {};    //!< Dense parent indices.
+  std::vector<size_t>  levels_      = {};    //!< Start index of each level.
+  std::vector<uint8_t> changed_     = {};    //!< Nodes changed in a pass.
+  CombineFn            combine_;             //!< Combines transforms.
+  bool                 restructure_ = true;  //!< If the pools need sorting.
+  bool                 dirty_       = true;  //!< If any nodes are dirty.
+  // clang-format on
+
+  /*==--- [listeners] ------------------------------------------------------==*/
+
+  /**
+   * Listener for changes to the structure of the hierarchy, or the
+   * membership of the pools.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto restructure_on(Manager&, const Entity&) -> void {
+    restructure_ = true;
+  }
+
+  /**
+   * Listener for updates to the local transform of the \p entity.
+   * \param  manager The manager for the entity.
+   * \param  entity  The entity whose local transform was updated.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto dirty_on(Manager& manager, const Entity& entity) -> void {
+    auto& nodes = manager.template ensure_component<Node>();
+    if (nodes.exists(entity)) {
+      nodes.get(entity).dirty = true;
+      dirty_                  = true;
+    }
+  }
+
+  /**
+   * Connects, or disconnects, the restructure listener to the construction
+   * and destruction signals for the \p Component.
+   * \param  manager   The manager to connect to.
+   * \tparam Component The type of the component.
+   * \tparam Connect   If the listener is connected or disconnected.
+   * \tparam Manager   The type of the manager.
+   */
+  template <typename Component, bool Connect, typename Manager>
+  auto connect(Manager& manager) -> void {
+    constexpr auto listener = &TransformHierarchy::restructure_on<Manager>;
+    auto&          pool     = manager.template ensure_component<Component>();
+    if constexpr (Connect) {
+      pool.on_construct.template connect<listener>(*this);
+      pool.on_destroy.template connect<listener>(*this);
+    } else {
+      pool.on_construct.template disconnect<listener>(*this);
+      pool.on_destroy.template disconnect<listener>(*this);
+    }
+  }
+
+  /*==--- [implementation] -------------------------------------------------==*/
+
+  /**
+   * Propagates the transforms, using the \p for_each function to apply
+   * functors over ranges of indices.
+   * \param  manager  The manager for the entities.
+   * \param  for_each The function to apply functors over ranges with.
+   * \tparam Manager  The type of the manager.
+   * \tparam ForEach  The type of the range function.
+   */
+  template <typename Manager, typename ForEach>
+  auto propagate_with(Manager& manager, ForEach&& for_each) -> void {
+    auto& nodes  = manager.template ensure_component<Node>();
+    auto& locals = manager.template ensure_component<Local>();
+    auto& worlds = manager.template ensure_component<World>();
+    if (restructure_) {
+      restructure(nodes, locals, worlds);
+    }
+    if (!dirty_) {
+      return;
+    }
+
+    // Nodes are at the back of the other pools, after any entities which are
+    // not in the hierarchy:
+    const size_t size  = nodes.size();
+    auto         node  = nodes.rbegin();
+    auto         local = locals.rbegin() + (locals.size() - size);
+    auto         world = worlds.rbegin() + (worlds.size() - size);
+    for (size_t level = 0; level + 1 < levels_.size(); ++level) {
+      for_each(levels_[level], levels_[level + 1], [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+          const Index parent = parents_[i];
+          const bool  dirty =
+            node[i].dirty || (parent != no_parent && changed_[parent]);
+          changed_[i] = dirty;
+          if (!dirty) {
+            continue;
+          }
+          node[i].dirty = false;
+          if (parent == no_parent) {
+            world[i] = combine_(std::as_const(local[i]));
+          } else {
+            world[i] = combine_(
+              std::as_const(world[parent]), std::as_const(local[i]));
+          }
+        }
+      });
+    }
+    dirty_ = false;
+  }
+
+  /**
+   * Sorts the \p nodes by depth, and the \p locals and \p worlds in the same
+   * order, and computes the parent indices and depth levels. All nodes are
+   * marked as dirty, since nodes may have moved in the hierarchy.
+   * \param  nodes  The pool of hierarchy nodes.
+   * \param  locals The pool of local transforms.
+   * \param  worlds The pool of world transforms.
+   * \tparam Nodes  The type of the node pool.
+   * \tparam Locals The type of the local transform pool.
+   * \tparam Worlds The type of the world transform pool.
+   */
+  template <typename Nodes, typename Locals, typename Worlds>
+  auto restructure(Nodes& nodes, Locals& locals, Worlds& worlds) -> void {
+    assert(
+      nodes.group == nullptr && locals.group == nullptr &&
+      worlds.group == nullptr && "Can't sort pools owned by a group!");
+    const size_t size = nodes.size();
+    auto         node = nodes.rbegin();
+
+    // Resolve depths, walking up to the nearest resolved ancestor:
+    constexpr auto        unresolved = std::numeric_limits<uint32_t>::max();
+    std::vector<Index>    path;
+    std::vector<uint32_t> depths(size, unresolved);
+    for (size_t i = 0; i < size; ++i) {
+      Index current = static_cast<Index>(i);
+      while (depths[current] == unresolved) {
+        const auto& parent = node[current].parent;
+        if (parent.invalid() || !nodes.exists(parent) || path.size() >= size) {
+          assert(path.size() < size && "Hierarchy contains a cycle!");
+          depths[current] = 0;
+          break;
+        }
+        path.push_back(current);
+        current = static_cast<Index>(nodes.index(parent));
+      }
+      for (; !path.empty(); path.pop_back()) {
+        depths[path.back()] = depths[current] + 1;
+        current             = path.back();
+      }
+    }
+    for (size_t i = 0; i < size; ++i) {
+      node[i].depth = depths[i];
+      node[i].dirty = true;
+    }
+
+    // Iteration is from the back, so sorting by inverted depth places the
+    // shallowest nodes at the front of the dense array:
+    nodes.sort([](const Node& n) { return ~n.depth; });
+    locals.sort_as(nodes);
+    worlds.sort_as(nodes);
+
+    parents_.resize(size);
+    changed_.assign(size, 0);
+    levels_.clear();
+    node                 = nodes.rbegin();
+    const auto* entities =
+      static_cast<const detail::sparse_set_t<Nodes>&>(nodes).rbegin();
+    for (size_t i = 0; i < size; ++i) {
+      const auto& parent = node[i].parent;
+      parents_[i]        = parent.invalid() || !nodes.exists(parent)
+                             ? no_parent
+                             : static_cast<Index>(nodes.index(parent));
+      while (levels_.size() <= node[i].depth) {
+        levels_.push_back(i);
+      }
+      assert(
+        locals.exists(entities[i]) && worlds.exists(entities[i]) &&
+        "Hierarchy nodes must have local and world transforms!");
+    }
+    levels_.push_back(size);
+    restructure_ = false;
+    dirty_       = true;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_HIERARCHY_HPP
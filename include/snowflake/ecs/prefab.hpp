@@ -0,0 +1,197 @@
+//==--- snowflake/ecs/prefab.hpp --------------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  prefab.hpp
+/// \brief This file defines a prefab, which is a set of component values that
+///        can be instantiated for many entities at once.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_PREFAB_HPP
+#define SNOWFLAKE_ECS_PREFAB_HPP
+
+#include "entity_manager.hpp"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Prefab which records a set of component values once, and instantiates
+ * copies of them for many entities in bulk, for example:
+ *
+ * ~~~{.cpp}
+ * Prefab<Entity> bullet;
+ * bullet.set<Velocity>(0.0f, 10.0f).set<Damage>(5);
+ * bullet.instantiate(manager, 1000, std::back_inserter(bullets));
+ * ~~~
+ *
+ * Instantiation creates all the entities in a single batch, and then inserts
+ * the components for all of the entities into each pool in turn, so each
+ * pool is grown once and the value is broadcast into the new components,
+ * rather than emplacing each component for each entity. The construction
+ * signals are published for each of the new components, and groups and
+ * queries are updated, as for emplace().
+ *
+ * \tparam Entity    The type of the entities.
+ * \tparam Allocator The type of the allocator for the manager.
+ */
+template <
+  typename Entity,
+  typename Allocator = wrench::ObjectPoolAllocator<Entity>>
+class Prefab {
+  // clang-format off
+  /** Defines the type of the manager. */
+  using Manager  = EntityManager<Entity, Allocator>;
+  /** Defines the type of the function to insert a component. */
+  using InsertFn =
+    void (*)(Manager&, const Entity*, const Entity*, const void*);
+  // clang-format on
+
+  /**
+   * A recorded component value.
+   */
+  struct Entry {
+    uint32_t              key    = 0;       //!< Key for the component type.
+    InsertFn              insert = nullptr; //!< Inserts the component.
+    std::shared_ptr<void> value  = nullptr; //!< The component value.
+  };
+
+  // clang-format off
+  /** Defines the type of the container of entries. */
+  using Entries  = std::vector<Entry>;
+  /** Defines the type of the container of entities. */
+  using Entities = std::vector<Entity>;
+  // clang-format on
+
+ public:
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Sets the value of the \p Component in the prefab to a component
+   * constructed from the \p args, replacing any existing value.
+   * \param  args      Arguments for the construction of the component.
+   * \tparam Component The type of the component.
+   * \tparam Args      The types of the arguments.
+   * \return A reference to the prefab.
+   */
+  template <typename Component, typename... Args>
+  auto set(Args&&... args) -> Prefab& {
+    auto value = std::make_shared<Component>(
+      make_component<Component>(std::forward<Args>(args)...));
+    for (auto& entry : entries_) {
+      if (entry.key == component_key<Component>()) {
+        entry.value = std::move(value);
+        return *this;
+      }
+    }
+    entries_.push_back(
+      Entry{component_key<Component>(), &insert<Component>, std::move(value)});
+    return *this;
+  }
+
+  /**
+   * Removes the \p Component from the prefab, if it is in the prefab.
+   * \tparam Component The type of the component.
+   * \return A reference to the prefab.
+   */
+  template <typename Component>
+  auto unset() -> Prefab& {
+    entries_.erase(
+      std::remove_if(
+        entries_.begin(),
+        entries_.end(),
+        [](const Entry& e) { return e.key == component_key<Component>(); }),
+      entries_.end());
+    return *this;
+  }
+
+  /**
+   * Determines if the \p Component is in the prefab.
+   * \tparam Component The type of the component.
+   * \return __true__ if the prefab has a value for the component.
+   */
+  template <typename Component>
+  snowflake_nodiscard auto has() const noexcept -> bool {
+    return std::any_of(entries_.begin(), entries_.end(), [](const Entry& e) {
+      return e.key == component_key<Component>();
+    });
+  }
+
+  /**
+   * Returns the number of components in the prefab.
+   * \return The number of components.
+   */
+  snowflake_nodiscard auto size() const noexcept -> size_t {
+    return entries_.size();
+  }
+
+  /**
+   * Creates an entity in the \p manager with all the components in the
+   * prefab.
+   * \param manager The manager to create the entity in.
+   * \return The created entity.
+   */
+  auto instantiate(Manager& manager) -> Entity {
+    Entity entity;
+    instantiate(manager, 1, &entity);
+    return entity;
+  }
+
+  /**
+   * Creates \p count entities in the \p manager with all the components in
+   * the prefab, writing the entities to \p out.
+   * \param  manager        The manager to create the entities in.
+   * \param  count          The number of entities to create.
+   * \param  out            The output iterator to write the entities to.
+   * \tparam OutputIterator The type of the output iterator.
+   * \return The output iterator, one past the last written entity.
+   */
+  template <typename OutputIterator>
+  auto instantiate(Manager& manager, size_t count, OutputIterator out)
+    -> OutputIterator {
+    entities_.clear();
+    entities_.reserve(count);
+    manager.create(count, std::back_inserter(entities_));
+    const Entity* first = entities_.data();
+    for (const auto& entry : entries_) {
+      entry.insert(manager, first, first + count, entry.value.get());
+    }
+    return std::copy(entities_.begin(), entities_.end(), out);
+  }
+
+ private:
+  Entries  entries_  = {}; //!< The recorded components.
+  Entities entities_ = {}; //!< Entities created by the last instantiation.
+
+  /**
+   * Inserts copies of the \p value into the pool for the \p Component for
+   * the entities in the range [\p first, \p last).
+   * \param  manager   The manager to insert the components into.
+   * \param  first     A pointer to the first entity.
+   * \param  last      A pointer to one past the last entity.
+   * \param  value     A pointer to the component value.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto insert(
+    Manager&      manager,
+    const Entity* first,
+    const Entity* last,
+    const void*   value) -> void {
+    manager.template insert<Component>(
+      first, last, *static_cast<const Component*>(value));
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_PREFAB_HPP
@@ -0,0 +1,213 @@
+//==--- snowflake/ecs/query.hpp ---------------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  query.hpp
+/// \brief This file defines a persistent query, which caches the entities
+///        which match it.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_QUERY_HPP
+#define SNOWFLAKE_ECS_QUERY_HPP
+
+#include "view.hpp"
+
+namespace snowflake {
+
+/**
+ * Persistent query over component storages, which keeps its own dense set of
+ * the entities which have *all* of the components in the query.
+ *
+ * Unlike a View, which probes every storage for each candidate entity, and
+ * unlike a Group, which owns and reorders its storages, a query only
+ * observes the storages. The set of matches is updated incrementally, so the
+ * query must be notified through construct() *after* a component is added to
+ * one of the storages, and through destroy() *before* a component is removed
+ * from one of the storages. The EntityManager does this for queries which it
+ * creates, through the signals for the components.
+ *
+ * Iterating over a query costs O(matches), and any number of queries can
+ * observe the same storages.
+ *
+ * \note The order of iteration is unspecified, and does not follow the order
+ *       of the storages.
+ *
+ * \tparam Storages The types of the observed storages.
+ */
+template <typename... Storages>
+class Query {
+  static_assert(
+    sizeof...(Storages) > 0, "Query requires at least one storage!");
+
+  // clang-format off
+  /** Defines the type of the sparse set for the storage. */
+  using Set   = detail::sparse_set_t<
+    std::tuple_element_t<0, std::tuple<Storages...>>>;
+  /** Defines the type of the container of the storages. */
+  using Pools = std::tuple<Storages*...>;
+  // clang-format on
+
+ public:
+  // clang-format off
+  /** Defines the type of the entities in the query. */
+  using Entity   = std::decay_t<decltype(*std::declval<Set>().rbegin())>;
+  /** Defines the size type for the query. */
+  using SizeType = typename Set::SizeType;
+  // clang-format on
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Constructor to create the query from the storages, which adds any
+   * entities which are already in all of the storages to the query.
+   * \param storages The storages observed by the query.
+   */
+  Query(Storages&... storages) : pools_{&storages...} {
+    const Set* smallest = std::get<0>(pools_);
+    ((smallest = storages.size() < smallest->size() ? &storages : smallest),
+     ...);
+    for (SizeType i = 0; i < smallest->size(); ++i) {
+      construct(smallest->rbegin()[i]);
+    }
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Returns the number of entities which match the query.
+   * \return The number of matching entities.
+   */
+  snowflake_nodiscard auto size() const noexcept -> SizeType {
+    return matches_.size();
+  }
+
+  /**
+   * Determines if no entities match the query.
+   * \return __true__ if there are no matching entities.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return matches_.empty();
+  }
+
+  /**
+   * Determines if the \p entity matches the query.
+   * \param entity The entity to check.
+   * \return __true__ if the entity matches the query.
+   */
+  snowflake_nodiscard auto
+  contains(const Entity& entity) const noexcept -> bool {
+    return matches_.exists(entity);
+  }
+
+  /**
+   * Gets a pointer to the dense array of matching entities, for the first
+   * size() elements.
+   * \return A pointer to the matching entities.
+   */
+  snowflake_nodiscard auto entities() const noexcept -> const Entity* {
+    return matches_.rbegin();
+  }
+
+  /**
+   * Notifies the query that a component has been added to the \p entity in
+   * one of the observed storages. If the entity now has all the components in
+   * the query then it is added to the matches.
+   * \param entity The entity which gained a component.
+   */
+  auto construct(const Entity& entity) -> void {
+    if ((std::get<Storages*>(pools_)->exists(entity) && ...) &&
+        !matches_.exists(entity)) {
+      matches_.emplace(entity);
+    }
+  }
+
+  /**
+   * Notifies the query that a component is *about to be* removed from the
+   * \p entity in one of the observed storages. If the entity matches the
+   * query then it is removed from the matches.
+   * \param entity The entity which will lose a component.
+   */
+  auto destroy(const Entity& entity) noexcept -> void {
+    if (matches_.exists(entity)) {
+      matches_.erase(entity);
+    }
+  }
+
+  /**
+   * Applies the \p functor to each entity which matches the query, and all of
+   * the components in the query for the entity.
+   *
+   * The functor can either take the entity followed by the components, or
+   * just the components, for example:
+   *
+   * ~~~{.cpp}
+   * query.each([] (Entity e, Position& p, Velocity& v) { ... });
+   * query.each([] (Position& p, Velocity& v) { ... });
+   * ~~~
+   *
+   * \note Removing the components for the *currently iterated* entity is
+   *       valid, since the matches are iterated from the back to the front.
+   *
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each(Functor&& functor) const -> void {
+    for (auto it = matches_.begin(), end = matches_.end(); it != end; ++it) {
+      const Entity entity = *it;
+      if constexpr (std::is_invocable_v<
+                      Functor,
+                      Entity,
+                      decltype(std::declval<Storages&>().get(entity))...>) {
+        functor(entity, std::get<Storages*>(pools_)->get(entity)...);
+      } else {
+        functor(std::get<Storages*>(pools_)->get(entity)...);
+      }
+    }
+  }
+
+  /**
+   * Applies the \p functor to each entity which matches the query, and all of
+   * the components in the query for the entity, in parallel, using the
+   * threads in the \p pool. The functor has the same form as for each().
+   *
+   * \note The functor may be invoked concurrently, and must not add or remove
+   *       components from any of the storages in the query.
+   *
+   * \param  pool    The thread pool to execute the functor with.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto parallel_for_each(ThreadPool& pool, Functor&& functor) const -> void {
+    const Entity* ents = entities();
+    pool.parallel_for_aligned(ents, size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const Entity entity = ents[i];
+        if constexpr (std::is_invocable_v<
+                        Functor,
+                        Entity,
+                        decltype(std::declval<Storages&>().get(entity))...>) {
+          functor(entity, std::get<Storages*>(pools_)->get(entity)...);
+        } else {
+          functor(std::get<Storages*>(pools_)->get(entity)...);
+        }
+      }
+    });
+  }
+
+ private:
+  Pools pools_   = {}; //!< Storages observed by the query.
+  Set   matches_ = {}; //!< Entities which match the query.
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_QUERY_HPP
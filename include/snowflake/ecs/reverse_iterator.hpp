@@ -17,6 +17,8 @@
 #define SNOWFLAKE_ECS_REVERSE_ITERATOR_HPP
 
 #include <snowflake/util/portability.hpp>
+#include <cassert>
+#include <iterator>
 #include <type_traits>
 
 namespace snowflake {
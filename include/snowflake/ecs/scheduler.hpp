@@ -0,0 +1,446 @@
+//==--- snowflake/ecs/scheduler.hpp ------------------------ -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  scheduler.hpp
+/// \brief This file defines a scheduler which runs systems in parallel, based
+///        on the components which they read and write.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_SCHEDULER_HPP
+#define SNOWFLAKE_ECS_SCHEDULER_HPP
+
+#include "command_buffer.hpp"
+#include <snowflake/util/thread_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Declares the components which a system reads.
+ * \tparam Components The types of the components.
+ */
+template <typename... Components>
+struct Reads {};
+
+/**
+ * Declares the components which a system writes.
+ * \tparam Components The types of the components.
+ */
+template <typename... Components>
+struct Writes {};
+
+/**
+ * Timing information for a system.
+ */
+struct SystemTiming {
+  // clang-format off
+  /** Defines the type of the durations. */
+  using Duration = std::chrono::nanoseconds;
+  // clang-format on
+
+  const char* name  = nullptr; //!< The name of the system.
+  Duration    last  = {};      //!< Duration of the last run.
+  Duration    total = {};      //!< Duration of all runs.
+  uint64_t    runs  = 0;       //!< Number of runs.
+};
+
+/**
+ * Scheduler which runs systems on a thread pool, running systems which do
+ * not conflict in parallel.
+ *
+ * Each system declares the components which it reads and writes when it is
+ * added. Systems conflict if either writes a component which the other reads
+ * or writes, and conflicting systems run in the order in which they were
+ * added, while systems which do not conflict run concurrently, for example:
+ *
+ * ~~~{.cpp}
+ * Scheduler<Entity> scheduler{pool};
+ * scheduler.add<Reads<Velocity>, Writes<Position>>("move", move);
+ * scheduler.add<Reads<Health>, Writes<>>("check", check);   // With move.
+ * scheduler.add<Reads<Position>, Writes<Bounds>>("bound", bound); // After.
+ * scheduler.sync();
+ * scheduler.add<Reads<Bounds>, Writes<>>("collide", collide);
+ * scheduler.run(manager);
+ * ~~~
+ *
+ * Systems are invoked as `system(manager, commands)`, and must only make
+ * structural changes (creating and recycling entities, and emplacing and
+ * removing components) through the command buffer, which is private to the
+ * system. The command buffers are applied at sync points, which are added
+ * with sync(), and at the end of each run, and systems after a sync point
+ * only run once all systems before it have completed and the commands have
+ * been applied.
+ *
+ * The pools for all declared components are created before the systems run,
+ * so that systems do not modify the manager when they access them.
+ *
+ * \note Systems must only access the components which they declare. Systems
+ *       which only read a component should access it through a const
+ *       manager, since non-const access to components whose changes are
+ *       tracked marks them as changed.
+ *
+ * \note Structural changes through signals, or listeners connected to the
+ *       manager, run when the commands are applied, on the thread which calls
+ *       run().
+ *
+ * \tparam Entity    The type of the entities.
+ * \tparam Allocator The type of the allocator for the manager.
+ */
+template <
+  typename Entity,
+  typename Allocator = wrench::ObjectPoolAllocator<Entity>>
+class Scheduler {
+ public:
+  // clang-format off
+  /** Defines the type of the manager. */
+  using Manager  = EntityManager<Entity, Allocator>;
+  /** Defines the type of the command buffers for the systems. */
+  using Commands = CommandBuffer<Entity, Allocator>;
+  // clang-format on
+
+ private:
+  /**
+   * System which is run by the scheduler.
+   */
+  struct System {
+    // clang-format off
+    /** Defines the type of the function to run the system. */
+    using RunFn     = void (*)(void*, Manager&, Commands&);
+    /** Defines the type of the function to create the pools. */
+    using PrepareFn = void (*)(Manager&);
+    /** Defines the type of the component keys. */
+    using Keys      = std::vector<uint32_t>;
+    /** Defines the type of the indices of the dependent systems. */
+    using Indices   = std::vector<size_t>;
+    // clang-format on
+
+    std::shared_ptr<void> functor      = nullptr; //!< The system functor.
+    RunFn                 run          = nullptr; //!< Runs the functor.
+    PrepareFn             prepare      = nullptr; //!< Creates the pools.
+    Keys                  reads        = {};      //!< Components read.
+    Keys                  writes       = {};      //!< Components written.
+    Indices               dependents   = {};      //!< Systems after this.
+    size_t                dependencies = 0;       //!< Systems before this.
+  };
+
+  // clang-format off
+  /** Defines the type of the container for systems. */
+  using Systems   = std::vector<System>;
+  /** Defines the type of the container for command buffers. */
+  using Buffers   = std::deque<Commands>;
+  /** Defines the type of the container for timings. */
+  using Timings   = std::vector<SystemTiming>;
+  /** Defines the type of the counters for remaining dependencies. */
+  using Remaining = std::unique_ptr<std::atomic<size_t>[]>;
+  /** Defines the type of the container for sync points. */
+  using Syncs     = std::vector<size_t>;
+  // clang-format on
+
+ public:
+  /**
+   * Constructor to set the thread pool to run the systems on.
+   * \param pool The thread pool, which must outlive the scheduler.
+   */
+  explicit Scheduler(ThreadPool& pool) noexcept : pool_{&pool} {}
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  // clang-format off
+  /** Copy constructor -- deleted. */
+  Scheduler(const Scheduler&)       = delete;
+  /** Move constructor -- deleted. */
+  Scheduler(Scheduler&&)            = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const Scheduler&)  = delete;
+  /** Move assignment -- deleted. */
+  auto operator=(Scheduler&&)       = delete;
+  // clang-format on
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Adds a system which reads the components in \p ReadList and writes the
+   * components in \p WriteList, which runs after all conflicting systems
+   * which were added before it.
+   *
+   * \param  name      The name of the system, for the timings, which must
+   *                   outlive the scheduler.
+   * \param  functor   The system, which is invoked with the manager and the
+   *                   command buffer for the system.
+   * \tparam ReadList  The Reads list of components which are read.
+   * \tparam WriteList The Writes list of components which are written.
+   * \tparam Functor   The type of the system functor.
+   * \return The index of the system.
+   */
+  template <typename ReadList, typename WriteList, typename Functor>
+  auto add(const char* name, Functor&& functor) -> size_t {
+    using F = std::decay_t<Functor>;
+    System system;
+    system.functor = std::make_shared<F>(std::forward<Functor>(functor));
+    system.run     = [](void* f, Manager& manager, Commands& commands) {
+      (*static_cast<F*>(f))(manager, commands);
+    };
+    system.prepare = [](Manager& manager) {
+      ensure_pools(manager, ReadList{});
+      ensure_pools(manager, WriteList{});
+    };
+    system.reads  = keys(ReadList{});
+    system.writes = keys(WriteList{});
+
+    systems_.emplace_back(std::move(system));
+    buffers_.emplace_back();
+    timings_.push_back(SystemTiming{name});
+    built_ = false;
+    return systems_.size() - 1;
+  }
+
+  /**
+   * Adds a sync point after the systems which have been added, so that the
+   * systems added after it run once all systems before it have completed and
+   * their commands have been applied.
+   */
+  auto sync() -> void {
+    if (syncs_.empty() || syncs_.back() != systems_.size()) {
+      syncs_.push_back(systems_.size());
+    }
+    built_ = false;
+  }
+
+  /**
+   * Runs all the systems once, on the \p manager, and applies their commands
+   * at each sync point and at the end of the run.
+   *
+   * \note The manager must not be used by anything other than the systems
+   *       while this runs.
+   *
+   * \param manager The manager to run the systems on.
+   */
+  auto run(Manager& manager) -> void {
+    if (!built_) {
+      build();
+    }
+    for (const auto& system : systems_) {
+      system.prepare(manager);
+    }
+
+    manager_     = &manager;
+    size_t begin = 0;
+    for (size_t i = 0; i <= syncs_.size(); ++i) {
+      const size_t end = i < syncs_.size() ? syncs_[i] : systems_.size();
+      run_phase(begin, end);
+      Commands::apply(
+        manager,
+        buffers_.begin() + static_cast<ptrdiff_t>(begin),
+        buffers_.begin() + static_cast<ptrdiff_t>(end));
+      begin = end;
+    }
+    manager_ = nullptr;
+  }
+
+  /**
+   * Gets the number of systems in the scheduler.
+   * \return The number of systems.
+   */
+  snowflake_nodiscard auto size() const noexcept -> size_t {
+    return systems_.size();
+  }
+
+  /**
+   * Gets the number of systems which the system at \p index must wait for,
+   * within its phase.
+   * \param index The index of the system.
+   * \return The number of systems which must run before the system.
+   */
+  snowflake_nodiscard auto dependencies(size_t index) -> size_t {
+    if (!built_) {
+      build();
+    }
+    return systems_[index].dependencies;
+  }
+
+  /**
+   * Gets the timings for the systems, in the order the systems were added.
+   *
+   * \note The timings must not be read while the systems are running.
+   *
+   * \return The timings for the systems.
+   */
+  snowflake_nodiscard auto timings() const noexcept -> const Timings& {
+    return timings_;
+  }
+
+  /**
+   * Resets the timings for all systems.
+   */
+  auto reset_timings() noexcept -> void {
+    for (auto& timing : timings_) {
+      timing = SystemTiming{timing.name};
+    }
+  }
+
+ private:
+  Systems             systems_   = {};      //!< The systems to run.
+  Buffers             buffers_   = {};      //!< Command buffer per system.
+  Timings             timings_   = {};      //!< Timing per system.
+  Syncs               syncs_     = {};      //!< Indices of sync points.
+  Remaining           remaining_ = nullptr; //!< Dependencies remaining.
+  ThreadPool*         pool_      = nullptr; //!< Pool to run the systems on.
+  Manager*            manager_   = nullptr; //!< Manager for the current run.
+  ThreadPool::Counter pending_   = {0};     //!< Systems left in the phase.
+  bool                built_     = false;   //!< If the graph is up to date.
+
+  /**
+   * Gets the keys for the \p Components.
+   * \tparam List       The list of components.
+   * \tparam Components The types of the components.
+   * \return The sorted keys for the components.
+   */
+  template <template <typename...> typename List, typename... Components>
+  static auto keys(List<Components...>) -> std::vector<uint32_t> {
+    std::vector<uint32_t> result{component_key<Components>()...};
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  /**
+   * Creates the pools for the \p Components in the \p manager.
+   * \param  manager    The manager to create the pools in.
+   * \tparam List       The list of components.
+   * \tparam Components The types of the components.
+   */
+  template <template <typename...> typename List, typename... Components>
+  static auto ensure_pools(Manager& manager, List<Components...>) -> void {
+    (static_cast<void>(manager.template view<Components>()), ...);
+  }
+
+  /**
+   * Determines if the sorted \p a and \p b keys have any key in common.
+   * \param a The first keys.
+   * \param b The second keys.
+   * \return __true__ if any key is in both.
+   */
+  static auto overlaps(
+    const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) noexcept
+    -> bool {
+    auto i = a.begin(), j = b.begin();
+    while (i != a.end() && j != b.end()) {
+      if (*i == *j) {
+        return true;
+      }
+      *i < *j ? ++i : ++j;
+    }
+    return false;
+  }
+
+  /**
+   * Determines if the system \p a conflicts with the system \p b.
+   * \param a The first system.
+   * \param b The second system.
+   * \return __true__ if the systems can't run concurrently.
+   */
+  static auto conflicts(const System& a, const System& b) noexcept -> bool {
+    return overlaps(a.writes, b.writes) || overlaps(a.writes, b.reads) ||
+           overlaps(a.reads, b.writes);
+  }
+
+  /**
+   * Builds the dependency graph for the systems in each phase.
+   */
+  auto build() -> void {
+    for (auto& system : systems_) {
+      system.dependents.clear();
+      system.dependencies = 0;
+    }
+    size_t begin = 0;
+    for (size_t p = 0; p <= syncs_.size(); ++p) {
+      const size_t end = p < syncs_.size() ? syncs_[p] : systems_.size();
+      for (size_t j = begin; j < end; ++j) {
+        for (size_t i = begin; i < j; ++i) {
+          if (conflicts(systems_[i], systems_[j])) {
+            systems_[i].dependents.push_back(j);
+            ++systems_[j].dependencies;
+          }
+        }
+      }
+      begin = end;
+    }
+    remaining_ = std::make_unique<std::atomic<size_t>[]>(systems_.size());
+    built_     = true;
+  }
+
+  /**
+   * Runs the systems in the range [\p begin, \p end), returning once they
+   * have all completed.
+   * \param begin The index of the first system in the phase.
+   * \param end   The index of one past the last system in the phase.
+   */
+  auto run_phase(size_t begin, size_t end) -> void {
+    if (begin == end) {
+      return;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      remaining_[i].store(systems_[i].dependencies, std::memory_order_relaxed);
+    }
+    pending_.store(end - begin, std::memory_order_relaxed);
+    for (size_t i = begin; i < end; ++i) {
+      if (systems_[i].dependencies == 0) {
+        submit(i);
+      }
+    }
+    pool_->wait(pending_);
+  }
+
+  /**
+   * Submits the system at \p index to the pool.
+   * \param index The index of the system.
+   */
+  auto submit(size_t index) -> void {
+    pool_->submit(
+      ThreadPool::Task{&execute, this, index, index + 1, &pending_});
+  }
+
+  /**
+   * Runs the system at \p index, and submits the systems which depend on it
+   * once they have no remaining dependencies.
+   * \param data  A pointer to the scheduler.
+   * \param index The index of the system.
+   */
+  static auto execute(void* data, size_t index, size_t) -> void {
+    using Clock      = std::chrono::steady_clock;
+    auto&  scheduler = *static_cast<Scheduler*>(data);
+    auto&  system    = scheduler.systems_[index];
+    auto&  timing    = scheduler.timings_[index];
+    const auto start = Clock::now();
+    system.run(
+      system.functor.get(), *scheduler.manager_, scheduler.buffers_[index]);
+    timing.last = std::chrono::duration_cast<SystemTiming::Duration>(
+      Clock::now() - start);
+    timing.total += timing.last;
+    ++timing.runs;
+
+    for (const auto dependent : system.dependents) {
+      auto& remaining = scheduler.remaining_[dependent];
+      if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        scheduler.submit(dependent);
+      }
+    }
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_SCHEDULER_HPP
@@ -0,0 +1,481 @@
+//==--- snowflake/ecs/snapshot.hpp ------------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  snapshot.hpp
+/// \brief This file defines a binary snapshot format for entity managers.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_SNAPSHOT_HPP
+#define SNOWFLAKE_ECS_SNAPSHOT_HPP
+
+#include "entity_manager.hpp"
+#include <snowflake/util/mapped_file.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace snowflake {
+
+/**
+ * Defines the alignment of the arrays in a snapshot file.
+ */
+static constexpr size_t snapshot_alignment = cache_line_size;
+
+/**
+ * Header at the start of a snapshot file.
+ */
+struct SnapshotHeader {
+  /** Defines the magic value which identifies a snapshot file. */
+  static constexpr std::array<char, 8> snapshot_magic = {
+    'S', 'N', 'F', 'L', 'S', 'N', 'A', 'P'};
+  /** Defines the version of the snapshot format. */
+  static constexpr uint32_t snapshot_version = 1;
+
+  std::array<char, 8> magic       = snapshot_magic;   //!< File identifier.
+  uint32_t            version     = snapshot_version; //!< Format version.
+  uint32_t            entity_size = 0;                //!< Size of an entity.
+  uint64_t            entities    = 0;                //!< Entities created.
+  uint64_t            next        = 0;                //!< Next free entity.
+  uint64_t            free        = 0;                //!< Free entities.
+  uint64_t            offset      = 0;                //!< Entity array.
+  uint64_t            components  = 0;                //!< Component arrays.
+};
+
+/**
+ * Entry for the arrays for a component in a snapshot file. The entries
+ * follow the header, in the order of the components in the snapshot.
+ */
+struct SnapshotEntry {
+  uint64_t size             = 0; //!< Size of a component.
+  uint64_t count            = 0; //!< Number of components.
+  uint64_t entity_offset    = 0; //!< Offset of the dense entities.
+  uint64_t component_offset = 0; //!< Offset of the components.
+};
+
+/**
+ * Saves and loads the state of an entity manager to and from a binary file.
+ *
+ * The file is a header, followed by a table of entries for the components,
+ * and then the entity array of the manager, and the dense entity and
+ * component arrays of each of the component pools, each as a raw blob aligned
+ * to snapshot_alignment. Saving is therefore a handful of bulk writes, and
+ * loading maps the file and copies each blob straight into the storage with
+ * a single bulk copy, so that load time is dominated by the page faults for
+ * the mapped file rather than by parsing.
+ *
+ * The dense order of each pool is preserved, so any sorting of the pools is
+ * retained.
+ *
+ * \note The components in a snapshot are identified by their position in the
+ *       component list, since component ids are not stable between runs, so
+ *       the same list must be used for saving and loading.
+ *
+ * \note The snapshot format is native to the machine, and only valid for
+ *       components which are trivially copyable.
+ *
+ * \tparam Entity    The type of the entities.
+ * \tparam Allocator The type of the allocator for the manager.
+ */
+template <typename Entity, typename Allocator>
+class Snapshot {
+  /** Defines the type of the manager. */
+  using Manager = EntityManager<Entity, Allocator>;
+  /** Defines the type of the entity sets. */
+  using Entities = typename Manager::PoolData;
+
+ public:
+  /**
+   * Saves the entities in the \p manager, and the \p Components for the
+   * entities, to the file at \p path.
+   * \param  manager    The manager to save.
+   * \param  path       The path of the file to save to.
+   * \tparam Components The types of the components to save.
+   * \return __true__ if the snapshot was written.
+   */
+  template <typename... Components>
+  static auto save(const Manager& manager, const char* path) -> bool {
+    check_components<Components...>();
+    SnapshotHeader header;
+    header.entity_size = sizeof(Entity);
+    header.entities    = manager.entities_.size();
+    header.next        = manager.next_;
+    header.free        = manager.free_;
+    header.components  = sizeof...(Components);
+
+    // Compute the layout of the arrays to write.
+    std::array<SnapshotEntry, sizeof...(Components)> entries;
+    uint64_t offset = align(
+      sizeof(SnapshotHeader) + sizeof(SnapshotEntry) * entries.size());
+    header.offset = offset;
+    offset        = align(offset + sizeof(Entity) * header.entities);
+
+    size_t i = 0;
+    ((describe<Components>(manager, entries[i], offset), ++i), ...);
+
+    std::FILE* file = std::fopen(path, "wb");
+    if (file == nullptr) {
+      return false;
+    }
+    Writer writer{file};
+    writer.write(&header, sizeof(header));
+    writer.write(entries.data(), sizeof(SnapshotEntry) * entries.size());
+    writer.write_at(
+      header.offset,
+      manager.entities_.data(),
+      sizeof(Entity) * header.entities);
+    i = 0;
+    ((write_arrays<Components>(manager, writer, entries[i]), ++i), ...);
+    return std::fclose(file) == 0 && writer.ok;
+  }
+
+  /**
+   * Loads the entities, and the \p Components for the entities, from the
+   * snapshot file at \p path, into the \p manager.
+   *
+   * \note The manager must be empty, otherwise the snapshot is not loaded.
+   *
+   * \param  manager    The manager to load the snapshot into.
+   * \param  path       The path of the file to load.
+   * \tparam Components The types of the components to load, which must be the
+   *                    same as the components the snapshot was saved with.
+   * \return __true__ if the snapshot was loaded, or __false__ if the manager
+   *         is not empty, or the file could not be read, is corrupt, or does
+   *         not match the components.
+   */
+  template <typename... Components>
+  static auto load(Manager& manager, const char* path) -> bool {
+    check_components<Components...>();
+    if (!manager.entities_.empty()) {
+      return false;
+    }
+
+    const MappedFile file(path);
+    const auto*      header = header_of(file, sizeof...(Components));
+    if (header == nullptr) {
+      return false;
+    }
+    const auto* entries = reinterpret_cast<const SnapshotEntry*>(header + 1);
+    const bool  valid =
+      in_file(file, header->offset, header->entities, sizeof(Entity)) &&
+      check_free_list(file, *header) &&
+      check_entries<Components...>(file, entries);
+    if (!valid) {
+      return false;
+    }
+
+    const auto* entities =
+      reinterpret_cast<const Entity*>(file.data() + header->offset);
+    manager.entities_.assign(entities, entities + header->entities);
+    manager.next_ = static_cast<size_t>(header->next);
+    manager.free_ = static_cast<size_t>(header->free);
+
+    size_t i = 0;
+    ((adopt<Components>(manager, file, entries[i++])), ...);
+    return true;
+  }
+
+ private:
+  /**
+   * Writer for the blobs in the file, which pads the file to the offset of
+   * each blob.
+   */
+  struct Writer {
+    std::FILE* file     = nullptr; //!< File to write to.
+    uint64_t   position = 0;       //!< Current position in the file.
+    bool       ok       = true;    //!< If all writes succeeded.
+
+    /**
+     * Writes \p bytes bytes from \p data at the current position.
+     * \param data  The data to write.
+     * \param bytes The number of bytes to write.
+     */
+    auto write(const void* data, uint64_t bytes) noexcept -> void {
+      if (bytes > 0) {
+        ok = ok && std::fwrite(data, 1, bytes, file) == bytes;
+      }
+      position += bytes;
+    }
+
+    /**
+     * Pads the file up to \p offset and writes \p bytes bytes from \p data.
+     * \param offset The offset to write the data at.
+     * \param data   The data to write.
+     * \param bytes  The number of bytes to write.
+     */
+    auto write_at(uint64_t offset, const void* data, uint64_t bytes) noexcept
+      -> void {
+      static constexpr std::array<char, snapshot_alignment> zeros = {};
+      assert(offset >= position && offset - position <= zeros.size());
+      write(zeros.data(), offset - position);
+      write(data, bytes);
+    }
+  };
+
+  /**
+   * Defines the size of each element of the blob for a \p Component, which
+   * is zero for empty components, which only store the entities.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static constexpr uint64_t blob_size =
+    std::is_empty_v<Component> ? 0 : sizeof(Component);
+
+  /**
+   * Checks that the \p Components can be stored in a snapshot.
+   * \tparam Components The types of the components.
+   */
+  template <typename... Components>
+  static constexpr auto check_components() noexcept -> void {
+    static_assert(
+      (std::is_trivially_copyable_v<Components> && ...),
+      "Snapshot components must be trivially copyable!");
+    static_assert(
+      !(soa_layout_v<Components> || ...),
+      "Snapshots are not supported for soa components!");
+  }
+
+  /**
+   * Aligns the \p offset to the alignment of the snapshot arrays.
+   * \param offset The offset to align.
+   * \return The aligned offset.
+   */
+  static constexpr auto align(uint64_t offset) noexcept -> uint64_t {
+    return (offset + snapshot_alignment - 1) / snapshot_alignment *
+           snapshot_alignment;
+  }
+
+  /**
+   * Determines if the array of \p count elements of \p size bytes at
+   * \p offset is in the \p file.
+   * \param file   The mapped file.
+   * \param offset The offset of the array.
+   * \param count  The number of elements in the array.
+   * \param size   The size of an element in the array.
+   * \return __true__ if the array is in the file.
+   */
+  static auto in_file(
+    const MappedFile& file,
+    uint64_t          offset,
+    uint64_t          count,
+    uint64_t          size) noexcept -> bool {
+    // The count is compared against the space left, rather than multiplying
+    // it by the size, so that corrupt counts can't overflow:
+    return offset % snapshot_alignment == 0 && offset <= file.size() &&
+           (size == 0 || count <= (file.size() - offset) / size);
+  }
+
+  /**
+   * Checks that the free list in the \p header is consistent with the
+   * entities in the \p file, so that a corrupt file can't corrupt the free
+   * list of the manager.
+   *
+   * \note The entity array must be in the file.
+   *
+   * \param file   The mapped file.
+   * \param header The header of the snapshot.
+   * \return __true__ if the free list is valid.
+   */
+  static auto
+  check_free_list(const MappedFile& file, const SnapshotHeader& header) noexcept
+    -> bool {
+    if (header.free > header.entities) {
+      return false;
+    }
+    const auto* entities =
+      reinterpret_cast<const Entity*>(file.data() + header.offset);
+
+    // Each free entity links to the next, and the last to the null id:
+    uint64_t next = header.next;
+    for (uint64_t i = 0; i < header.free; ++i) {
+      if (next >= header.entities) {
+        return false;
+      }
+      next = static_cast<uint64_t>(entities[next]);
+    }
+    return next == Entity::null_id;
+  }
+
+  /**
+   * Gets the header of the snapshot in the \p file, if the file is a valid
+   * snapshot with \p components components.
+   * \param file       The mapped file.
+   * \param components The number of components expected in the snapshot.
+   * \return A pointer to the header, or nullptr if the file is not valid.
+   */
+  static auto header_of(const MappedFile& file, size_t components) noexcept
+    -> const SnapshotHeader* {
+    const uint64_t bytes =
+      sizeof(SnapshotHeader) + sizeof(SnapshotEntry) * components;
+    if (!file.valid() || file.size() < bytes) {
+      return nullptr;
+    }
+    const auto* header = reinterpret_cast<const SnapshotHeader*>(file.data());
+    const bool  valid  = header->magic == SnapshotHeader::snapshot_magic &&
+                       header->version == SnapshotHeader::snapshot_version &&
+                       header->entity_size == sizeof(Entity) &&
+                       header->components == components;
+    return valid ? header : nullptr;
+  }
+
+  /**
+   * Checks that the \p entries match the \p Components, and that their
+   * arrays are in the \p file.
+   * \param  file       The mapped file.
+   * \param  entries    The entries for the components.
+   * \tparam Components The types of the components.
+   * \return __true__ if the entries are valid.
+   */
+  template <typename... Components>
+  static auto
+  check_entries(const MappedFile& file, const SnapshotEntry* entries) noexcept
+    -> bool {
+    constexpr std::array<uint64_t, sizeof...(Components)> sizes = {
+      blob_size<Components>...};
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      const auto& entry = entries[i];
+      const bool  valid =
+        entry.size == sizes[i] &&
+        in_file(file, entry.entity_offset, entry.count, sizeof(Entity)) &&
+        in_file(file, entry.component_offset, entry.count, entry.size);
+      if (!valid) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Fills the \p entry for the \p Component, and advances the \p offset past
+   * the arrays for the component.
+   * \param  manager   The manager with the component.
+   * \param  entry     The entry to fill.
+   * \param  offset    The offset for the arrays, which is advanced.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto
+  describe(const Manager& manager, SnapshotEntry& entry, uint64_t& offset)
+    -> void {
+    const auto* pool       = manager.template find_component<Component>();
+    entry.size             = blob_size<Component>;
+    entry.count            = pool != nullptr ? pool->size() : 0;
+    entry.entity_offset    = offset;
+    entry.component_offset = align(offset + sizeof(Entity) * entry.count);
+    offset = align(entry.component_offset + entry.size * entry.count);
+  }
+
+  /**
+   * Writes the arrays of entities and components for the \p Component,
+   * described by the \p entry, with the \p writer. Contiguous components are
+   * written with a single write, and paged components with a write per page.
+   * \param  manager   The manager with the component.
+   * \param  writer    The writer to write with.
+   * \param  entry     The entry for the component.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto write_arrays(
+    const Manager& manager, Writer& writer, const SnapshotEntry& entry)
+    -> void {
+    const auto* pool = manager.template find_component<Component>();
+    writer.write_at(
+      entry.entity_offset,
+      pool != nullptr ? static_cast<const Entities&>(*pool).rbegin() : nullptr,
+      sizeof(Entity) * entry.count);
+    writer.write_at(entry.component_offset, nullptr, 0);
+    if constexpr (!std::is_empty_v<Component>) {
+      if (entry.count == 0) {
+        return;
+      }
+      const auto components = pool->crbegin();
+      if constexpr (paged_storage_v<Component>) {
+        for (uint64_t i = 0; i < entry.count; i += component_page_size) {
+          const uint64_t count = std::min(
+            entry.count - i, static_cast<uint64_t>(component_page_size));
+          writer.write(&components[i], entry.size * count);
+        }
+      } else {
+        writer.write(components, entry.size * entry.count);
+      }
+    }
+  }
+
+  /**
+   * Copies the arrays for the \p Component described by the \p entry in the
+   * \p file into the pool for the component in the \p manager. The pool is
+   * created even if the snapshot has no components of the type, and the
+   * construction signal is published for each loaded component.
+   * \param  manager   The manager to load the component into.
+   * \param  file      The mapped file.
+   * \param  entry     The entry for the component.
+   * \tparam Component The type of the component.
+   */
+  template <typename Component>
+  static auto adopt(
+    Manager& manager, const MappedFile& file, const SnapshotEntry& entry)
+    -> void {
+    auto& pool = manager.template ensure_component<Component>();
+    if (entry.count == 0) {
+      return;
+    }
+    const auto* dense =
+      reinterpret_cast<const Entity*>(file.data() + entry.entity_offset);
+    const auto* components =
+      reinterpret_cast<const Component*>(file.data() + entry.component_offset);
+    pool.insert(manager, dense, dense + entry.count, components);
+  }
+};
+
+/**
+ * Saves the entities in the \p manager, and the \p Components for the
+ * entities, to a snapshot file at \p path.
+ *
+ * \see Snapshot
+ *
+ * \param  manager    The manager to save.
+ * \param  path       The path of the file to save to.
+ * \tparam Components The types of the components to save.
+ * \tparam Entity     The type of the entities.
+ * \tparam Allocator  The type of the allocator for the manager.
+ * \return __true__ if the snapshot was written.
+ */
+template <typename... Components, typename Entity, typename Allocator>
+auto save_snapshot(
+  const EntityManager<Entity, Allocator>& manager, const char* path) -> bool {
+  return Snapshot<Entity, Allocator>::template save<Components...>(
+    manager, path);
+}
+
+/**
+ * Loads the entities, and the \p Components for the entities, from the
+ * snapshot file at \p path into the empty \p manager.
+ *
+ * \see Snapshot
+ *
+ * \param  manager    The manager to load into.
+ * \param  path       The path of the file to load.
+ * \tparam Components The types of the components to load.
+ * \tparam Entity     The type of the entities.
+ * \tparam Allocator  The type of the allocator for the manager.
+ * \return __true__ if the snapshot was loaded.
+ */
+template <typename... Components, typename Entity, typename Allocator>
+auto load_snapshot(EntityManager<Entity, Allocator>& manager, const char* path)
+  -> bool {
+  return Snapshot<Entity, Allocator>::template load<Components...>(
+    manager, path);
+}
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_SNAPSHOT_HPP
@@ -0,0 +1,524 @@
+//==--- snowflake/ecs/soa_storage.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  soa_storage.hpp
+/// \brief This file defines structure-of-arrays storage for components.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_SOA_STORAGE_HPP
+#define SNOWFLAKE_ECS_SOA_STORAGE_HPP
+
+#include "component_traits.hpp"
+#include "sparse_set.hpp"
+#include <snowflake/util/aligned_allocator.hpp>
+
+namespace snowflake {
+
+/**
+ * Defines the alignment of the arrays for the fields in soa storage, which is
+ * sufficient for the widest vector instructions.
+ */
+static constexpr size_t soa_alignment = 64;
+
+/**
+ * Non-owning span over the contiguous data for a single field of the
+ * components in soa storage.
+ *
+ * \tparam T The type of the field.
+ */
+template <typename T>
+class FieldSpan {
+ public:
+  /**
+   * Constructor to set the data and the size of the span.
+   * \param data A pointer to the data.
+   * \param size The number of elements in the span.
+   */
+  FieldSpan(T* data, size_t size) noexcept : data_{data}, size_{size} {}
+
+  /**
+   * Gets a pointer to the data, which is aligned to soa_alignment.
+   * \return A pointer to the data.
+   */
+  snowflake_nodiscard auto data() const noexcept -> T* {
+    return data_;
+  }
+
+  /**
+   * Gets the number of elements in the span.
+   * \return The number of elements in the span.
+   */
+  snowflake_nodiscard auto size() const noexcept -> size_t {
+    return size_;
+  }
+
+  /**
+   * Gets a reference to the element at \p index.
+   * \param index The index of the element.
+   * \return A reference to the element.
+   */
+  snowflake_nodiscard auto operator[](size_t index) const noexcept -> T& {
+    return data_[index];
+  }
+
+  /**
+   * Gets a pointer to the first element in the span.
+   * \return A pointer to the first element.
+   */
+  snowflake_nodiscard auto begin() const noexcept -> T* {
+    return data_;
+  }
+
+  /**
+   * Gets a pointer to one past the last element in the span.
+   * \return A pointer to the end of the span.
+   */
+  snowflake_nodiscard auto end() const noexcept -> T* {
+    return data_ + size_;
+  }
+
+ private:
+  T*     data_ = nullptr; //!< Pointer to the data.
+  size_t size_ = 0;       //!< Number of elements.
+};
+
+namespace detail {
+
+/**
+ * Gets the type of the member for a pointer to a member.
+ * \tparam T The type of the pointer to the member.
+ */
+template <typename T>
+struct MemberType;
+
+/**
+ * Specialization for pointers to members.
+ * \tparam T The type of the member.
+ * \tparam C The type of the class.
+ */
+template <typename T, typename C>
+struct MemberType<T C::*> {
+  /** The type of the member. */
+  using type = T;
+};
+
+/**
+ * Defines the types of the arrays for each of the fields in a layout.
+ * \tparam Fields  The type of the tuple of pointers to members.
+ * \tparam Indices The indices of the fields.
+ */
+template <typename Fields, typename Indices>
+struct SoaArrays;
+
+/**
+ * Specialization to define the arrays for the fields.
+ * \tparam Fields The type of the tuple of pointers to members.
+ * \tparam Is     The indices of the fields.
+ */
+template <typename Fields, size_t... Is>
+struct SoaArrays<Fields, std::index_sequence<Is...>> {
+  /**
+   * Defines the type of the array for a field.
+   * \tparam T The type of the field.
+   */
+  template <typename T>
+  using Array = std::vector<T, AlignedAllocator<T, soa_alignment>>;
+
+  /** Defines the type of the tuple of arrays. */
+  using type = std::tuple<Array<typename MemberType<
+    std::decay_t<std::tuple_element_t<Is, Fields>>>::type>...>;
+};
+
+} // namespace detail
+
+/**
+ * Implementation of storage for components which stores the components with
+ * a structure-of-arrays layout, where each of the fields in the SoaLayout of
+ * the component is stored in a separate, aligned, array. The ordering of each
+ * of the field arrays is the same as the dense entity array.
+ *
+ * This allows loops which only touch some of the fields of the component to
+ * only load those fields, and allows the fields to be processed with wide
+ * vector instructions through the raw field spans.
+ *
+ * Since the component does not exist as a single object, access to a single
+ * component is through a proxy Reference, which references each of the
+ * fields.
+ *
+ * \see SoaLayout, ComponentStorage
+ *
+ * \tparam Entity          The type of the entity.
+ * \tparam Component       The type of the component.
+ * \tparam EntityAllocator The type of the entity allocator.
+ */
+template <
+  typename Entity,
+  typename Component,
+  typename EntityAllocator = wrench::ObjectPoolAllocator<Entity>>
+class SoaComponentStorage : public SparseSet<Entity, EntityAllocator> {
+  static_assert(
+    soa_layout_v<Component>,
+    "SoaComponentStorage requires an aggregate component with a SoaLayout!");
+
+  // clang-format off
+  /** Storage type for the entities */
+  using Entities = SparseSet<Entity, EntityAllocator>;
+  /** Defines the type of the tuple of field pointers. */
+  using Fields   = std::decay_t<decltype(SoaLayout<Component>::fields)>;
+  /** Defines the indices of the fields. */
+  using Indices  = std::make_index_sequence<std::tuple_size_v<Fields>>;
+  /** Defines the type of the arrays for the fields. */
+  using Arrays   = typename detail::SoaArrays<Fields, Indices>::type;
+  // clang-format on
+
+  /** The pointers to the members for each of the fields. */
+  static constexpr Fields fields = SoaLayout<Component>::fields;
+
+ public:
+  /** The size type. */
+  using SizeType = size_t;
+
+  /** The number of fields in the layout. */
+  static constexpr size_t field_count = std::tuple_size_v<Fields>;
+
+  /** The page size for the storage. */
+  static constexpr size_t page_size = Entities::page_size;
+
+  /**
+   * Defines the type of a field.
+   * \tparam I The index of the field.
+   */
+  template <size_t I>
+  using FieldType = typename detail::MemberType<
+    std::decay_t<std::tuple_element_t<I, Fields>>>::type;
+
+  /**
+   * Proxy reference to a component in the storage, which references each of
+   * the fields of the component.
+   *
+   * \tparam IsConst If the reference is const.
+   */
+  template <bool IsConst>
+  class Proxy {
+    friend class SoaComponentStorage;
+
+    /** Defines the type of the pointer to the arrays. */
+    using ArraysPtr = std::conditional_t<IsConst, const Arrays*, Arrays*>;
+
+    /**
+     * Constructor to set the arrays and the index of the component.
+     * \param arrays The arrays for the fields.
+     * \param index  The index of the component.
+     */
+    Proxy(ArraysPtr arrays, SizeType index) noexcept
+    : arrays_{arrays}, index_{index} {}
+
+   public:
+    /**
+     * Gets a reference to the field with index \p I.
+     * \tparam I The index of the field.
+     * \return A reference to the field.
+     */
+    template <size_t I>
+    snowflake_nodiscard auto get() const noexcept -> std::
+      conditional_t<IsConst, const FieldType<I>&, FieldType<I>&> {
+      return std::get<I>(*arrays_)[index_];
+    }
+
+    /**
+     * Loads the fields into a component.
+     * \return The component with the values of the fields.
+     */
+    snowflake_nodiscard auto load() const -> Component {
+      Component component{};
+      load_fields(component, Indices());
+      return component;
+    }
+
+    /**
+     * Conversion to the component type.
+     * \return The component with the values of the fields.
+     */
+    operator Component() const {
+      return load();
+    }
+
+    /**
+     * Stores the fields referenced by the \p other proxy. This assigns the
+     * values of the fields, and does not rebind the proxy.
+     * \param other The other proxy to store the fields of.
+     * \return A reference to this proxy.
+     */
+    auto operator=(const Proxy& other) -> const Proxy& {
+      return *this = other.load();
+    }
+
+    /**
+     * Stores the fields of the \p component.
+     * \param component The component to store.
+     * \return A reference to this proxy.
+     */
+    auto operator=(const Component& component) -> const Proxy& {
+      static_assert(!IsConst, "Can't assign through a const reference!");
+      store_fields(component, Indices());
+      return *this;
+    }
+
+   private:
+    ArraysPtr arrays_ = nullptr; //!< Arrays for the fields.
+    SizeType  index_  = 0;       //!< Index of the component.
+
+    /**
+     * Loads the fields into the \p component.
+     * \param  component The component to load into.
+     * \tparam Is        The indices of the fields.
+     */
+    template <size_t... Is>
+    auto load_fields(Component& component, std::index_sequence<Is...>) const
+      -> void {
+      ((component.*std::get<Is>(fields) = get<Is>()), ...);
+    }
+
+    /**
+     * Stores the fields of the \p component.
+     * \param  component The component to store.
+     * \tparam Is        The indices of the fields.
+     */
+    template <size_t... Is>
+    auto
+    store_fields(const Component& component, std::index_sequence<Is...>) const
+      -> void {
+      ((get<Is>() = component.*std::get<Is>(fields)), ...);
+    }
+  };
+
+  // clang-format off
+  /** The reference type for components in the storage. */
+  using Reference      = Proxy<false>;
+  /** The const reference type for components in the storage. */
+  using ConstReference = Proxy<true>;
+  // clang-format on
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Default constructor for storage -- this does not use an allocator for
+   * entities.
+   */
+  SoaComponentStorage() noexcept = default;
+
+  /**
+   * Constructor which sets the allocator for the entities.
+   * \param allocator The allocator for the entities.
+   */
+  SoaComponentStorage(EntityAllocator* allocator) noexcept
+  : Entities{allocator} {}
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Reserves enough space to emplace \p size compoennts.
+   * \param size The number of entities to reserve.
+   */
+  auto reserve(SizeType size) -> void {
+    std::apply(
+      [size](auto&... arrays) { (arrays.reserve(size), ...); }, arrays_);
+    Entities::reserve(size);
+  }
+
+  /**
+   * Emplaces a component into the storage, splitting the component into its
+   * fields.
+   *
+   * \note If the entity is already assosciated with this component, then this
+   *       will cause undefined behaviour in release, or assert in debug.
+   *
+   * \param  entity The entity to emplace the component for.
+   * \param  args   Arguments for the construciton of the component.
+   * \tparam Args  The type of the args.
+   */
+  template <typename... Args>
+  auto emplace(const Entity& entity, Args&&... args) -> void {
+    const Component component =
+      make_component<Component>(std::forward<Args>(args)...);
+    push_fields(component, Indices());
+    Entities::emplace(entity);
+  }
+
+  /**
+   * Removes the component assosciated with the entity from the storage.
+   *
+   * \note If the entity does not exist then this will assert in debug builds,
+   *       while in release builds it will cause undefined behaviour.
+   *
+   * \param entity The entity to remove.
+   */
+  auto erase(const Entity& entity) noexcept -> void {
+    const auto index = Entities::index(entity);
+    const bool last  = index == Entities::size() - 1;
+    std::apply(
+      [index, last](auto&... arrays) {
+        ((last ? void() : void(arrays[index] = std::move(arrays.back())),
+          arrays.pop_back()),
+         ...);
+      },
+      arrays_);
+    Entities::erase(entity);
+  }
+
+  /**
+   * Removes the components assosciated with all the entities in the range
+   * [\p first, \p last) from the storage, in a single batch.
+   *
+   * \note If any of the entities do not exist then this will assert in debug
+   *       builds, while in release builds it will cause undefined behaviour.
+   *
+   * \param  first    An iterator to the first entity to remove.
+   * \param  last     An iterator to one past the last entity to remove.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Iterator>
+  auto erase(Iterator first, Iterator last) noexcept -> void {
+    Entities::erase(first, last, [&](SizeType from, SizeType to) {
+      std::apply(
+        [from, to](auto&... arrays) {
+          ((arrays[to] = std::move(arrays[from])), ...);
+        },
+        arrays_);
+    });
+    std::apply(
+      [size = Entities::size()](auto&... arrays) {
+        (arrays.erase(arrays.begin() + size, arrays.end()), ...);
+      },
+      arrays_);
+  }
+
+  /**
+   * Swaps two components in the storage.
+   *
+   * \note If either of the entities assosciated with the components are not
+   *       present then this will cause undefined behaviour in release, or
+   *       assert in debug.
+   *
+   * \param a A component to swap with.
+   * \param b A component to swap with.
+   */
+  auto swap(const Entity& a, const Entity& b) noexcept -> void {
+    const auto index_a = Entities::index(a);
+    const auto index_b = Entities::index(b);
+    std::apply(
+      [index_a, index_b](auto&... arrays) {
+        (std::swap(arrays[index_a], arrays[index_b]), ...);
+      },
+      arrays_);
+    Entities::swap(a, b);
+  }
+
+  /**
+   * Gets a proxy reference to the component assosciated with the given
+   * entity.
+   *
+   * \note If the entity does not exist, this causes endefined behaviour in
+   *       release, or asserts in debug.
+   *
+   * \param entity The entity to get the component for.
+   * \return A proxy reference to the component.
+   */
+  auto get(const Entity& entity) noexcept -> Reference {
+    return Reference{&arrays_, Entities::index(entity)};
+  }
+
+  /**
+   * Gets a const proxy reference to the component assosciated with the given
+   * entity.
+   *
+   * \note If the entity does not exist, this causes endefined behaviour in
+   *       release, or asserts in debug.
+   *
+   * \param entity The entity to get the component for.
+   * \return A const proxy reference to the component.
+   */
+  auto get(const Entity& entity) const noexcept -> ConstReference {
+    return ConstReference{&arrays_, Entities::index(entity)};
+  }
+
+  /**
+   * Gets a span over the contiguous data for the field with index \p I, which
+   * is ordered the same as the dense entities.
+   * \tparam I The index of the field to get.
+   * \return A span over the data for the field.
+   */
+  template <size_t I>
+  snowflake_nodiscard auto field() noexcept -> FieldSpan<FieldType<I>> {
+    auto& array = std::get<I>(arrays_);
+    return FieldSpan<FieldType<I>>{array.data(), array.size()};
+  }
+
+  /**
+   * Gets a const span over the contiguous data for the field with index
+   * \p I, which is ordered the same as the dense entities.
+   * \tparam I The index of the field to get.
+   * \return A const span over the data for the field.
+   */
+  template <size_t I>
+  snowflake_nodiscard auto field() const noexcept
+    -> FieldSpan<const FieldType<I>> {
+    const auto& array = std::get<I>(arrays_);
+    return FieldSpan<const FieldType<I>>{array.data(), array.size()};
+  }
+
+ private:
+  Arrays arrays_ = {}; //!< Arrays for each of the fields.
+
+  /**
+   * Pushes the fields of the \p component onto the back of the arrays.
+   * \param  component The component to push.
+   * \tparam Is        The indices of the fields.
+   */
+  template <size_t... Is>
+  auto push_fields(const Component& component, std::index_sequence<Is...>)
+    -> void {
+    (std::get<Is>(arrays_).push_back(component.*std::get<Is>(fields)), ...);
+  }
+};
+
+namespace detail {
+
+/**
+ * Determines if the Storage is a SoaComponentStorage.
+ * \tparam Storage The type of the storage.
+ */
+template <typename Storage>
+struct IsSoaStorage : std::false_type {};
+
+/**
+ * Specialization for a SoaComponentStorage.
+ * \tparam Entity          The type of the entity.
+ * \tparam Component       The type of the component.
+ * \tparam EntityAllocator The type of the entity allocator.
+ */
+template <typename Entity, typename Component, typename EntityAllocator>
+struct IsSoaStorage<SoaComponentStorage<Entity, Component, EntityAllocator>>
+: std::true_type {};
+
+} // namespace detail
+
+/**
+ * True if the Storage stores its components with a structure-of-arrays
+ * layout.
+ * \tparam Storage The type of the storage.
+ */
+template <typename Storage>
+static constexpr bool soa_storage_v = detail::IsSoaStorage<Storage>::value;
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_SOA_STORAGE_HPP
@@ -18,7 +18,13 @@
 
 #include "entity.hpp"
 #include "reverse_iterator.hpp"
+#include <snowflake/util/virtual_memory.hpp>
 #include <wrench/memory/allocator.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
 #include <vector>
 
 namespace snowflake {
@@ -34,6 +40,35 @@ static constexpr size_t sparse_page_size =
   2 << 14;
 #endif
 
+/**
+ * Defines if the sparse pages are reserved from a single region of virtual
+ * memory, rather than allocated individually.
+ *
+ * When enabled, each sparse set reserves enough address space for the sparse
+ * entries of the first sparse_virtual_entities entities, and relies on the
+ * operating system to zero-fill pages on demand, so pages which are never
+ * touched use no resident memory and need no initialization. Pages for
+ * entities outside of the reservation, or which can't be reserved or
+ * committed, are allocated individually.
+ */
+static constexpr bool sparse_virtual_pages =
+#if defined(SNOWFLAKE_SPARSE_VIRTUAL_PAGES)
+  SNOWFLAKE_SPARSE_VIRTUAL_PAGES;
+#else
+  false;
+#endif
+
+/**
+ * Defines the number of entities for which each sparse set reserves virtual
+ * memory, when sparse_virtual_pages is enabled.
+ */
+static constexpr size_t sparse_virtual_entities =
+#if defined(SNOWFLAKE_SPARSE_VIRTUAL_ENTITIES)
+  SNOWFLAKE_SPARSE_VIRTUAL_ENTITIES;
+#else
+  size_t{1} << 24;
+#endif
+
 /**
  * Implementation of a sparse set, which stores two vectors -- one which is
  * sparse and another which is dense. The sparse array does cause memory
@@ -45,6 +80,12 @@ static constexpr size_t sparse_page_size =
  * through the sparse array is only required when inserting and deleting from
  * the set, which should not be on the hot path when this type is used.
  *
+ * The sparse pages store the index of the entity in the dense array *plus
+ * one*, so that an entity which is not in the set has an all-zero entry. This
+ * means that pages do not need to be initialized other than zero-filled,
+ * which the operating system does lazily for large allocations, and for
+ * pages reserved from virtual memory (see sparse_virtual_pages).
+ *
  * \note The order entities are inserted into the set is not preserved.
  *
  * \tparam Entity    The type of the entity.
@@ -59,8 +100,10 @@ class SparseSet {
     "Entity must be convertible to size type for use in sparse set!");
 
   // clang-format off
+  /** Defines the type of the entries in a page. */
+  using Index  = typename Entity::IdType;
   /** Defines the type of a page. */
-  using Page   = Entity*;
+  using Page   = Index*;
   /** Defines the type of the sparse container. */
   using Sparse = std::vector<Page>;
   /** Defines the type of the dense container. */
@@ -68,7 +111,11 @@ class SparseSet {
   // clang-format on
 
   /** Defines a nullpage. */
-  static constexpr Page nullpage = nullptr;
+  static constexpr Page  nullpage   = nullptr;
+  /** Defines the value of an entry for an entity not in the set. */
+  static constexpr Index null_index = 0;
+  /** Defines the entity which marks removed slots in the dense array. */
+  static constexpr Entity tombstone{std::numeric_limits<Index>::max()};
 
  public:
   // clang-format off
@@ -94,7 +141,7 @@ class SparseSet {
    * Constructor to set the allocator for the set.
    * \param allocator The allocator for the sparse set.
    */
-  SparseSet(Allocator* allocator) noexcept : allocator_{allocator_} {}
+  SparseSet(Allocator* allocator) noexcept : allocator_{allocator} {}
 
   /**
    * Destructor which cleans up the sparse pages. Here this is virtual so that
@@ -103,7 +150,8 @@ class SparseSet {
    */
   virtual ~SparseSet() noexcept {
     for (auto& page : sparse_) {
-      if (page == nullptr) {
+      // Virtual pages are released with the region.
+      if (page == nullptr || in_region(page)) {
         continue;
       }
 
@@ -192,7 +240,7 @@ class SparseSet {
   snowflake_nodiscard auto
   index(const Entity& entity) const noexcept -> SizeType {
     assert(exists(entity) && "Can't get the index of an invalid entity!");
-    return static_cast<SizeType>(page(entity)[offset(entity)]);
+    return static_cast<SizeType>(page(entity)[offset(entity)]) - 1;
   }
 
   /**
@@ -204,7 +252,7 @@ class SparseSet {
   snowflake_nodiscard auto exists(const Entity& entity) const noexcept -> bool {
     const auto page_id = page_index(entity);
     return page_id < sparse_.size() && sparse_[page_id] &&
-           !sparse_[page_id][offset(entity)].invalid();
+           sparse_[page_id][offset(entity)] != null_index;
   }
 
   /**
@@ -221,11 +269,54 @@ class SparseSet {
    */
   auto emplace(const Entity& entity) noexcept -> void {
     assert(!exists(entity) && "Entity already in sparse set!");
-    using IdType          = typename Entity::IdType;
-    sparse_entity(entity) = Entity{static_cast<IdType>(dense_.size())};
+    sparse_index(entity) = static_cast<Index>(dense_.size() + 1);
     dense_.emplace_back(entity);
   }
 
+  /**
+   * Inserts all the entities in the range [\p first, \p last) into the
+   * sparse set.
+   *
+   * This is more efficient than emplacing each of the entities, since the
+   * sparse and dense arrays are resized once, and the sparse entries are
+   * written grouped by page, so that each page is only looked up once. If
+   * the entities are not already ordered by page, the order in which the
+   * sparse entries are written is sorted by page, while the entities are
+   * still added to the dense array in the order of the range.
+   *
+   * \note This will assert in debug builds if any of the entities are already
+   *       in the set.
+   *
+   * \param  first    An iterator to the first entity to insert.
+   * \param  last     An iterator to one past the last entity to insert.
+   * \tparam Iterator The type of the iterator, which must be a forward
+   *                  iterator.
+   */
+  template <typename Iterator>
+  auto insert(Iterator first, Iterator last) -> void {
+    const SizeType start  = dense_.size();
+    SizeType       pages  = sparse_.size();
+    bool           sorted = true;
+    for (auto it = first, prev = first; it != last; prev = it++) {
+      sorted = sorted && page_index(*prev) <= page_index(*it);
+      pages  = std::max(pages, page_index(*it) + 1);
+    }
+    sparse_.resize(pages, nullpage);
+    dense_.insert(dense_.end(), first, last);
+
+    if (sorted) {
+      link(start, dense_.size(), [](SizeType i) { return i; });
+      return;
+    }
+
+    std::vector<SizeType> order(dense_.size() - start);
+    std::iota(order.begin(), order.end(), start);
+    std::sort(order.begin(), order.end(), [&](SizeType a, SizeType b) {
+      return page_index(dense_[a]) < page_index(dense_[b]);
+    });
+    link(0, order.size(), [&order](SizeType i) { return order[i]; });
+  }
+
   /**
    * Removes the \p entity from the sparse set.
    *
@@ -236,15 +327,37 @@ class SparseSet {
    */
   auto erase(const Entity& entity) noexcept -> void {
     assert(exists(entity) && "Erasing an entity not in the sparse set!");
-    auto& curr_sparse = sparse_entity(entity);
+    auto& curr_sparse = sparse_index(entity);
 
     // Swap the one to remove with the back one in dense:
-    dense_[curr_sparse]          = dense_.back();
-    sparse_entity(dense_.back()) = curr_sparse;
-    curr_sparse.reset();
+    dense_[curr_sparse - 1]     = dense_.back();
+    sparse_index(dense_.back()) = curr_sparse;
+    curr_sparse                 = null_index;
     dense_.pop_back();
   }
 
+  /**
+   * Removes all the entities in the range [\p first, \p last) from the
+   * sparse set.
+   *
+   * \note If any of the entities do not exist then this will assert in debug
+   *       builds, while in release builds it will cause undefined behaviour.
+   *
+   * \note The range must not be an iterator over this set, since removal
+   *       reorders the set.
+   *
+   * The entities are removed in a single batch, where each sparse entry is
+   * updated once, and the dense array is compacted once.
+   *
+   * \param  first    An iterator to the first entity to remove.
+   * \param  last     An iterator to one past the last entity to remove.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Iterator>
+  auto erase(Iterator first, Iterator last) noexcept -> void {
+    erase(first, last, [](SizeType, SizeType) {});
+  }
+
   /**
    * Swaps two entities in the sparse set.
    *
@@ -260,9 +373,9 @@ class SparseSet {
     assert(exists(a) && "Can't swap entity which doesn't exist!");
     assert(exists(b) && "Can't swap entity which doesn't exist!");
 
-    auto& sparse_a = sparse_entity(a);
-    auto& sparse_b = sparse_entity(b);
-    std::swap(dense_[sparse_a], dense_[sparse_b]);
+    auto& sparse_a = sparse_index(a);
+    auto& sparse_b = sparse_index(b);
+    std::swap(dense_[sparse_a - 1], dense_[sparse_b - 1]);
     std::swap(sparse_a, sparse_b);
   }
 
@@ -345,10 +458,154 @@ class SparseSet {
     return exists(entity) ? --Iterator(end() - index(entity)) : end();
   }
 
+ protected:
+  /**
+   * Removes all the entities in the range [\p first, \p last) from the
+   * sparse set in a single batch.
+   *
+   * The removed entities are first marked with a tombstone in the dense
+   * array. Each removed entity in the part of the dense array which remains
+   * is then replaced by the next remaining entity from the back of the dense
+   * array, so that each entity is moved at most once, and each sparse entry
+   * is written once, without any additional memory. For each entity which is
+   * moved, the \p move_data functor is invoked with the old and new
+   * positions, so that derived storages can move their data in the same way.
+   *
+   * \note If any of the entities do not exist, or if an entity is in the
+   *       range more than once, then this will assert in debug builds, while
+   *       in release builds it will cause undefined behaviour.
+   *
+   * \param  first     An iterator to the first entity to remove.
+   * \param  last      An iterator to one past the last entity to remove.
+   * \param  move_data The functor to move data between two positions.
+   * \tparam Iterator  The type of the iterator, which must be a forward
+   *                   iterator.
+   * \tparam MoveData  The type of the move functor.
+   */
+  template <typename Iterator, typename MoveData>
+  auto erase(Iterator first, Iterator last, MoveData&& move_data) noexcept
+    -> void {
+    SizeType removed = 0;
+    for (auto it = first; it != last; ++it, ++removed) {
+      assert(exists(*it) && "Erasing an entity not in the sparse set!");
+      assert(*it != tombstone && "Erasing a tombstone from the sparse set!");
+      auto& slot = dense_[sparse_index(*it) - 1];
+      assert(slot != tombstone && "Erasing an entity more than once!");
+      slot = tombstone;
+    }
+
+    const SizeType size = dense_.size() - removed;
+    SizeType       tail = size;
+    for (; first != last; ++first) {
+      auto&          entry = sparse_index(*first);
+      const SizeType hole  = entry - 1;
+      entry                = null_index;
+      if (hole >= size) {
+        continue;
+      }
+
+      while (dense_[tail] == tombstone) {
+        ++tail;
+      }
+      dense_[hole]               = dense_[tail];
+      sparse_index(dense_[hole]) = static_cast<Index>(hole + 1);
+      move_data(tail++, hole);
+    }
+    dense_.resize(size);
+  }
+
+  /**
+   * Rearranges the set so that the entity at position `i` in the dense array
+   * is the entity which was at position `order[i]`.
+   *
+   * The permutation is applied in place by following its cycles, and for
+   * each pair of positions which are swapped in the dense array, the
+   * \p swap_data functor is invoked with the positions, so that derived
+   * storages can swap their data in the same way.
+   *
+   * \note The \p order is used as scratch space and is modified.
+   *
+   * \param  order     The permutation to apply, which must have one index for
+   *                   each entity in the set.
+   * \param  swap_data The functor to swap data at two positions.
+   * \tparam SwapData  The type of the swap functor.
+   */
+  template <typename SwapData>
+  auto arrange(std::vector<SizeType>& order, SwapData&& swap_data) noexcept
+    -> void {
+    assert(order.size() == dense_.size() && "Invalid order for arrange!");
+    for (SizeType i = 0; i < order.size(); ++i) {
+      SizeType curr = i, next = order[i];
+      while (next != i) {
+        swap_at(curr, next);
+        swap_data(curr, next);
+        order[curr] = curr;
+        curr        = next;
+        next        = order[curr];
+      }
+      order[curr] = curr;
+    }
+  }
+
+  /**
+   * Rearranges the set so that the entities which are in both this set and
+   * the \p other set are iterated first, and in the same order as in the
+   * \p other set. Entities which are not in the \p other set are iterated
+   * after, in an unspecified order.
+   *
+   * For each pair of positions which are swapped in the dense array, the
+   * \p swap_data functor is invoked with the positions.
+   *
+   * \param  other          The other set to arrange in the order of.
+   * \param  swap_data      The functor to swap data at two positions.
+   * \tparam OtherAllocator The type of the allocator for the other set.
+   * \tparam SwapData       The type of the swap functor.
+   */
+  template <typename OtherAllocator, typename SwapData>
+  auto arrange_as(
+    const SparseSet<Entity, OtherAllocator>& other,
+    SwapData&&                               swap_data) noexcept -> void {
+    // Iteration is from the back of the dense array, so the shared entities
+    // are moved to the back in the other's iteration order.
+    SizeType pos = dense_.size();
+    for (auto it = other.begin(), end = other.end(); it != end && pos; ++it) {
+      if (!exists(*it)) {
+        continue;
+      }
+      const SizeType curr = index(*it);
+      if (curr != --pos) {
+        swap_at(curr, pos);
+        swap_data(curr, pos);
+      }
+    }
+  }
+
  private:
-  Sparse     sparse_    = {};      //!< Sparse array.
-  Dense      dense_     = {};      //!< Dense array,
-  Allocator* allocator_ = nullptr; //!< Pointer to allocator.
+  /** The number of bytes in a page. */
+  static constexpr size_t page_bytes = sizeof(Index) * page_size;
+  /** The maximum number of pages required for any entity. */
+  static constexpr size_t max_pages =
+    (size_t{std::numeric_limits<Index>::max()} + page_size) / page_size;
+  /** The number of pages in the region for virtual pages. */
+  static constexpr size_t virtual_pages = std::min(
+    max_pages, (sparse_virtual_entities + page_size - 1) / page_size);
+
+  Sparse        sparse_    = {};      //!< Sparse array.
+  Dense         dense_     = {};      //!< Dense array,
+  Allocator*    allocator_ = nullptr; //!< Pointer to allocator.
+  VirtualRegion region_    = {};      //!< Region for virtual pages.
+
+  /**
+   * Swaps the entities at positions \p a and \p b in the dense array, and
+   * updates their sparse entries.
+   * \param a The position of an entity to swap.
+   * \param b The position of an entity to swap.
+   */
+  auto swap_at(SizeType a, SizeType b) noexcept -> void {
+    std::swap(dense_[a], dense_[b]);
+    page(dense_[a])[offset(dense_[a])] = static_cast<Index>(a + 1);
+    page(dense_[b])[offset(dense_[b])] = static_cast<Index>(b + 1);
+  }
 
   /**
    * Gets the page index for the entity.
@@ -389,39 +646,94 @@ class SparseSet {
    *
    * \note This will call the allocator to allocate the page if the page at the
    *       given index had not been allocated. If the allocator is null, this
-   *       will call the global allocator.
+   *       will call the global allocator, which zero-fills the page. When
+   *       virtual pages are enabled, and the page is within the reserved
+   *       region, the page is a pointer into the region, which is committed
+   *       but not allocated or initialized. If the region can't be reserved,
+   *       or the page can't be committed, the page is allocated instead.
    *
    * \param index The index of the page to get.
    * \return A pointer to the page at the \p index.
    */
   snowflake_nodiscard auto fetch_page(SizeType index) noexcept -> Page& {
-    constexpr size_t page_byte_size = sizeof(Entity) * page_size;
-    while (sparse_.size() <= index) {
-      sparse_.emplace_back(nullpage);
+    if (sparse_.size() <= index) {
+      sparse_.resize(index + 1, nullpage);
+    }
+    if (sparse_[index] != nullpage) {
+      return sparse_[index];
     }
-    if (sparse_[index] == nullpage) {
-      sparse_[index] = static_cast<Page>(
-        allocator_ ? allocator_->alloc(page_byte_size)
-                   : malloc(page_byte_size));
 
-      for (auto *e = sparse_[index], *end = e + page_size; e != end; ++e) {
-        e->reset();
+    if constexpr (sparse_virtual_pages) {
+      if (index < virtual_pages) {
+        if (!region_.valid()) {
+          region_ = VirtualRegion{virtual_pages * page_bytes};
+        }
+        if (region_.commit(index * page_bytes, page_bytes)) {
+          sparse_[index] =
+            static_cast<Page>(region_.data()) + index * page_size;
+          return sparse_[index];
+        }
       }
     }
+
+    if (allocator_ != nullptr) {
+      sparse_[index] = static_cast<Page>(allocator_->alloc(page_bytes));
+      std::memset(sparse_[index], 0, page_bytes);
+    } else {
+      sparse_[index] = static_cast<Page>(std::calloc(page_size, sizeof(Index)));
+    }
     return sparse_[index];
   }
 
   /**
-   * Returns a reference to an entity in the sparse vector for the given \p
-   * entity.
+   * Sets the sparse entries for the entities at the positions in the dense
+   * array given by \p position for each of the indices in the range
+   * [\p begin, \p end), looking up the page only when it changes.
+   * \param  begin    The first index in the range.
+   * \param  end      One past the last index in the range.
+   * \param  position The functor which gets the position for an index.
+   * \tparam Position The type of the position functor.
+   */
+  template <typename Position>
+  auto link(SizeType begin, SizeType end, Position&& position) noexcept
+    -> void {
+    Page*    page    = nullptr;
+    SizeType page_id = sparse_.size();
+    for (SizeType i = begin; i < end; ++i) {
+      const SizeType pos    = position(i);
+      const Entity&  entity = dense_[pos];
+      if (page_index(entity) != page_id) {
+        page_id = page_index(entity);
+        page    = &fetch_page(page_id);
+      }
+      assert((*page)[offset(entity)] == null_index && "Entity already in set!");
+      (*page)[offset(entity)] = static_cast<Index>(pos + 1);
+    }
+  }
+
+  /**
+   * Determines if the \p page is in the region for virtual pages.
+   * \param page The page to check.
+   * \return __true__ if the page is in the region.
+   */
+  snowflake_nodiscard auto in_region(Page page) const noexcept -> bool {
+    const Index* first = static_cast<const Index*>(region_.data());
+    const Index* last  = first + virtual_pages * page_size;
+    std::less<const Index*> less;
+    return first != nullptr && !less(page, first) && less(page, last);
+  }
+
+  /**
+   * Returns a reference to the entry in the sparse vector for the given
+   * \p entity, which is the index of the entity in the dense array plus one.
    *
    * \note This will allocate a page for the entity if a page for the entity
    *       isn't already allocated.
    *
-   * \param entity The entity to get from the sparse vector.
+   * \param entity The entity to get the sparse entry for.
    */
   snowflake_nodiscard auto
-  sparse_entity(const Entity& entity) noexcept -> Entity& {
+  sparse_index(const Entity& entity) noexcept -> Index& {
     return fetch_page(page_index(entity))[offset(entity)];
   }
 };
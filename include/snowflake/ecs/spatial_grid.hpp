@@ -0,0 +1,1035 @@
+//==--- snowflake/ecs/spatial_grid.hpp --------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  spatial_grid.hpp
+/// \brief This file defines a spatial index over a position component, which
+///        is a hashed uniform grid.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_SPATIAL_GRID_HPP
+#define SNOWFLAKE_ECS_SPATIAL_GRID_HPP
+
+#include "component_storage.hpp"
+#include <snowflake/util/thread_pool.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Defines the number of shards for the cells in a spatial grid. Each shard is
+ * rebuilt by a single thread, so this limits the parallelism of a rebuild.
+ * This must be a power of two.
+ */
+static constexpr size_t spatial_grid_shards =
+#if defined(SNOWFLAKE_SPATIAL_GRID_SHARDS)
+  SNOWFLAKE_SPATIAL_GRID_SHARDS;
+#else
+  16;
+#endif
+
+/**
+ * A point in space.
+ */
+struct SpatialPoint {
+  float x = 0.0f; //!< The x coordinate of the point.
+  float y = 0.0f; //!< The y coordinate of the point.
+  float z = 0.0f; //!< The z coordinate of the point.
+};
+
+/**
+ * A plane which bounds a region of space, where the points `p` for which
+ * `x * p.x + y * p.y + z * p.z + d >= 0` are inside the region.
+ */
+struct SpatialPlane {
+  float x = 0.0f; //!< The x component of the normal.
+  float y = 0.0f; //!< The y component of the normal.
+  float z = 0.0f; //!< The z component of the normal.
+  float d = 0.0f; //!< The offset of the plane.
+};
+
+/**
+ * Default position function for a spatial grid, for components with x, y and
+ * z members.
+ */
+struct MemberPosition {
+  /**
+   * Gets the position of the \p component.
+   * \param  component The component to get the position of.
+   * \tparam Component The type of the component.
+   * \return The position of the component.
+   */
+  template <typename Component>
+  auto operator()(const Component& component) const noexcept -> SpatialPoint {
+    return SpatialPoint{
+      static_cast<float>(component.x),
+      static_cast<float>(component.y),
+      static_cast<float>(component.z)};
+  }
+};
+
+/**
+ * Spatial index over the entities with a position \p Component, which answers
+ * range, nearest neighbour, and frustum queries without scanning all of the
+ * components.
+ *
+ * Space is divided into cubic cells, and only the occupied cells are stored,
+ * in a hash map which is split into shards so that the grid can be rebuilt in
+ * parallel. Each cell stores the entities in the cell along with their
+ * positions, so that queries only touch the cells which they overlap.
+ *
+ * The grid is kept up to date through the signals for the component when it
+ * is attached to a manager. Entities are added and removed immediately, while
+ * entities whose components are updated (through replace() or patch()) are
+ * marked as moved, and only the moved entities are re-bucketed by update(),
+ * once per frame, for example:
+ *
+ * ~~~{.cpp}
+ * SpatialGrid<Entity, Position> grid{2.0f};
+ * grid.attach(manager);
+ * // ...
+ * manager.patch<Position>(entity, [] (auto& p) { p.x += 1.0f; });
+ * grid.update(manager);
+ * grid.each_in_range(center, 5.0f, [] (Entity e, SpatialPoint p) { ... });
+ * ~~~
+ *
+ * \note Components which are modified through get() or views do not publish
+ *       the update signal, so such entities must be marked with moved(), or
+ *       the grid must be rebuilt.
+ *
+ * \note The grid stores the positions at the last update, and queries are
+ *       answered with those positions.
+ *
+ * \tparam Entity     The type of the entity.
+ * \tparam Component  The type of the position component.
+ * \tparam PositionFn The type of the function which returns the position of a
+ *                    component as a SpatialPoint.
+ */
+template <
+  typename Entity,
+  typename Component,
+  typename PositionFn = MemberPosition>
+class SpatialGrid {
+  static_assert(
+    spatial_grid_shards > 0 &&
+      (spatial_grid_shards & (spatial_grid_shards - 1)) == 0,
+    "Number of spatial grid shards must be a power of two!");
+
+  /** Defines the number of bits for each coordinate of a cell in a key. */
+  static constexpr int32_t coord_bits  = 21;
+  /** Defines the largest magnitude of a cell coordinate. */
+  static constexpr int32_t coord_limit = (1 << (coord_bits - 1)) - 1;
+
+  /**
+   * The integer coordinates of a cell.
+   */
+  struct Coord {
+    int32_t x = 0; //!< The x coordinate of the cell.
+    int32_t y = 0; //!< The y coordinate of the cell.
+    int32_t z = 0; //!< The z coordinate of the cell.
+  };
+
+  /**
+   * An entity in a cell, and its position.
+   */
+  struct Entry {
+    SpatialPoint position = {}; //!< The position of the entity.
+    Entity       entity   = {}; //!< The entity.
+  };
+
+  // clang-format off
+  /** Defines the type of the key for a cell. */
+  using CellKey = uint64_t;
+  /** Defines the type of a cell. */
+  using Cell    = std::vector<Entry>;
+  /** Defines the type of the container of cells. */
+  using Cells   = std::unordered_map<CellKey, Cell>;
+  // clang-format on
+
+  /**
+   * The location of an entity in the grid.
+   */
+  struct Record {
+    CellKey  cell  = 0;     //!< The key of the cell of the entity.
+    uint32_t slot  = 0;     //!< The index of the entity in the cell.
+    bool     moved = false; //!< If the entity has moved since an update.
+  };
+
+  /**
+   * A shard of the cells, and the bounds of the shard's cells.
+   */
+  struct alignas(cache_line_size) Shard {
+    Cells cells = {}; //!< The occupied cells in the shard.
+    Coord lo    = {}; //!< The lower bound of the cells.
+    Coord hi    = {}; //!< The upper bound of the cells.
+  };
+
+  // clang-format off
+  /** Defines the type of the locations of the entities. */
+  using Records = ComponentStorage<Entity, Record>;
+  /** Defines the type of the container of shards. */
+  using Shards  = std::array<Shard, spatial_grid_shards>;
+  // clang-format on
+
+ public:
+  // clang-format off
+  /** Defines the size type for the grid. */
+  using SizeType = typename Records::SizeType;
+  // clang-format on
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Creates the grid with cells of size \p cell_size.
+   *
+   * The cell size should be around the size of a typical range query, so
+   * that most queries touch a small number of cells.
+   *
+   * \param cell_size   The size of the cells.
+   * \param position_fn The function which returns the position of a
+   *                    component.
+   */
+  explicit SpatialGrid(float cell_size, PositionFn position_fn = {}) noexcept
+  : cell_size_{cell_size},
+    inv_cell_size_{1.0f / cell_size},
+    position_fn_{std::move(position_fn)} {}
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  // Attached grids are referenced by the signals of the manager, so the grid
+  // can't be copied or moved.
+
+  // clang-format off
+  /** Copy constructor -- deleted. */
+  SpatialGrid(const SpatialGrid&)    = delete;
+  /** Move constructor -- deleted. */
+  SpatialGrid(SpatialGrid&&)         = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const SpatialGrid&) = delete;
+  /** Move assignment -- deleted. */
+  auto operator=(SpatialGrid&&)      = delete;
+  // clang-format on
+
+  /*==--- [maintenance] ----------------------------------------------------==*/
+
+  /**
+   * Attaches the grid to the \p manager, so that entities are added, removed
+   * and marked as moved as their components are added, removed and updated,
+   * and adds all entities which already have the component to the grid.
+   *
+   * \note The grid must be detached before it is destroyed, if the manager
+   *       outlives it.
+   *
+   * \param  manager The manager to attach the grid to.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto attach(Manager& manager) -> void {
+    manager.template on_construct<Component>()
+      .template connect<&SpatialGrid::construct<Manager>>(*this);
+    manager.template on_update<Component>()
+      .template connect<&SpatialGrid::update_one<Manager>>(*this);
+    manager.template on_destroy<Component>()
+      .template connect<&SpatialGrid::destroy<Manager>>(*this);
+    rebuild(manager);
+  }
+
+  /**
+   * Detaches the grid from the \p manager.
+   * \param  manager The manager to detach the grid from.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto detach(Manager& manager) -> void {
+    manager.template on_construct<Component>()
+      .template disconnect<&SpatialGrid::construct<Manager>>(*this);
+    manager.template on_update<Component>()
+      .template disconnect<&SpatialGrid::update_one<Manager>>(*this);
+    manager.template on_destroy<Component>()
+      .template disconnect<&SpatialGrid::destroy<Manager>>(*this);
+  }
+
+  /**
+   * Adds the \p entity at the \p position to the grid.
+   *
+   * \note If the entity is already in the grid, this will assert in debug,
+   *       and cause undefined behaviour in release.
+   *
+   * \param entity   The entity to add.
+   * \param position The position of the entity.
+   */
+  auto insert(const Entity& entity, const SpatialPoint& position) -> void {
+    const auto coord = coords(position);
+    records_.emplace(entity, Record{key(coord), 0, false});
+    link(records_.get(entity), Entry{position, entity}, coord);
+  }
+
+  /**
+   * Removes the \p entity from the grid.
+   *
+   * \note If the entity is not in the grid, this will assert in debug, and
+   *       cause undefined behaviour in release.
+   *
+   * \param entity The entity to remove.
+   */
+  auto erase(const Entity& entity) -> void {
+    unlink(records_.get(entity));
+    records_.erase(entity);
+  }
+
+  /**
+   * Marks the \p entity as moved, so that it is re-bucketed by the next
+   * update(). Marking an entity multiple times is valid.
+   * \param entity The entity which has moved.
+   */
+  auto moved(const Entity& entity) -> void {
+    auto& record = records_.get(entity);
+    if (!record.moved) {
+      record.moved = true;
+      moved_.push_back(entity);
+    }
+  }
+
+  /**
+   * Updates the positions of the entities which have moved since the last
+   * update from their components in the \p manager, moving the entities
+   * which have changed cells. The cost is proportional to the number of
+   * moved entities.
+   *
+   * \param  manager The manager to get the positions from.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto update(const Manager& manager) -> void {
+    for (const auto& entity : moved_) {
+      if (!records_.exists(entity)) {
+        continue;
+      }
+      auto& record = records_.get(entity);
+      if (!record.moved) {
+        continue;
+      }
+      record.moved = false;
+
+      const auto position =
+        position_fn_(manager.template get<Component>(entity));
+      const auto coord = coords(position);
+      const auto cell  = key(coord);
+      if (cell == record.cell) {
+        (*find_cell(cell))[record.slot].position = position;
+        continue;
+      }
+      unlink(record);
+      record.cell = cell;
+      link(record, Entry{position, entity}, coord);
+    }
+    moved_.clear();
+  }
+
+  /**
+   * Rebuilds the grid from all of the components in the \p manager.
+   * \param  manager The manager to get the positions from.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto rebuild(Manager& manager) -> void {
+    rebuild_with(manager, [](size_t begin, size_t end, auto&& functor) {
+      functor(begin, end);
+    });
+  }
+
+  /**
+   * Rebuilds the grid from all of the components in the \p manager, in
+   * parallel, using the threads in the \p pool.
+   *
+   * The cells for the entities are computed in parallel, and then each shard
+   * of the cells is filled by a single thread, so no synchronization is
+   * required.
+   *
+   * \param  manager The manager to get the positions from.
+   * \param  pool    The thread pool to rebuild the grid with.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto rebuild(Manager& manager, ThreadPool& pool) -> void {
+    rebuild_with(manager, [&pool](size_t begin, size_t end, auto&& functor) {
+      const size_t grain =
+        std::max(size_t{1}, (end - begin) / (pool.concurrency() * 4));
+      pool.parallel_for(begin, end, grain, functor);
+    });
+  }
+
+  /**
+   * Removes all entities from the grid.
+   */
+  auto clear() -> void {
+    records_ = Records{};
+    for (auto& shard : shards_) {
+      shard.cells.clear();
+    }
+    moved_.clear();
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Returns the number of entities in the grid.
+   * \return The number of entities in the grid.
+   */
+  snowflake_nodiscard auto size() const noexcept -> SizeType {
+    return records_.size();
+  }
+
+  /**
+   * Determines if the grid is empty.
+   * \return __true__ if there are no entities in the grid.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return records_.empty();
+  }
+
+  /**
+   * Returns the number of occupied cells in the grid.
+   * \return The number of occupied cells.
+   */
+  snowflake_nodiscard auto cells() const noexcept -> size_t {
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+      count += shard.cells.size();
+    }
+    return count;
+  }
+
+  /**
+   * Determines if the \p entity is in the grid.
+   * \param entity The entity to check.
+   * \return __true__ if the entity is in the grid.
+   */
+  snowflake_nodiscard auto
+  contains(const Entity& entity) const noexcept -> bool {
+    return records_.exists(entity);
+  }
+
+  /**
+   * Gets the position of the \p entity in the grid, as of the last update.
+   *
+   * \note If the entity is not in the grid, this will assert in debug, and
+   *       cause undefined behaviour in release.
+   *
+   * \param entity The entity to get the position of.
+   * \return The position of the entity.
+   */
+  snowflake_nodiscard auto
+  position(const Entity& entity) const -> SpatialPoint {
+    const auto& record = records_.get(entity);
+    return (*find_cell(record.cell))[record.slot].position;
+  }
+
+  /*==--- [queries] --------------------------------------------------------==*/
+
+  /**
+   * Applies the \p functor to each entity within \p radius of the \p center.
+   *
+   * The functor can either take the entity and its position, or just the
+   * entity, for example:
+   *
+   * ~~~{.cpp}
+   * grid.each_in_range(center, r, [] (Entity e, const SpatialPoint& p) {});
+   * grid.each_in_range(center, r, [] (Entity e) {});
+   * ~~~
+   *
+   * \note The order of the entities is unspecified.
+   *
+   * \param  center  The center of the range.
+   * \param  radius  The radius of the range.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each_in_range(
+    const SpatialPoint& center, float radius, Functor&& functor) const
+    -> void {
+    const float limit = radius * radius;
+    const auto  lo    = coords(
+      SpatialPoint{center.x - radius, center.y - radius, center.z - radius});
+    const auto hi = coords(
+      SpatialPoint{center.x + radius, center.y + radius, center.z + radius});
+    each_cell(lo, hi, [&](const Cell& cell) {
+      for (const auto& entry : cell) {
+        if (distance2(entry.position, center) <= limit) {
+          invoke(functor, entry);
+        }
+      }
+    });
+  }
+
+  /**
+   * Writes the (up to) \p count entities which are nearest to the \p center
+   * to \p out, in order of increasing distance.
+   *
+   * Cells are searched in rings of increasing distance from the cell of the
+   * center, until no unsearched cell can be closer than the furthest of the
+   * nearest entities.
+   *
+   * \param  center The point to find the nearest entities to.
+   * \param  count  The number of entities to find.
+   * \param  out    The iterator to write the entities to.
+   * \tparam OutputIterator The type of the output iterator.
+   * \return The output iterator after the last written entity.
+   */
+  template <typename OutputIterator>
+  auto nearest(const SpatialPoint& center, size_t count, OutputIterator out)
+    const -> OutputIterator {
+    if (count == 0 || empty()) {
+      return out;
+    }
+
+    using Candidate = std::pair<float, Entity>;
+    std::vector<Candidate> best;
+    best.reserve(std::min(count, size_t{records_.size()}));
+    const auto closer = [](const Candidate& a, const Candidate& b) {
+      return a.first < b.first;
+    };
+    const auto search = [&](const Cell& cell) {
+      for (const auto& entry : cell) {
+        const float d = distance2(entry.position, center);
+        if (best.size() < count) {
+          best.emplace_back(d, entry.entity);
+          std::push_heap(best.begin(), best.end(), closer);
+        } else if (d < best.front().first) {
+          std::pop_heap(best.begin(), best.end(), closer);
+          best.back() = Candidate{d, entry.entity};
+          std::push_heap(best.begin(), best.end(), closer);
+        }
+      }
+    };
+
+    const auto [lo, hi] = bounds();
+    const auto origin   = coords(center);
+    const auto occupied = cells();
+    const auto furthest = std::max(
+      {origin.x - lo.x,
+       hi.x - origin.x,
+       origin.y - lo.y,
+       hi.y - origin.y,
+       origin.z - lo.z,
+       hi.z - origin.z});
+    for (int32_t ring = 0; ring <= furthest; ++ring) {
+      // Once a ring has more cells than are occupied, it's cheaper to search
+      // all of the remaining occupied cells directly:
+      const uint64_t side  = 2 * uint64_t(ring) + 1;
+      const uint64_t inner = side - 2;
+      if (ring > 0 && side * side * side - inner * inner * inner > occupied) {
+        each_occupied([&](const Coord& coord, const Cell& cell) {
+          if (chebyshev(coord, origin) >= ring) {
+            search(cell);
+          }
+        });
+        break;
+      }
+
+      each_shell_cell(origin, ring, lo, hi, search);
+      const float reach = static_cast<float>(ring) * cell_size_;
+      if (best.size() == count && best.front().first <= reach * reach) {
+        break;
+      }
+    }
+
+    std::sort_heap(best.begin(), best.end(), closer);
+    for (const auto& candidate : best) {
+      *out++ = candidate.second;
+    }
+    return out;
+  }
+
+  /**
+   * Applies the \p functor to each entity which is inside all of the
+   * \p planes, which is usually the six planes of a view frustum. The
+   * functor has the same form as for each_in_range().
+   *
+   * Each occupied cell is tested against the planes first, so that the
+   * entities in cells which are entirely outside are skipped, and the
+   * entities in cells which are entirely inside are not tested. The cost is
+   * proportional to the number of occupied cells, plus the number of entities
+   * in cells which intersect the frustum.
+   *
+   * \param  planes  The planes which bound the region.
+   * \param  functor The functor to apply.
+   * \tparam Planes  The number of planes.
+   * \tparam Functor The type of the functor.
+   */
+  template <size_t Planes, typename Functor>
+  auto each_in_frustum(
+    const std::array<SpatialPlane, Planes>& planes, Functor&& functor) const
+    -> void {
+    each_occupied([&](const Coord& coord, const Cell& cell) {
+      const SpatialPoint lo{
+        static_cast<float>(coord.x) * cell_size_,
+        static_cast<float>(coord.y) * cell_size_,
+        static_cast<float>(coord.z) * cell_size_};
+      const SpatialPoint hi{
+        lo.x + cell_size_, lo.y + cell_size_, lo.z + cell_size_};
+
+      bool inside = true;
+      for (const auto& plane : planes) {
+        // Corners of the cell furthest along, and against, the normal:
+        const SpatialPoint front{
+          plane.x >= 0.0f ? hi.x : lo.x,
+          plane.y >= 0.0f ? hi.y : lo.y,
+          plane.z >= 0.0f ? hi.z : lo.z};
+        const SpatialPoint back{
+          plane.x >= 0.0f ? lo.x : hi.x,
+          plane.y >= 0.0f ? lo.y : hi.y,
+          plane.z >= 0.0f ? lo.z : hi.z};
+        if (distance(plane, front) < 0.0f) {
+          return;
+        }
+        inside = inside && distance(plane, back) >= 0.0f;
+      }
+
+      for (const auto& entry : cell) {
+        if (inside || std::all_of(
+                        planes.begin(), planes.end(), [&](const auto& plane) {
+                          return distance(plane, entry.position) >= 0.0f;
+                        })) {
+          invoke(functor, entry);
+        }
+      }
+    });
+  }
+
+ private:
+  Records             records_       = {}; //!< Locations of the entities.
+  Shards              shards_        = {}; //!< Shards of the cells.
+  std::vector<Entity> moved_         = {}; //!< Entities marked as moved.
+  float               cell_size_     = 1.0f; //!< Size of the cells.
+  float               inv_cell_size_ = 1.0f; //!< Inverse of the cell size.
+  PositionFn          position_fn_;          //!< Gets component positions.
+
+  /*==--- [listeners] ------------------------------------------------------==*/
+
+  /**
+   * Listener for when the component is added to the \p entity.
+   * \param  manager The manager for the entity.
+   * \param  entity  The entity which gained the component.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto construct(Manager& manager, const Entity& entity) -> void {
+    insert(
+      entity,
+      position_fn_(std::as_const(manager).template get<Component>(entity)));
+  }
+
+  /**
+   * Listener for when the component for the \p entity is updated.
+   * \param  entity  The entity whose component was updated.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto update_one(Manager&, const Entity& entity) -> void {
+    moved(entity);
+  }
+
+  /**
+   * Listener for when the component is removed from the \p entity.
+   * \param  entity  The entity which will lose the component.
+   * \tparam Manager The type of the manager.
+   */
+  template <typename Manager>
+  auto destroy(Manager&, const Entity& entity) -> void {
+    erase(entity);
+  }
+
+  /*==--- [implementation] -------------------------------------------------==*/
+
+  /**
+   * Rebuilds the grid from all of the components in the \p manager, using the
+   * \p for_each function to apply functors over ranges of indices.
+   * \param  manager  The manager to get the positions from.
+   * \param  for_each The function to apply functors over ranges with.
+   * \tparam Manager  The type of the manager.
+   * \tparam ForEach  The type of the range function.
+   */
+  template <typename Manager, typename ForEach>
+  auto rebuild_with(Manager& manager, ForEach&& for_each) -> void {
+    clear();
+    std::vector<Entity> entities;
+    manager.template view<Component>().each(
+      [&](const Entity& entity, auto&&) { entities.push_back(entity); });
+    records_.insert(entities.begin(), entities.end(), Record{});
+
+    const auto&          source = std::as_const(manager);
+    std::vector<Entry>   entries(entities.size());
+    std::vector<CellKey> keys(entities.size());
+    std::vector<Coord>   coordinates(entities.size());
+    for_each(0, entities.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const auto& entity = entities[i];
+        entries[i] = Entry{
+          position_fn_(source.template get<Component>(entity)), entity};
+        coordinates[i] = coords(entries[i].position);
+        keys[i]        = key(coordinates[i]);
+      }
+    });
+
+    // Bucket the entities by shard with a counting sort, so that each shard
+    // only walks the entities in its own bucket:
+    std::array<size_t, spatial_grid_shards + 1> offsets = {};
+    for (const auto& k : keys) {
+      ++offsets[shard_index(k) + 1];
+    }
+    for (size_t s = 0; s < spatial_grid_shards; ++s) {
+      offsets[s + 1] += offsets[s];
+    }
+    std::vector<size_t> order(entities.size());
+    {
+      auto next = offsets;
+      for (size_t i = 0; i < keys.size(); ++i) {
+        order[next[shard_index(keys[i])]++] = i;
+      }
+    }
+
+    // Each shard only touches its own cells, and the records of the entities
+    // in its cells, so shards can be filled concurrently:
+    for_each(0, spatial_grid_shards, [&](size_t begin, size_t end) {
+      for (size_t s = begin; s < end; ++s) {
+        for (size_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+          const size_t i      = order[j];
+          auto&        record = records_.get(entities[i]);
+          record.cell         = keys[i];
+          link(record, entries[i], coordinates[i]);
+        }
+      }
+    });
+  }
+
+  /**
+   * Adds the \p entry to the cell for the \p record, which has \p coord,
+   * setting the slot for the record.
+   * \param record The record for the entry.
+   * \param entry  The entry to add.
+   * \param coord  The coordinates of the cell.
+   */
+  auto link(Record& record, const Entry& entry, const Coord& coord) -> void {
+    auto&      shard = shards_[shard_index(record.cell)];
+    const bool first = shard.cells.empty();
+    auto&      cell  = shard.cells[record.cell];
+    record.slot      = static_cast<uint32_t>(cell.size());
+    cell.push_back(entry);
+
+    if (first) {
+      shard.lo = coord;
+      shard.hi = coord;
+      return;
+    }
+    shard.lo = Coord{
+      std::min(shard.lo.x, coord.x),
+      std::min(shard.lo.y, coord.y),
+      std::min(shard.lo.z, coord.z)};
+    shard.hi = Coord{
+      std::max(shard.hi.x, coord.x),
+      std::max(shard.hi.y, coord.y),
+      std::max(shard.hi.z, coord.z)};
+  }
+
+  /**
+   * Removes the entry for the \p record from its cell, removing the cell if
+   * it is then empty.
+   * \param record The record for the entry to remove.
+   */
+  auto unlink(const Record& record) -> void {
+    auto& cells = shards_[shard_index(record.cell)].cells;
+    auto  it    = cells.find(record.cell);
+    auto& cell  = it->second;
+
+    const uint32_t slot                  = record.slot;
+    cell[slot]                           = cell.back();
+    records_.get(cell[slot].entity).slot = slot;
+    cell.pop_back();
+    if (cell.empty()) {
+      cells.erase(it);
+    }
+  }
+
+  /**
+   * Gets a pointer to the cell with the \p key, or nullptr if the cell is not
+   * occupied.
+   * \param key The key of the cell.
+   * \return A pointer to the cell, or nullptr.
+   */
+  snowflake_nodiscard auto find_cell(CellKey key) const -> const Cell* {
+    const auto& cells = shards_[shard_index(key)].cells;
+    const auto  it    = cells.find(key);
+    return it == cells.end() ? nullptr : &it->second;
+  }
+
+  /**
+   * Gets a mutable pointer to the cell with the \p key, or nullptr if the
+   * cell is not occupied.
+   * \param key The key of the cell.
+   * \return A pointer to the cell, or nullptr.
+   */
+  snowflake_nodiscard auto find_cell(CellKey key) -> Cell* {
+    return const_cast<Cell*>(std::as_const(*this).find_cell(key));
+  }
+
+  /**
+   * Gets the bounds of the occupied cells. The bounds are conservative, since
+   * they are not shrunk when cells are removed.
+   *
+   * \note The grid must not be empty.
+   *
+   * \return The lower and upper bounds of the occupied cells.
+   */
+  snowflake_nodiscard auto bounds() const noexcept -> std::pair<Coord, Coord> {
+    Coord lo{coord_limit, coord_limit, coord_limit};
+    Coord hi{-coord_limit, -coord_limit, -coord_limit};
+    for (const auto& shard : shards_) {
+      if (shard.cells.empty()) {
+        continue;
+      }
+      lo = Coord{
+        std::min(lo.x, shard.lo.x),
+        std::min(lo.y, shard.lo.y),
+        std::min(lo.z, shard.lo.z)};
+      hi = Coord{
+        std::max(hi.x, shard.hi.x),
+        std::max(hi.y, shard.hi.y),
+        std::max(hi.z, shard.hi.z)};
+    }
+    return {lo, hi};
+  }
+
+  /**
+   * Applies the \p functor to each occupied cell, and its coordinates.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each_occupied(Functor&& functor) const -> void {
+    for (const auto& shard : shards_) {
+      for (const auto& [cell_key, cell] : shard.cells) {
+        functor(decode(cell_key), cell);
+      }
+    }
+  }
+
+  /**
+   * Applies the \p functor to each occupied cell in the box of cells
+   * [\p lo, \p hi]. If the box has more cells than are occupied, the occupied
+   * cells are searched instead.
+   * \param  lo      The lower bound of the box.
+   * \param  hi      The upper bound of the box.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each_cell(Coord lo, Coord hi, Functor&& functor) const -> void {
+    if (empty()) {
+      return;
+    }
+    const auto [min, max] = bounds();
+    lo = Coord{
+      std::max(lo.x, min.x), std::max(lo.y, min.y), std::max(lo.z, min.z)};
+    hi = Coord{
+      std::min(hi.x, max.x), std::min(hi.y, max.y), std::min(hi.z, max.z)};
+    if (lo.x > hi.x || lo.y > hi.y || lo.z > hi.z) {
+      return;
+    }
+
+    const uint64_t volume = uint64_t(hi.x - lo.x + 1) *
+                            uint64_t(hi.y - lo.y + 1) *
+                            uint64_t(hi.z - lo.z + 1);
+    if (volume > cells()) {
+      each_occupied([&](const Coord& coord, const Cell& cell) {
+        if (
+          coord.x >= lo.x && coord.x <= hi.x && coord.y >= lo.y &&
+          coord.y <= hi.y && coord.z >= lo.z && coord.z <= hi.z) {
+          functor(cell);
+        }
+      });
+      return;
+    }
+
+    for (int32_t x = lo.x; x <= hi.x; ++x) {
+      for (int32_t y = lo.y; y <= hi.y; ++y) {
+        for (int32_t z = lo.z; z <= hi.z; ++z) {
+          if (const auto* cell = find_cell(key(Coord{x, y, z}))) {
+            functor(*cell);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Applies the \p functor to each occupied cell which is exactly \p ring
+   * cells from the \p origin (in the Chebyshev distance), and inside the
+   * bounds [\p lo, \p hi].
+   * \param  origin  The cell at the center of the ring.
+   * \param  ring    The distance of the cells from the origin.
+   * \param  lo      The lower bound of the cells.
+   * \param  hi      The upper bound of the cells.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each_shell_cell(
+    const Coord& origin,
+    int32_t      ring,
+    const Coord& lo,
+    const Coord& hi,
+    Functor&&    functor) const -> void {
+    const auto visit = [&](int32_t x, int32_t y, int32_t z) {
+      if (z >= lo.z && z <= hi.z) {
+        if (const auto* cell = find_cell(key(Coord{x, y, z}))) {
+          functor(*cell);
+        }
+      }
+    };
+
+    const int32_t x_end = std::min(origin.x + ring, hi.x);
+    const int32_t y_end = std::min(origin.y + ring, hi.y);
+    for (int32_t x = std::max(origin.x - ring, lo.x); x <= x_end; ++x) {
+      for (int32_t y = std::max(origin.y - ring, lo.y); y <= y_end; ++y) {
+        const bool face = std::abs(x - origin.x) == ring ||
+                          std::abs(y - origin.y) == ring;
+        if (face) {
+          for (int32_t z = origin.z - ring; z <= origin.z + ring; ++z) {
+            visit(x, y, z);
+          }
+        } else {
+          visit(x, y, origin.z - ring);
+          visit(x, y, origin.z + ring);
+        }
+      }
+    }
+  }
+
+  /**
+   * Invokes the \p functor with the entity in the \p entry, and its position
+   * if the functor accepts it.
+   * \param  functor The functor to invoke.
+   * \param  entry   The entry to invoke the functor with.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  static auto invoke(Functor& functor, const Entry& entry) -> void {
+    if constexpr (std::is_invocable_v<Functor, Entity, const SpatialPoint&>) {
+      functor(entry.entity, entry.position);
+    } else {
+      functor(entry.entity);
+    }
+  }
+
+  /**
+   * Gets the coordinates of the cell which contains the \p point.
+   * \param point The point to get the cell of.
+   * \return The coordinates of the cell.
+   */
+  snowflake_nodiscard auto
+  coords(const SpatialPoint& point) const noexcept -> Coord {
+    constexpr float limit = static_cast<float>(coord_limit);
+    const auto      axis  = [this, limit](float value) {
+      const float cell = std::floor(value * inv_cell_size_);
+      return static_cast<int32_t>(std::clamp(cell, -limit, limit));
+    };
+    return Coord{axis(point.x), axis(point.y), axis(point.z)};
+  }
+
+  /**
+   * Gets the key for the cell with the \p coord.
+   * \param coord The coordinates of the cell.
+   * \return The key of the cell.
+   */
+  snowflake_nodiscard static auto key(const Coord& coord) noexcept -> CellKey {
+    constexpr CellKey mask = (CellKey{1} << coord_bits) - 1;
+    const auto axis = [](int32_t value) {
+      return static_cast<CellKey>(static_cast<uint32_t>(value)) & mask;
+    };
+    return (axis(coord.x) << (2 * coord_bits)) |
+           (axis(coord.y) << coord_bits) | axis(coord.z);
+  }
+
+  /**
+   * Gets the coordinates of the cell with the \p key.
+   * \param key The key of the cell.
+   * \return The coordinates of the cell.
+   */
+  snowflake_nodiscard static auto decode(CellKey key) noexcept -> Coord {
+    constexpr CellKey mask = (CellKey{1} << coord_bits) - 1;
+    const auto axis = [key](int32_t shift) {
+      const auto value = static_cast<int32_t>((key >> shift) & mask);
+      return value > coord_limit ? value - (1 << coord_bits) : value;
+    };
+    return Coord{axis(2 * coord_bits), axis(coord_bits), axis(0)};
+  }
+
+  /**
+   * Gets the index of the shard for the cell with the \p key.
+   * \param key The key of the cell.
+   * \return The index of the shard for the cell.
+   */
+  snowflake_nodiscard static auto
+  shard_index(CellKey key) noexcept -> size_t {
+    // Fibonacci hashing, so that neighbouring cells are spread over shards:
+    constexpr CellKey multiplier = 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((key * multiplier) >> 32) &
+           (spatial_grid_shards - 1);
+  }
+
+  /**
+   * Gets the Chebyshev distance between the cells \p a and \p b.
+   * \param a The first cell.
+   * \param b The second cell.
+   * \return The largest difference between the coordinates of the cells.
+   */
+  snowflake_nodiscard static auto
+  chebyshev(const Coord& a, const Coord& b) noexcept -> int32_t {
+    return std::max(
+      {std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z)});
+  }
+
+  /**
+   * Gets the squared distance between the points \p a and \p b.
+   * \param a The first point.
+   * \param b The second point.
+   * \return The squared distance between the points.
+   */
+  snowflake_nodiscard static auto
+  distance2(const SpatialPoint& a, const SpatialPoint& b) noexcept -> float {
+    const float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  /**
+   * Gets the signed distance of the \p point from the \p plane, scaled by the
+   * length of the normal of the plane.
+   * \param plane The plane.
+   * \param point The point.
+   * \return The scaled signed distance from the plane.
+   */
+  snowflake_nodiscard static auto
+  distance(const SpatialPlane& plane, const SpatialPoint& point) noexcept
+    -> float {
+    return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.d;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_SPATIAL_GRID_HPP
@@ -0,0 +1,77 @@
+//==--- snowflake/ecs/storage.hpp -------------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  storage.hpp
+/// \brief This file defines the selection of the storage for a component.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_STORAGE_HPP
+#define SNOWFLAKE_ECS_STORAGE_HPP
+
+#include "component_storage.hpp"
+#include "component_traits.hpp"
+#include "soa_storage.hpp"
+#include "tag_storage.hpp"
+#include "tracked_storage.hpp"
+
+namespace snowflake {
+
+/**
+ * Selects the type of the storage for a component, based on the traits of the
+ * component.
+ *
+ * \see component_traits.hpp
+ *
+ * \tparam Entity    The type of the entity.
+ * \tparam Component The type of the component.
+ * \tparam Allocator The type of the entity allocator.
+ */
+template <typename Entity, typename Component, typename Allocator>
+struct StorageSelector {
+  static_assert(
+    !(soa_layout_v<Component> && track_changes_v<Component>),
+    "Change tracking is not supported for soa components!");
+  static_assert(
+    !(soa_layout_v<Component> && paged_storage_v<Component>),
+    "Paged storage is not supported for soa components!");
+  static_assert(
+    !(std::is_empty_v<Component> && track_changes_v<Component>),
+    "Change tracking is not supported for empty components!");
+
+  /** Defines the type of the storage for the component. */
+  using type = std::conditional_t<
+    soa_layout_v<Component>,
+    SoaComponentStorage<Entity, Component, Allocator>,
+    std::conditional_t<
+      std::is_empty_v<Component>,
+      TagStorage<Entity, Component, Allocator>,
+      std::conditional_t<
+        track_changes_v<Component>,
+        TrackedComponentStorage<Entity, Component, Allocator>,
+        ComponentStorage<Entity, Component, Allocator>>>>;
+};
+
+/**
+ * Defines the type of the storage for a component.
+ * \tparam Entity    The type of the entity.
+ * \tparam Component The type of the component.
+ * \tparam Allocator The type of the entity allocator.
+ */
+template <
+  typename Entity,
+  typename Component,
+  typename Allocator = wrench::ObjectPoolAllocator<Entity>>
+using storage_t =
+  typename StorageSelector<Entity, Component, Allocator>::type;
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_STORAGE_HPP
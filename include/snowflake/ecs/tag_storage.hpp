@@ -0,0 +1,247 @@
+//==--- snowflake/ecs/tag_storage.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  tag_storage.hpp
+/// \brief This file defines storage for empty (tag) components.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_TAG_STORAGE_HPP
+#define SNOWFLAKE_ECS_TAG_STORAGE_HPP
+
+#include "component_traits.hpp"
+#include "sparse_set.hpp"
+#include <snowflake/util/radix_sort.hpp>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Pointer-like access to the shared instance of a tag component, which can
+ * be indexed like the pointer to the components of other storages, but
+ * always refers to the same instance.
+ *
+ * \tparam Component The type of the tag component.
+ */
+template <typename Component>
+class TagPointer {
+ public:
+  /**
+   * Constructor to set the instance.
+   * \param instance The shared instance.
+   */
+  constexpr explicit TagPointer(Component* instance) noexcept
+  : instance_{instance} {}
+
+  /**
+   * Gets a reference to the shared instance.
+   * \return A reference to the instance.
+   */
+  constexpr auto operator[](size_t) const noexcept -> Component& {
+    return *instance_;
+  }
+
+  /**
+   * Gets a reference to the shared instance.
+   * \return A reference to the instance.
+   */
+  constexpr auto operator*() const noexcept -> Component& {
+    return *instance_;
+  }
+
+  /**
+   * Gets a pointer to the shared instance.
+   * \return A pointer to the instance.
+   */
+  constexpr auto operator->() const noexcept -> Component* {
+    return instance_;
+  }
+
+ private:
+  Component* instance_ = nullptr; //!< The shared instance.
+};
+
+/**
+ * Storage for empty (tag) components, which only stores membership in the
+ * sparse set, and no component data.
+ *
+ * Since all instances of an empty type are equivalent, get() returns a shared
+ * instance, which makes the storage a drop in replacement for the
+ * ComponentStorage when used through the EntityManager, views and groups,
+ * while emplacing and erasing are just the sparse set operations. Iterating
+ * over the storage iterates over the entities.
+ *
+ * \tparam Entity          The type of the entity.
+ * \tparam Component       The type of the component, which must be empty.
+ * \tparam EntityAllocator The type of the entity allocator.
+ */
+template <
+  typename Entity,
+  typename Component,
+  typename EntityAllocator = wrench::ObjectPoolAllocator<Entity>>
+class TagStorage : public SparseSet<Entity, EntityAllocator> {
+  static_assert(
+    std::is_empty_v<Component>, "Tag storage requires an empty component!");
+
+  /** Storage type for the entities */
+  using Entities = SparseSet<Entity, EntityAllocator>;
+
+ public:
+  // clang-format off
+  /** The size type. */
+  using SizeType             = size_t;
+  /** The reverse iterator type for the components. */
+  using ReverseIterator      = TagPointer<Component>;
+  /** The const reverse iterator type for the components. */
+  using ConstReverseIterator = TagPointer<const Component>;
+  // clang-format on
+
+  /** Default constructor for the storage. */
+  TagStorage() noexcept = default;
+
+  /**
+   * Constructor which sets the allocator for the entities.
+   * \param allocator The allocator for the entities.
+   */
+  TagStorage(EntityAllocator* allocator) noexcept : Entities{allocator} {}
+
+  /**
+   * Adds the tag to the \p entity. The arguments are ignored, since all tag
+   * components are equivalent.
+   *
+   * \note If the entity already has the tag, then this will cause undefined
+   *       behaviour in release, or assert in debug.
+   *
+   * \param  entity The entity to add the tag for.
+   * \tparam Args   The type of the args.
+   */
+  template <typename... Args>
+  auto emplace(const Entity& entity, Args&&...) -> void {
+    Entities::emplace(entity);
+  }
+
+  /**
+   * Adds the tag to all the entities in the range [\p first, \p last). The
+   * source of the components is ignored.
+   * \param  first    An iterator to the first entity to insert.
+   * \param  last     An iterator to one past the last entity to insert.
+   * \tparam Iterator The type of the entity iterator.
+   * \tparam Source   The type of the component or component iterator.
+   */
+  template <typename Iterator, typename Source>
+  auto insert(Iterator first, Iterator last, Source&&) -> void {
+    Entities::insert(first, last);
+  }
+
+  /**
+   * Gets the shared instance of the tag.
+   *
+   * \note If the entity does not have the tag, then this will assert in debug.
+   *
+   * \param entity The entity to get the tag for.
+   * \return A reference to the shared instance.
+   */
+  auto get(const Entity& entity) noexcept -> Component& {
+    assert(Entities::exists(entity) && "Entity does not have tag!");
+    return instance_;
+  }
+
+  /**
+   * Gets the shared instance of the tag.
+   *
+   * \note If the entity does not have the tag, then this will assert in debug.
+   *
+   * \param entity The entity to get the tag for.
+   * \return A const reference to the shared instance.
+   */
+  auto get(const Entity& entity) const noexcept -> const Component& {
+    assert(Entities::exists(entity) && "Entity does not have tag!");
+    return instance_;
+  }
+
+  /**
+   * Returns pointer-like access to the components, from the *least*
+   * recently inserted, which always refers to the shared instance.
+   * \return Pointer-like access to the tags.
+   */
+  snowflake_nodiscard auto rbegin() noexcept -> ReverseIterator {
+    return ReverseIterator{&instance_};
+  }
+
+  /**
+   * Returns const pointer-like access to the components, from the *least*
+   * recently inserted, which always refers to the shared instance.
+   * \return Pointer-like access to the tags.
+   */
+  snowflake_nodiscard auto crbegin() const noexcept -> ConstReverseIterator {
+    return ConstReverseIterator{&instance_};
+  }
+
+  /**
+   * Sorts the entities with the tag by the key returned by the \p key_fn, so
+   * that iterating from begin() to end() visits the entities in ascending
+   * order of key.
+   *
+   * \see ComponentStorage::sort
+   *
+   * \param  key_fn The function which returns the key to sort by.
+   * \tparam KeyFn  The type of the key function.
+   */
+  template <typename KeyFn>
+  auto sort(KeyFn&& key_fn) -> void {
+    const SizeType size = Entities::size();
+    const Entity*  ents = Entities::rbegin();
+    auto           key  = [&](SizeType i) {
+      if constexpr (std::is_invocable_v<KeyFn, Entity, const Component&>) {
+        return key_fn(ents[i], std::as_const(instance_));
+      } else {
+        return key_fn(std::as_const(instance_));
+      }
+    };
+    using Key = std::decay_t<decltype(key(0))>;
+
+    std::vector<Key> keys(size);
+    for (SizeType i = 0; i < size; ++i) {
+      keys[i] = key(size - 1 - i);
+    }
+
+    std::vector<SizeType> order = radix_sort_order(keys.data(), size);
+    std::vector<SizeType> positions(size);
+    for (SizeType i = 0; i < size; ++i) {
+      positions[size - 1 - i] = size - 1 - order[i];
+    }
+    Entities::arrange(positions, [](SizeType, SizeType) {});
+  }
+
+  /**
+   * Sorts the entities with the tag in the order of the \p other storage.
+   *
+   * \see ComponentStorage::sort_as
+   *
+   * \param  other          The other storage to sort in the order of.
+   * \tparam OtherAllocator The type of the allocator for the other storage.
+   */
+  template <typename OtherAllocator>
+  auto sort_as(const SparseSet<Entity, OtherAllocator>& other) noexcept
+    -> void {
+    Entities::arrange_as(other, [](SizeType, SizeType) {});
+  }
+
+ private:
+  /** The instance which is shared by all entities. */
+  static inline Component instance_ = {};
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_TAG_STORAGE_HPP
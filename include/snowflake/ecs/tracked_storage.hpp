@@ -0,0 +1,627 @@
+//==--- snowflake/ecs/tracked_storage.hpp ------------------ -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  tracked_storage.hpp
+/// \brief This file defines component storage which tracks changes to the
+///        components.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_TRACKED_STORAGE_HPP
+#define SNOWFLAKE_ECS_TRACKED_STORAGE_HPP
+
+#include "component_storage.hpp"
+#include <atomic>
+#include <iterator>
+
+namespace snowflake {
+
+/**
+ * Defines the number of components in a block for change tracking. Each block
+ * stores the maximum version of the components in the block, so that blocks
+ * with no changes can be skipped.
+ */
+static constexpr size_t change_block_size = 64;
+
+/**
+ * Storage for components which tracks the version at which each component was
+ * last changed, so that the components which have changed since a given
+ * version can be iterated in time proportional to the number of changes,
+ * rather than the number of components.
+ *
+ * A component is marked as changed with the current version when it is
+ * emplaced or accessed mutably through get(). Access which gives mutable
+ * access to *all* components (begin(), rbegin(), parallel_for_each(), and
+ * sorting) marks all components as changed, which is O(1). Access through
+ * const references does not mark components.
+ *
+ * Consumers of changes should advance the version *before* processing the
+ * changes, so that changes made during processing are seen next time:
+ *
+ * ~~~{.cpp}
+ * const auto now = storage.advance_version();
+ * for (const auto& entity : storage.changed_since(last_seen)) {
+ *   // ...
+ * }
+ * last_seen = now;
+ * ~~~
+ *
+ * \note Removed components are not reported as changes.
+ *
+ * \tparam Entity          The type of the entity.
+ * \tparam Component       The type of the component.
+ * \tparam EntityAllocator The type of the entity allocator.
+ */
+template <
+  typename Entity,
+  typename Component,
+  typename EntityAllocator = wrench::ObjectPoolAllocator<Entity>>
+class TrackedComponentStorage
+: public ComponentStorage<Entity, Component, EntityAllocator> {
+  // clang-format off
+  /** Defines the type of the base storage. */
+  using Storage  = ComponentStorage<Entity, Component, EntityAllocator>;
+  /** Defines the type of the sparse set for the storage. */
+  using Entities = SparseSet<Entity, EntityAllocator>;
+  // clang-format on
+
+ public:
+  // clang-format off
+  /** Defines the type of the versions. */
+  using Version  = uint32_t;
+  /** Defines the size type for the storage. */
+  using SizeType = typename Storage::SizeType;
+  // clang-format on
+
+  /**
+   * Range over the entities whose components have changed since a version.
+   */
+  class ChangedRange {
+   public:
+    /**
+     * Iterator over the changed entities.
+     */
+    class Iterator {
+      friend class ChangedRange;
+
+      /**
+       * Constructor to set the storage, the starting index and the version.
+       * \param storage The storage to iterate over.
+       * \param index   The index to start from.
+       * \param version The version to find changes since.
+       */
+      Iterator(
+        const TrackedComponentStorage* storage,
+        SizeType                       index,
+        Version                        version) noexcept
+      : storage_{storage}, index_{index}, version_{version} {
+        skip();
+      }
+
+     public:
+      // clang-format off
+      /** Difference type for the iterator. */
+      using difference_type   = std::ptrdiff_t;
+      /** Value type for the iterator. */
+      using value_type        = Entity;
+      /** Pointer type for the iterator. */
+      using pointer           = const Entity*;
+      /** Reference type for the iterator. */
+      using reference         = const Entity&;
+      /** Category for the iterator. */
+      using iterator_category = std::forward_iterator_tag;
+      // clang-format on
+
+      /** Default constructor for the iterator. */
+      Iterator() noexcept = default;
+
+      /**
+       * Overload of prefix increment operator, which moves to the next
+       * changed entity.
+       * \return A reference to the modified iterator.
+       */
+      auto operator++() noexcept -> Iterator& {
+        ++index_;
+        skip();
+        return *this;
+      }
+
+      /**
+       * Overload of postfix increment operator.
+       * \return The new iterator with the original position.
+       */
+      auto operator++(int) noexcept -> Iterator {
+        Iterator curr = *this;
+        operator++();
+        return curr;
+      }
+
+      /**
+       * Equality comparison operator.
+       * \param other The other iterator to compare to.
+       * \return __true__ if the iterators are equal.
+       */
+      snowflake_nodiscard auto
+      operator==(const Iterator& other) const noexcept -> bool {
+        return other.index_ == index_;
+      }
+
+      /**
+       * Inequality comparison operator.
+       * \param other The other iterator to compare to.
+       * \return __true__ if the iterators are not equal.
+       */
+      snowflake_nodiscard auto
+      operator!=(const Iterator& other) const noexcept -> bool {
+        return other.index_ != index_;
+      }
+
+      /**
+       * Overload of dereference operator to get the changed entity.
+       * \return A reference to the changed entity.
+       */
+      snowflake_nodiscard auto operator*() const noexcept -> reference {
+        return storage_->Entities::rbegin()[index_];
+      }
+
+      /**
+       * Overload of arrow operator to access the changed entity.
+       * \return A pointer to the changed entity.
+       */
+      snowflake_nodiscard auto operator->() const noexcept -> pointer {
+        return storage_->Entities::rbegin() + index_;
+      }
+
+     private:
+      const TrackedComponentStorage* storage_ = nullptr; //!< Storage.
+      SizeType                       index_   = 0;       //!< Current index.
+      Version                        version_ = 0;       //!< Base version.
+
+      /**
+       * Moves the iterator forward to the next changed entity, skipping
+       * blocks which have not changed.
+       */
+      auto skip() noexcept -> void {
+        const SizeType size = storage_->size();
+        while (index_ < size) {
+          const SizeType block = index_ / change_block_size;
+          if (storage_->block_version(block) <= version_) {
+            index_ = (block + 1) * change_block_size;
+            continue;
+          }
+          if (storage_->version_at(index_) > version_) {
+            return;
+          }
+          ++index_;
+        }
+        index_ = size;
+      }
+    };
+
+    /**
+     * Constructor to set the storage and the version.
+     * \param storage The storage to find the changes in.
+     * \param version The version to find changes since.
+     */
+    ChangedRange(
+      const TrackedComponentStorage* storage, Version version) noexcept
+    : storage_{storage}, version_{version} {}
+
+    /**
+     * Gets an iterator to the first changed entity.
+     * \return An iterator to the first changed entity.
+     */
+    snowflake_nodiscard auto begin() const noexcept -> Iterator {
+      return Iterator{storage_, 0, version_};
+    }
+
+    /**
+     * Gets an iterator to the end of the changed entities.
+     * \return An iterator to the end of the changed entities.
+     */
+    snowflake_nodiscard auto end() const noexcept -> Iterator {
+      return Iterator{storage_, storage_->size(), version_};
+    }
+
+   private:
+    const TrackedComponentStorage* storage_ = nullptr; //!< Storage.
+    Version                        version_ = 0;       //!< Base version.
+  };
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /** Default constructor. */
+  TrackedComponentStorage() noexcept = default;
+
+  /**
+   * Constructor which sets the allocator for the entities.
+   * \param allocator The allocator for the entities.
+   */
+  TrackedComponentStorage(EntityAllocator* allocator) noexcept
+  : Storage{allocator} {}
+
+  /*==--- [versions] -------------------------------------------------------==*/
+
+  /**
+   * Gets the current version, which is the version that changes are marked
+   * with.
+   * \return The current version.
+   */
+  snowflake_nodiscard auto version() const noexcept -> Version {
+    return version_;
+  }
+
+  /**
+   * Advances the current version, so that changes made after this call have
+   * a greater version than the returned version.
+   * \return The version before advancing.
+   */
+  auto advance_version() noexcept -> Version {
+    return version_++;
+  }
+
+  /**
+   * Gets a range over the entities whose components have changed since the
+   * \p version, i.e which were changed with a version greater than
+   * \p version.
+   *
+   * \note The order of the entities in the range is unspecified.
+   *
+   * \param version The version to get the changes since.
+   * \return A range over the changed entities.
+   */
+  snowflake_nodiscard auto
+  changed_since(Version version) const noexcept -> ChangedRange {
+    return ChangedRange{this, version};
+  }
+
+  /**
+   * Gets the version at which the component for the \p entity last changed.
+   *
+   * \note If the entity does not exist, this causes undefined behaviour in
+   *       release, or asserts in debug.
+   *
+   * \param entity The entity to get the version of the component for.
+   * \return The version at which the component last changed.
+   */
+  snowflake_nodiscard auto
+  version(const Entity& entity) const noexcept -> Version {
+    return version_at(Entities::index(entity));
+  }
+
+  /**
+   * Marks the component for the \p entity as changed, with the current
+   * version.
+   * \param entity The entity to mark the component for.
+   */
+  auto touch(const Entity& entity) noexcept -> void {
+    mark(Entities::index(entity));
+  }
+
+  /**
+   * Marks all the components as changed, with the current version.
+   */
+  auto touch_all() noexcept -> void {
+    all_version_ = version_;
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Reserves enough space to emplace \p size compoennts.
+   * \param size The number of components to reserve.
+   */
+  auto reserve(SizeType size) -> void {
+    Storage::reserve(size);
+    versions_.reserve(size);
+  }
+
+  /**
+   * Emplaces a component into the storage, and marks it as changed.
+   * \param  entity The entity to emplace the component for.
+   * \param  args   Arguments for the construciton of the component.
+   * \tparam Args   The type of the args.
+   */
+  template <typename... Args>
+  auto emplace(const Entity& entity, Args&&... args) -> void {
+    Storage::emplace(entity, std::forward<Args>(args)...);
+    versions_.push_back(version_);
+    mark(versions_.size() - 1);
+  }
+
+  /**
+   * Inserts components for all the entities in the range [\p first,
+   * \p last), and marks them as changed.
+   *
+   * \see ComponentStorage::insert
+   *
+   * \param  first    An iterator to the first entity to insert.
+   * \param  last     An iterator to one past the last entity to insert.
+   * \param  source   A component to copy, or an iterator to the components.
+   * \tparam Iterator The type of the entity iterator.
+   * \tparam Source   The type of the component or component iterator.
+   */
+  template <typename Iterator, typename Source>
+  auto insert(Iterator first, Iterator last, Source&& source) -> void {
+    const SizeType start = versions_.size();
+    Storage::insert(first, last, std::forward<Source>(source));
+    versions_.resize(Storage::size(), version_);
+    for (SizeType i = start; i < versions_.size(); i += change_block_size) {
+      mark(i);
+    }
+    if (versions_.size() > start) {
+      mark(versions_.size() - 1);
+    }
+  }
+
+  /**
+   * Removes the component assosciated with the entity from the storage.
+   * \param entity The entity to remove.
+   */
+  auto erase(const Entity& entity) noexcept -> void {
+    const SizeType index = Entities::index(entity);
+    versions_[index]     = versions_.back();
+    versions_.pop_back();
+    if (index < versions_.size()) {
+      raise_block(index, versions_[index]);
+    }
+    Storage::erase(entity);
+  }
+
+  /**
+   * Removes the components assosciated with all the entities in the range
+   * [\p first, \p last) from the storage.
+   * \param  first    An iterator to the first entity to remove.
+   * \param  last     An iterator to one past the last entity to remove.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Iterator>
+  auto erase(Iterator first, Iterator last) noexcept -> void {
+    for (; first != last; ++first) {
+      erase(*first);
+    }
+  }
+
+  /**
+   * Swaps two components in the storage, along with their versions.
+   * \param a A component to swap with.
+   * \param b A component to swap with.
+   */
+  auto swap(const Entity& a, const Entity& b) noexcept -> void {
+    const SizeType index_a = Entities::index(a);
+    const SizeType index_b = Entities::index(b);
+    std::swap(versions_[index_a], versions_[index_b]);
+    raise_block(index_a, versions_[index_a]);
+    raise_block(index_b, versions_[index_b]);
+    Storage::swap(a, b);
+  }
+
+  /**
+   * Gets the component assosciated with the given entity, and marks it as
+   * changed.
+   * \param entity The entity to get the component for.
+   * \return A reference to the component.
+   */
+  auto get(const Entity& entity) -> Component& {
+    const SizeType index = Entities::index(entity);
+    mark(index);
+    return Storage::rbegin()[index];
+  }
+
+  /**
+   * Gets the component assosciated with the given entity, without marking it
+   * as changed.
+   * \param entity The entity to get the component for.
+   * \return A const reference to the component.
+   */
+  auto get(const Entity& entity) const -> const Component& {
+    return Storage::get(entity);
+  }
+
+  /**
+   * Applies the \p functor to each component in the storage, in parallel,
+   * and marks all components as changed.
+   *
+   * \see ComponentStorage::parallel_for_each
+   *
+   * \param  pool    The thread pool to execute the functor with.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto parallel_for_each(ThreadPool& pool, Functor&& functor) -> void {
+    touch_all();
+    Storage::parallel_for_each(pool, std::forward<Functor>(functor));
+  }
+
+  /**
+   * Sorts the storage by the key returned by the \p key_fn, and marks all
+   * components as changed.
+   *
+   * \see ComponentStorage::sort
+   *
+   * \param  key_fn The function which returns the key to sort by.
+   * \tparam KeyFn  The type of the key function.
+   */
+  template <typename KeyFn>
+  auto sort(KeyFn&& key_fn) -> void {
+    touch_all();
+    Storage::sort(std::forward<KeyFn>(key_fn));
+  }
+
+  /**
+   * Sorts the storage in the order of the \p other storage, and marks all
+   * components as changed.
+   *
+   * \see ComponentStorage::sort_as
+   *
+   * \param  other          The other storage to sort in the order of.
+   * \tparam OtherAllocator The type of the allocator for the other storage.
+   */
+  template <typename OtherAllocator>
+  auto sort_as(const SparseSet<Entity, OtherAllocator>& other) noexcept
+    -> void {
+    touch_all();
+    Storage::sort_as(other);
+  }
+
+  /*==--- [iteration] ------------------------------------------------------==*/
+
+  /**
+   * Returns an iterator to the beginning of the components, and marks all
+   * components as changed. Use cbegin() to iterate without marking.
+   * \return An iterator to the most recent component.
+   */
+  snowflake_nodiscard auto begin() noexcept -> typename Storage::Iterator {
+    touch_all();
+    return Storage::begin();
+  }
+
+  /**
+   * Returns an iterator to the end of the components.
+   * \return An iterator to the end of the components.
+   */
+  snowflake_nodiscard auto end() noexcept -> typename Storage::Iterator {
+    return Storage::end();
+  }
+
+  /**
+   * Returns a pointer to the least recently inserted component, and marks
+   * all components as changed. Use crbegin() to access without marking.
+   * \return A pointer to the least recently inserted component.
+   */
+  snowflake_nodiscard auto
+  rbegin() noexcept -> typename Storage::ReverseIterator {
+    touch_all();
+    return Storage::rbegin();
+  }
+
+  /**
+   * Returns a pointer to one past the most recently inserted component.
+   * \return A pointer to one past the most recent component.
+   */
+  snowflake_nodiscard auto
+  rend() noexcept -> typename Storage::ReverseIterator {
+    return Storage::rend();
+  }
+
+  /**
+   * Finds a component, if it exists, and marks it as changed.
+   * \param entity The entity to find.
+   * \return A valid iterator if found, otherwise an iterator to the end.
+   */
+  snowflake_nodiscard auto
+  find(const Entity& entity) noexcept -> typename Storage::Iterator {
+    if (Entities::exists(entity)) {
+      mark(Entities::index(entity));
+    }
+    return Storage::find(entity);
+  }
+
+ private:
+  /**
+   * Version for a block, which is copyable so that it can be stored in a
+   * vector, and atomic, since blocks are shared by components which may be
+   * accessed from different threads.
+   */
+  struct BlockVersion {
+    /** Default constructor. */
+    BlockVersion() noexcept = default;
+
+    /**
+     * Copy constructor.
+     * \param other The other block version to copy.
+     */
+    BlockVersion(const BlockVersion& other) noexcept
+    : value{other.value.load(std::memory_order_relaxed)} {}
+
+    /**
+     * Copy assignment.
+     * \param other The other block version to copy.
+     * \return A reference to this block version.
+     */
+    auto operator=(const BlockVersion& other) noexcept -> BlockVersion& {
+      value.store(
+        other.value.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+      return *this;
+    }
+
+    std::atomic<Version> value{0}; //!< Maximum version in the block.
+  };
+
+  // clang-format off
+  /** Defines the type of the container for versions. */
+  using Versions      = std::vector<Version>;
+  /** Defines the type of the container for block versions. */
+  using BlockVersions = std::vector<BlockVersion>;
+  // clang-format on
+
+  Versions      versions_       = {}; //!< Version of each component.
+  BlockVersions block_versions_ = {}; //!< Max version of each block.
+  Version       version_        = 1;  //!< Current version.
+  Version       all_version_    = 0;  //!< Version all were last changed.
+
+  /**
+   * Gets the version of the component at \p index.
+   * \param index The index of the component.
+   * \return The version of the component.
+   */
+  snowflake_nodiscard auto
+  version_at(SizeType index) const noexcept -> Version {
+    return std::max(versions_[index], all_version_);
+  }
+
+  /**
+   * Gets the maximum version of the components in \p block.
+   * \param block The index of the block.
+   * \return The maximum version in the block.
+   */
+  snowflake_nodiscard auto
+  block_version(SizeType block) const noexcept -> Version {
+    return std::max(
+      block_versions_[block].value.load(std::memory_order_relaxed),
+      all_version_);
+  }
+
+  /**
+   * Marks the component at \p index as changed with the current version.
+   * \param index The index of the component.
+   */
+  auto mark(SizeType index) noexcept -> void {
+    versions_[index] = version_;
+    raise_block(index, version_);
+  }
+
+  /**
+   * Raises the version of the block containing \p index to at least
+   * \p version.
+   *
+   * \note This may be called from multiple threads for components in the
+   *       same block, but only when the storage is not being resized.
+   *
+   * \param index   The index of a component in the block.
+   * \param version The version to raise the block to.
+   */
+  auto raise_block(SizeType index, Version version) noexcept -> void {
+    const SizeType block = index / change_block_size;
+    if (block >= block_versions_.size()) {
+      block_versions_.resize(block + 1);
+    }
+    auto& value = block_versions_[block].value;
+    if (value.load(std::memory_order_relaxed) < version) {
+      value.store(version, std::memory_order_relaxed);
+    }
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_TRACKED_STORAGE_HPP
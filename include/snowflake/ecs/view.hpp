@@ -0,0 +1,510 @@
+//==--- snowflake/ecs/view.hpp ----------------------------- -*- C++ -*- ---==//
+//
+//                              Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  view.hpp
+/// \brief This file defines a view over multiple component storages.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_ECS_VIEW_HPP
+#define SNOWFLAKE_ECS_VIEW_HPP
+
+#include "sparse_set.hpp"
+#include <snowflake/util/thread_pool.hpp>
+#include <algorithm>
+#include <tuple>
+
+namespace snowflake {
+namespace detail {
+
+/**
+ * Helper struct to get the type of the sparse set which a storage type is
+ * built on.
+ *
+ * \tparam Storage The type of the storage to get the sparse set type of.
+ */
+template <typename Storage>
+struct GetSparseSet {
+ private:
+  /**
+   * Overload for types which are sparse sets.
+   * \tparam E The type of the entity for the set.
+   * \tparam A The type of the allocator for the set.
+   */
+  template <typename E, typename A>
+  static auto test(const SparseSet<E, A>*) -> SparseSet<E, A>;
+
+ public:
+  /** Defines the type of the sparse set. */
+  using type = decltype(test(std::declval<std::decay_t<Storage>*>()));
+};
+
+/**
+ * Defines the type of the sparse set which a storage is built on.
+ * \tparam Storage The type of the storage.
+ */
+template <typename Storage>
+using sparse_set_t = typename GetSparseSet<Storage>::type;
+
+} // namespace detail
+
+/**
+ * List of components which entities must *not* have to be in a view, for
+ * example:
+ *
+ * ~~~{.cpp}
+ * manager.view<Transform, Renderable>(exclude<Hidden>);
+ * ~~~
+ *
+ * \tparam Components The types of the excluded components.
+ */
+template <typename... Components>
+struct Exclude {};
+
+/**
+ * List of components which entities may or may not have to be in a view,
+ * which are passed to the view's functors as pointers which are null for
+ * entities without the component, for example:
+ *
+ * ~~~{.cpp}
+ * manager.view<Transform>(optional<Light>)
+ *   .each([] (Transform& t, Light* light) { ... });
+ * ~~~
+ *
+ * \tparam Components The types of the optional components.
+ */
+template <typename... Components>
+struct Optional {};
+
+/**
+ * Excludes the \p Components from a view.
+ * \tparam Components The types of the excluded components.
+ */
+template <typename... Components>
+inline constexpr Exclude<Components...> exclude = {};
+
+/**
+ * Makes the \p Components optional in a view.
+ * \tparam Components The types of the optional components.
+ */
+template <typename... Components>
+inline constexpr Optional<Components...> optional = {};
+
+/**
+ * View over multiple component storages, which allows iteration over all
+ * entities which have *all* of the components in the \p Required storages,
+ * *none* of the components in the \p Excluded storages, and any of the
+ * components in the \p Optionals storages.
+ *
+ * Iteration is driven by the *smallest* required storage in the view at the
+ * time that the view is created, so the number of candidate entities is
+ * minimal, and each candidate only needs to be checked for membership in the
+ * remaining storages. Membership and exclusion are both checked against the
+ * sparse arrays of the storages, before any component is accessed, and the
+ * optional components are found in the same pass.
+ *
+ * \note The view is non-owning, and is invalidated if any of the storages are
+ *       destroyed.
+ *
+ * \note Adding or removing the components in the view while iterating over
+ *       the view is undefined behaviour, with the exception of removing the
+ *       components for the *currently iterated* entity, which is valid since
+ *       the view iterates from the back of the storages to the front.
+ *
+ * \tparam Required  A tuple of the types of the required storages.
+ * \tparam Excluded  A tuple of the types of the excluded storages.
+ * \tparam Optionals A tuple of the types of the optional storages.
+ */
+template <typename Required, typename Excluded, typename Optionals>
+class BasicView;
+
+/**
+ * View over the entities which have all of the components in the
+ * \p Storages.
+ * \see BasicView
+ * \tparam Storages The types of the storages for the view.
+ */
+template <typename... Storages>
+using View = BasicView<std::tuple<Storages...>, std::tuple<>, std::tuple<>>;
+
+/**
+ * Specialization of the view for tuples of the storages.
+ * \tparam Storages  The types of the required storages.
+ * \tparam Excluded  The types of the excluded storages.
+ * \tparam Optionals The types of the optional storages.
+ */
+template <typename... Storages, typename... Excluded, typename... Optionals>
+class BasicView<
+  std::tuple<Storages...>,
+  std::tuple<Excluded...>,
+  std::tuple<Optionals...>> {
+  static_assert(sizeof...(Storages) > 0, "View requires at least one storage!");
+
+  // clang-format off
+  /** Defines the type of the sparse set for the storage. */
+  using Set           = detail::sparse_set_t<
+    std::tuple_element_t<0, std::tuple<Storages...>>>;
+  /** Defines the type of the container of the storages. */
+  using Pools         = std::tuple<Storages*...>;
+  /** Defines the type of the container of the excluded storages. */
+  using ExcludedPools = std::tuple<Excluded*...>;
+  /** Defines the type of the container of the optional storages. */
+  using OptionalPools = std::tuple<Optionals*...>;
+  /** Defines the type of the iterator over the candidate entities. */
+  using SetIter       = typename Set::Iterator;
+  // clang-format on
+
+ public:
+  // clang-format off
+  /** Defines the type of the entities in the view. */
+  using Entity   = std::decay_t<decltype(*std::declval<SetIter>())>;
+  /** Defines the size type for the view. */
+  using SizeType = typename Set::SizeType;
+  // clang-format on
+
+  /**
+   * Iterator over the entities in the view. This iterates over the candidate
+   * entities, skipping any which are not in the view.
+   */
+  class Iterator {
+    friend class BasicView;
+
+    /**
+     * Constructor to set the view, the iterator over the candidates, and the
+     * end of the candidates.
+     * \param view The view to iterate over.
+     * \param it   The current candidate iterator.
+     * \param end  The end of the candidates.
+     */
+    Iterator(const BasicView* view, SetIter it, SetIter end) noexcept
+    : view_{view}, it_{it}, end_{end} {
+      skip();
+    }
+
+   public:
+    // clang-format off
+    /** Difference type for the iterator. */
+    using difference_type   = typename SetIter::difference_type;
+    /** Value type for the iterator. */
+    using value_type        = Entity;
+    /** Pointer type for the iterator. */
+    using pointer           = const Entity*;
+    /** Reference type for the iterator. */
+    using reference         = const Entity&;
+    /** Category for the iterator. */
+    using iterator_category = std::forward_iterator_tag;
+    // clang-format on
+
+    /** Default constructor for the iterator. */
+    Iterator() noexcept = default;
+
+    /**
+     * Overload of prefix increment operator, which moves to the next entity
+     * which is present in all storages.
+     * \return A reference to the modified iterator.
+     */
+    auto operator++() noexcept -> Iterator& {
+      ++it_;
+      skip();
+      return *this;
+    }
+
+    /**
+     * Overload of postfix increment operator.
+     * \return The new iterator with the original position.
+     */
+    auto operator++(int) noexcept -> Iterator {
+      Iterator curr = *this;
+      operator++();
+      return curr;
+    }
+
+    /**
+     * Equality comparison operator.
+     * \param other The other iterator to compare to.
+     * \return __true__ if the iterators are equal.
+     */
+    snowflake_nodiscard auto
+    operator==(const Iterator& other) const noexcept -> bool {
+      return other.it_ == it_;
+    }
+
+    /**
+     * Inequality comparison operator.
+     * \param other The other iterator to compare to.
+     * \return __true__ if the iterators are not equal.
+     */
+    snowflake_nodiscard auto
+    operator!=(const Iterator& other) const noexcept -> bool {
+      return other.it_ != it_;
+    }
+
+    /**
+     * Overload of arrow operator to access a pointer to the iterated entity.
+     * \return A pointer to the iterated entity.
+     */
+    snowflake_nodiscard auto operator->() const -> pointer {
+      return it_.operator->();
+    }
+
+    /**
+     * Overload of derference operator to get a reference to the iterated
+     * entity.
+     * \return A reference to the iterated entity.
+     */
+    snowflake_nodiscard auto operator*() const -> reference {
+      return *it_;
+    }
+
+   private:
+    const BasicView* view_ = nullptr; //!< The view being iterated.
+    SetIter          it_   = {};      //!< The current candidate.
+    SetIter          end_  = {};      //!< The end of the candidates.
+
+    /**
+     * Moves the iterator forward until it points to an entity which is in the
+     * view, or to the end.
+     */
+    auto skip() noexcept -> void {
+      while (it_ != end_ && !view_->contains(*it_)) {
+        ++it_;
+      }
+    }
+  };
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Constructor to create the view from the storages. This selects the
+   * smallest of the required storages to drive the iteration.
+   *
+   * \note Any of the excluded and optional storages may be null, in which
+   *       case they are treated as empty.
+   *
+   * \param storages  The required storages for the view.
+   * \param excluded  Pointers to the excluded storages for the view.
+   * \param optionals Pointers to the optional storages for the view.
+   */
+  BasicView(
+    Storages&... storages,
+    Excluded*... excluded,
+    Optionals*... optionals) noexcept
+  : pools_{&storages...},
+    excluded_{excluded...},
+    optionals_{optionals...} {
+    candidates_ = std::get<0>(pools_);
+    (select(storages), ...);
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Returns the maximum number of entities which can be iterated over in the
+   * view, which is the size of the smallest storage in the view.
+   * \return The upper bound on the number of entities in the view.
+   */
+  snowflake_nodiscard auto size_hint() const noexcept -> SizeType {
+    return candidates_->size();
+  }
+
+  /**
+   * Determines if the \p entity has all the required components in the view,
+   * and none of the excluded components.
+   * \param entity The entity to check.
+   * \return __true__ if the entity is in the view.
+   */
+  snowflake_nodiscard auto
+  contains(const Entity& entity) const noexcept -> bool {
+    return (std::get<Storages*>(pools_)->exists(entity) && ...) &&
+           (!has(std::get<Excluded*>(excluded_), entity) && ...);
+  }
+
+  /**
+   * Gets the component of type from \p Storage for the \p entity.
+   *
+   * \note If the entity is not in the view then this will assert in debug,
+   *       or cause undefined behaviour in release.
+   *
+   * \param  entity  The entity to get the component for.
+   * \tparam Storage The type of the storage to get the component from.
+   * \return A reference to the component.
+   */
+  template <typename Storage>
+  snowflake_nodiscard decltype(auto) get(const Entity& entity) const {
+    return std::get<Storage*>(pools_)->get(entity);
+  }
+
+  /**
+   * Gets a pointer to the optional component from \p Storage for the
+   * \p entity.
+   * \param  entity  The entity to get the component for.
+   * \tparam Storage The type of the optional storage to get the component
+   *                 from.
+   * \return A pointer to the component, or nullptr if the entity does not
+   *         have the component.
+   */
+  template <typename Storage>
+  snowflake_nodiscard auto find(const Entity& entity) const {
+    Storage* storage = std::get<Storage*>(optionals_);
+    using Pointer    = decltype(&storage->get(entity));
+    return has(storage, entity) ? &storage->get(entity) : Pointer{nullptr};
+  }
+
+  /**
+   * Gets all the required components in the view for the \p entity.
+   *
+   * \note If the entity is not in the view then this will assert in debug,
+   *       or cause undefined behaviour in release.
+   *
+   * \param entity The entity to get the components for.
+   * \return A tuple of references to the components.
+   */
+  snowflake_nodiscard auto get(const Entity& entity) const {
+    return std::tuple<decltype(std::declval<Storages&>().get(entity))...>{
+      std::get<Storages*>(pools_)->get(entity)...};
+  }
+
+  /**
+   * Applies the \p functor to each entity in the view, and all of the
+   * components in the view for the entity.
+   *
+   * The functor can either take the entity followed by the components, or
+   * just the components, for example:
+   *
+   * ~~~{.cpp}
+   * view.each([] (Entity e, Position& p, Velocity& v) { ... });
+   * view.each([] (Position& p, Velocity& v) { ... });
+   * ~~~
+   *
+   * The required components are followed by pointers to the optional
+   * components, which are null if the entity does not have the component.
+   *
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto each(Functor&& functor) const -> void {
+    for (auto it = candidates_->begin(), end = candidates_->end(); it != end;
+         ++it) {
+      const Entity entity = *it;
+      if (contains(entity)) {
+        invoke(functor, entity);
+      }
+    }
+  }
+
+  /**
+   * Applies the \p functor to each entity in the view, and all of the
+   * components in the view for the entity, in parallel, using the threads in
+   * the \p pool.
+   *
+   * The candidate entities are split into contiguous chunks, a few for each
+   * thread in the pool. The functor has the same form as for each().
+   *
+   * \note The functor may be invoked concurrently, and must not add or remove
+   *       components from any of the storages in the view.
+   *
+   * \param  pool    The thread pool to execute the functor with.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto parallel_for_each(ThreadPool& pool, Functor&& functor) const -> void {
+    const Entity* ents  = candidates_->rbegin();
+    const size_t  size  = candidates_->size();
+    const size_t  grain = std::max(size_t{1024}, size / pool.concurrency() / 4);
+    pool.parallel_for(0, size, grain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const Entity entity = ents[i];
+        if (contains(entity)) {
+          invoke(functor, entity);
+        }
+      }
+    });
+  }
+
+  /*==--- [iteration] ------------------------------------------------------==*/
+
+  /**
+   * Returns an iterator to the first entity in the view.
+   * \return An iterator to the first entity in the view.
+   */
+  snowflake_nodiscard auto begin() const noexcept -> Iterator {
+    return Iterator{this, candidates_->begin(), candidates_->end()};
+  }
+
+  /**
+   * Returns an iterator to the end of the view.
+   * \return An iterator to the end of the view.
+   */
+  snowflake_nodiscard auto end() const noexcept -> Iterator {
+    return Iterator{this, candidates_->end(), candidates_->end()};
+  }
+
+ private:
+  Pools         pools_      = {};      //!< Storages for the view.
+  ExcludedPools excluded_   = {};      //!< Excluded storages.
+  OptionalPools optionals_  = {};      //!< Optional storages.
+  const Set*    candidates_ = nullptr; //!< Smallest storage in the view.
+
+  /**
+   * Invokes the \p functor with the components for the \p entity, which
+   * must be in the view.
+   * \param  functor The functor to invoke.
+   * \param  entity  The entity to invoke the functor for.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto invoke(Functor& functor, const Entity& entity) const -> void {
+    if constexpr (std::is_invocable_v<
+                    Functor&,
+                    Entity,
+                    decltype(std::declval<Storages&>().get(entity))...,
+                    decltype(find<Optionals>(entity))...>) {
+      functor(
+        entity,
+        std::get<Storages*>(pools_)->get(entity)...,
+        find<Optionals>(entity)...);
+    } else {
+      functor(
+        std::get<Storages*>(pools_)->get(entity)...,
+        find<Optionals>(entity)...);
+    }
+  }
+
+  /**
+   * Determines if the \p storage has the \p entity, where a null storage is
+   * treated as empty.
+   * \param  storage The storage to check, which may be null.
+   * \param  entity  The entity to check for.
+   * \tparam Storage The type of the storage.
+   * \return __true__ if the storage exists and has the entity.
+   */
+  template <typename Storage>
+  static auto has(const Storage* storage, const Entity& entity) noexcept
+    -> bool {
+    return storage != nullptr && storage->exists(entity);
+  }
+
+  /**
+   * Sets the candidates to the \p storage if it is smaller than the current
+   * candidates.
+   * \param storage The storage to check.
+   */
+  auto select(const Set& storage) noexcept -> void {
+    if (storage.size() < candidates_->size()) {
+      candidates_ = &storage;
+    }
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_ECS_VIEW_HPP
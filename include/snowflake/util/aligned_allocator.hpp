@@ -0,0 +1,105 @@
+//==--- snowflake/util/aligned_allocator.hpp --------------- -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  aligned_allocator.hpp
+/// \brief This file defines an allocator for aligned memory.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_ALIGNED_ALLOCATOR_HPP
+#define SNOWFLAKE_UTIL_ALIGNED_ALLOCATOR_HPP
+
+#include "portability.hpp"
+#include <cstddef>
+#include <new>
+
+namespace snowflake {
+
+/**
+ * Standard library compatible allocator which allocates memory aligned to
+ * \p Alignment bytes, for use with containers whose data is processed with
+ * wide vector instructions.
+ *
+ * \tparam T         The type to allocate.
+ * \tparam Alignment The alignment of the allocations, in bytes.
+ */
+template <typename T, size_t Alignment = 64>
+class AlignedAllocator {
+  static_assert(
+    (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two!");
+  static_assert(
+    Alignment >= alignof(T), "Alignment must be at least alignof(T)!");
+
+ public:
+  /** The type of the allocated values. */
+  using value_type = T;
+
+  /**
+   * Rebinds the allocator to another type.
+   * \tparam U The type to rebind to.
+   */
+  template <typename U>
+  struct rebind {
+    /** The type of the rebound allocator. */
+    using other = AlignedAllocator<U, Alignment>;
+  };
+
+  /** Default constructor. */
+  AlignedAllocator() noexcept = default;
+
+  /**
+   * Converting constructor from an allocator for another type.
+   * \tparam U The type of the other allocator.
+   */
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+  /**
+   * Allocates memory for \p n elements, aligned to the alignment.
+   * \param n The number of elements to allocate.
+   * \return A pointer to the allocated memory.
+   */
+  snowflake_nodiscard auto allocate(size_t n) -> T* {
+    return static_cast<T*>(
+      ::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+  }
+
+  /**
+   * Deallocates the memory pointed to by \p ptr.
+   * \param ptr The pointer to the memory to deallocate.
+   */
+  auto deallocate(T* ptr, size_t) noexcept -> void {
+    ::operator delete(ptr, std::align_val_t{Alignment});
+  }
+
+  /**
+   * Equality comparison, which is always true since the allocator has no
+   * state.
+   */
+  template <typename U>
+  constexpr auto
+  operator==(const AlignedAllocator<U, Alignment>&) const noexcept -> bool {
+    return true;
+  }
+
+  /**
+   * Inequality comparison, which is always false since the allocator has no
+   * state.
+   */
+  template <typename U>
+  constexpr auto
+  operator!=(const AlignedAllocator<U, Alignment>&) const noexcept -> bool {
+    return false;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_ALIGNED_ALLOCATOR_HPP
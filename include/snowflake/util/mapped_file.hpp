@@ -0,0 +1,192 @@
+//==--- snowflake/util/mapped_file.hpp --------------------- -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  mapped_file.hpp
+/// \brief This file defines functionality for memory mapping files.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_MAPPED_FILE_HPP
+#define SNOWFLAKE_UTIL_MAPPED_FILE_HPP
+
+#include "portability.hpp"
+#include <cstddef>
+#include <utility>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace snowflake {
+
+/**
+ * Read-only memory mapping of a file. The contents of the file are only read
+ * from disk when the mapped pages are first touched, so the cost of opening
+ * a large file is independent of its size.
+ */
+class MappedFile {
+ public:
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Default constructor, which creates an empty mapping.
+   */
+  MappedFile() noexcept = default;
+
+  /**
+   * Maps the file at \p path.
+   *
+   * \note If the file can not be opened or mapped, or is empty, the mapping
+   *       is empty, which can be checked with valid().
+   *
+   * \param path The path to the file to map.
+   */
+  explicit MappedFile(const char* path) noexcept {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(
+      path,
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping != nullptr) {
+        data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+      }
+    }
+    CloseHandle(file);
+    size_ = data_ != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+#else
+    const int file = open(path, O_RDONLY);
+    if (file < 0) {
+      return;
+    }
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+      void* data = mmap(
+        nullptr,
+        static_cast<size_t>(info.st_size),
+        PROT_READ,
+        MAP_PRIVATE,
+        file,
+        0);
+      if (data != MAP_FAILED) {
+        data_ = data;
+        size_ = static_cast<size_t>(info.st_size);
+        // The data is usually read front to back, so let the kernel read
+        // ahead aggressively.
+        madvise(data_, size_, MADV_SEQUENTIAL);
+      }
+    }
+    close(file);
+#endif
+  }
+
+  /**
+   * Destructor, which unmaps the file.
+   */
+  ~MappedFile() noexcept {
+    release();
+  }
+
+  /**
+   * Move constructor, which takes ownership of the \p other mapping.
+   * \param other The other mapping to move from.
+   */
+  MappedFile(MappedFile&& other) noexcept
+  : data_{std::exchange(other.data_, nullptr)},
+    size_{std::exchange(other.size_, 0)} {}
+
+  /**
+   * Move assignment, which unmaps this file, and takes ownership of the
+   * \p other mapping.
+   * \param other The other mapping to move from.
+   * \return A reference to this mapping.
+   */
+  auto operator=(MappedFile&& other) noexcept -> MappedFile& {
+    if (this != &other) {
+      release();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  /** Copy constructor -- deleted. */
+  MappedFile(const MappedFile&) = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const MappedFile&) = delete;
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Gets a pointer to the start of the mapped file.
+   * \return A pointer to the file data, or nullptr if the mapping is empty.
+   */
+  snowflake_nodiscard auto data() const noexcept -> const std::byte* {
+    return static_cast<const std::byte*>(data_);
+  }
+
+  /**
+   * Gets the number of bytes in the mapped file.
+   * \return The size of the file, in bytes.
+   */
+  snowflake_nodiscard auto size() const noexcept -> size_t {
+    return size_;
+  }
+
+  /**
+   * Determines if the mapping is valid.
+   * \return __true__ if the file is mapped.
+   */
+  snowflake_nodiscard auto valid() const noexcept -> bool {
+    return data_ != nullptr;
+  }
+
+ private:
+  void*  data_ = nullptr; //!< Pointer to the start of the mapping.
+  size_t size_ = 0;       //!< Size of the mapping, in bytes.
+
+  /**
+   * Unmaps the file, if it is mapped.
+   */
+  auto release() noexcept -> void {
+    if (data_ == nullptr) {
+      return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_MAPPED_FILE_HPP
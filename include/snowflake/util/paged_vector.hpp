@@ -0,0 +1,441 @@
+//==--- snowflake/util/paged_vector.hpp -------------------- -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  paged_vector.hpp
+/// \brief This file defines a vector which stores elements in fixed size
+///        pages, which are never relocated.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_PAGED_VECTOR_HPP
+#define SNOWFLAKE_UTIL_PAGED_VECTOR_HPP
+
+#include "portability.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Pointer-like access to the elements of a PagedVector, which can be indexed
+ * and offset like a pointer into contiguous data, but finds the page for each
+ * element.
+ *
+ * \note Like a pointer into a std::vector, this is invalidated when pages are
+ *       added to the vector, while references to the elements are not.
+ *
+ * \tparam T        The type of the elements, which may be const.
+ * \tparam PageSize The number of elements in each page.
+ */
+template <typename T, size_t PageSize>
+class PagedPointer {
+  /** Defines the type of a page. */
+  using Page = std::remove_const_t<T>*;
+
+ public:
+  // clang-format off
+  /** The type of the difference between pointers. */
+  using difference_type   = std::ptrdiff_t;
+  /** The type of the elements. */
+  using value_type        = std::remove_const_t<T>;
+  /** The type of a pointer to an element. */
+  using pointer           = T*;
+  /** The type of a reference to an element. */
+  using reference         = T&;
+  /** The category of the iterator. */
+  using iterator_category = std::random_access_iterator_tag;
+  // clang-format on
+
+  /** Default constructor. */
+  constexpr PagedPointer() noexcept = default;
+
+  /**
+   * Constructor to set the pages and the index of the pointed to element.
+   * \param pages The pages of the vector.
+   * \param index The index of the element.
+   */
+  constexpr PagedPointer(const Page* pages, size_t index) noexcept
+  : pages_{pages}, index_{index} {}
+
+  /**
+   * Gets a reference to the element at \p offset from this pointer.
+   * \param offset The offset of the element.
+   * \return A reference to the element.
+   */
+  constexpr auto operator[](difference_type offset) const noexcept -> T& {
+    const size_t i = index_ + offset;
+    return pages_[i / PageSize][i % PageSize];
+  }
+
+  /**
+   * Gets a reference to the pointed to element.
+   * \return A reference to the element.
+   */
+  constexpr auto operator*() const noexcept -> T& {
+    return (*this)[0];
+  }
+
+  /**
+   * Gets a pointer to the pointed to element.
+   * \return A pointer to the element.
+   */
+  constexpr auto operator->() const noexcept -> T* {
+    return &(*this)[0];
+  }
+
+  /**
+   * Advances the pointer by one element.
+   * \return A reference to the advanced pointer.
+   */
+  constexpr auto operator++() noexcept -> PagedPointer& {
+    ++index_;
+    return *this;
+  }
+
+  /**
+   * Advances the pointer by \p offset elements.
+   * \param offset The number of elements to advance by.
+   * \return A reference to the advanced pointer.
+   */
+  constexpr auto operator+=(difference_type offset) noexcept -> PagedPointer& {
+    index_ += offset;
+    return *this;
+  }
+
+  /**
+   * Gets a pointer which is \p offset elements past this pointer.
+   * \param offset The number of elements to advance by.
+   * \return The advanced pointer.
+   */
+  constexpr auto
+  operator+(difference_type offset) const noexcept -> PagedPointer {
+    return PagedPointer{pages_, index_ + offset};
+  }
+
+  /**
+   * Gets the number of elements between this pointer and the \p other.
+   * \param other The other pointer.
+   * \return The number of elements between the pointers.
+   */
+  constexpr auto
+  operator-(const PagedPointer& other) const noexcept -> difference_type {
+    return static_cast<difference_type>(index_) -
+           static_cast<difference_type>(other.index_);
+  }
+
+  /**
+   * Compares the pointer with the \p other pointer.
+   * \param other The other pointer.
+   * \return __true__ if the pointers point to the same element.
+   */
+  constexpr auto operator==(const PagedPointer& other) const noexcept -> bool {
+    return pages_ == other.pages_ && index_ == other.index_;
+  }
+
+  /**
+   * Compares the pointer with the \p other pointer.
+   * \param other The other pointer.
+   * \return __true__ if the pointers point to different elements.
+   */
+  constexpr auto operator!=(const PagedPointer& other) const noexcept -> bool {
+    return !(*this == other);
+  }
+
+ private:
+  const Page* pages_ = nullptr; //!< The pages of the vector.
+  size_t      index_ = 0;       //!< The index of the element.
+};
+
+/**
+ * Vector which stores its elements in pages of \p PageSize elements, rather
+ * than in a single contiguous allocation.
+ *
+ * Pages are allocated as the vector grows, and are never relocated, so growth
+ * is constant time without moving any of the existing elements, and pointers
+ * and references to elements remain valid when elements are added. Elements
+ * are contiguous within a page, and pages are aligned to cache lines.
+ *
+ * \note Pages are not released when elements are removed, until the vector is
+ *       destroyed, just as a std::vector keeps its capacity.
+ *
+ * \tparam T        The type of the elements.
+ * \tparam PageSize The number of elements in each page, which must be a power
+ *                  of two.
+ */
+template <typename T, size_t PageSize>
+class PagedVector {
+  static_assert(
+    PageSize > 0 && (PageSize & (PageSize - 1)) == 0,
+    "Page size must be a power of two!");
+
+  /** Defines the type of a page. */
+  using Page = T*;
+
+  /** The alignment of the pages. */
+  static constexpr size_t page_alignment =
+    std::max(alignof(T), cache_line_size);
+
+ public:
+  // clang-format off
+  /** The size type. */
+  using SizeType     = size_t;
+  /** The type of the elements. */
+  using value_type   = T;
+  /** Pointer-like access to the elements. */
+  using Pointer      = PagedPointer<T, PageSize>;
+  /** Const pointer-like access to the elements. */
+  using ConstPointer = PagedPointer<const T, PageSize>;
+  // clang-format on
+
+  /** The number of elements in each page. */
+  static constexpr SizeType page_size = PageSize;
+
+  /** Default constructor. */
+  PagedVector() noexcept = default;
+
+  /** Destructor which destroys the elements and releases the pages. */
+  ~PagedVector() noexcept {
+    clear();
+    for (auto page : pages_) {
+      ::operator delete(page, std::align_val_t{page_alignment});
+    }
+  }
+
+  /**
+   * Move constructor, which takes the pages of the \p other vector.
+   * \param other The other vector to move from.
+   */
+  PagedVector(PagedVector&& other) noexcept
+  : pages_{std::move(other.pages_)}, size_{std::exchange(other.size_, 0)} {
+    other.pages_.clear();
+  }
+
+  /**
+   * Move assignment, which swaps the pages with the \p other vector.
+   * \param other The other vector to move from.
+   * \return A reference to this vector.
+   */
+  auto operator=(PagedVector&& other) noexcept -> PagedVector& {
+    if (this != &other) {
+      std::swap(pages_, other.pages_);
+      std::swap(size_, other.size_);
+    }
+    return *this;
+  }
+
+  /** Copying is not allowed. */
+  PagedVector(const PagedVector&) = delete;
+  /** Copy assignment is not allowed. */
+  auto operator=(const PagedVector&) = delete;
+
+  /*==--- [capacity] -------------------------------------------------------==*/
+
+  /**
+   * Gets the number of elements in the vector.
+   * \return The number of elements.
+   */
+  snowflake_nodiscard auto size() const noexcept -> SizeType {
+    return size_;
+  }
+
+  /**
+   * Determines if the vector is empty.
+   * \return __true__ if there are no elements.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return size_ == 0;
+  }
+
+  /**
+   * Gets the number of elements which can be stored without allocating.
+   * \return The capacity of the vector.
+   */
+  snowflake_nodiscard auto capacity() const noexcept -> SizeType {
+    return pages_.size() * page_size;
+  }
+
+  /**
+   * Allocates enough pages to store \p size elements.
+   * \param size The number of elements to reserve.
+   */
+  auto reserve(SizeType size) -> void {
+    const SizeType pages = (size + page_size - 1) / page_size;
+    while (pages_.size() < pages) {
+      pages_.push_back(static_cast<Page>(::operator new(
+        sizeof(T) * page_size, std::align_val_t{page_alignment})));
+    }
+  }
+
+  /*==--- [modifiers] ------------------------------------------------------==*/
+
+  /**
+   * Constructs an element at the end of the vector from the \p args.
+   * \param  args The arguments for the construction of the element.
+   * \tparam Args The types of the arguments.
+   * \return A reference to the new element.
+   */
+  template <typename... Args>
+  auto emplace_back(Args&&... args) -> T& {
+    reserve(size_ + 1);
+    T* element = address(size_);
+    new (element) T(std::forward<Args>(args)...);
+    ++size_;
+    return *element;
+  }
+
+  /**
+   * Adds the \p value to the end of the vector.
+   * \param value The value to add.
+   */
+  auto push_back(T&& value) -> void {
+    emplace_back(std::move(value));
+  }
+
+  /**
+   * Adds a copy of the \p value to the end of the vector.
+   * \param value The value to add.
+   */
+  auto push_back(const T& value) -> void {
+    emplace_back(value);
+  }
+
+  /**
+   * Adds \p count copies of the \p value to the end of the vector.
+   * \param count The number of copies to add.
+   * \param value The value to copy.
+   */
+  auto append(SizeType count, const T& value) -> void {
+    reserve(size_ + count);
+    for (SizeType i = 0; i < count; ++i) {
+      new (address(size_)) T(value);
+      ++size_;
+    }
+  }
+
+  /**
+   * Adds copies of the elements in the range [\p first, \p last) to the end
+   * of the vector. For trivially copyable elements from contiguous memory,
+   * this is one copy per page.
+   * \param  first    An iterator to the first element to add.
+   * \param  last     An iterator to one past the last element to add.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Iterator>
+  auto append(Iterator first, Iterator last) -> void {
+    const auto count = static_cast<SizeType>(std::distance(first, last));
+    reserve(size_ + count);
+    if constexpr (
+      std::is_pointer_v<Iterator> && std::is_trivially_copyable_v<T>) {
+      SizeType copied = 0;
+      while (copied < count) {
+        const SizeType offset = size_ % page_size;
+        const SizeType bytes  = std::min(page_size - offset, count - copied);
+        std::memcpy(address(size_), first + copied, sizeof(T) * bytes);
+        copied += bytes;
+        size_ += bytes;
+      }
+    } else {
+      for (; first != last; ++first) {
+        new (address(size_)) T(*first);
+        ++size_;
+      }
+    }
+  }
+
+  /**
+   * Removes the last element from the vector.
+   * \note If the vector is empty, this asserts in debug.
+   */
+  auto pop_back() noexcept -> void {
+    assert(size_ > 0 && "Can't pop from empty vector!");
+    --size_;
+    address(size_)->~T();
+  }
+
+  /**
+   * Removes all elements from the vector, keeping the pages.
+   */
+  auto clear() noexcept -> void {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for (SizeType i = 0; i < size_; ++i) {
+        address(i)->~T();
+      }
+    }
+    size_ = 0;
+  }
+
+  /*==--- [access] ---------------------------------------------------------==*/
+
+  /**
+   * Gets the element at the \p index.
+   * \param index The index of the element.
+   * \return A reference to the element.
+   */
+  auto operator[](SizeType index) noexcept -> T& {
+    return *address(index);
+  }
+
+  /**
+   * Gets the element at the \p index.
+   * \param index The index of the element.
+   * \return A const reference to the element.
+   */
+  auto operator[](SizeType index) const noexcept -> const T& {
+    return *address(index);
+  }
+
+  /**
+   * Gets the last element in the vector.
+   * \return A reference to the last element.
+   */
+  auto back() noexcept -> T& {
+    return *address(size_ - 1);
+  }
+
+  /**
+   * Gets pointer-like access to the elements, from the first element.
+   * \return Pointer-like access to the elements.
+   */
+  snowflake_nodiscard auto data() noexcept -> Pointer {
+    return Pointer{pages_.data(), 0};
+  }
+
+  /**
+   * Gets const pointer-like access to the elements, from the first element.
+   * \return Const pointer-like access to the elements.
+   */
+  snowflake_nodiscard auto data() const noexcept -> ConstPointer {
+    return ConstPointer{pages_.data(), 0};
+  }
+
+ private:
+  std::vector<Page> pages_ = {}; //!< The pages of elements.
+  SizeType          size_  = 0;  //!< The number of elements.
+
+  /**
+   * Gets the address of the element at the \p index.
+   * \param index The index of the element.
+   * \return A pointer to the element.
+   */
+  auto address(SizeType index) const noexcept -> T* {
+    return pages_[index / page_size] + index % page_size;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_PAGED_VECTOR_HPP
@@ -0,0 +1,218 @@
+//==--- snowflake/util/radix_sort.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  radix_sort.hpp
+/// \brief This file defines a radix sort for arithmetic keys.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_RADIX_SORT_HPP
+#define SNOWFLAKE_UTIL_RADIX_SORT_HPP
+
+#include "portability.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace snowflake {
+namespace detail {
+
+/**
+ * Defines the unsigned integer type with \p Bytes bytes.
+ * \tparam Bytes The number of bytes in the type.
+ */
+template <size_t Bytes>
+struct UnsignedOfSize {};
+
+/** Specialization for one byte. */
+template <>
+struct UnsignedOfSize<1> {
+  /** The type of the unsigned integer. */
+  using type = uint8_t;
+};
+
+/** Specialization for two bytes. */
+template <>
+struct UnsignedOfSize<2> {
+  /** The type of the unsigned integer. */
+  using type = uint16_t;
+};
+
+/** Specialization for four bytes. */
+template <>
+struct UnsignedOfSize<4> {
+  /** The type of the unsigned integer. */
+  using type = uint32_t;
+};
+
+/** Specialization for eight bytes. */
+template <>
+struct UnsignedOfSize<8> {
+  /** The type of the unsigned integer. */
+  using type = uint64_t;
+};
+
+} // namespace detail
+
+/**
+ * Defines the type of the unsigned integer which a key of type Key is mapped
+ * to for radix sorting.
+ * \tparam Key The type of the key.
+ */
+template <typename Key>
+using radix_key_t = typename detail::UnsignedOfSize<sizeof(Key)>::type;
+
+/**
+ * Maps the \p key to an unsigned integer, such that the order of the unsigned
+ * integers is the same as the order of the keys.
+ *
+ * Signed integers have the sign bit flipped. Floating point values have the
+ * sign bit flipped if they are positive, and all bits flipped if they are
+ * negative.
+ *
+ * \param  key The key to map to an unsigned integer.
+ * \tparam Key The type of the key.
+ * \return The unsigned integer for the key.
+ */
+template <typename Key>
+auto radix_key(Key key) noexcept -> radix_key_t<Key> {
+  static_assert(
+    std::is_arithmetic_v<Key>, "Radix sort keys must be arithmetic types!");
+  using Bits          = radix_key_t<Key>;
+  constexpr Bits sign = Bits{1} << (sizeof(Key) * 8 - 1);
+
+  if constexpr (std::is_floating_point_v<Key>) {
+    Bits bits;
+    std::memcpy(&bits, &key, sizeof(Key));
+    return (bits & sign) ? static_cast<Bits>(~bits)
+                         : static_cast<Bits>(bits | sign);
+  } else if constexpr (std::is_signed_v<Key>) {
+    return static_cast<Bits>(static_cast<Bits>(key) ^ sign);
+  } else {
+    return static_cast<Bits>(key);
+  }
+}
+
+namespace detail {
+
+/**
+ * Sorts the \p keys and \p order with insertion sort, moving at most
+ * \p budget elements. This is very fast for keys which are nearly sorted.
+ *
+ * \note If the budget is exceeded the keys are only partially sorted.
+ *
+ * \param  keys   The keys to sort.
+ * \param  order  The indices to sort with the keys.
+ * \param  budget The maximum number of elements to move.
+ * \tparam Bits   The type of the keys.
+ * \return __true__ if the keys were sorted within the budget.
+ */
+template <typename Bits>
+auto insertion_sort(
+  std::vector<Bits>& keys, std::vector<size_t>& order, size_t budget) noexcept
+  -> bool {
+  for (size_t i = 1; i < keys.size(); ++i) {
+    const Bits   key   = keys[i];
+    const size_t index = order[i];
+    size_t       j     = i;
+    for (; j > 0 && keys[j - 1] > key; --j) {
+      keys[j]  = keys[j - 1];
+      order[j] = order[j - 1];
+    }
+    keys[j]  = key;
+    order[j] = index;
+
+    if ((i - j) > budget) {
+      return false;
+    }
+    budget -= i - j;
+  }
+  return true;
+}
+
+} // namespace detail
+
+/**
+ * Computes the order of the \p size keys pointed to by \p keys, such that
+ * `keys[order[i]]` is sorted in ascending order. The sort is stable.
+ *
+ * This first tries an insertion sort with a budget linear in the number of
+ * keys, so that nearly sorted keys (i.e keys which were sorted and have
+ * changed slightly since) are sorted in linear time. If the keys are not
+ * nearly sorted, this uses a least significant digit radix sort, with one
+ * pass per byte of the key, skipping passes for bytes which are the same for
+ * all keys.
+ *
+ * \param  keys A pointer to the keys to sort.
+ * \param  size The number of keys.
+ * \tparam Key  The type of the keys.
+ * \return The indices of the keys, in sorted order.
+ */
+template <typename Key>
+auto radix_sort_order(const Key* keys, size_t size) -> std::vector<size_t> {
+  using Bits = radix_key_t<Key>;
+  // clang-format off
+  constexpr size_t radix        = 256;
+  constexpr size_t passes       = sizeof(Bits);
+  constexpr size_t budget_scale = 8;
+  // clang-format on
+
+  std::vector<Bits>   bits(size);
+  std::vector<size_t> order(size);
+  for (size_t i = 0; i < size; ++i) {
+    bits[i]  = radix_key(keys[i]);
+    order[i] = i;
+  }
+
+  if (detail::insertion_sort(bits, order, budget_scale * size)) {
+    return order;
+  }
+
+  // Compute the histograms for all passes at once, and then the offsets.
+  std::array<std::array<size_t, radix>, passes> offsets{};
+  for (const auto key : bits) {
+    for (size_t pass = 0; pass < passes; ++pass) {
+      ++offsets[pass][(key >> (pass * 8)) & 0xff];
+    }
+  }
+
+  std::vector<Bits>   bits_tmp(size);
+  std::vector<size_t> order_tmp(size);
+  for (size_t pass = 0; pass < passes; ++pass) {
+    auto&  offset = offsets[pass];
+    size_t total  = 0;
+    bool   skip   = false;
+    for (auto& count : offset) {
+      skip           = skip || count == size;
+      const auto cnt = count;
+      count          = total;
+      total += cnt;
+    }
+    if (skip) {
+      continue;
+    }
+
+    const size_t shift = pass * 8;
+    for (size_t i = 0; i < size; ++i) {
+      const size_t dst = offset[(bits[i] >> shift) & 0xff]++;
+      bits_tmp[dst]    = bits[i];
+      order_tmp[dst]   = order[i];
+    }
+    bits.swap(bits_tmp);
+    order.swap(order_tmp);
+  }
+  return order;
+}
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_RADIX_SORT_HPP
@@ -0,0 +1,389 @@
+//==--- snowflake/util/relocating_vector.hpp --------------- -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  relocating_vector.hpp
+/// \brief This file defines a contiguous vector for elements which can be
+///        relocated by copying their bytes.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_RELOCATING_VECTOR_HPP
+#define SNOWFLAKE_UTIL_RELOCATING_VECTOR_HPP
+
+#include "portability.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace snowflake {
+
+/**
+ * Swaps the objects \p a and \p b by swapping their bytes, rather than by
+ * moving them through a temporary.
+ *
+ * \note This is only valid for types which can be relocated with a copy of
+ *       their bytes.
+ *
+ * \param  a An object to swap.
+ * \param  b An object to swap.
+ * \tparam T The type of the objects.
+ */
+template <typename T>
+auto relocate_swap(T& a, T& b) noexcept -> void {
+  if (&a == &b) {
+    return;
+  }
+  alignas(T) unsigned char tmp[sizeof(T)];
+  void*                    pa = std::addressof(a);
+  void*                    pb = std::addressof(b);
+  std::memcpy(tmp, pa, sizeof(T));
+  std::memcpy(pa, pb, sizeof(T));
+  std::memcpy(pb, tmp, sizeof(T));
+}
+
+/**
+ * Contiguous vector for elements which can be relocated by copying their
+ * bytes, and which do not need to be notified when their address changes.
+ *
+ * Growth copies the bytes of the existing elements into the new allocation,
+ * rather than moving and destroying each element, and allocations with
+ * default alignment are grown with realloc, which can often extend the
+ * allocation in place. Removing an element by relocating the last element
+ * into its place is a single byte copy.
+ *
+ * \note Like std::vector, pointers and references to the elements are
+ *       invalidated when the vector grows.
+ *
+ * \tparam T The type of the elements, which must be relocatable.
+ */
+template <typename T>
+class RelocatingVector {
+  /** If the allocation can be managed with realloc. */
+  static constexpr bool use_realloc = alignof(T) <= alignof(std::max_align_t);
+
+ public:
+  // clang-format off
+  /** The size type. */
+  using SizeType   = size_t;
+  /** The type of the elements. */
+  using value_type = T;
+  // clang-format on
+
+  /** Default constructor. */
+  RelocatingVector() noexcept = default;
+
+  /** Destructor which destroys the elements and releases the memory. */
+  ~RelocatingVector() noexcept {
+    clear();
+    release(data_);
+  }
+
+  /**
+   * Copy constructor, which copies the elements of the \p other vector.
+   * \param other The other vector to copy.
+   */
+  RelocatingVector(const RelocatingVector& other) {
+    append(other.data_, other.data_ + other.size_);
+  }
+
+  /**
+   * Move constructor, which takes the elements of the \p other vector.
+   * \param other The other vector to move from.
+   */
+  RelocatingVector(RelocatingVector&& other) noexcept
+  : data_{std::exchange(other.data_, nullptr)},
+    size_{std::exchange(other.size_, 0)},
+    capacity_{std::exchange(other.capacity_, 0)} {}
+
+  /**
+   * Copy assignment, which replaces the elements with copies of the elements
+   * of the \p other vector.
+   * \param other The other vector to copy.
+   * \return A reference to this vector.
+   */
+  auto operator=(const RelocatingVector& other) -> RelocatingVector& {
+    if (this != &other) {
+      RelocatingVector copy{other};
+      swap(copy);
+    }
+    return *this;
+  }
+
+  /**
+   * Move assignment, which swaps the elements with the \p other vector.
+   * \param other The other vector to move from.
+   * \return A reference to this vector.
+   */
+  auto operator=(RelocatingVector&& other) noexcept -> RelocatingVector& {
+    swap(other);
+    return *this;
+  }
+
+  /**
+   * Swaps the elements of this vector with the \p other vector.
+   * \param other The other vector to swap with.
+   */
+  auto swap(RelocatingVector& other) noexcept -> void {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+  }
+
+  /*==--- [capacity] -------------------------------------------------------==*/
+
+  /**
+   * Gets the number of elements in the vector.
+   * \return The number of elements.
+   */
+  snowflake_nodiscard auto size() const noexcept -> SizeType {
+    return size_;
+  }
+
+  /**
+   * Determines if the vector is empty.
+   * \return __true__ if there are no elements.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return size_ == 0;
+  }
+
+  /**
+   * Gets the number of elements which can be stored without allocating.
+   * \return The capacity of the vector.
+   */
+  snowflake_nodiscard auto capacity() const noexcept -> SizeType {
+    return capacity_;
+  }
+
+  /**
+   * Allocates enough memory to store \p size elements.
+   * \param size The number of elements to reserve.
+   */
+  auto reserve(SizeType size) -> void {
+    if (size > capacity_) {
+      relocate(size);
+    }
+  }
+
+  /*==--- [modifiers] ------------------------------------------------------==*/
+
+  /**
+   * Constructs an element at the end of the vector from the \p args.
+   * \param  args The arguments for the construction of the element.
+   * \tparam Args The types of the arguments.
+   * \return A reference to the new element.
+   */
+  template <typename... Args>
+  auto emplace_back(Args&&... args) -> T& {
+    if (size_ == capacity_) {
+      // The args may refer to an element, which growth would invalidate.
+      T value(std::forward<Args>(args)...);
+      relocate(grown_capacity(size_ + 1));
+      return *new (data_ + size_++) T(std::move(value));
+    }
+    return *new (data_ + size_++) T(std::forward<Args>(args)...);
+  }
+
+  /**
+   * Adds the \p value to the end of the vector.
+   * \param value The value to add.
+   */
+  auto push_back(T&& value) -> void {
+    emplace_back(std::move(value));
+  }
+
+  /**
+   * Adds a copy of the \p value to the end of the vector.
+   * \param value The value to add.
+   */
+  auto push_back(const T& value) -> void {
+    emplace_back(value);
+  }
+
+  /**
+   * Adds \p count copies of the \p value to the end of the vector.
+   * \param count The number of copies to add.
+   * \param value The value to copy.
+   */
+  auto append(SizeType count, const T& value) -> void {
+    if (size_ + count > capacity_) {
+      const T copy(value);
+      relocate(grown_capacity(size_ + count));
+      std::uninitialized_fill_n(data_ + size_, count, copy);
+    } else {
+      std::uninitialized_fill_n(data_ + size_, count, value);
+    }
+    size_ += count;
+  }
+
+  /**
+   * Adds copies of the elements in the range [\p first, \p last) to the end
+   * of the vector.
+   *
+   * \note The range must not be in this vector.
+   *
+   * \param  first    An iterator to the first element to add.
+   * \param  last     An iterator to one past the last element to add.
+   * \tparam Iterator The type of the iterator.
+   */
+  template <typename Iterator>
+  auto append(Iterator first, Iterator last) -> void {
+    const auto count = static_cast<SizeType>(std::distance(first, last));
+    if (size_ + count > capacity_) {
+      relocate(grown_capacity(size_ + count));
+    }
+    std::uninitialized_copy(first, last, data_ + size_);
+    size_ += count;
+  }
+
+  /**
+   * Removes the element at the \p index by destroying it and relocating the
+   * last element into its place, which does not preserve the order.
+   * \note If the index is out of range, this asserts in debug.
+   * \param index The index of the element to remove.
+   */
+  auto erase_unordered(SizeType index) noexcept -> void {
+    assert(index < size_ && "Can't erase element out of range!");
+    T* element = data_ + index;
+    element->~T();
+    if (--size_ != index) {
+      std::memcpy(
+        static_cast<void*>(element),
+        static_cast<const void*>(data_ + size_),
+        sizeof(T));
+    }
+  }
+
+  /**
+   * Removes the last element from the vector.
+   * \note If the vector is empty, this asserts in debug.
+   */
+  auto pop_back() noexcept -> void {
+    assert(size_ > 0 && "Can't pop from empty vector!");
+    data_[--size_].~T();
+  }
+
+  /**
+   * Removes all elements from the vector, keeping the memory.
+   */
+  auto clear() noexcept -> void {
+    std::destroy(data_, data_ + size_);
+    size_ = 0;
+  }
+
+  /*==--- [access] ---------------------------------------------------------==*/
+
+  /**
+   * Gets the element at the \p index.
+   * \param index The index of the element.
+   * \return A reference to the element.
+   */
+  auto operator[](SizeType index) noexcept -> T& {
+    return data_[index];
+  }
+
+  /**
+   * Gets the element at the \p index.
+   * \param index The index of the element.
+   * \return A const reference to the element.
+   */
+  auto operator[](SizeType index) const noexcept -> const T& {
+    return data_[index];
+  }
+
+  /**
+   * Gets the last element in the vector.
+   * \return A reference to the last element.
+   */
+  auto back() noexcept -> T& {
+    return data_[size_ - 1];
+  }
+
+  /**
+   * Gets a pointer to the first element.
+   * \return A pointer to the elements.
+   */
+  snowflake_nodiscard auto data() noexcept -> T* {
+    return data_;
+  }
+
+  /**
+   * Gets a const pointer to the first element.
+   * \return A const pointer to the elements.
+   */
+  snowflake_nodiscard auto data() const noexcept -> const T* {
+    return data_;
+  }
+
+ private:
+  T*       data_     = nullptr; //!< The elements.
+  SizeType size_     = 0;       //!< The number of elements.
+  SizeType capacity_ = 0;       //!< The number of allocated elements.
+
+  /**
+   * Gets the capacity to grow to so that at least \p size elements fit, which
+   * doubles the capacity so that adding elements is amortized constant time.
+   * \param size The number of elements which must fit.
+   * \return The capacity to grow to.
+   */
+  auto grown_capacity(SizeType size) const noexcept -> SizeType {
+    return std::max({size, capacity_ * 2, SizeType{8}});
+  }
+
+  /**
+   * Moves the elements into an allocation for \p capacity elements, by
+   * copying their bytes.
+   * \param capacity The number of elements to allocate for.
+   */
+  auto relocate(SizeType capacity) -> void {
+    if constexpr (use_realloc) {
+      void* data =
+        std::realloc(static_cast<void*>(data_), sizeof(T) * capacity);
+      if (data == nullptr) {
+        throw std::bad_alloc{};
+      }
+      data_ = static_cast<T*>(data);
+    } else {
+      T* data = static_cast<T*>(
+        ::operator new(sizeof(T) * capacity, std::align_val_t{alignof(T)}));
+      if (size_ > 0) {
+        std::memcpy(
+          static_cast<void*>(data),
+          static_cast<const void*>(data_),
+          sizeof(T) * size_);
+      }
+      release(data_);
+      data_ = data;
+    }
+    capacity_ = capacity;
+  }
+
+  /**
+   * Releases the memory for the \p data.
+   * \param data The memory to release.
+   */
+  static auto release(T* data) noexcept -> void {
+    if constexpr (use_realloc) {
+      std::free(static_cast<void*>(data));
+    } else {
+      ::operator delete(
+        static_cast<void*>(data), std::align_val_t{alignof(T)});
+    }
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_RELOCATING_VECTOR_HPP
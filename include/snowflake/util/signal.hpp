@@ -0,0 +1,257 @@
+//==--- snowflake/util/signal.hpp -------------------------- -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  signal.hpp
+/// \brief This file defines a signal, which calls connected delegates.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_SIGNAL_HPP
+#define SNOWFLAKE_UTIL_SIGNAL_HPP
+
+#include "portability.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Defines the number of delegates which are stored inline in a signal, before
+ * the signal needs to allocate.
+ */
+static constexpr size_t signal_inline_delegates =
+#if defined(SNOWFLAKE_SIGNAL_INLINE_DELEGATES)
+  SNOWFLAKE_SIGNAL_INLINE_DELEGATES;
+#else
+  4;
+#endif
+
+/**
+ * Signal which calls all of the connected delegates when it is published.
+ *
+ * A delegate is a function pointer and an optional instance pointer, so
+ * connecting does not allocate, and the first signal_inline_delegates
+ * delegates are stored inline in the signal. Publishing a signal with no
+ * delegates is a single comparison.
+ *
+ * Delegates are called in the order in which they were connected.
+ *
+ * \note Connecting or disconnecting delegates while the signal is being
+ *       published causes undefined behaviour.
+ *
+ * \tparam Args The types of the arguments for the delegates.
+ */
+template <typename... Args>
+class Signal {
+ public:
+  /** Defines the type of the function for a delegate. */
+  using Function = void (*)(void*, Args...);
+
+  /**
+   * Delegate for the signal.
+   */
+  struct Delegate {
+    Function function = nullptr; //!< The function to call.
+    void*    instance = nullptr; //!< The instance to call the function with.
+
+    /**
+     * Compares the delegate with the \p other delegate.
+     * \param other The other delegate to compare with.
+     * \return __true__ if the delegates are the same.
+     */
+    auto operator==(const Delegate& other) const noexcept -> bool {
+      return function == other.function && instance == other.instance;
+    }
+  };
+
+  /*==--- [connection] -----------------------------------------------------==*/
+
+  /**
+   * Connects the free function \p Fn to the signal.
+   * \tparam Fn The function to connect, which must be callable with the
+   *            arguments of the signal.
+   */
+  template <auto Fn>
+  auto connect() -> void {
+    connect(Delegate{&free_function<Fn>, nullptr});
+  }
+
+  /**
+   * Connects the member function \p Fn of the \p instance to the signal. The
+   * function can also be a free function which takes a reference to the
+   * instance as its first argument.
+   * \param  instance The instance to call the function with, which must
+   *                  outlive the connection.
+   * \tparam Fn       The function to connect.
+   * \tparam T        The type of the instance.
+   */
+  template <auto Fn, typename T>
+  auto connect(T& instance) -> void {
+    connect(Delegate{&bound_function<Fn, T>, erase_type(instance)});
+  }
+
+  /**
+   * Connects the \p delegate to the signal.
+   * \param delegate The delegate to connect.
+   */
+  auto connect(const Delegate& delegate) -> void {
+    if (size_ < signal_inline_delegates) {
+      inline_[size_] = delegate;
+    } else {
+      overflow_.push_back(delegate);
+    }
+    ++size_;
+  }
+
+  /**
+   * Disconnects the free function \p Fn from the signal.
+   * \tparam Fn The function to disconnect.
+   */
+  template <auto Fn>
+  auto disconnect() -> void {
+    disconnect(Delegate{&free_function<Fn>, nullptr});
+  }
+
+  /**
+   * Disconnects the function \p Fn for the \p instance from the signal.
+   * \param  instance The instance the function was connected with.
+   * \tparam Fn       The function to disconnect.
+   * \tparam T        The type of the instance.
+   */
+  template <auto Fn, typename T>
+  auto disconnect(T& instance) -> void {
+    disconnect(Delegate{&bound_function<Fn, T>, erase_type(instance)});
+  }
+
+  /**
+   * Disconnects all delegates which are the same as the \p delegate, keeping
+   * the order of the other delegates.
+   * \param delegate The delegate to disconnect.
+   */
+  auto disconnect(const Delegate& delegate) -> void {
+    size_t kept = 0;
+    for (size_t i = 0; i < size_; ++i) {
+      const Delegate current = at(i);
+      if (!(current == delegate)) {
+        at(kept++) = current;
+      }
+    }
+    size_ = kept;
+    overflow_.resize(
+      size_ > signal_inline_delegates ? size_ - signal_inline_delegates : 0);
+  }
+
+  /**
+   * Disconnects all delegates.
+   */
+  auto clear() noexcept -> void {
+    size_ = 0;
+    overflow_.clear();
+  }
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Gets the number of connected delegates.
+   * \return The number of delegates.
+   */
+  snowflake_nodiscard auto size() const noexcept -> size_t {
+    return size_;
+  }
+
+  /**
+   * Determines if the signal has no connected delegates.
+   * \return __true__ if no delegates are connected.
+   */
+  snowflake_nodiscard auto empty() const noexcept -> bool {
+    return size_ == 0;
+  }
+
+  /**
+   * Calls all the connected delegates with the \p args.
+   * \param args The arguments to call the delegates with.
+   */
+  auto publish(Args... args) const -> void {
+    if (size_ == 0) {
+      return;
+    }
+    const size_t count = std::min(size_, signal_inline_delegates);
+    for (size_t i = 0; i < count; ++i) {
+      inline_[i].function(inline_[i].instance, args...);
+    }
+    for (const auto& delegate : overflow_) {
+      delegate.function(delegate.instance, args...);
+    }
+  }
+
+ private:
+  std::array<Delegate, signal_inline_delegates> inline_   = {}; //!< Inline.
+  std::vector<Delegate>                         overflow_ = {}; //!< Overflow.
+  size_t size_ = 0; //!< Number of connected delegates.
+
+  /**
+   * Gets the delegate at \p index.
+   * \param index The index of the delegate.
+   * \return A reference to the delegate.
+   */
+  auto at(size_t index) noexcept -> Delegate& {
+    return index < signal_inline_delegates
+             ? inline_[index]
+             : overflow_[index - signal_inline_delegates];
+  }
+
+  /**
+   * Calls the free function \p Fn.
+   * \param  args The arguments for the function.
+   * \tparam Fn   The function to call.
+   */
+  template <auto Fn>
+  static auto free_function(void*, Args... args) -> void {
+    Fn(args...);
+  }
+
+  /**
+   * Gets a pointer to the \p instance with the type erased, which is cast
+   * back to the type of the instance, including its constness, when the
+   * function for the instance is called.
+   * \param  instance The instance to get a pointer to.
+   * \tparam T        The type of the instance.
+   * \return A type erased pointer to the instance.
+   */
+  template <typename T>
+  static auto erase_type(T& instance) noexcept -> void* {
+    return const_cast<void*>(static_cast<const void*>(&instance));
+  }
+
+  /**
+   * Calls the function \p Fn with the \p instance.
+   * \param  instance The instance to call the function with, which is cast
+   *                  back to the type of the instance.
+   * \param  args     The arguments for the function.
+   * \tparam Fn       The function to call.
+   * \tparam T        The type of the instance.
+   */
+  template <auto Fn, typename T>
+  static auto bound_function(void* instance, Args... args) -> void {
+    auto& object = *static_cast<T*>(instance);
+    if constexpr (std::is_member_function_pointer_v<decltype(Fn)>) {
+      (object.*Fn)(args...);
+    } else {
+      Fn(object, args...);
+    }
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_SIGNAL_HPP
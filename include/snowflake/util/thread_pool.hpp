@@ -0,0 +1,405 @@
+//==--- snowflake/util/thread_pool.hpp --------------------- -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  thread_pool.hpp
+/// \brief This file defines a work-stealing thread pool.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_THREAD_POOL_HPP
+#define SNOWFLAKE_UTIL_THREAD_POOL_HPP
+
+#include "portability.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace snowflake {
+
+/**
+ * Defines the size of a cache line, in bytes.
+ */
+static constexpr size_t cache_line_size =
+#if defined(SNOWFLAKE_CACHE_LINE_SIZE)
+  SNOWFLAKE_CACHE_LINE_SIZE;
+#else
+  64;
+#endif
+
+/**
+ * Thread pool which uses work stealing to balance the load between the
+ * threads in the pool.
+ *
+ * Each worker has its own queue of tasks. Tasks submitted from a worker are
+ * pushed onto that worker's queue, and tasks submitted from other threads are
+ * distributed over the queues. A worker pops tasks from the back of its own
+ * queue, and when the queue is empty it steals from the front of the other
+ * queues.
+ *
+ * Threads which wait for tasks to complete (i.e the thread which calls
+ * parallel_for()) help to execute tasks while they wait, so that a pool with
+ * N workers uses N + 1 threads for a parallel loop.
+ *
+ * Tasks are a function pointer and a pointer to the data for the task, and a
+ * range of indices, so submitting a task does not allocate, other than when
+ * the queue needs to grow.
+ */
+class ThreadPool {
+ public:
+  /**
+   * Defines the type of the counter for tasks which have not completed.
+   */
+  using Counter = std::atomic<size_t>;
+
+  /**
+   * Task which can be executed by the pool.
+   */
+  struct Task {
+    /** Defines the type of the function for the task. */
+    using Function = void (*)(void*, size_t, size_t);
+
+    Function fn      = nullptr; //!< The function to invoke.
+    void*    data    = nullptr; //!< Data passed to the function.
+    size_t   begin   = 0;       //!< Start of the range for the task.
+    size_t   end     = 0;       //!< End of the range for the task.
+    Counter* pending = nullptr; //!< Counter to decrement on completion.
+  };
+
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Creates the thread pool with \p workers worker threads.
+   *
+   * \note A pool with zero workers is valid, in which case all tasks are
+   *       executed by the threads which wait on them.
+   *
+   * \param workers The number of worker threads in the pool.
+   */
+  explicit ThreadPool(
+    size_t workers = std::max(std::thread::hardware_concurrency(), 2u) - 1)
+  : queues_(std::max(workers, size_t{1})) {
+    threads_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+      threads_.emplace_back([this, i] { run(i); });
+    }
+  }
+
+  /**
+   * Destructor, which waits for the workers to finish their current tasks.
+   */
+  ~ThreadPool() noexcept {
+    {
+      std::lock_guard<std::mutex> guard(sleep_mutex_);
+      stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  // clang-format off
+  /** Copy constructor -- deleted. */
+  ThreadPool(const ThreadPool&)     = delete;
+  /** Move constructor -- deleted. */
+  ThreadPool(ThreadPool&&)          = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const ThreadPool&) = delete;
+  /** Move assignment -- deleted. */
+  auto operator=(ThreadPool&&)      = delete;
+  // clang-format on
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Returns the number of worker threads in the pool.
+   * \return The number of workers in the pool.
+   */
+  snowflake_nodiscard auto workers() const noexcept -> size_t {
+    return threads_.size();
+  }
+
+  /**
+   * Returns the number of threads which execute tasks, which is the number of
+   * workers, plus the thread which waits on the tasks.
+   * \return The number of threads which execute tasks.
+   */
+  snowflake_nodiscard auto concurrency() const noexcept -> size_t {
+    return threads_.size() + 1;
+  }
+
+  /**
+   * Returns the index of the calling thread in the range [0, concurrency()),
+   * which can be used to index per-thread data (i.e command buffers) from
+   * within tasks. Workers have indices [0, workers()), and any other thread
+   * has index workers().
+   *
+   * \note Since all non-worker threads have the same index, only a single
+   *       non-worker thread should execute tasks which use per-thread data.
+   *
+   * \return The index of the calling thread.
+   */
+  snowflake_nodiscard auto thread_index() const noexcept -> size_t {
+    const size_t index = worker_index();
+    return index < threads_.size() ? index : threads_.size();
+  }
+
+  /**
+   * Submits the \p task to the pool.
+   *
+   * \note The pending counter for the task must be incremented before the
+   *       task is submitted.
+   *
+   * \param task The task to submit.
+   */
+  auto submit(const Task& task) -> void {
+    const size_t index = worker_index() < queues_.size()
+                           ? worker_index()
+                           : next_queue_.fetch_add(1) % queues_.size();
+    {
+      auto&                       queue = queues_[index];
+      std::lock_guard<std::mutex> guard(queue.mutex);
+      queue.tasks.push_back(task);
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+
+    // Acquire the sleep mutex so that a worker can't miss the notification
+    // between checking the queued count and going to sleep.
+    { std::lock_guard<std::mutex> guard(sleep_mutex_); }
+    sleep_cv_.notify_one();
+  }
+
+  /**
+   * Waits until the \p pending counter reaches zero, executing tasks from the
+   * pool while waiting.
+   * \param pending The counter to wait on.
+   */
+  auto wait(const Counter& pending) -> void {
+    while (pending.load(std::memory_order_acquire) != 0) {
+      Task task;
+      if (pop(worker_index(), task)) {
+        execute(task);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /**
+   * Applies the \p functor to the range [\p begin, \p end), in chunks of
+   * \p grain indices, returning once all chunks have been processed.
+   *
+   * The functor is invoked as `functor(chunk_begin, chunk_end)`, and may be
+   * invoked concurrently for different chunks.
+   *
+   * \param  begin   The start of the range.
+   * \param  end     The end of the range.
+   * \param  grain   The number of indices in each chunk.
+   * \param  functor The functor to apply.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename Functor>
+  auto parallel_for(size_t begin, size_t end, size_t grain, Functor&& functor)
+    -> void {
+    if (begin >= end) {
+      return;
+    }
+    grain               = std::max(grain, size_t{1});
+    const size_t chunks = (end - begin + grain - 1) / grain;
+    if (chunks == 1 || threads_.empty()) {
+      functor(begin, end);
+      return;
+    }
+
+    using F = std::remove_reference_t<Functor>;
+    Counter pending{chunks};
+    for (size_t c = 0; c < chunks; ++c) {
+      const size_t first = begin + c * grain;
+      submit(Task{
+        [](void* data, size_t b, size_t e) { (*static_cast<F*>(data))(b, e); },
+        const_cast<void*>(static_cast<const void*>(&functor)),
+        first,
+        std::min(first + grain, end),
+        &pending});
+    }
+    wait(pending);
+  }
+
+  /**
+   * Applies the \p functor to the \p size elements starting at \p data, in
+   * chunks whose boundaries are aligned to cache lines, so that different
+   * threads never write to the same cache line of the data.
+   *
+   * The functor is invoked as `functor(chunk_begin, chunk_end)` with indices
+   * into the data, and may be invoked concurrently for different chunks.
+   *
+   * \note If the data is not aligned to the size of its elements then the
+   *       chunk boundaries can't be aligned, but the chunks are still a
+   *       multiple of the cache line size.
+   *
+   * \param  data    A pointer to the data to iterate over.
+   * \param  size    The number of elements in the data.
+   * \param  functor The functor to apply.
+   * \tparam T       The type of the data.
+   * \tparam Functor The type of the functor.
+   */
+  template <typename T, typename Functor>
+  auto parallel_for_aligned(const T* data, size_t size, Functor&& functor)
+    -> void {
+    // Number of elements for a whole number of cache lines:
+    constexpr size_t step =
+      cache_line_size / std::gcd(sizeof(T), cache_line_size);
+    constexpr size_t min_grain = std::max(size_t{1024}, step);
+
+    size_t grain = std::max(min_grain, size / (concurrency() * 4));
+    grain        = ((grain + step - 1) / step) * step;
+
+    // Number of elements before the first aligned element, if any:
+    const auto   address = reinterpret_cast<uintptr_t>(data);
+    const size_t bytes   = (cache_line_size - address % cache_line_size) %
+                         cache_line_size;
+    const size_t head  = bytes % sizeof(T) == 0 ? bytes / sizeof(T) : 0;
+    const size_t shift = (grain - head % grain) % grain;
+
+    // The range is offset by the shift so that the second chunk starts at the
+    // first aligned element, and the first chunk is only the head:
+    parallel_for(0, size + shift, grain, [&](size_t begin, size_t end) {
+      functor(begin > shift ? begin - shift : 0, end - shift);
+    });
+  }
+
+ private:
+  /**
+   * Queue of tasks for a worker, aligned to a cache line so that the queues of
+   * different workers do not share cache lines.
+   */
+  struct alignas(cache_line_size) Queue {
+    std::mutex       mutex = {}; //!< Mutex for the queue.
+    std::deque<Task> tasks = {}; //!< Tasks in the queue.
+  };
+
+  // clang-format off
+  /** Defines the type of the container for the queues. */
+  using Queues  = std::vector<Queue>;
+  /** Defines the type of the container for the threads. */
+  using Threads = std::vector<std::thread>;
+  // clang-format on
+
+  Queues                  queues_      = {};    //!< Queue per worker.
+  Threads                 threads_     = {};    //!< Worker threads.
+  std::atomic<size_t>     queued_      = {0};   //!< Number of queued tasks.
+  std::atomic<size_t>     next_queue_  = {0};   //!< Next queue for tasks.
+  std::mutex              sleep_mutex_ = {};    //!< Mutex for sleeping.
+  std::condition_variable sleep_cv_    = {};    //!< Sleeping condition.
+  bool                    stop_        = false; //!< If the pool must stop.
+
+  /**
+   * Returns a reference to the index of the worker for the calling thread in
+   * the pool which it belongs to.
+   * \return A reference to the index of the worker.
+   */
+  static auto worker_slot() noexcept -> std::pair<const ThreadPool*, size_t>& {
+    thread_local std::pair<const ThreadPool*, size_t> slot{
+      nullptr, ~size_t{0}};
+    return slot;
+  }
+
+  /**
+   * Returns the index of the worker in this pool for the calling thread, or
+   * an invalid index if the calling thread is not a worker in this pool.
+   * \return The index of the worker for the calling thread.
+   */
+  auto worker_index() const noexcept -> size_t {
+    const auto& slot = worker_slot();
+    return slot.first == this ? slot.second : ~size_t{0};
+  }
+
+  /**
+   * Executes the \p task, and decrements its pending counter.
+   * \param task The task to execute.
+   */
+  static auto execute(const Task& task) -> void {
+    task.fn(task.data, task.begin, task.end);
+    task.pending->fetch_sub(1, std::memory_order_acq_rel);
+  }
+
+  /**
+   * Pops a task, first from the back of the queue at \p index, if it is valid,
+   * and then from the front of the other queues.
+   * \param index The index of the queue to pop from first.
+   * \param task  The task to pop into.
+   * \return __true__ if a task was popped.
+   */
+  auto pop(size_t index, Task& task) -> bool {
+    if (queued_.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+
+    if (index < queues_.size()) {
+      auto&                       queue = queues_[index];
+      std::lock_guard<std::mutex> guard(queue.mutex);
+      if (!queue.tasks.empty()) {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        queued_.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+      }
+    }
+
+    const size_t start = index < queues_.size() ? index + 1 : 0;
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      auto& queue = queues_[(start + i) % queues_.size()];
+      std::unique_lock<std::mutex> guard(queue.mutex, std::try_to_lock);
+      if (guard.owns_lock() && !queue.tasks.empty()) {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        queued_.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Runs the worker with the given \p index.
+   * \param index The index of the worker.
+   */
+  auto run(size_t index) -> void {
+    worker_slot() = {this, index};
+    while (true) {
+      Task task;
+      if (pop(index, task)) {
+        execute(task);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> guard(sleep_mutex_);
+      sleep_cv_.wait(guard, [this] {
+        return stop_ || queued_.load(std::memory_order_acquire) != 0;
+      });
+      if (stop_) {
+        return;
+      }
+    }
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_THREAD_POOL_HPP
@@ -0,0 +1,205 @@
+//==--- snowflake/util/virtual_memory.hpp ------------------ -*- C++ -*- ---==//
+//
+//                            Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  virtual_memory.hpp
+/// \brief This file defines functionality for reserving virtual memory.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_UTIL_VIRTUAL_MEMORY_HPP
+#define SNOWFLAKE_UTIL_VIRTUAL_MEMORY_HPP
+
+#include "portability.hpp"
+#include <cstddef>
+#include <utility>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+namespace snowflake {
+
+/**
+ * Region of virtual memory which is reserved but which is only backed by
+ * physical memory when it is touched. The memory in the region is zero-filled
+ * when it is first touched, so reading untouched memory returns zero, and
+ * untouched pages do not use any resident memory.
+ *
+ * The region is reserved without any access, so that the reservation does
+ * not count against the commit limit, and parts of the region must be
+ * committed with commit() before they are accessed, which can fail if the
+ * system is out of memory.
+ *
+ * This is useful for large, sparsely accessed arrays, which would otherwise
+ * need to be allocated and initialized in full.
+ */
+class VirtualRegion {
+ public:
+  /*==--- [construction] ---------------------------------------------------==*/
+
+  /**
+   * Default constructor, which creates an empty region.
+   */
+  VirtualRegion() noexcept = default;
+
+  /**
+   * Reserves a region of \p bytes bytes.
+   *
+   * \note If the reservation fails the region is empty, which can be checked
+   *       with valid().
+   *
+   * \param bytes The number of bytes to reserve.
+   */
+  explicit VirtualRegion(size_t bytes) noexcept {
+#if defined(_WIN32)
+    // The address space is only reserved, and parts of it are committed when
+    // they are first used, in commit().
+    data_ = VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    // The address space is only reserved, and parts of it are made accessible
+    // when they are first used, in commit():
+    void* data = mmap(
+      nullptr,
+      bytes,
+      PROT_NONE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+      -1,
+      0);
+    data_ = data == MAP_FAILED ? nullptr : data;
+#endif
+    size_ = data_ != nullptr ? bytes : 0;
+  }
+
+  /**
+   * Destructor, which releases the region.
+   */
+  ~VirtualRegion() noexcept {
+    release();
+  }
+
+  /**
+   * Move constructor, which takes ownership of the \p other region.
+   * \param other The other region to move from.
+   */
+  VirtualRegion(VirtualRegion&& other) noexcept
+  : data_{std::exchange(other.data_, nullptr)},
+    size_{std::exchange(other.size_, 0)} {}
+
+  /**
+   * Move assignment, which releases this region, and takes ownership of the
+   * \p other region.
+   * \param other The other region to move from.
+   * \return A reference to this region.
+   */
+  auto operator=(VirtualRegion&& other) noexcept -> VirtualRegion& {
+    if (this != &other) {
+      release();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  /*==--- [deleted] --------------------------------------------------------==*/
+
+  /** Copy constructor -- deleted. */
+  VirtualRegion(const VirtualRegion&) = delete;
+  /** Copy assignment -- deleted. */
+  auto operator=(const VirtualRegion&) = delete;
+
+  /*==--- [interface] ------------------------------------------------------==*/
+
+  /**
+   * Gets a pointer to the start of the region.
+   * \return A pointer to the region, or nullptr if the region is empty.
+   */
+  snowflake_nodiscard auto data() const noexcept -> void* {
+    return data_;
+  }
+
+  /**
+   * Gets the number of bytes in the region.
+   * \return The size of the region, in bytes.
+   */
+  snowflake_nodiscard auto size() const noexcept -> size_t {
+    return size_;
+  }
+
+  /**
+   * Commits the \p bytes bytes starting \p offset bytes into the region, so
+   * that they can be accessed. Committed memory is zero-filled, and is only
+   * backed by physical memory when it is first touched.
+   *
+   * \note Committing memory which is already committed has no effect. The
+   *       range is extended to the pages of the operating system which it
+   *       overlaps.
+   *
+   * \param offset The offset of the memory to commit, in bytes.
+   * \param bytes  The number of bytes to commit.
+   * \return __true__ if the memory was committed, __false__ if the range is
+   *         not within the region, or if the memory could not be committed.
+   */
+  auto commit(size_t offset, size_t bytes) noexcept -> bool {
+    if (data_ == nullptr || offset > size_ || bytes > size_ - offset) {
+      return false;
+    }
+#if defined(_WIN32)
+    return VirtualAlloc(
+             static_cast<char*>(data_) + offset,
+             bytes,
+             MEM_COMMIT,
+             PAGE_READWRITE) != nullptr;
+#else
+    // The region starts on a page boundary, so aligning the offset down to a
+    // page boundary keeps it within the region:
+    const size_t page  = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t start = offset & ~(page - 1);
+    return mprotect(
+             static_cast<char*>(data_) + start,
+             offset + bytes - start,
+             PROT_READ | PROT_WRITE) == 0;
+#endif
+  }
+
+  /**
+   * Determines if the region is valid.
+   * \return __true__ if the region has been reserved.
+   */
+  snowflake_nodiscard auto valid() const noexcept -> bool {
+    return data_ != nullptr;
+  }
+
+ private:
+  void*  data_ = nullptr; //!< Pointer to the start of the region.
+  size_t size_ = 0;       //!< Size of the region, in bytes.
+
+  /**
+   * Releases the region, if it is valid.
+   */
+  auto release() noexcept -> void {
+    if (data_ == nullptr) {
+      return;
+    }
+#if defined(_WIN32)
+    VirtualFree(data_, 0, MEM_RELEASE);
+#else
+    munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+};
+
+} // namespace snowflake
+
+#endif // SNOWFLAKE_UTIL_VIRTUAL_MEMORY_HPP
@@ -14,11 +14,25 @@
 //==------------------------------------------------------------------------==//
 
 #include "ecs/component_id.hpp"
+#include "ecs/command_buffer.hpp"
+#include "ecs/archetype_manager.hpp"
+#include "ecs/delta_snapshot.hpp"
 #include "ecs/entity.hpp"
 #include "ecs/entity_manager.hpp"
+#include "ecs/group.hpp"
+#include "ecs/hierarchy.hpp"
 #include "ecs/component_storage.hpp"
+#include "ecs/prefab.hpp"
+#include "ecs/query.hpp"
 #include "ecs/reverse_iterator.hpp"
+#include "ecs/scheduler.hpp"
+#include "ecs/snapshot.hpp"
+#include "ecs/soa_storage.hpp"
 #include "ecs/sparse_set.hpp"
+#include "ecs/spatial_grid.hpp"
+#include "ecs/tag_storage.hpp"
+#include "ecs/tracked_storage.hpp"
+#include "ecs/view.hpp"
 
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,196 @@
+//==--- snowflake/tests/ecs/archetype_manager.hpp ---------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  archetype_manager.hpp
+/// \brief This file implements tests for the archetype manager.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_ARCHETYPE_MANAGER_HPP
+#define SNOWFLAKE_TESTS_ECS_ARCHETYPE_MANAGER_HPP
+
+#include <snowflake/ecs/archetype_manager.hpp>
+#include <snowflake/ecs/entity_manager.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+struct ArchPos {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+struct ArchVel {
+  float dx = 0.0f;
+  float dy = 0.0f;
+};
+
+struct ArchName {
+  std::string name;
+};
+
+struct alignas(256) ArchWide {
+  float value = 0.0f;
+};
+
+struct ArchHuge {
+  char bytes[snowflake::archetype_chunk_size] = {};
+};
+
+using ArchManager = snowflake::ArchetypeManager<snowflake::Entity>;
+
+template <typename Manager>
+class archetype_backends : public ::testing::Test {};
+
+using ArchBackends = ::testing::Types<
+  snowflake::EntityManager<snowflake::Entity>,
+  snowflake::ArchetypeManager<snowflake::Entity>>;
+
+TYPED_TEST_SUITE(archetype_backends, ArchBackends);
+
+TYPED_TEST(archetype_backends, same_interface) {
+  TypeParam                      manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(2000, std::back_inserter(entities));
+
+  for (size_t i = 0; i < entities.size(); ++i) {
+    const auto f = static_cast<float>(i);
+    manager.template emplace<ArchPos>(entities[i], f, f);
+    if (i % 2 == 0) {
+      manager.template emplace<ArchVel>(entities[i], 1.0f, 2.0f);
+    }
+  }
+  EXPECT_EQ(manager.template size<ArchPos>(), size_t{2000});
+  EXPECT_EQ(manager.template size<ArchVel>(), size_t{1000});
+
+  manager.template view<ArchPos, ArchVel>().each(
+    [](ArchPos& pos, const ArchVel& vel) {
+      pos.x += vel.dx;
+      pos.y += vel.dy;
+    });
+
+  for (size_t i = 0; i < entities.size(); ++i) {
+    const auto  f   = static_cast<float>(i);
+    const auto& pos = manager.template get<ArchPos>(entities[i]);
+    EXPECT_EQ(pos.x, i % 2 == 0 ? f + 1.0f : f);
+    EXPECT_EQ(pos.y, i % 2 == 0 ? f + 2.0f : f);
+  }
+
+  for (size_t i = 0; i < entities.size(); i += 4) {
+    manager.template remove<ArchVel>(entities[i]);
+  }
+  manager.recycle(entities.begin() + 1000, entities.end());
+
+  EXPECT_EQ(manager.entities_active(), size_t{1000});
+  EXPECT_EQ(manager.entities_free(), size_t{1000});
+  EXPECT_EQ(manager.template size<ArchPos>(), size_t{1000});
+  EXPECT_EQ(manager.template size<ArchVel>(), size_t{250});
+
+  size_t count = 0;
+  manager.template view<ArchPos, ArchVel>().each(
+    [&](snowflake::Entity e, const ArchPos& pos, const ArchVel&) {
+      EXPECT_EQ(e % 4, size_t{2});
+      EXPECT_EQ(pos.x, static_cast<float>(e) + 1.0f);
+      ++count;
+    });
+  EXPECT_EQ(count, size_t{250});
+}
+
+TEST(archetype_manager, moves_components_between_archetypes) {
+  ArchManager manager;
+  auto        e1 = manager.create();
+  auto        e2 = manager.create();
+
+  manager.emplace<ArchName>(e1, "first");
+  manager.emplace<ArchName>(e2, "second");
+  manager.emplace<ArchPos>(e1, 1.0f, 2.0f);
+  EXPECT_EQ(manager.archetypes(), size_t{3});
+  EXPECT_TRUE(manager.has<ArchPos>(e1));
+  EXPECT_FALSE(manager.has<ArchPos>(e2));
+  EXPECT_FALSE(manager.has<ArchVel>(e2));
+
+  EXPECT_EQ(manager.get<ArchName>(e1).name, "first");
+  EXPECT_EQ(manager.get<ArchName>(e2).name, "second");
+  EXPECT_EQ(manager.get<ArchPos>(e1).y, 2.0f);
+
+  // The archetype for the components is reused through the edge.
+  manager.emplace<ArchPos>(e2, 3.0f, 4.0f);
+  EXPECT_EQ(manager.archetypes(), size_t{3});
+
+  manager.remove<ArchName>(e1);
+  EXPECT_EQ(manager.archetypes(), size_t{4});
+  EXPECT_FALSE(manager.has<ArchName>(e1));
+  EXPECT_EQ(manager.get<ArchName>(e2).name, "second");
+  EXPECT_EQ(manager.get<ArchPos>(e1).x, 1.0f);
+  EXPECT_EQ(manager.get<ArchPos>(e2).x, 3.0f);
+
+  const auto& cmanager = manager;
+  EXPECT_EQ(cmanager.view<ArchPos>().archetypes(), size_t{2});
+  EXPECT_EQ(cmanager.view<ArchPos>().size(), size_t{2});
+  EXPECT_EQ(cmanager.view<ArchVel>().size(), size_t{0});
+}
+
+TEST(archetype_manager, chunks_stay_packed) {
+  ArchManager                    manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(10000, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<ArchVel>(e, static_cast<float>(e), 0.0f);
+  }
+
+  // Recycle every third entity, so that rows are moved from the back.
+  for (size_t i = 0; i < entities.size(); i += 3) {
+    manager.recycle(entities[i]);
+  }
+  for (size_t i = 0; i < entities.size(); ++i) {
+    if (i % 3 != 0) {
+      EXPECT_EQ(manager.get<ArchVel>(entities[i]).dx, static_cast<float>(i));
+    }
+  }
+
+  snowflake::ThreadPool pool(4);
+  std::atomic<size_t>   sum{0};
+  manager.view<ArchVel>().parallel_for_each(
+    pool, [&](snowflake::Entity e, const ArchVel& vel) {
+      EXPECT_EQ(static_cast<float>(e), vel.dx);
+      sum.fetch_add(e, std::memory_order_relaxed);
+    });
+
+  size_t expected = 0;
+  for (size_t i = 0; i < entities.size(); ++i) {
+    expected += i % 3 != 0 ? i : 0;
+  }
+  EXPECT_EQ(sum.load(), expected);
+}
+
+TEST(archetype_manager, over_aligned_and_oversized_components) {
+  ArchManager                    manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(100, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<ArchPos>(e, 1.0f, 2.0f);
+    manager.emplace<ArchWide>(e, static_cast<float>(e));
+  }
+  for (auto e : entities) {
+    const auto address = reinterpret_cast<uintptr_t>(&manager.get<ArchWide>(e));
+    EXPECT_EQ(address % alignof(ArchWide), uintptr_t{0});
+    EXPECT_EQ(manager.get<ArchWide>(e).value, static_cast<float>(e));
+  }
+
+  // A row which doesn't fit in a chunk is rejected, and the entity is left
+  // unchanged.
+  EXPECT_THROW(manager.emplace<ArchHuge>(entities[0]), std::length_error);
+  EXPECT_FALSE(manager.has<ArchHuge>(entities[0]));
+  EXPECT_EQ(manager.get<ArchPos>(entities[0]).y, 2.0f);
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_ARCHETYPE_MANAGER_HPP
@@ -0,0 +1,125 @@
+//==--- snowflake/tests/ecs/command_buffer.hpp ------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  command_buffer.hpp
+/// \brief This file implements tests for command buffers.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_COMMAND_BUFFER_HPP
+#define SNOWFLAKE_TESTS_ECS_COMMAND_BUFFER_HPP
+
+#include <snowflake/ecs/command_buffer.hpp>
+#include <gtest/gtest.h>
+#include <string>
+
+struct CmdPos {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+struct CmdName {
+  std::string name;
+};
+
+using CmdManager = snowflake::EntityManager<snowflake::Entity>;
+using CmdBuffer  = snowflake::CommandBuffer<snowflake::Entity>;
+
+TEST(command_buffer, create_emplace_and_resolve) {
+  CmdManager manager;
+  CmdBuffer  buffer;
+
+  auto a = buffer.create();
+  auto b = buffer.create();
+  buffer.emplace<CmdPos>(a, 1.0f, 2.0f);
+  buffer.emplace<CmdName>(a, std::string(100, 'a'));
+  buffer.emplace<CmdPos>(b, 3.0f, 4.0f);
+  EXPECT_FALSE(buffer.empty());
+  EXPECT_EQ(manager.entities_created(), size_t{0});
+
+  buffer.apply(manager);
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(manager.entities_created(), size_t{2});
+  EXPECT_EQ(manager.size<CmdPos>(), size_t{2});
+  EXPECT_EQ(manager.size<CmdName>(), size_t{1});
+
+  const auto ea = buffer.resolve(a);
+  const auto eb = buffer.resolve(b);
+  EXPECT_EQ(manager.get<CmdPos>(ea).y, 2.0f);
+  EXPECT_EQ(manager.get<CmdPos>(eb).x, 3.0f);
+  EXPECT_EQ(manager.get<CmdName>(ea).name, std::string(100, 'a'));
+}
+
+TEST(command_buffer, remove_replace_and_destroy) {
+  CmdManager manager;
+  auto       e1 = manager.create();
+  auto       e2 = manager.create();
+  manager.emplace<CmdPos>(e1, 1.0f, 1.0f);
+  manager.emplace<CmdPos>(e2, 2.0f, 2.0f);
+  manager.emplace<CmdName>(e2, std::string("e2"));
+
+  CmdBuffer buffer;
+  buffer.remove<CmdPos>(e1);
+  buffer.remove<CmdName>(e1); // e1 has no name, so this does nothing.
+  buffer.emplace<CmdPos>(e2, 5.0f, 5.0f);
+  buffer.emplace<CmdPos>(e2, 6.0f, 6.0f);
+  buffer.destroy(e2);
+  buffer.destroy(e2);
+  buffer.apply(manager);
+
+  EXPECT_EQ(manager.size<CmdPos>(), size_t{0});
+  EXPECT_EQ(manager.size<CmdName>(), size_t{0});
+  EXPECT_EQ(manager.entities_active(), size_t{1});
+
+  // Replacing keeps the last emplaced component.
+  buffer.emplace<CmdPos>(e1, 5.0f, 5.0f);
+  buffer.emplace<CmdPos>(e1, 6.0f, 6.0f);
+  buffer.apply(manager);
+  EXPECT_EQ(manager.size<CmdPos>(), size_t{1});
+  EXPECT_EQ(manager.get<CmdPos>(e1).x, 6.0f);
+}
+
+TEST(command_buffer, clear_destroys_unapplied_components) {
+  CmdManager manager;
+  {
+    CmdBuffer buffer;
+    for (int i = 0; i < 1000; ++i) {
+      buffer.emplace<CmdName>(buffer.create(), std::string(64, 'x'));
+    }
+    buffer.clear();
+    EXPECT_TRUE(buffer.empty());
+    buffer.emplace<CmdName>(buffer.create(), std::string(64, 'y'));
+  }
+  EXPECT_EQ(manager.entities_created(), size_t{0});
+}
+
+TEST(command_buffer, parallel_recording) {
+  snowflake::ThreadPool  pool{3};
+  std::vector<CmdBuffer> buffers(pool.concurrency());
+  CmdManager             manager;
+
+  constexpr size_t count = 10000;
+  pool.parallel_for(0, count, 64, [&](size_t begin, size_t end) {
+    auto& buffer = buffers[pool.thread_index()];
+    for (size_t i = begin; i < end; ++i) {
+      buffer.emplace<CmdPos>(buffer.create(), static_cast<float>(i), 0.0f);
+    }
+  });
+  CmdBuffer::apply(manager, buffers.begin(), buffers.end());
+
+  EXPECT_EQ(manager.entities_created(), count);
+  EXPECT_EQ(manager.size<CmdPos>(), count);
+  size_t sum = 0;
+  manager.view<CmdPos>().each(
+    [&](const CmdPos& p) { sum += static_cast<size_t>(p.x); });
+  EXPECT_EQ(sum, count * (count - 1) / 2);
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_COMMAND_BUFFER_HPP
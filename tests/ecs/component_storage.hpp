@@ -19,6 +19,9 @@
 #include <snowflake/ecs/entity.hpp>
 #include <snowflake/ecs/component_storage.hpp>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
 
 struct Agg {
   int   a;
@@ -32,8 +35,33 @@ struct NonAgg {
   float b;
 };
 
+struct PagedAgg {
+  int   a;
+  float b;
+};
+
+struct OwnComp {
+  OwnComp(int v) : value{std::make_unique<int>(v)} {}
+
+  std::unique_ptr<int> value;
+};
+
+struct alignas(64) WideComp {
+  int a;
+};
+
+namespace snowflake {
+template <>
+struct PagedStorage<PagedAgg> : std::true_type {};
+template <>
+struct Relocatable<OwnComp> : std::true_type {};
+} // namespace snowflake
+
 using AggStorage    = snowflake::ComponentStorage<snowflake::Entity, Agg>;
 using NonAggStorage = snowflake::ComponentStorage<snowflake::Entity, NonAgg>;
+using PagedStorage  = snowflake::ComponentStorage<snowflake::Entity, PagedAgg>;
+using OwnStorage    = snowflake::ComponentStorage<snowflake::Entity, OwnComp>;
+using WideStorage   = snowflake::ComponentStorage<snowflake::Entity, WideComp>;
 using IdType        = typename snowflake::Entity::IdType;
 
 constexpr inline size_t num_comps = 100;
@@ -263,4 +291,283 @@ TEST(component_storage, find_non_agregagte) {
   EXPECT_EQ(it->b, a.b);
 }
 
+TEST(component_storage, parallel_for_each) {
+  snowflake::ThreadPool pool{3};
+  AggStorage            aggs;
+  constexpr size_t      count = 100000;
+  for (size_t i = 0; i < count; ++i) {
+    aggs.emplace(snowflake::Entity{static_cast<IdType>(i)}, int(i), 0.0f);
+  }
+
+  aggs.parallel_for_each(pool, [](Agg& a) { a.b = float(a.a) * 2.0f; });
+  aggs.parallel_for_each(pool, [](snowflake::Entity e, Agg& a) {
+    a.a = static_cast<int>(e.id()) + 1;
+  });
+
+  for (size_t i = 0; i < count; ++i) {
+    const auto& a = aggs.get(snowflake::Entity{static_cast<IdType>(i)});
+    EXPECT_EQ(a.a, int(i) + 1);
+    EXPECT_EQ(a.b, float(i) * 2.0f);
+  }
+}
+
+TEST(component_storage, parallel_for_aligned_chunks_start_on_cache_lines) {
+  snowflake::ThreadPool pool{3};
+  constexpr size_t      line  = snowflake::cache_line_size;
+  constexpr size_t      count = 20000;
+  std::vector<int>      buffer(count + line);
+
+  // Offset the data so that it is deliberately not aligned to a cache line.
+  const auto address = reinterpret_cast<uintptr_t>(buffer.data());
+  const auto skip    = (line - address % line) / sizeof(int) + 1;
+  const int* data    = buffer.data() + skip;
+  ASSERT_NE(reinterpret_cast<uintptr_t>(data) % line, uintptr_t{0});
+
+  std::mutex                             mutex;
+  std::vector<std::pair<size_t, size_t>> chunks;
+  pool.parallel_for_aligned(data, count, [&](size_t begin, size_t end) {
+    std::lock_guard<std::mutex> lock{mutex};
+    chunks.emplace_back(begin, end);
+  });
+  std::sort(chunks.begin(), chunks.end());
+  ASSERT_GT(chunks.size(), size_t{1});
+  EXPECT_EQ(chunks.front().first, size_t{0});
+  EXPECT_EQ(chunks.back().second, count);
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    EXPECT_EQ(chunks[i].first, chunks[i - 1].second);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data + chunks[i].first) % line, 0u);
+  }
+}
+
+TEST(component_storage, bulk_insert_and_erase) {
+  AggStorage                     aggs;
+  std::vector<snowflake::Entity> entities;
+  std::vector<Agg>               values;
+  for (IdType i = 0; i < 500; ++i) {
+    entities.emplace_back(i * 3);
+    values.push_back(Agg{int(i), float(i)});
+  }
+
+  aggs.insert(entities.begin(), entities.begin() + 250, values.data());
+  aggs.insert(entities.begin() + 250, entities.end(), Agg{-1, -1.0f});
+  EXPECT_EQ(aggs.size(), entities.size());
+  for (size_t i = 0; i < entities.size(); ++i) {
+    const auto& a = aggs.get(entities[i]);
+    EXPECT_EQ(a.a, i < 250 ? int(i) : -1);
+  }
+
+  aggs.erase(entities.begin(), entities.begin() + 200);
+  EXPECT_EQ(aggs.size(), size_t{300});
+  for (size_t i = 200; i < entities.size(); ++i) {
+    EXPECT_EQ(aggs.get(entities[i]).a, i < 250 ? int(i) : -1);
+  }
+}
+
+TEST(component_storage, batch_erase_compacts_once) {
+  // Erase every third entity, which leaves holes in the front of the dense
+  // array which are filled from the back.
+  constexpr IdType               count = 3000;
+  AggStorage                     aggs;
+  OwnStorage                     owned;
+  std::vector<snowflake::Entity> erased;
+  for (IdType i = 0; i < count; ++i) {
+    aggs.emplace(snowflake::Entity{i}, int(i), float(i));
+    owned.emplace(snowflake::Entity{i}, int(i));
+    if (i % 3 == 0) {
+      erased.emplace_back(i);
+    }
+  }
+
+  aggs.erase(erased.begin(), erased.end());
+  owned.erase(erased.begin(), erased.end());
+  EXPECT_EQ(aggs.size(), size_t{count - erased.size()});
+  EXPECT_EQ(owned.size(), aggs.size());
+  for (IdType i = 0; i < count; ++i) {
+    const snowflake::Entity e{i};
+    ASSERT_EQ(aggs.exists(e), i % 3 != 0);
+    ASSERT_EQ(owned.exists(e), i % 3 != 0);
+    if (i % 3 != 0) {
+      EXPECT_EQ(aggs.get(e).a, int(i));
+      EXPECT_EQ(*owned.get(e).value, int(i));
+      EXPECT_EQ(*(owned.rbegin() + owned.index(e))->value, int(i));
+    }
+  }
+}
+
+TEST(component_storage, sort_by_key) {
+  AggStorage storage;
+  for (IdType i = 0; i < 5000; ++i) {
+    const IdType value = (i * 7919) % 5000;
+    storage.emplace(
+      snowflake::Entity{i},
+      static_cast<int>(value) - 2500,
+      static_cast<float>(value) * -0.5f);
+  }
+
+  // Random integer keys, with negative values, use the radix sort.
+  storage.sort([](const Agg& c) { return c.a; });
+  int prev = std::numeric_limits<int>::min();
+  for (const auto& c : storage) {
+    EXPECT_LE(prev, c.a);
+    prev = c.a;
+  }
+  for (IdType i = 0; i < 5000; ++i) {
+    snowflake::Entity e{i};
+    EXPECT_EQ(storage.get(e).a, static_cast<int>((i * 7919) % 5000) - 2500);
+  }
+
+  // Float keys in the opposite order.
+  storage.sort([](snowflake::Entity, const Agg& c) { return c.b; });
+  float prev_b = -std::numeric_limits<float>::max();
+  for (const auto& c : storage) {
+    EXPECT_LE(prev_b, c.b);
+    prev_b = c.b;
+  }
+
+  // Nearly sorted keys use the insertion sort.
+  auto it = storage.begin();
+  std::swap(it[10].b, it[11].b);
+  storage.sort([](const Agg& c) { return c.b; });
+  prev_b = -std::numeric_limits<float>::max();
+  for (const auto& c : storage) {
+    EXPECT_LE(prev_b, c.b);
+    prev_b = c.b;
+  }
+}
+
+TEST(component_storage, sort_as_other_storage) {
+  AggStorage    a;
+  NonAggStorage b;
+  for (IdType i = 0; i < 100; ++i) {
+    a.emplace(snowflake::Entity{i}, static_cast<int>(i % 17), 0.0f);
+    if (i % 3 == 0) {
+      b.emplace(snowflake::Entity{i}, static_cast<int>(i), 0.0f);
+    }
+  }
+  b.emplace(snowflake::Entity{IdType{200}}, 200, 0.0f);
+
+  a.sort([](const Agg& c) { return c.a; });
+  b.sort_as(a);
+
+  // Shared entities come first in the order of a, then the others.
+  const snowflake::SparseSet<snowflake::Entity>& set_a = a;
+  const snowflake::SparseSet<snowflake::Entity>& set_b = b;
+  std::vector<snowflake::Entity>                 expected;
+  for (const auto& e : set_a) {
+    if (b.exists(e)) {
+      expected.push_back(e);
+    }
+  }
+  auto e = set_b.begin();
+  for (const auto& ex : expected) {
+    EXPECT_EQ(*e, ex);
+    EXPECT_EQ(b.get(ex).a, static_cast<int>(IdType{ex}));
+    ++e;
+  }
+  EXPECT_EQ(*e, snowflake::Entity{IdType{200}});
+}
+
+TEST(component_storage, paged_pointers_are_stable) {
+  constexpr IdType count = snowflake::component_page_size * 3 + 17;
+  PagedStorage     storage;
+  storage.emplace(snowflake::Entity{0}, 0, 0.0f);
+  const PagedAgg* first = &storage.get(snowflake::Entity{0});
+  for (IdType i = 1; i < count; ++i) {
+    storage.emplace(snowflake::Entity{i}, static_cast<int>(i), float(i));
+  }
+  EXPECT_EQ(first, &storage.get(snowflake::Entity{0}));
+
+  // Pointer-like access spans the pages.
+  const auto components = storage.rbegin();
+  EXPECT_EQ(storage.rend() - components, static_cast<ptrdiff_t>(count));
+  for (IdType i = 0; i < count; ++i) {
+    EXPECT_EQ(components[i].a, static_cast<int>(i));
+  }
+
+  storage.erase(snowflake::Entity{0});
+  EXPECT_EQ(storage.size(), size_t{count - 1});
+  EXPECT_EQ(storage.get(snowflake::Entity{count - 1}).a, int(count - 1));
+  EXPECT_EQ(first, &storage.get(snowflake::Entity{count - 1}));
+}
+
+TEST(component_storage, paged_bulk_insert_sort_and_parallel_for_each) {
+  constexpr IdType               count = snowflake::component_page_size * 2;
+  PagedStorage                   storage;
+  std::vector<snowflake::Entity> entities;
+  std::vector<PagedAgg>          values;
+  for (IdType i = 0; i < count; ++i) {
+    entities.emplace_back(i);
+    values.push_back(PagedAgg{static_cast<int>((i * 7919) % count), 0.0f});
+  }
+
+  // Insert across the page boundary, from contiguous data and a value.
+  storage.emplace(snowflake::Entity{count}, -1, 0.0f);
+  storage.insert(entities.begin(), entities.end() - 10, values.data());
+  storage.insert(entities.end() - 10, entities.end(), PagedAgg{-2, 0.0f});
+  for (IdType i = 0; i < count; ++i) {
+    EXPECT_EQ(storage.get(entities[i]).a, i + 10 < count ? values[i].a : -2);
+  }
+
+  snowflake::ThreadPool pool{3};
+  storage.parallel_for_each(pool, [](snowflake::Entity e, PagedAgg& c) {
+    c.b = static_cast<float>(e.id());
+  });
+  for (IdType i = 0; i < count; ++i) {
+    EXPECT_EQ(storage.get(entities[i]).b, static_cast<float>(i));
+  }
+
+  storage.sort([](const PagedAgg& c) { return c.a; });
+  int prev = std::numeric_limits<int>::min();
+  for (const auto& c : storage) {
+    EXPECT_LE(prev, c.a);
+    prev = c.a;
+  }
+}
+
+TEST(component_storage, relocatable_components_are_relocated_bitwise) {
+  static_assert(snowflake::relocatable_v<Agg>);
+  static_assert(snowflake::relocatable_v<OwnComp>);
+  static_assert(!snowflake::relocatable_v<std::unique_ptr<int>>);
+
+  // Growth, erasure and swaps relocate the owned values, which must neither
+  // leak nor be freed twice.
+  constexpr IdType count = 1000;
+  OwnStorage    storage;
+  for (IdType i = 0; i < count; ++i) {
+    storage.emplace(snowflake::Entity{i}, static_cast<int>(i));
+  }
+  for (IdType i = 0; i < count; i += 3) {
+    storage.erase(snowflake::Entity{i});
+  }
+  storage.swap(snowflake::Entity{1}, snowflake::Entity{998});
+  storage.sort([](const OwnComp& c) { return -*c.value; });
+  for (IdType i = 0; i < count; ++i) {
+    const bool exists = i % 3 != 0;
+    ASSERT_EQ(storage.exists(snowflake::Entity{i}), exists);
+    if (exists) {
+      EXPECT_EQ(*storage.get(snowflake::Entity{i}).value, static_cast<int>(i));
+    }
+  }
+  int prev = std::numeric_limits<int>::max();
+  for (const auto& c : storage) {
+    EXPECT_GT(prev, *c.value);
+    prev = *c.value;
+  }
+
+  // Over-aligned components can't be grown in place, but are still aligned.
+  WideStorage                    wide;
+  std::vector<snowflake::Entity> entities;
+  for (IdType i = 0; i < count; ++i) {
+    entities.emplace_back(i);
+  }
+  wide.insert(entities.begin(), entities.begin() + 10, WideComp{7});
+  for (IdType i = 10; i < count; ++i) {
+    wide.emplace(entities[i], static_cast<int>(i));
+  }
+  wide.erase(entities[0]);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(wide.rbegin()) % 64, uintptr_t{0});
+  EXPECT_EQ(wide.get(entities[9]).a, 7);
+  EXPECT_EQ(wide.get(entities[count - 1]).a, static_cast<int>(count - 1));
+}
+
 #endif // SNOWFLAKE_TESTS_ECS_COMPONENT_STORAGE_HPP
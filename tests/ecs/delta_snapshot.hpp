@@ -0,0 +1,149 @@
+//==--- snowflake/tests/ecs/delta_snapshot.hpp ------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  delta_snapshot.hpp
+/// \brief This file implements tests for delta snapshots.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_DELTA_SNAPSHOT_HPP
+#define SNOWFLAKE_TESTS_ECS_DELTA_SNAPSHOT_HPP
+
+#include <snowflake/ecs/delta_snapshot.hpp>
+#include <gtest/gtest.h>
+
+struct DeltaPos {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+struct DeltaHp {
+  int value = 0;
+};
+
+namespace snowflake {
+template <>
+struct TrackChanges<DeltaHp> : std::true_type {};
+} // namespace snowflake
+
+using DeltaManager = snowflake::EntityManager<snowflake::Entity>;
+
+/**
+ * Gets the state of the components in the manager, sorted by entity, so that
+ * states can be compared regardless of the order of the pools.
+ */
+inline auto delta_state(const DeltaManager& manager)
+  -> std::vector<std::tuple<uint32_t, int, float, float>> {
+  std::vector<std::tuple<uint32_t, int, float, float>> state;
+  manager.view<DeltaPos>().each([&](snowflake::Entity e, const DeltaPos& p) {
+    state.emplace_back(e, -1, p.x, p.y);
+  });
+  manager.view<DeltaHp>().each([&](snowflake::Entity e, const DeltaHp& h) {
+    state.emplace_back(e, h.value, 0.0f, 0.0f);
+  });
+  std::sort(state.begin(), state.end());
+  return state;
+}
+
+TEST(delta_snapshot, capture_and_rollback) {
+  DeltaManager                   manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(100, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<DeltaPos>(e, static_cast<float>(e), 0.0f);
+    manager.emplace<DeltaHp>(e, 100);
+  }
+
+  auto history = snowflake::make_delta_history<DeltaPos, DeltaHp>(manager, 4);
+  const auto start      = delta_state(manager);
+  const auto start_next = manager.create();
+  manager.recycle(start_next);
+
+  // Nothing has changed, so the delta only has the headers.
+  const auto empty_size = history.capture().size();
+  EXPECT_EQ(history.frames(), size_t{1});
+
+  // Tick 1: move some entities, and damage one.
+  for (size_t i = 0; i < 10; ++i) {
+    manager.get<DeltaPos>(entities[i]).y += 1.0f;
+  }
+  manager.get<DeltaHp>(entities[5]).value -= 10;
+  EXPECT_GT(history.capture().size(), empty_size);
+  const auto tick1 = delta_state(manager);
+
+  // Tick 2: destroy and create entities, and add and remove components.
+  manager.recycle(entities[3]);
+  manager.remove<DeltaPos>(entities[7]);
+  const auto created = manager.create();
+  manager.emplace<DeltaHp>(created, 50);
+  history.capture();
+  const auto tick2 = delta_state(manager);
+  EXPECT_NE(tick1, tick2);
+
+  // Uncaptured changes are discarded when rolling back.
+  manager.get<DeltaHp>(entities[0]).value = 0;
+  manager.recycle(entities[1]);
+  EXPECT_EQ(history.rollback(0), size_t{0});
+  EXPECT_EQ(delta_state(manager), tick2);
+
+  EXPECT_EQ(history.rollback(1), size_t{1});
+  EXPECT_EQ(delta_state(manager), tick1);
+  EXPECT_EQ(manager.entities_active(), size_t{100});
+
+  EXPECT_EQ(history.rollback(5), size_t{2});
+  EXPECT_EQ(delta_state(manager), start);
+  EXPECT_EQ(history.frames(), size_t{0});
+
+  // The free list is restored, so entities are created in the same order.
+  EXPECT_EQ(manager.create(), start_next);
+}
+
+TEST(delta_snapshot, replay_deltas) {
+  DeltaManager source, replay;
+  for (auto* manager : {&source, &replay}) {
+    std::vector<snowflake::Entity> entities;
+    manager->create(50, std::back_inserter(entities));
+    for (auto e : entities) {
+      manager->emplace<DeltaPos>(e, 0.0f, static_cast<float>(e));
+    }
+  }
+
+  auto recorder = snowflake::make_delta_history<DeltaPos, DeltaHp>(source);
+  auto player   = snowflake::make_delta_history<DeltaPos, DeltaHp>(replay);
+
+  std::vector<snowflake::DeltaSnapshot> deltas;
+  for (int tick = 0; tick < 20; ++tick) {
+    source.view<DeltaPos>().each([&](DeltaPos& p) { p.x += 1.0f; });
+    const auto e = source.create();
+    source.emplace<DeltaHp>(e, tick);
+    if (tick % 3 == 0) {
+      source.recycle(snowflake::Entity{static_cast<uint32_t>(tick)});
+    }
+    const auto& delta = recorder.capture();
+    deltas.emplace_back().assign(delta.data(), delta.size());
+  }
+
+  for (const auto& delta : deltas) {
+    player.apply(delta);
+  }
+  EXPECT_EQ(delta_state(replay), delta_state(source));
+  EXPECT_EQ(replay.entities_created(), source.entities_created());
+  EXPECT_EQ(replay.entities_free(), source.entities_free());
+
+  // Deltas revert in reverse order.
+  for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+    player.revert(*it);
+  }
+  EXPECT_EQ(replay.entities_created(), size_t{50});
+  EXPECT_EQ(replay.size<DeltaHp>(), size_t{0});
+  EXPECT_EQ(replay.size<DeltaPos>(), size_t{50});
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_DELTA_SNAPSHOT_HPP
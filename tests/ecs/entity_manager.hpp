@@ -52,6 +52,37 @@ TEST(entity_manager, creation_and_recycling) {
   EXPECT_EQ(manager.entities_free(), size_t{1});
 }
 
+TEST(entity_manager, batch_creation_and_recycling) {
+  EntityManager                  manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(1000, std::back_inserter(entities));
+  EXPECT_EQ(entities.size(), size_t{1000});
+  EXPECT_EQ(manager.entities_active(), size_t{1000});
+  for (size_t i = 0; i < entities.size(); ++i) {
+    EXPECT_EQ(static_cast<size_t>(entities[i]), i);
+    manager.emplace<DynamicComponent>(entities[i], 1, 1.0f);
+  }
+
+  manager.recycle(entities.begin(), entities.begin() + 400);
+  EXPECT_EQ(manager.entities_active(), size_t{600});
+  EXPECT_EQ(manager.entities_free(), size_t{400});
+  EXPECT_EQ(manager.size<DynamicComponent>(), size_t{600});
+
+  // Recycled entities are reused before new entities are created.
+  std::vector<snowflake::Entity> more(500);
+  manager.create(more.size(), more.begin());
+  EXPECT_EQ(manager.entities_created(), size_t{1100});
+  EXPECT_EQ(manager.entities_active(), size_t{1100});
+  EXPECT_EQ(manager.entities_free(), size_t{0});
+
+  std::sort(more.begin(), more.end());
+  EXPECT_EQ(std::unique(more.begin(), more.end()), more.end());
+  EXPECT_EQ(static_cast<size_t>(more.front()), size_t{0});
+  EXPECT_EQ(static_cast<size_t>(more.back()), size_t{1099});
+  EXPECT_EQ(static_cast<size_t>(more[399]), size_t{399});
+  EXPECT_EQ(static_cast<size_t>(more[400]), size_t{1000});
+}
+
 TEST(entity_manager, dynamic_components) {
   EntityManager em;
 
@@ -70,7 +101,7 @@ TEST(entity_manager, dynamic_components) {
   EXPECT_EQ(c2.a, 5);
   EXPECT_EQ(c2.b, 6.0f);
 
-  EXPECT_EQ(em.size<StaticComponent>(), size_t{2});
+  EXPECT_EQ(em.size<DynamicComponent>(), size_t{2});
 }
 
 TEST(entity_manager, static_components) {
@@ -94,4 +125,167 @@ TEST(entity_manager, static_components) {
   EXPECT_EQ(em.size<StaticComponent>(), size_t{2});
 }
 
+using ListManager = snowflake::EntityManager<
+  snowflake::Entity,
+  snowflake::ComponentList<StaticComponent, DynamicComponent>>;
+
+inline auto
+list_construct_count(int& count, ListManager&, const snowflake::Entity&)
+  -> void {
+  ++count;
+}
+
+TEST(entity_manager, component_list) {
+  ListManager em;
+  EXPECT_EQ(em.size<StaticComponent>(), size_t{0});
+  EXPECT_EQ(em.size<DynamicComponent>(), size_t{0});
+
+  int constructed = 0;
+  em.on_construct<DynamicComponent>().connect<&list_construct_count>(
+    constructed);
+
+  std::vector<snowflake::Entity> entities;
+  em.create(10, std::back_inserter(entities));
+  for (auto e : entities) {
+    em.emplace<DynamicComponent>(e, static_cast<int>(e), 1.0f);
+    if (e % 2 == 0) {
+      em.emplace<StaticComponent>(e, static_cast<int>(e), 2.0f);
+    }
+  }
+  EXPECT_EQ(constructed, 10);
+  EXPECT_EQ(em.get<DynamicComponent>(entities[3]).a, 3);
+  EXPECT_EQ(em.get<StaticComponent>(entities[4]).b, 2.0f);
+
+  size_t count = 0;
+  em.view<StaticComponent, DynamicComponent>().each(
+    [&](snowflake::Entity e, StaticComponent& s, DynamicComponent& d) {
+      EXPECT_EQ(e % 2, uint32_t{0});
+      EXPECT_EQ(s.a, d.a);
+      ++count;
+    });
+  EXPECT_EQ(count, size_t{5});
+
+  auto& group = em.group<StaticComponent, DynamicComponent>();
+  EXPECT_EQ(group.size(), size_t{5});
+
+  em.recycle(entities.begin(), entities.begin() + 4);
+  EXPECT_EQ(group.size(), size_t{3});
+  EXPECT_EQ(em.size<DynamicComponent>(), size_t{6});
+  EXPECT_EQ(em.size<StaticComponent>(), size_t{3});
+  EXPECT_EQ(em.entities_free(), size_t{4});
+}
+
+struct SignalListener {
+  std::vector<snowflake::Entity> constructed;
+  std::vector<snowflake::Entity> updated;
+  std::vector<snowflake::Entity> destroyed;
+
+  auto construct(EntityManager&, const snowflake::Entity& e) -> void {
+    constructed.push_back(e);
+  }
+  auto update(EntityManager& manager, const snowflake::Entity& e) -> void {
+    updated.push_back(e);
+    EXPECT_EQ(manager.get<DynamicComponent>(e).a, 7);
+  }
+  auto destroy(EntityManager& manager, const snowflake::Entity& e) -> void {
+    // The component still exists when the signal is published.
+    EXPECT_EQ(manager.get<DynamicComponent>(e).b, 3.0f);
+    destroyed.push_back(e);
+  }
+};
+
+static size_t signal_free_calls = 0;
+
+inline auto signal_free_listener(EntityManager&, const snowflake::Entity&)
+  -> void {
+  ++signal_free_calls;
+}
+
+TEST(entity_manager, component_signals) {
+  EntityManager  em;
+  SignalListener listener;
+  em.on_construct<DynamicComponent>()
+    .connect<&SignalListener::construct>(listener);
+  em.on_update<DynamicComponent>().connect<&SignalListener::update>(listener);
+  em.on_destroy<DynamicComponent>().connect<&SignalListener::destroy>(
+    listener);
+  em.on_construct<DynamicComponent>().connect<&signal_free_listener>();
+  EXPECT_EQ(em.on_construct<DynamicComponent>().size(), size_t{2});
+  EXPECT_TRUE(em.on_construct<StaticComponent>().empty());
+
+  auto e1 = em.create();
+  auto e2 = em.create();
+  em.emplace<DynamicComponent>(e1, 4, 3.0f);
+  em.emplace<DynamicComponent>(e2, 5, 3.0f);
+  em.emplace<StaticComponent>(e2, 1, 1.0f);
+  EXPECT_EQ(listener.constructed, (std::vector<snowflake::Entity>{e1, e2}));
+  EXPECT_EQ(signal_free_calls, size_t{2});
+
+  em.replace<DynamicComponent>(e1, 7, 3.0f);
+  em.patch<DynamicComponent>(e2, [](auto& c) { c.a = 7; });
+  EXPECT_EQ(listener.updated, (std::vector<snowflake::Entity>{e1, e2}));
+
+  em.remove<DynamicComponent>(e1);
+  em.recycle(e2);
+  EXPECT_EQ(listener.destroyed, (std::vector<snowflake::Entity>{e1, e2}));
+
+  em.on_construct<DynamicComponent>().disconnect<&signal_free_listener>();
+  em.emplace<DynamicComponent>(em.create(), 1, 3.0f);
+  EXPECT_EQ(signal_free_calls, size_t{2});
+  EXPECT_EQ(listener.constructed.size(), size_t{3});
+}
+
+inline auto signal_count(int& value, int& total) -> void {
+  value = ++total;
+}
+
+TEST(entity_manager, signal_inline_and_overflow_delegates) {
+  snowflake::Signal<int&> signal;
+  std::vector<int>        values(10, 0);
+  for (auto& value : values) {
+    signal.connect<&signal_count>(value);
+  }
+  int total = 0;
+  signal.publish(total);
+  EXPECT_EQ(total, 10);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(values[i], i + 1);
+  }
+
+  // Disconnecting keeps the order of the other delegates.
+  signal.disconnect<&signal_count>(values[1]);
+  EXPECT_EQ(signal.size(), size_t{9});
+  total = 0;
+  signal.publish(total);
+  EXPECT_EQ(values[0], 1);
+  EXPECT_EQ(values[1], 2);
+  EXPECT_EQ(values[2], 2);
+  EXPECT_EQ(values[9], 9);
+}
+
+struct SignalCounter {
+  int step = 0;
+
+  auto add(int& total) const -> void {
+    total += step;
+  }
+};
+
+TEST(entity_manager, signal_const_member_functions) {
+  snowflake::Signal<int&> signal;
+  const SignalCounter     one{1};
+  const SignalCounter     ten{10};
+  signal.connect<&SignalCounter::add>(one);
+  signal.connect<&SignalCounter::add>(ten);
+
+  int total = 0;
+  signal.publish(total);
+  EXPECT_EQ(total, 11);
+
+  signal.disconnect<&SignalCounter::add>(ten);
+  EXPECT_EQ(signal.size(), size_t{1});
+  signal.publish(total);
+  EXPECT_EQ(total, 12);
+}
+
 #endif // SNOWFLAKE_TESTS_ECS_ENTITY_MANAGER_HPP
@@ -0,0 +1,125 @@
+//==--- snowflake/tests/ecs/group.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  group.hpp
+/// \brief This file implements tests for owning groups.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_GROUP_HPP
+#define SNOWFLAKE_TESTS_ECS_GROUP_HPP
+
+#include <snowflake/ecs/entity_manager.hpp>
+#include <gtest/gtest.h>
+
+struct GroupPos {
+  float x = 0.0f;
+};
+
+struct GroupVel {
+  float dx = 0.0f;
+};
+
+struct GroupPaged {
+  float x = 0.0f;
+};
+
+namespace snowflake {
+template <>
+struct PagedStorage<GroupPaged> : std::true_type {};
+} // namespace snowflake
+
+using GroupManager = snowflake::EntityManager<snowflake::Entity>;
+
+TEST(group, packs_existing_entities) {
+  GroupManager em;
+  for (int i = 0; i < 20; ++i) {
+    auto e = em.create();
+    em.emplace<GroupPos>(e, float(i));
+    if (i % 3 == 0) {
+      em.emplace<GroupVel>(e, float(i));
+    }
+  }
+
+  auto& group = em.group<GroupPos, GroupVel>();
+  EXPECT_EQ(group.size(), size_t{7});
+
+  size_t count = 0;
+  group.each([&](snowflake::Entity e, GroupPos& p, GroupVel& v) {
+    EXPECT_EQ(p.x, v.dx);
+    EXPECT_EQ(e.id() % 3, snowflake::Entity::IdType{0});
+    ++count;
+  });
+  EXPECT_EQ(count, size_t{7});
+
+  // The same group is returned on subsequent requests.
+  EXPECT_EQ(&group, &(em.group<GroupPos, GroupVel>()));
+}
+
+TEST(group, tracks_emplace_and_remove) {
+  GroupManager em;
+  auto&        group = em.group<GroupPos, GroupVel>();
+  EXPECT_TRUE(group.empty());
+
+  std::vector<snowflake::Entity> entities;
+  for (int i = 0; i < 10; ++i) {
+    auto e = entities.emplace_back(em.create());
+    em.emplace<GroupPos>(e, float(i));
+  }
+  EXPECT_TRUE(group.empty());
+
+  for (int i = 0; i < 10; i += 2) {
+    em.emplace<GroupVel>(entities[i], float(i));
+  }
+  EXPECT_EQ(group.size(), size_t{5});
+
+  // Group entities must be packed at the front, in the same order.
+  for (size_t i = 0; i < group.size(); ++i) {
+    const auto e = group.entities()[i];
+    EXPECT_TRUE(group.contains(e));
+    EXPECT_EQ(em.get<GroupPos>(e).x, em.get<GroupVel>(e).dx);
+  }
+
+  em.remove<GroupVel>(entities[4]);
+  EXPECT_EQ(group.size(), size_t{4});
+  EXPECT_FALSE(group.contains(entities[4]));
+
+  em.remove<GroupPos>(entities[0]);
+  EXPECT_EQ(group.size(), size_t{3});
+  EXPECT_FALSE(group.contains(entities[0]));
+
+  group.each([&](GroupPos& p, GroupVel& v) { EXPECT_EQ(p.x, v.dx); });
+  for (size_t i = 0; i < group.size(); ++i) {
+    EXPECT_TRUE(group.contains(group.entities()[i]));
+  }
+}
+
+TEST(group, owns_paged_storage) {
+  GroupManager em;
+  auto&        group = em.group<GroupPaged, GroupVel>();
+  const size_t count = snowflake::component_page_size * 2;
+  for (size_t i = 0; i < count; ++i) {
+    auto e = em.create();
+    em.emplace<GroupPaged>(e, float(i));
+    if (i % 2 == 0) {
+      em.emplace<GroupVel>(e, float(i));
+    }
+  }
+  EXPECT_EQ(group.size(), count / 2);
+
+  size_t visited = 0;
+  group.each([&](const GroupPaged& p, const GroupVel& v) {
+    EXPECT_EQ(p.x, v.dx);
+    ++visited;
+  });
+  EXPECT_EQ(visited, count / 2);
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_GROUP_HPP
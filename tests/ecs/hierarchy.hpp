@@ -0,0 +1,217 @@
+//==--- snowflake/tests/ecs/hierarchy.hpp ------------------ -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  hierarchy.hpp
+/// \brief This file implements tests for the transform hierarchy.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_HIERARCHY_HPP
+#define SNOWFLAKE_TESTS_ECS_HIERARCHY_HPP
+
+#include <snowflake/ecs/hierarchy.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+
+struct HierLocal {
+  float offset = 0.0f;
+  float scale  = 1.0f;
+};
+
+struct HierWorld {
+  float offset = 0.0f;
+  float scale  = 1.0f;
+};
+
+struct HierCombine {
+  std::atomic<size_t>* count = nullptr;
+
+  auto operator()(const HierLocal& local) const -> HierWorld {
+    if (count != nullptr) {
+      count->fetch_add(1, std::memory_order_relaxed);
+    }
+    return HierWorld{local.offset, local.scale};
+  }
+
+  auto operator()(const HierWorld& parent, const HierLocal& local) const
+    -> HierWorld {
+    if (count != nullptr) {
+      count->fetch_add(1, std::memory_order_relaxed);
+    }
+    return HierWorld{
+      parent.offset + parent.scale * local.offset, parent.scale * local.scale};
+  }
+};
+
+using HierManager = snowflake::EntityManager<snowflake::Entity>;
+using HierNode    = snowflake::HierarchyNode<snowflake::Entity>;
+using Hierarchy   = snowflake::
+  TransformHierarchy<snowflake::Entity, HierLocal, HierWorld, HierCombine>;
+
+/**
+ * Computes the world transform of the \p entity by walking up the hierarchy,
+ * where parents which are not in the hierarchy are ignored.
+ */
+inline auto hier_expected(HierManager& em, snowflake::Entity entity)
+  -> HierWorld {
+  const auto& local  = em.get<HierLocal>(entity);
+  const auto& parent = em.get<HierNode>(entity).parent;
+  if (parent.invalid() || !em.view<HierNode>().contains(parent)) {
+    return HierWorld{local.offset, local.scale};
+  }
+  const auto world = hier_expected(em, parent);
+  return HierWorld{
+    world.offset + world.scale * local.offset, world.scale * local.scale};
+}
+
+/**
+ * Creates a random tree of \p count entities, with at most \p roots roots,
+ * where each entity is created after its parent.
+ */
+inline auto hier_tree(
+  HierManager& em, Hierarchy& hierarchy, size_t count, size_t roots)
+  -> std::vector<snowflake::Entity> {
+  std::mt19937                          gen{29};
+  std::uniform_real_distribution<float> dist{0.5f, 1.5f};
+  std::vector<snowflake::Entity>        entities;
+  em.create(count, std::back_inserter(entities));
+  for (size_t i = 0; i < count; ++i) {
+    em.emplace<HierLocal>(entities[i], dist(gen), dist(gen));
+    em.emplace<HierWorld>(entities[i]);
+    std::uniform_int_distribution<size_t> pick{0, i == 0 ? 0 : i - 1};
+    const auto parent = i < roots ? snowflake::Entity{} : entities[pick(gen)];
+    hierarchy.set_parent(em, entities[i], parent);
+  }
+  return entities;
+}
+
+TEST(hierarchy, propagates_through_depth_sorted_pools) {
+  HierManager em;
+  Hierarchy   hierarchy;
+  hierarchy.attach(em);
+
+  // A chain 0 -> 1 -> 2, and 3 -> 4, created children first.
+  std::vector<snowflake::Entity> e;
+  em.create(5, std::back_inserter(e));
+  for (size_t i = 0; i < e.size(); ++i) {
+    em.emplace<HierLocal>(e[i], float(i + 1), 2.0f);
+    em.emplace<HierWorld>(e[i]);
+  }
+  hierarchy.set_parent(em, e[2], e[1]);
+  hierarchy.set_parent(em, e[4], e[3]);
+  hierarchy.set_parent(em, e[1], e[0]);
+  hierarchy.set_parent(em, e[0], snowflake::Entity{});
+  hierarchy.set_parent(em, e[3], snowflake::Entity{});
+  // An entity with transforms which is not in the hierarchy:
+  const auto loose = em.create();
+  em.emplace<HierLocal>(loose, 100.0f, 1.0f);
+  em.emplace<HierWorld>(loose, -1.0f, -1.0f);
+
+  hierarchy.propagate(em);
+  EXPECT_EQ(hierarchy.levels(), size_t{3});
+  EXPECT_EQ(em.get<HierNode>(e[2]).depth, uint32_t{2});
+  EXPECT_EQ(em.get<HierWorld>(e[0]).offset, 1.0f);
+  EXPECT_EQ(em.get<HierWorld>(e[1]).offset, 1.0f + 2.0f * 2.0f);
+  EXPECT_EQ(em.get<HierWorld>(e[2]).offset, 5.0f + 4.0f * 3.0f);
+  EXPECT_EQ(em.get<HierWorld>(e[2]).scale, 8.0f);
+  EXPECT_EQ(em.get<HierWorld>(e[4]).offset, 4.0f + 2.0f * 5.0f);
+  EXPECT_EQ(em.get<HierWorld>(loose).offset, -1.0f);
+
+  // Iteration is from the back of the dense arrays, so is deepest first.
+  uint32_t last = std::numeric_limits<uint32_t>::max();
+  em.view<HierNode>().each([&](const HierNode& node) {
+    EXPECT_LE(node.depth, last);
+    last = node.depth;
+  });
+}
+
+TEST(hierarchy, skips_clean_subtrees) {
+  std::atomic<size_t> count{0};
+  HierManager         em;
+  Hierarchy           hierarchy{HierCombine{&count}};
+  hierarchy.attach(em);
+
+  // Root 0 with children 1 and 2, where 2 has children 3 and 4.
+  std::vector<snowflake::Entity> e;
+  em.create(5, std::back_inserter(e));
+  const size_t parents[] = {0, 0, 0, 2, 2};
+  for (size_t i = 0; i < e.size(); ++i) {
+    em.emplace<HierLocal>(e[i], 1.0f, 1.0f);
+    em.emplace<HierWorld>(e[i]);
+    const auto parent = i == 0 ? snowflake::Entity{} : e[parents[i]];
+    hierarchy.set_parent(em, e[i], parent);
+  }
+  hierarchy.propagate(em);
+  EXPECT_EQ(count.exchange(0), size_t{5});
+
+  hierarchy.propagate(em);
+  EXPECT_EQ(count.exchange(0), size_t{0});
+
+  em.patch<HierLocal>(e[2], [](HierLocal& l) { l.offset = 10.0f; });
+  hierarchy.propagate(em);
+  EXPECT_EQ(count.exchange(0), size_t{3});
+  EXPECT_EQ(em.get<HierWorld>(e[3]).offset, 12.0f);
+  EXPECT_EQ(em.get<HierWorld>(e[1]).offset, 2.0f);
+
+  em.get<HierLocal>(e[4]).offset = 5.0f;
+  hierarchy.mark_dirty(em, e[4]);
+  hierarchy.propagate(em);
+  EXPECT_EQ(count.exchange(0), size_t{1});
+  EXPECT_EQ(em.get<HierWorld>(e[4]).offset, 16.0f);
+}
+
+TEST(hierarchy, follows_structural_changes) {
+  HierManager em;
+  Hierarchy   hierarchy;
+  hierarchy.attach(em);
+  auto entities = hier_tree(em, hierarchy, 200, 4);
+  hierarchy.propagate(em);
+
+  // Reparent a subtree, and remove a node so that its children become roots.
+  hierarchy.set_parent(em, entities[150], entities[3]);
+  em.remove<HierNode>(entities[10]);
+  em.recycle(entities[20]);
+  em.emplace<HierLocal>(em.create(), 1.0f, 1.0f);
+  hierarchy.propagate(em);
+
+  em.view<HierNode, HierWorld>().each(
+    [&](snowflake::Entity e, const HierNode&, const HierWorld& world) {
+      const auto expected = hier_expected(em, e);
+      EXPECT_FLOAT_EQ(world.offset, expected.offset);
+      EXPECT_FLOAT_EQ(world.scale, expected.scale);
+    });
+
+  hierarchy.detach(em);
+  em.patch<HierLocal>(entities[0], [](HierLocal& l) { l.offset = 99.0f; });
+  hierarchy.propagate(em);
+  EXPECT_NE(em.get<HierWorld>(entities[0]).offset, 99.0f);
+}
+
+TEST(hierarchy, propagates_levels_in_parallel) {
+  HierManager           serial_em, parallel_em;
+  Hierarchy             serial, parallel;
+  snowflake::ThreadPool pool{3};
+  serial.attach(serial_em);
+  parallel.attach(parallel_em);
+  const auto a = hier_tree(serial_em, serial, 20000, 8);
+  const auto b = hier_tree(parallel_em, parallel, 20000, 8);
+
+  serial.propagate(serial_em);
+  parallel.propagate(parallel_em, pool);
+  EXPECT_EQ(parallel.levels(), serial.levels());
+  for (size_t i = 0; i < a.size(); ++i) {
+    EXPECT_EQ(
+      parallel_em.get<HierWorld>(b[i]).offset,
+      serial_em.get<HierWorld>(a[i]).offset);
+  }
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_HIERARCHY_HPP
@@ -0,0 +1,104 @@
+//==--- snowflake/tests/ecs/prefab.hpp --------------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  prefab.hpp
+/// \brief This file implements tests for prefabs.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_PREFAB_HPP
+#define SNOWFLAKE_TESTS_ECS_PREFAB_HPP
+
+#include <snowflake/ecs/prefab.hpp>
+#include <gtest/gtest.h>
+#include <string>
+
+struct PrefabVel {
+  float dx = 0.0f;
+  float dy = 0.0f;
+};
+
+struct PrefabName {
+  std::string name = {};
+};
+
+struct PrefabEnemy {};
+
+struct PrefabSoa {
+  float a;
+  int   b;
+};
+
+template <>
+struct snowflake::SoaLayout<PrefabSoa> {
+  static constexpr auto fields = std::make_tuple(&PrefabSoa::a, &PrefabSoa::b);
+};
+
+using PrefabManager = snowflake::EntityManager<snowflake::Entity>;
+
+TEST(prefab, records_component_values) {
+  snowflake::Prefab<snowflake::Entity> prefab;
+  prefab.set<PrefabVel>(1.0f, 2.0f).set<PrefabName>("bullet");
+  prefab.set<PrefabVel>(3.0f, 4.0f);
+  EXPECT_EQ(prefab.size(), size_t{2});
+  EXPECT_TRUE(prefab.has<PrefabVel>());
+  EXPECT_FALSE(prefab.has<PrefabEnemy>());
+
+  prefab.unset<PrefabName>();
+  EXPECT_EQ(prefab.size(), size_t{1});
+
+  PrefabManager em;
+  const auto    e = prefab.instantiate(em);
+  EXPECT_EQ(em.get<PrefabVel>(e).dx, 3.0f);
+  EXPECT_EQ(std::as_const(em).size<PrefabVel>(), size_t{1});
+}
+
+TEST(prefab, instantiates_in_bulk) {
+  snowflake::Prefab<snowflake::Entity> prefab;
+  prefab.set<PrefabVel>(1.0f, 2.0f)
+    .set<PrefabName>("crowd")
+    .set<PrefabEnemy>()
+    .set<PrefabSoa>(0.5f, 7);
+
+  PrefabManager em;
+  size_t        constructed = 0;
+  auto&         query       = em.query<PrefabVel, PrefabEnemy>();
+  auto&         group       = em.group<PrefabVel, PrefabName>();
+  auto          count       = [&](PrefabManager&, const snowflake::Entity&) {
+    ++constructed;
+  };
+  em.on_construct<PrefabName>().connect<&decltype(count)::operator()>(count);
+
+  // Recycled entities are reused by the batch.
+  std::vector<snowflake::Entity> existing;
+  em.create(10, std::back_inserter(existing));
+  em.recycle(existing[3]);
+
+  std::vector<snowflake::Entity> spawned;
+  prefab.instantiate(em, 1000, std::back_inserter(spawned));
+  ASSERT_EQ(spawned.size(), size_t{1000});
+  EXPECT_EQ(spawned[0].id(), existing[3].id());
+  EXPECT_EQ(em.entities_active(), size_t{1009});
+
+  EXPECT_EQ(constructed, size_t{1000});
+  EXPECT_EQ(query.size(), size_t{1000});
+  EXPECT_EQ(group.size(), size_t{1000});
+  for (auto e : spawned) {
+    EXPECT_EQ(em.get<PrefabVel>(e).dy, 2.0f);
+    EXPECT_EQ(em.get<PrefabName>(e).name, "crowd");
+    EXPECT_EQ(em.get<PrefabSoa>(e).load().b, 7);
+  }
+
+  prefab.instantiate(em, 24, std::back_inserter(spawned));
+  EXPECT_EQ(std::as_const(em).size<PrefabVel>(), size_t{1024});
+  EXPECT_EQ(group.size(), size_t{1024});
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_PREFAB_HPP
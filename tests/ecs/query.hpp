@@ -0,0 +1,128 @@
+//==--- snowflake/tests/ecs/query.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  query.hpp
+/// \brief This file implements tests for persistent queries.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_QUERY_HPP
+#define SNOWFLAKE_TESTS_ECS_QUERY_HPP
+
+#include <snowflake/ecs/entity_manager.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+
+struct QueryPos {
+  float x = 0.0f;
+};
+
+struct QueryVel {
+  float dx = 0.0f;
+};
+
+struct QueryTarget {
+  int id = 0;
+};
+
+using QueryManager = snowflake::EntityManager<snowflake::Entity>;
+
+/**
+ * Gets the sorted entities which match the \p query.
+ */
+template <typename QueryType>
+auto query_entities(const QueryType& query) -> std::vector<snowflake::Entity> {
+  std::vector<snowflake::Entity> result(
+    query.entities(), query.entities() + query.size());
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+TEST(query, matches_existing_and_new_entities) {
+  QueryManager                   em;
+  std::vector<snowflake::Entity> entities;
+  em.create(20, std::back_inserter(entities));
+  for (auto e : entities) {
+    em.emplace<QueryPos>(e, float(e));
+    if (e % 2 == 0) {
+      em.emplace<QueryVel>(e, 1.0f);
+    }
+  }
+
+  auto& query = em.query<QueryPos, QueryVel>();
+  EXPECT_EQ(query.size(), size_t{10});
+  EXPECT_EQ(&query, &(em.query<QueryPos, QueryVel>()));
+
+  // Adding the missing component adds the entity.
+  em.emplace<QueryVel>(entities[1], 2.0f);
+  EXPECT_TRUE(query.contains(entities[1]));
+  EXPECT_EQ(query.size(), size_t{11});
+
+  // Removing either component, or recycling, removes the entity.
+  em.remove<QueryPos>(entities[0]);
+  em.remove<QueryVel>(entities[2]);
+  em.recycle(entities[4]);
+  EXPECT_EQ(query.size(), size_t{8});
+  EXPECT_FALSE(query.contains(entities[0]));
+  EXPECT_FALSE(query.contains(entities[2]));
+  EXPECT_FALSE(query.contains(entities[4]));
+
+  size_t count = 0;
+  query.each([&](snowflake::Entity e, QueryPos& p, const QueryVel& v) {
+    EXPECT_EQ(p.x, float(e));
+    p.x += v.dx;
+    ++count;
+  });
+  EXPECT_EQ(count, query.size());
+
+  // The matches are the same as for a view.
+  std::vector<snowflake::Entity> viewed;
+  em.view<QueryPos, QueryVel>().each(
+    [&](snowflake::Entity e, QueryPos&, QueryVel&) { viewed.push_back(e); });
+  std::sort(viewed.begin(), viewed.end());
+  EXPECT_EQ(query_entities(query), viewed);
+}
+
+TEST(query, coexists_with_groups_and_other_queries) {
+  QueryManager em;
+  auto&        group = em.group<QueryPos, QueryVel>();
+  auto&        moves = em.query<QueryPos, QueryVel>();
+  auto&        seeks = em.query<QueryPos, QueryTarget>();
+
+  std::vector<snowflake::Entity> entities;
+  em.create(30, std::back_inserter(entities));
+  for (auto e : entities) {
+    em.emplace<QueryPos>(e, float(e));
+    if (e % 3 == 0) {
+      em.emplace<QueryVel>(e, 1.0f);
+    }
+    if (e % 5 == 0) {
+      em.emplace<QueryTarget>(e, static_cast<int>(e));
+    }
+  }
+  EXPECT_EQ(group.size(), size_t{10});
+  EXPECT_EQ(moves.size(), size_t{10});
+  EXPECT_EQ(seeks.size(), size_t{6});
+
+  // Removing the current entity's components while iterating is valid.
+  seeks.each([&](snowflake::Entity e, QueryPos&, QueryTarget&) {
+    em.remove<QueryTarget>(e);
+  });
+  EXPECT_TRUE(seeks.empty());
+
+  snowflake::ThreadPool pool{2};
+  moves.parallel_for_each(
+    pool, [](QueryPos& p, const QueryVel& v) { p.x += v.dx; });
+  for (auto e : query_entities(moves)) {
+    EXPECT_EQ(em.get<QueryPos>(e).x, float(e) + 1.0f);
+  }
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_QUERY_HPP
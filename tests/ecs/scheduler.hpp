@@ -0,0 +1,162 @@
+//==--- snowflake/tests/ecs/scheduler.hpp ------------------ -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  scheduler.hpp
+/// \brief This file implements tests for the system scheduler.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_SCHEDULER_HPP
+#define SNOWFLAKE_TESTS_ECS_SCHEDULER_HPP
+
+#include <snowflake/ecs/scheduler.hpp>
+#include <gtest/gtest.h>
+#include <thread>
+
+struct SchedPos {
+  float x = 0.0f;
+};
+
+struct SchedVel {
+  float dx = 0.0f;
+};
+
+struct SchedSpawn {
+  int count = 0;
+};
+
+using SchedManager   = snowflake::EntityManager<snowflake::Entity>;
+using SchedScheduler = snowflake::Scheduler<snowflake::Entity>;
+using SchedCommands  = SchedScheduler::Commands;
+
+TEST(scheduler, builds_dependencies_from_declarations) {
+  using snowflake::Reads;
+  using snowflake::Writes;
+  snowflake::ThreadPool pool{2};
+  SchedScheduler        scheduler{pool};
+  auto nop = [](SchedManager&, SchedCommands&) {};
+
+  const auto a = scheduler.add<Reads<SchedVel>, Writes<SchedPos>>("a", nop);
+  const auto b = scheduler.add<Reads<SchedVel>, Writes<>>("b", nop);
+  const auto c = scheduler.add<Reads<SchedPos>, Writes<>>("c", nop);
+  const auto d = scheduler.add<Reads<>, Writes<SchedVel>>("d", nop);
+  scheduler.sync();
+  const auto e = scheduler.add<Reads<>, Writes<SchedPos>>("e", nop);
+
+  EXPECT_EQ(scheduler.dependencies(a), size_t{0});
+  EXPECT_EQ(scheduler.dependencies(b), size_t{0}); // Both only read vel.
+  EXPECT_EQ(scheduler.dependencies(c), size_t{1}); // After a.
+  EXPECT_EQ(scheduler.dependencies(d), size_t{2}); // After a and b.
+  EXPECT_EQ(scheduler.dependencies(e), size_t{0}); // After the sync point.
+}
+
+TEST(scheduler, runs_conflicting_systems_in_order) {
+  using snowflake::Reads;
+  using snowflake::Writes;
+  snowflake::ThreadPool pool{3};
+  SchedScheduler        scheduler{pool};
+  SchedManager          manager;
+
+  std::vector<snowflake::Entity> entities;
+  manager.create(1000, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<SchedPos>(e, 0.0f);
+    manager.emplace<SchedVel>(e, 1.0f);
+  }
+
+  scheduler.add<Reads<SchedVel>, Writes<SchedPos>>(
+    "integrate", [](SchedManager& m, SchedCommands&) {
+      m.view<SchedPos, SchedVel>().each(
+        [](SchedPos& p, const SchedVel& v) { p.x += v.dx; });
+    });
+  scheduler.add<Reads<>, Writes<SchedVel>>(
+    "accelerate", [](SchedManager& m, SchedCommands&) {
+      m.view<SchedVel>().each([](SchedVel& v) { v.dx *= 2.0f; });
+    });
+
+  for (int frame = 0; frame < 3; ++frame) {
+    scheduler.run(manager);
+  }
+  // Velocities are 1, 2, 4 when integrated.
+  for (auto e : entities) {
+    EXPECT_EQ(manager.get<SchedPos>(e).x, 7.0f);
+    EXPECT_EQ(manager.get<SchedVel>(e).dx, 8.0f);
+  }
+
+  const auto& timings = scheduler.timings();
+  ASSERT_EQ(timings.size(), size_t{2});
+  EXPECT_STREQ(timings[0].name, "integrate");
+  EXPECT_EQ(timings[0].runs, uint64_t{3});
+  EXPECT_GE(timings[1].total, timings[1].last);
+  scheduler.reset_timings();
+  EXPECT_EQ(scheduler.timings()[0].runs, uint64_t{0});
+}
+
+TEST(scheduler, runs_independent_systems_concurrently) {
+  using snowflake::Reads;
+  using snowflake::Writes;
+  snowflake::ThreadPool pool{2};
+  SchedScheduler        scheduler{pool};
+  SchedManager          manager;
+
+  // Each system waits for the other to start, which only completes if they
+  // run concurrently.
+  std::atomic<int> started{0};
+  std::atomic<int> overlapped{0};
+  auto             meet = [&](SchedManager&, SchedCommands&) {
+    started.fetch_add(1);
+    const auto timeout =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (started.load() < 2 && std::chrono::steady_clock::now() < timeout) {
+      std::this_thread::yield();
+    }
+    overlapped.fetch_add(started.load() == 2 ? 1 : 0);
+  };
+  scheduler.add<Reads<SchedVel>, Writes<SchedPos>>("pos", meet);
+  scheduler.add<Reads<SchedVel>, Writes<SchedSpawn>>("spawn", meet);
+  scheduler.run(manager);
+  EXPECT_EQ(overlapped.load(), 2);
+}
+
+TEST(scheduler, defers_structural_changes_to_sync_points) {
+  using snowflake::Reads;
+  using snowflake::Writes;
+  snowflake::ThreadPool pool{2};
+  SchedScheduler        scheduler{pool};
+  SchedManager          manager;
+
+  size_t seen_before = 0, seen_after = 0;
+  scheduler.add<Reads<>, Writes<SchedSpawn>>(
+    "spawn", [](SchedManager&, SchedCommands& commands) {
+      for (int i = 0; i < 10; ++i) {
+        commands.emplace<SchedSpawn>(commands.create(), i);
+      }
+    });
+  scheduler.add<Reads<SchedSpawn>, Writes<>>(
+    "before", [&](SchedManager& m, SchedCommands&) {
+      seen_before = std::as_const(m).size<SchedSpawn>();
+    });
+  scheduler.sync();
+  scheduler.add<Reads<SchedSpawn>, Writes<>>(
+    "after", [&](SchedManager& m, SchedCommands&) {
+      seen_after = std::as_const(m).size<SchedSpawn>();
+    });
+
+  scheduler.run(manager);
+  EXPECT_EQ(seen_before, size_t{0});
+  EXPECT_EQ(seen_after, size_t{10});
+  EXPECT_EQ(manager.entities_active(), size_t{10});
+
+  scheduler.run(manager);
+  EXPECT_EQ(seen_before, size_t{10});
+  EXPECT_EQ(seen_after, size_t{20});
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_SCHEDULER_HPP
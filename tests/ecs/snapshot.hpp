@@ -0,0 +1,215 @@
+//==--- snowflake/tests/ecs/snapshot.hpp ------------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  snapshot.hpp
+/// \brief This file implements tests for snapshots.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_SNAPSHOT_HPP
+#define SNOWFLAKE_TESTS_ECS_SNAPSHOT_HPP
+
+#include <snowflake/ecs/snapshot.hpp>
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+struct SnapPos {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+struct SnapHealth {
+  int value = 0;
+};
+
+struct SnapUnused {
+  double value = 0.0;
+};
+
+struct SnapPaged {
+  int value = 0;
+};
+
+namespace snowflake {
+template <>
+struct PagedStorage<SnapPaged> : std::true_type {};
+} // namespace snowflake
+
+using SnapManager = snowflake::EntityManager<snowflake::Entity>;
+
+TEST(snapshot, save_and_load_round_trip) {
+  const std::string path = ::testing::TempDir() + "snowflake_snapshot.bin";
+
+  SnapManager                    manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(5000, std::back_inserter(entities));
+  for (auto e : entities) {
+    const auto f = static_cast<float>(e);
+    manager.emplace<SnapPos>(e, f, -f);
+    if (e % 3 == 0) {
+      manager.emplace<SnapHealth>(e, static_cast<int>(e));
+    }
+  }
+  manager.recycle(entities.begin(), entities.begin() + 10);
+  manager.sort<SnapHealth>([](const SnapHealth& h) { return -h.value; });
+
+  EXPECT_TRUE(
+    (snowflake::save_snapshot<SnapPos, SnapHealth, SnapUnused>(
+      manager, path.c_str())));
+
+  SnapManager loaded;
+  EXPECT_TRUE(
+    (snowflake::load_snapshot<SnapPos, SnapHealth, SnapUnused>(
+      loaded, path.c_str())));
+
+  EXPECT_EQ(loaded.entities_created(), manager.entities_created());
+  EXPECT_EQ(loaded.entities_free(), size_t{10});
+  EXPECT_EQ(loaded.size<SnapPos>(), manager.size<SnapPos>());
+  EXPECT_EQ(loaded.size<SnapHealth>(), manager.size<SnapHealth>());
+  EXPECT_EQ(loaded.size<SnapUnused>(), size_t{0});
+
+  for (size_t i = 10; i < entities.size(); ++i) {
+    const auto e = entities[i];
+    EXPECT_EQ(loaded.get<SnapPos>(e).x, static_cast<float>(e));
+    EXPECT_EQ(loaded.get<SnapPos>(e).y, -static_cast<float>(e));
+  }
+
+  // The sorted order of the pool is preserved.
+  const auto& original = manager.view<SnapHealth>();
+  const auto& restored = loaded.view<SnapHealth>();
+  std::vector<snowflake::Entity> a, b;
+  original.each(
+    [&](snowflake::Entity e, const SnapHealth&) { a.push_back(e); });
+  restored.each(
+    [&](snowflake::Entity e, const SnapHealth&) { b.push_back(e); });
+  EXPECT_EQ(a, b);
+
+  // Recycled entities are reused in the same order.
+  EXPECT_EQ(loaded.create(), manager.create());
+  std::remove(path.c_str());
+}
+
+TEST(snapshot, rejects_mismatched_files) {
+  const std::string path = ::testing::TempDir() + "snowflake_mismatch.bin";
+
+  SnapManager manager;
+  manager.emplace<SnapPos>(manager.create(), 1.0f, 2.0f);
+  EXPECT_TRUE(snowflake::save_snapshot<SnapPos>(manager, path.c_str()));
+
+  SnapManager a;
+  EXPECT_FALSE(snowflake::load_snapshot<SnapHealth>(a, path.c_str()));
+  SnapManager b;
+  EXPECT_FALSE(
+    (snowflake::load_snapshot<SnapPos, SnapHealth>(b, path.c_str())));
+  SnapManager c;
+  EXPECT_FALSE(snowflake::load_snapshot<SnapPos>(c, "/nonexistent/snapshot"));
+  std::remove(path.c_str());
+}
+
+TEST(snapshot, rejects_non_empty_managers_and_corrupt_files) {
+  const std::string path = ::testing::TempDir() + "snowflake_corrupt.bin";
+
+  SnapManager manager;
+  for (int i = 0; i < 10; ++i) {
+    manager.emplace<SnapPos>(manager.create(), 1.0f, 2.0f);
+  }
+  manager.recycle(snowflake::Entity{4});
+  EXPECT_TRUE(snowflake::save_snapshot<SnapPos>(manager, path.c_str()));
+
+  SnapManager non_empty;
+  non_empty.create();
+  EXPECT_FALSE(snowflake::load_snapshot<SnapPos>(non_empty, path.c_str()));
+
+  // Overwrites the value at the offset in the file, then tries to load it.
+  const auto load_with = [&](size_t offset, uint64_t value) {
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    std::fseek(file, static_cast<long>(offset), SEEK_SET);
+    uint64_t old = 0;
+    std::fread(&old, sizeof(old), 1, file);
+    std::fseek(file, static_cast<long>(offset), SEEK_SET);
+    std::fwrite(&value, sizeof(value), 1, file);
+    std::fclose(file);
+
+    SnapManager loaded;
+    const bool  ok = snowflake::load_snapshot<SnapPos>(loaded, path.c_str());
+    file           = std::fopen(path.c_str(), "r+b");
+    std::fseek(file, static_cast<long>(offset), SEEK_SET);
+    std::fwrite(&old, sizeof(old), 1, file);
+    std::fclose(file);
+    return ok;
+  };
+
+  using Header = snowflake::SnapshotHeader;
+  using Entry  = snowflake::SnapshotEntry;
+  constexpr size_t entry = sizeof(Header);
+  EXPECT_FALSE(load_with(offsetof(Header, next), 10));
+  EXPECT_FALSE(load_with(offsetof(Header, free), 11));
+  EXPECT_FALSE(load_with(offsetof(Header, free), 2));
+  EXPECT_FALSE(load_with(offsetof(Header, entities), uint64_t{1} << 61));
+  EXPECT_FALSE(load_with(entry + offsetof(Entry, count), uint64_t{1} << 62));
+  EXPECT_FALSE(load_with(entry + offsetof(Entry, component_offset), 8));
+
+  SnapManager loaded;
+  EXPECT_TRUE(snowflake::load_snapshot<SnapPos>(loaded, path.c_str()));
+  EXPECT_EQ(loaded.entities_free(), size_t{1});
+  EXPECT_EQ(loaded.create(), snowflake::Entity{4});
+  std::remove(path.c_str());
+}
+
+TEST(snapshot, paged_components_round_trip) {
+  const std::string path = ::testing::TempDir() + "snowflake_paged.bin";
+
+  SnapManager                    manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(
+    snowflake::component_page_size * 2 + 5, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<SnapPaged>(e, static_cast<int>(e) * 2);
+  }
+  EXPECT_TRUE((snowflake::save_snapshot<SnapPaged>(manager, path.c_str())));
+
+  SnapManager loaded;
+  EXPECT_TRUE((snowflake::load_snapshot<SnapPaged>(loaded, path.c_str())));
+  EXPECT_EQ(loaded.size<SnapPaged>(), entities.size());
+  for (auto e : entities) {
+    EXPECT_EQ(loaded.get<SnapPaged>(e).value, static_cast<int>(e) * 2);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(snapshot, load_into_component_list_manager) {
+  const std::string path = ::testing::TempDir() + "snowflake_list.bin";
+  using ListManager      = snowflake::EntityManager<
+    snowflake::Entity,
+    snowflake::ComponentList<SnapPos, SnapHealth>>;
+
+  SnapManager                    manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(100, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<SnapPos>(e, static_cast<float>(e), 0.0f);
+  }
+  EXPECT_TRUE(
+    (snowflake::save_snapshot<SnapPos, SnapHealth>(manager, path.c_str())));
+
+  ListManager loaded;
+  EXPECT_TRUE(
+    (snowflake::load_snapshot<SnapPos, SnapHealth>(loaded, path.c_str())));
+  EXPECT_EQ(loaded.size<SnapPos>(), size_t{100});
+  EXPECT_EQ(loaded.size<SnapHealth>(), size_t{0});
+  for (auto e : entities) {
+    EXPECT_EQ(loaded.get<SnapPos>(e).x, static_cast<float>(e));
+  }
+  std::remove(path.c_str());
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_SNAPSHOT_HPP
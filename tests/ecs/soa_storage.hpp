@@ -0,0 +1,151 @@
+//==--- snowflake/tests/ecs/soa_storage.hpp ---------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  soa_storage.hpp
+/// \brief This file implements tests for structure-of-arrays storage.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_SOA_STORAGE_HPP
+#define SNOWFLAKE_TESTS_ECS_SOA_STORAGE_HPP
+
+#include <snowflake/ecs/entity_manager.hpp>
+#include <snowflake/ecs/soa_storage.hpp>
+#include <gtest/gtest.h>
+
+struct SoaPos {
+  float x;
+  float y;
+  float z;
+};
+
+struct SoaBody {
+  double mass;
+  int    id;
+};
+
+template <>
+struct snowflake::SoaLayout<SoaPos> {
+  static constexpr auto fields =
+    std::make_tuple(&SoaPos::x, &SoaPos::y, &SoaPos::z);
+};
+
+template <>
+struct snowflake::SoaLayout<SoaBody> {
+  static constexpr auto fields = std::make_tuple(&SoaBody::mass, &SoaBody::id);
+};
+
+using SoaPosStorage =
+  snowflake::SoaComponentStorage<snowflake::Entity, SoaPos>;
+
+TEST(soa_storage, layout_trait) {
+  EXPECT_TRUE(snowflake::soa_layout_v<SoaPos>);
+  EXPECT_FALSE(snowflake::soa_layout_v<Agg>);
+
+  using Storage = snowflake::storage_t<snowflake::Entity, SoaPos>;
+  const bool is_soa = std::is_same_v<Storage, SoaPosStorage>;
+  EXPECT_TRUE(is_soa);
+}
+
+TEST(soa_storage, basic_functionality) {
+  SoaPosStorage     storage;
+  snowflake::Entity e1{1}, e2{7}, e3{3};
+
+  storage.emplace(e1, 1.0f, 2.0f, 3.0f);
+  storage.emplace(e2, SoaPos{4.0f, 5.0f, 6.0f});
+  storage.emplace(e3, 7.0f, 8.0f, 9.0f);
+  EXPECT_EQ(storage.size(), size_t{3});
+
+  auto p = storage.get(e2);
+  EXPECT_EQ(p.get<0>(), 4.0f);
+  EXPECT_EQ(p.get<1>(), 5.0f);
+  EXPECT_EQ(p.get<2>(), 6.0f);
+
+  p.get<1>() = 10.0f;
+  EXPECT_EQ(storage.get(e2).load().y, 10.0f);
+
+  storage.get(e1) = SoaPos{0.5f, 0.5f, 0.5f};
+  const SoaPos loaded = storage.get(e1);
+  EXPECT_EQ(loaded.z, 0.5f);
+
+  storage.erase(e1);
+  EXPECT_EQ(storage.size(), size_t{2});
+  EXPECT_FALSE(storage.exists(e1));
+  EXPECT_EQ(storage.get(e3).get<0>(), 7.0f);
+  EXPECT_EQ(storage.get(e2).get<1>(), 10.0f);
+
+  storage.swap(e2, e3);
+  EXPECT_EQ(storage.get(e3).get<2>(), 9.0f);
+  EXPECT_EQ(storage.get(e2).get<2>(), 6.0f);
+}
+
+TEST(soa_storage, batch_erase) {
+  SoaPosStorage                  storage;
+  std::vector<snowflake::Entity> erased;
+  for (IdType i = 0; i < 100; ++i) {
+    storage.emplace(snowflake::Entity{i}, float(i), float(i) * 2.0f, 0.0f);
+    if (i % 4 == 1) {
+      erased.emplace_back(i);
+    }
+  }
+
+  storage.erase(erased.begin(), erased.end());
+  EXPECT_EQ(storage.size(), size_t{75});
+  EXPECT_EQ(storage.field<0>().size(), size_t{75});
+  for (IdType i = 0; i < 100; ++i) {
+    ASSERT_EQ(storage.exists(snowflake::Entity{i}), i % 4 != 1);
+    if (i % 4 != 1) {
+      EXPECT_EQ(storage.get(snowflake::Entity{i}).get<1>(), float(i) * 2.0f);
+    }
+  }
+}
+
+TEST(soa_storage, field_spans_are_aligned) {
+  SoaPosStorage storage;
+  for (IdType i = 0; i < 100; ++i) {
+    storage.emplace(snowflake::Entity{i}, float(i), 0.0f, 0.0f);
+  }
+
+  auto xs = storage.field<0>();
+  auto ys = storage.field<1>();
+  EXPECT_EQ(xs.size(), size_t{100});
+  EXPECT_EQ(
+    reinterpret_cast<uintptr_t>(xs.data()) % snowflake::soa_alignment,
+    uintptr_t{0});
+  EXPECT_EQ(
+    reinterpret_cast<uintptr_t>(ys.data()) % snowflake::soa_alignment,
+    uintptr_t{0});
+
+  for (size_t i = 0; i < xs.size(); ++i) {
+    ys[i] = xs[i] * 2.0f;
+  }
+  for (IdType i = 0; i < 100; ++i) {
+    EXPECT_EQ(storage.get(snowflake::Entity{i}).get<1>(), float(i) * 2.0f);
+  }
+}
+
+TEST(soa_storage, entity_manager_views) {
+  snowflake::EntityManager<snowflake::Entity> em;
+  for (int i = 0; i < 10; ++i) {
+    auto e = em.create();
+    em.emplace<SoaPos>(e, float(i), 0.0f, 0.0f);
+    em.emplace<SoaBody>(e, double(i), i);
+  }
+
+  em.view<SoaPos, SoaBody>().each([](auto pos, auto body) {
+    pos.template get<1>() = float(body.template get<0>());
+  });
+  em.view<SoaPos>().each([](snowflake::Entity, auto pos) {
+    EXPECT_EQ(pos.template get<0>(), pos.template get<1>());
+  });
+  EXPECT_EQ(em.get<SoaPos>(snowflake::Entity{4}).get<1>(), 4.0f);
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_SOA_STORAGE_HPP
@@ -209,8 +209,8 @@ TEST(sparse_set, iterator_iteration) {
   snowflake::Entity ent{entity_id + 2};
 
   for (const auto& e : set) {
-    set.emplace(ent);
     it_sum += e;
+    set.emplace(ent);
     ent++;
   }
   EXPECT_EQ(it_sum, sum);
@@ -314,4 +314,120 @@ TEST(sparse_set, find) {
   EXPECT_EQ(*(++it), ent);
 }
 
+TEST(sparse_set, bulk_insert_and_erase) {
+  SparseSet                      set;
+  std::vector<snowflake::Entity> entities;
+  constexpr auto                 page_size = SparseSet::page_size;
+  for (IdType i = 0; i < 1000; ++i) {
+    entities.emplace_back(static_cast<IdType>(i * 7 % (3 * page_size)));
+  }
+
+  set.emplace(snowflake::Entity{IdType{3 * page_size + 1}});
+  set.insert(entities.begin(), entities.end());
+  EXPECT_EQ(set.size(), entities.size() + 1);
+  EXPECT_EQ(set.extent(), 4 * page_size);
+  for (size_t i = 0; i < entities.size(); ++i) {
+    EXPECT_TRUE(set.exists(entities[i]));
+    EXPECT_EQ(set.index(entities[i]), i + 1);
+  }
+
+  set.erase(entities.begin() + 100, entities.end());
+  EXPECT_EQ(set.size(), size_t{101});
+  for (size_t i = 0; i < entities.size(); ++i) {
+    EXPECT_EQ(set.exists(entities[i]), i < 100);
+  }
+  EXPECT_TRUE(set.exists(snowflake::Entity{IdType{3 * page_size + 1}}));
+}
+
+TEST(sparse_set, bulk_insert_and_erase_across_pages) {
+  // Alternate between pages so the insert writes the sparse entries out of
+  // order, and erase every third entity so holes are spread through the set.
+  SparseSet                      set;
+  std::vector<snowflake::Entity> entities, erased;
+  constexpr auto                 page_size = SparseSet::page_size;
+  for (IdType i = 0; i < 600; ++i) {
+    entities.emplace_back(static_cast<IdType>((i % 3) * page_size + i));
+    if (i % 3 == 1) {
+      erased.push_back(entities.back());
+    }
+  }
+
+  set.insert(entities.begin(), entities.end());
+  for (size_t i = 0; i < entities.size(); ++i) {
+    ASSERT_EQ(set.index(entities[i]), i);
+  }
+
+  set.erase(erased.begin(), erased.end());
+  EXPECT_EQ(set.size(), size_t{400});
+  for (size_t i = 0; i < entities.size(); ++i) {
+    ASSERT_EQ(set.exists(entities[i]), i % 3 != 1);
+  }
+  for (size_t i = 0; i < set.size(); ++i) {
+    EXPECT_EQ(set.index(set.rbegin()[i]), i);
+  }
+}
+
+TEST(sparse_set, zero_id_and_fresh_pages) {
+  SparseSet      set;
+  constexpr auto page_size = SparseSet::page_size;
+
+  // Entity 0 is stored with a non-zero sparse entry, so it must be found.
+  snowflake::Entity zero{0};
+  EXPECT_FALSE(set.exists(zero));
+  set.emplace(zero);
+  EXPECT_TRUE(set.exists(zero));
+  EXPECT_EQ(set.index(zero), size_t{0});
+
+  // Other entities on a fresh page are not in the set.
+  snowflake::Entity far{IdType{5 * page_size + 3}};
+  set.emplace(far);
+  for (IdType i = 0; i < page_size; i += 97) {
+    const auto id = static_cast<IdType>(5 * page_size + i);
+    EXPECT_EQ(set.exists(snowflake::Entity{id}), id == IdType{far});
+  }
+
+  set.erase(zero);
+  EXPECT_FALSE(set.exists(zero));
+  EXPECT_EQ(set.index(far), size_t{0});
+  set.emplace(zero);
+  EXPECT_EQ(set.index(zero), size_t{1});
+}
+
+TEST(sparse_set, virtual_region_is_zero_filled) {
+  constexpr size_t         bytes = size_t{1} << 30;
+  snowflake::VirtualRegion region{bytes};
+  ASSERT_TRUE(region.valid());
+  EXPECT_EQ(region.size(), bytes);
+
+  // Memory must be committed before it's accessed.
+  EXPECT_TRUE(region.commit(0, 64));
+  EXPECT_TRUE(region.commit(bytes / 2, 64));
+  EXPECT_TRUE(region.commit(bytes - 1, 1));
+  EXPECT_FALSE(region.commit(bytes - 1, 2));
+
+  auto* data = static_cast<unsigned char*>(region.data());
+  EXPECT_EQ(data[0], 0);
+  EXPECT_EQ(data[bytes / 2], 0);
+  data[bytes - 1] = 1;
+  EXPECT_EQ(data[bytes - 1], 1);
+
+  snowflake::VirtualRegion other{std::move(region)};
+  EXPECT_FALSE(region.valid());
+  EXPECT_TRUE(other.valid());
+}
+
+TEST(sparse_set, entities_outside_virtual_region) {
+  // Entities past the reserved virtual region use individually allocated
+  // pages, which must coexist with the pages in the region.
+  constexpr auto past =
+    static_cast<IdType>(snowflake::sparse_virtual_entities + 7);
+  snowflake::SparseSet<snowflake::Entity> set;
+  set.emplace(snowflake::Entity{3});
+  set.emplace(snowflake::Entity{past});
+  EXPECT_TRUE(set.exists(snowflake::Entity{3}));
+  EXPECT_TRUE(set.exists(snowflake::Entity{past}));
+  EXPECT_FALSE(set.exists(snowflake::Entity{past + 1}));
+  EXPECT_EQ(set.index(snowflake::Entity{past}), size_t{1});
+}
+
 #endif // SNOWFLAKE_TESTS_ECS_SPARSE_SET_HPP
\ No newline at end of file
@@ -0,0 +1,206 @@
+//==--- snowflake/tests/ecs/spatial_grid.hpp --------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  spatial_grid.hpp
+/// \brief This file implements tests for the spatial grid.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_SPATIAL_GRID_HPP
+#define SNOWFLAKE_TESTS_ECS_SPATIAL_GRID_HPP
+
+#include <snowflake/ecs/entity_manager.hpp>
+#include <snowflake/ecs/spatial_grid.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+
+struct GridPos {
+  float x = 0.0f;
+  float y = 0.0f;
+  float z = 0.0f;
+};
+
+using GridManager = snowflake::EntityManager<snowflake::Entity>;
+using Grid        = snowflake::SpatialGrid<snowflake::Entity, GridPos>;
+
+/**
+ * Creates \p count entities with random positions in [0, 100)^3.
+ */
+inline auto grid_populate(GridManager& em, size_t count)
+  -> std::vector<snowflake::Entity> {
+  std::mt19937                          gen{17};
+  std::uniform_real_distribution<float> dist{0.0f, 100.0f};
+  std::vector<snowflake::Entity>        entities;
+  em.create(count, std::back_inserter(entities));
+  for (auto e : entities) {
+    em.emplace<GridPos>(e, dist(gen), dist(gen), dist(gen));
+  }
+  return entities;
+}
+
+/**
+ * Gets the sorted entities within \p radius of \p c, by brute force.
+ */
+inline auto grid_brute_range(GridManager& em, GridPos c, float radius)
+  -> std::vector<snowflake::Entity> {
+  std::vector<snowflake::Entity> result;
+  em.view<GridPos>().each([&](snowflake::Entity e, const GridPos& p) {
+    const float dx = p.x - c.x, dy = p.y - c.y, dz = p.z - c.z;
+    if (dx * dx + dy * dy + dz * dz <= radius * radius) {
+      result.push_back(e);
+    }
+  });
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+/**
+ * Gets the sorted entities within \p radius of \p c, from the \p grid.
+ */
+inline auto grid_range(const Grid& grid, GridPos c, float radius)
+  -> std::vector<snowflake::Entity> {
+  std::vector<snowflake::Entity> result;
+  grid.each_in_range(
+    snowflake::SpatialPoint{c.x, c.y, c.z},
+    radius,
+    [&](snowflake::Entity e) { result.push_back(e); });
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+TEST(spatial_grid, answers_range_and_nearest_queries) {
+  GridManager em;
+  Grid        grid{4.0f};
+  const auto  entities = grid_populate(em, 2000);
+  grid.attach(em);
+  EXPECT_EQ(grid.size(), size_t{2000});
+
+  for (const auto& c : {GridPos{50, 50, 50}, GridPos{0, 0, 0}}) {
+    for (float radius : {0.5f, 3.0f, 11.0f, 200.0f}) {
+      EXPECT_EQ(grid_range(grid, c, radius), grid_brute_range(em, c, radius));
+    }
+  }
+
+  // Nearest, compared against sorting all entities by distance:
+  for (const auto& c : {GridPos{50, 50, 50}, GridPos{-30, 120, 4}}) {
+    std::vector<std::pair<float, snowflake::Entity>> all;
+    for (auto e : entities) {
+      const auto& p  = em.get<GridPos>(e);
+      const float dx = p.x - c.x, dy = p.y - c.y, dz = p.z - c.z;
+      all.emplace_back(dx * dx + dy * dy + dz * dz, e);
+    }
+    std::sort(all.begin(), all.end());
+    for (size_t k : {size_t{1}, size_t{10}, size_t{2500}}) {
+      std::vector<snowflake::Entity> found;
+      grid.nearest(
+        snowflake::SpatialPoint{c.x, c.y, c.z}, k, std::back_inserter(found));
+      ASSERT_EQ(found.size(), std::min(k, all.size()));
+      for (size_t i = 0; i < found.size(); ++i) {
+        EXPECT_EQ(found[i], all[i].second);
+      }
+    }
+  }
+}
+
+TEST(spatial_grid, answers_frustum_queries) {
+  GridManager em;
+  Grid        grid{8.0f};
+  grid_populate(em, 2000);
+  grid.attach(em);
+
+  // A box [20, 60] x [10, 50] x [30, 70], cut by the plane x + y <= 90.
+  const std::array<snowflake::SpatialPlane, 7> planes = {
+    {{1, 0, 0, -20},
+     {-1, 0, 0, 60},
+     {0, 1, 0, -10},
+     {0, -1, 0, 50},
+     {0, 0, 1, -30},
+     {0, 0, -1, 70},
+     {-1, -1, 0, 90}}};
+  std::vector<snowflake::Entity> found, expected;
+  grid.each_in_frustum(
+    planes, [&](snowflake::Entity e, const snowflake::SpatialPoint& p) {
+      EXPECT_EQ(p.x, em.get<GridPos>(e).x);
+      found.push_back(e);
+    });
+  em.view<GridPos>().each([&](snowflake::Entity e, const GridPos& p) {
+    if (
+      p.x >= 20 && p.x <= 60 && p.y >= 10 && p.y <= 50 && p.z >= 30 &&
+      p.z <= 70 && p.x + p.y <= 90) {
+      expected.push_back(e);
+    }
+  });
+  std::sort(found.begin(), found.end());
+  std::sort(expected.begin(), expected.end());
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(found, expected);
+}
+
+TEST(spatial_grid, tracks_component_changes) {
+  GridManager em;
+  Grid        grid{4.0f};
+  auto        entities = grid_populate(em, 500);
+  grid.attach(em);
+
+  // Moves through patch are only applied on update:
+  const auto moved = entities[0];
+  em.patch<GridPos>(moved, [](GridPos& p) { p = GridPos{-50, -50, -50}; });
+  EXPECT_NE(grid.position(moved).x, -50.0f);
+  grid.update(em);
+  EXPECT_EQ(grid.position(moved).x, -50.0f);
+  EXPECT_EQ(grid_range(grid, GridPos{-50, -50, -50}, 1.0f).size(), size_t{1});
+
+  // Moves within a cell, and moves through get() marked explicitly:
+  em.patch<GridPos>(moved, [](GridPos& p) { p.x += 0.5f; });
+  em.get<GridPos>(entities[1]) = GridPos{150, 150, 150};
+  grid.moved(entities[1]);
+  grid.update(em);
+  EXPECT_EQ(grid.position(moved).x, -49.5f);
+  EXPECT_EQ(grid.position(entities[1]).z, 150.0f);
+
+  // Removed components, recycled entities and new components:
+  em.remove<GridPos>(entities[2]);
+  em.patch<GridPos>(entities[3], [](GridPos& p) { p.x = 1.0f; });
+  em.recycle(entities[3]);
+  EXPECT_FALSE(grid.contains(entities[3]));
+  const auto created = em.create();
+  em.emplace<GridPos>(created, 120.0f, 120.0f, 120.0f);
+  grid.update(em);
+  EXPECT_FALSE(grid.contains(entities[2]));
+  EXPECT_TRUE(grid.contains(created));
+  EXPECT_EQ(grid.size(), size_t{499});
+
+  for (const auto& c : {GridPos{50, 50, 50}, GridPos{130, 130, 130}}) {
+    EXPECT_EQ(grid_range(grid, c, 30.0f), grid_brute_range(em, c, 30.0f));
+  }
+
+  grid.detach(em);
+  em.emplace<GridPos>(em.create(), 0.0f, 0.0f, 0.0f);
+  EXPECT_EQ(grid.size(), size_t{499});
+}
+
+TEST(spatial_grid, rebuilds_in_parallel) {
+  GridManager           em;
+  Grid                  serial{5.0f}, parallel{5.0f};
+  snowflake::ThreadPool pool{3};
+  grid_populate(em, 20000);
+  serial.rebuild(em);
+  parallel.rebuild(em, pool);
+
+  EXPECT_EQ(parallel.size(), serial.size());
+  EXPECT_EQ(parallel.cells(), serial.cells());
+  for (const auto& c : {GridPos{10, 20, 30}, GridPos{75, 75, 75}}) {
+    EXPECT_EQ(grid_range(parallel, c, 9.0f), grid_range(serial, c, 9.0f));
+    EXPECT_EQ(grid_range(parallel, c, 9.0f), grid_brute_range(em, c, 9.0f));
+  }
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_SPATIAL_GRID_HPP
@@ -0,0 +1,167 @@
+//==--- snowflake/tests/ecs/tag_storage.hpp ---------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  tag_storage.hpp
+/// \brief This file implements tests for the storage of tag components.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_TAG_STORAGE_HPP
+#define SNOWFLAKE_TESTS_ECS_TAG_STORAGE_HPP
+
+#include <snowflake/ecs/delta_snapshot.hpp>
+#include <snowflake/ecs/entity_manager.hpp>
+#include <snowflake/ecs/snapshot.hpp>
+#include <gtest/gtest.h>
+#include <string>
+
+struct TagVisible {};
+
+struct TagStatic : public snowflake::ComponentIdStatic<3> {};
+
+struct TagPos {
+  float x = 0.0f;
+};
+
+using TagManager = snowflake::EntityManager<snowflake::Entity>;
+
+/**
+ * Gets the sorted entities which have the TagVisible tag in the manager.
+ */
+inline auto tag_visible(const TagManager& manager)
+  -> std::vector<snowflake::Entity> {
+  std::vector<snowflake::Entity> visible;
+  manager.view<TagVisible>().each(
+    [&](snowflake::Entity e, const TagVisible&) { visible.push_back(e); });
+  std::sort(visible.begin(), visible.end());
+  return visible;
+}
+
+TEST(tag_storage, selected_for_empty_components) {
+  using Entity = snowflake::Entity;
+  static_assert(std::is_same_v<
+                snowflake::storage_t<Entity, TagVisible>,
+                snowflake::TagStorage<Entity, TagVisible>>);
+  static_assert(std::is_same_v<
+                snowflake::storage_t<Entity, TagStatic>,
+                snowflake::TagStorage<Entity, TagStatic>>);
+  static_assert(std::is_same_v<
+                snowflake::storage_t<Entity, TagPos>,
+                snowflake::ComponentStorage<Entity, TagPos>>);
+
+  // Only the sparse set is stored.
+  static_assert(
+    sizeof(snowflake::TagStorage<Entity, TagVisible>) ==
+    sizeof(snowflake::SparseSet<Entity>));
+}
+
+TEST(tag_storage, membership_and_iteration) {
+  snowflake::TagStorage<snowflake::Entity, TagVisible> storage;
+  for (uint32_t i = 0; i < 10; ++i) {
+    storage.emplace(snowflake::Entity{i * 2});
+  }
+  EXPECT_EQ(storage.size(), size_t{10});
+  EXPECT_TRUE(storage.exists(snowflake::Entity{4}));
+  EXPECT_FALSE(storage.exists(snowflake::Entity{5}));
+  EXPECT_EQ(
+    &storage.get(snowflake::Entity{2}), &storage.get(snowflake::Entity{4}));
+
+  storage.erase(snowflake::Entity{4});
+  EXPECT_FALSE(storage.exists(snowflake::Entity{4}));
+
+  // Iteration yields the entities.
+  size_t count = 0;
+  for (const auto& entity : storage) {
+    EXPECT_EQ(entity.id() % 2, uint32_t{0});
+    ++count;
+  }
+  EXPECT_EQ(count, size_t{9});
+
+  storage.sort([](snowflake::Entity e, const TagVisible&) { return e.id(); });
+  uint32_t last = 0;
+  for (const auto& entity : storage) {
+    EXPECT_GE(entity.id(), last);
+    last = entity.id();
+  }
+}
+
+TEST(tag_storage, manager_views_and_groups) {
+  TagManager                     manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(30, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<TagPos>(e, static_cast<float>(e));
+    if (e % 2 == 0) {
+      manager.emplace<TagVisible>(e);
+    }
+    if (e % 3 == 0) {
+      manager.emplace<TagStatic>(e);
+    }
+  }
+  EXPECT_EQ(manager.size<TagVisible>(), size_t{15});
+  EXPECT_EQ(manager.size<TagStatic>(), size_t{10});
+
+  size_t count = 0;
+  manager.view<TagPos, TagVisible, TagStatic>().each(
+    [&](snowflake::Entity e, TagPos& pos, TagVisible&, TagStatic&) {
+      EXPECT_EQ(e % 6, uint32_t{0});
+      EXPECT_EQ(pos.x, static_cast<float>(e));
+      ++count;
+    });
+  EXPECT_EQ(count, size_t{5});
+
+  auto& group = manager.group<TagPos, TagVisible>();
+  EXPECT_EQ(group.size(), size_t{15});
+  group.each([](snowflake::Entity e, const TagPos& pos, const TagVisible&) {
+    EXPECT_EQ(pos.x, static_cast<float>(e));
+  });
+
+  manager.recycle(entities[0]);
+  manager.remove<TagVisible>(entities[2]);
+  EXPECT_EQ(group.size(), size_t{13});
+  EXPECT_EQ(manager.size<TagVisible>(), size_t{13});
+  EXPECT_EQ(manager.size<TagStatic>(), size_t{9});
+}
+
+TEST(tag_storage, snapshots_and_deltas) {
+  const std::string path = ::testing::TempDir() + "snowflake_tags.bin";
+
+  TagManager                     manager;
+  std::vector<snowflake::Entity> entities;
+  manager.create(100, std::back_inserter(entities));
+  for (auto e : entities) {
+    manager.emplace<TagPos>(e, static_cast<float>(e));
+    if (e % 4 == 0) {
+      manager.emplace<TagVisible>(e);
+    }
+  }
+
+  auto history = snowflake::make_delta_history<TagPos, TagVisible>(manager);
+  history.capture();
+  const auto start = tag_visible(manager);
+  manager.remove<TagVisible>(entities[0]);
+  manager.emplace<TagVisible>(entities[1]);
+  history.capture();
+  EXPECT_NE(tag_visible(manager), start);
+
+  EXPECT_EQ(history.rollback(1), size_t{1});
+  EXPECT_EQ(tag_visible(manager), start);
+
+  EXPECT_TRUE(
+    (snowflake::save_snapshot<TagPos, TagVisible>(manager, path.c_str())));
+  TagManager loaded;
+  EXPECT_TRUE(
+    (snowflake::load_snapshot<TagPos, TagVisible>(loaded, path.c_str())));
+  EXPECT_EQ(loaded.size<TagVisible>(), size_t{25});
+  EXPECT_EQ(tag_visible(loaded), start);
+  std::remove(path.c_str());
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_TAG_STORAGE_HPP
@@ -0,0 +1,125 @@
+//==--- snowflake/tests/ecs/tracked_storage.hpp ------------ -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  tracked_storage.hpp
+/// \brief This file implements tests for storage which tracks changes.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_TRACKED_STORAGE_HPP
+#define SNOWFLAKE_TESTS_ECS_TRACKED_STORAGE_HPP
+
+#include <snowflake/ecs/entity_manager.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+
+struct TrackedPos {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+struct TrackedVel {
+  float dx = 0.0f;
+  float dy = 0.0f;
+};
+
+template <>
+struct snowflake::TrackChanges<TrackedPos> : std::true_type {};
+
+using TrackedStorage =
+  snowflake::TrackedComponentStorage<snowflake::Entity, TrackedPos>;
+using TrackedManager = snowflake::EntityManager<snowflake::Entity>;
+
+/**
+ * Returns the sorted ids of the entities in the \p range.
+ */
+template <typename Range>
+auto tracked_ids(const Range& range) -> std::vector<uint32_t> {
+  std::vector<uint32_t> ids;
+  for (const auto& e : range) {
+    ids.push_back(static_cast<uint32_t>(e));
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+TEST(tracked_storage, trait_selects_storage) {
+  using Storage = snowflake::storage_t<snowflake::Entity, TrackedPos>;
+  using Other   = snowflake::storage_t<snowflake::Entity, TrackedVel>;
+  EXPECT_TRUE((std::is_same_v<Storage, TrackedStorage>));
+  EXPECT_FALSE(snowflake::track_changes_v<TrackedVel>);
+  EXPECT_TRUE((std::is_same_v<
+               Other,
+               snowflake::ComponentStorage<snowflake::Entity, TrackedVel>>));
+}
+
+TEST(tracked_storage, changed_since) {
+  TrackedStorage storage;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    storage.emplace(snowflake::Entity{i}, static_cast<float>(i), 0.0f);
+  }
+
+  // Everything is new.
+  auto seen = storage.advance_version();
+  EXPECT_EQ(tracked_ids(storage.changed_since(0)).size(), size_t{1000});
+  EXPECT_TRUE(tracked_ids(storage.changed_since(seen)).empty());
+
+  // Only mutable access marks changes.
+  const auto& cstorage = storage;
+  EXPECT_EQ(cstorage.get(snowflake::Entity{5}).x, 5.0f);
+  storage.get(snowflake::Entity{7}).x = 1.0f;
+  storage.get(snowflake::Entity{900}).y = 1.0f;
+  auto now = storage.advance_version();
+  EXPECT_EQ(
+    tracked_ids(storage.changed_since(seen)),
+    (std::vector<uint32_t>{7, 900}));
+  seen = now;
+
+  // Erasing moves the version of the back component.
+  storage.get(snowflake::Entity{999}).x = 2.0f;
+  storage.erase(snowflake::Entity{3});
+  storage.swap(snowflake::Entity{999}, snowflake::Entity{10});
+  now = storage.advance_version();
+  EXPECT_EQ(
+    tracked_ids(storage.changed_since(seen)), (std::vector<uint32_t>{999}));
+  EXPECT_EQ(storage.version(snowflake::Entity{999}), now);
+  seen = now;
+
+  // Iteration with mutable access marks everything.
+  for (auto& c : storage) {
+    c.x += 1.0f;
+  }
+  storage.advance_version();
+  EXPECT_EQ(tracked_ids(storage.changed_since(seen)).size(), size_t{999});
+}
+
+TEST(tracked_storage, manager_views_mark_changes) {
+  TrackedManager manager;
+  for (int i = 0; i < 200; ++i) {
+    auto e = manager.create();
+    manager.emplace<TrackedPos>(e, 0.0f, 0.0f);
+    if (i % 10 == 0) {
+      manager.emplace<TrackedVel>(e, 1.0f, 1.0f);
+    }
+  }
+
+  const auto seen = manager.advance_version<TrackedPos>();
+  manager.view<TrackedPos, TrackedVel>().each(
+    [](TrackedPos& p, const TrackedVel& v) { p.x += v.dx; });
+  manager.advance_version<TrackedPos>();
+
+  const auto changed = tracked_ids(manager.changed_since<TrackedPos>(seen));
+  EXPECT_EQ(changed.size(), size_t{20});
+  for (auto id : changed) {
+    EXPECT_EQ(id % 10, uint32_t{0});
+  }
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_TRACKED_STORAGE_HPP
@@ -0,0 +1,225 @@
+//==--- snowflake/tests/ecs/view.hpp ----------------------- -*- C++ -*- ---==//
+//
+//                                Snowflake
+//
+//                      Copyright (c) 2020 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  view.hpp
+/// \brief This file implements tests for views over components.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef SNOWFLAKE_TESTS_ECS_VIEW_HPP
+#define SNOWFLAKE_TESTS_ECS_VIEW_HPP
+
+#include <snowflake/ecs/entity_manager.hpp>
+#include <gtest/gtest.h>
+
+struct ViewPos {
+  float x = 0.0f;
+  float y = 0.0f;
+};
+
+struct ViewVel {
+  float dx = 0.0f;
+  float dy = 0.0f;
+};
+
+struct ViewMass {
+  float m = 0.0f;
+};
+
+struct ViewHidden {};
+
+struct ViewUnused {};
+
+using ViewManager = snowflake::EntityManager<snowflake::Entity>;
+
+TEST(view, single_component) {
+  ViewManager em;
+  for (int i = 0; i < 10; ++i) {
+    auto e = em.create();
+    em.emplace<ViewPos>(e, float(i), float(i));
+  }
+
+  size_t count = 0;
+  em.view<ViewPos>().each([&count](ViewPos& p) {
+    EXPECT_EQ(p.x, p.y);
+    ++count;
+  });
+  EXPECT_EQ(count, size_t{10});
+}
+
+TEST(view, multi_component_join) {
+  ViewManager em;
+  for (int i = 0; i < 100; ++i) {
+    auto e = em.create();
+    em.emplace<ViewPos>(e, float(i), float(i));
+    if (i % 2 == 0) {
+      em.emplace<ViewVel>(e, 1.0f, 2.0f);
+    }
+    if (i % 4 == 0) {
+      em.emplace<ViewMass>(e, float(i));
+    }
+  }
+
+  auto view = em.view<ViewPos, ViewVel, ViewMass>();
+  EXPECT_EQ(view.size_hint(), size_t{25});
+
+  size_t count = 0;
+  view.each([&](snowflake::Entity e, ViewPos& p, ViewVel& v, ViewMass& m) {
+    EXPECT_EQ(e.id() % 4, snowflake::Entity::IdType{0});
+    EXPECT_EQ(m.m, p.x);
+    p.x += v.dx;
+    ++count;
+  });
+  EXPECT_EQ(count, size_t{25});
+
+  count = 0;
+  for (auto e : view) {
+    auto [p, v, m] = view.get(e);
+    EXPECT_EQ(p.x, m.m + v.dx);
+    ++count;
+  }
+  EXPECT_EQ(count, size_t{25});
+}
+
+TEST(view, empty_join) {
+  ViewManager em;
+  auto        e1 = em.create();
+  auto        e2 = em.create();
+  em.emplace<ViewPos>(e1, 1.0f, 1.0f);
+  em.emplace<ViewVel>(e2, 1.0f, 1.0f);
+
+  auto view = em.view<ViewPos, ViewVel>();
+  EXPECT_EQ(view.begin(), view.end());
+  EXPECT_FALSE(view.contains(e1));
+  EXPECT_FALSE(view.contains(e2));
+}
+
+TEST(view, const_view) {
+  ViewManager em;
+  auto        e = em.create();
+  em.emplace<ViewPos>(e, 1.0f, 2.0f);
+  em.emplace<ViewVel>(e, 3.0f, 4.0f);
+
+  const auto& cem   = em;
+  size_t      count = 0;
+  cem.view<ViewPos, ViewVel>().each([&](const ViewPos& p, const ViewVel& v) {
+    EXPECT_EQ(p.y, 2.0f);
+    EXPECT_EQ(v.dx, 3.0f);
+    ++count;
+  });
+  EXPECT_EQ(count, size_t{1});
+}
+
+TEST(view, parallel_for_each) {
+  snowflake::ThreadPool pool{3};
+  ViewManager           em;
+  for (int i = 0; i < 50000; ++i) {
+    auto e = em.create();
+    em.emplace<ViewPos>(e, float(i), 0.0f);
+    if (i % 2 == 1) {
+      em.emplace<ViewVel>(e, 1.0f, 2.0f);
+    }
+  }
+
+  std::atomic<size_t> count{0};
+  em.view<ViewPos, ViewVel>().parallel_for_each(
+    pool, [&](ViewPos& p, const ViewVel& v) {
+      p.y = p.x + v.dy;
+      count.fetch_add(1, std::memory_order_relaxed);
+    });
+  EXPECT_EQ(count.load(), size_t{25000});
+
+  em.view<ViewPos>().each([](snowflake::Entity e, const ViewPos& p) {
+    EXPECT_EQ(p.y, e.id() % 2 == 1 ? p.x + 2.0f : 0.0f);
+  });
+}
+
+TEST(view, exclude_and_optional_components) {
+  using snowflake::exclude;
+  using snowflake::optional;
+  ViewManager em;
+  for (int i = 0; i < 100; ++i) {
+    auto e = em.create();
+    em.emplace<ViewPos>(e, float(i), 0.0f);
+    if (i % 2 == 0) {
+      em.emplace<ViewVel>(e, 1.0f, 1.0f);
+    }
+    if (i % 3 == 0) {
+      em.emplace<ViewMass>(e, float(i));
+    }
+    if (i % 5 == 0) {
+      em.emplace<ViewHidden>(e);
+    }
+  }
+
+  size_t count = 0, with_mass = 0;
+  auto   view =
+    em.view<ViewPos, ViewVel>(exclude<ViewHidden>, optional<ViewMass>);
+  view.each([&](snowflake::Entity e, ViewPos& p, ViewVel&, ViewMass* m) {
+    EXPECT_EQ(e.id() % 2, size_t{0});
+    EXPECT_NE(e.id() % 5, size_t{0});
+    EXPECT_EQ(m != nullptr, e.id() % 3 == 0);
+    if (m != nullptr) {
+      EXPECT_EQ(m->m, p.x);
+      ++with_mass;
+    }
+    ++count;
+  });
+  EXPECT_EQ(count, size_t{40});
+  EXPECT_EQ(with_mass, size_t{13});
+  EXPECT_EQ(size_t(std::distance(view.begin(), view.end())), count);
+  EXPECT_FALSE(view.contains(snowflake::Entity{10}));
+  EXPECT_TRUE(view.contains(snowflake::Entity{12}));
+
+  // Either term can be used alone, and const views yield const pointers.
+  count = 0;
+  em.view<ViewPos>(exclude<ViewVel, ViewHidden>).each([&](const ViewPos&) {
+    ++count;
+  });
+  EXPECT_EQ(count, size_t{40});
+
+  const auto& cem = em;
+  count           = 0;
+  cem.view<ViewPos>(optional<ViewVel>)
+    .each([&](const ViewPos&, const ViewVel* v) { count += v != nullptr; });
+  EXPECT_EQ(count, size_t{50});
+
+  std::atomic<size_t>   parallel{0};
+  snowflake::ThreadPool pool{3};
+  em.view<ViewPos>(exclude<ViewHidden>, optional<ViewMass>)
+    .parallel_for_each(pool, [&](ViewPos&, ViewMass* m) {
+      parallel.fetch_add(m != nullptr, std::memory_order_relaxed);
+    });
+  EXPECT_EQ(parallel.load(), size_t{27});
+}
+
+TEST(view, const_view_with_missing_pools) {
+  using snowflake::exclude;
+  using snowflake::optional;
+  ViewManager em;
+  for (int i = 0; i < 10; ++i) {
+    em.emplace<ViewPos>(em.create(), float(i), 0.0f);
+  }
+
+  // The pool for the unused component is never created, so it is treated as
+  // empty, rather than being accessed.
+  const auto& cem   = em;
+  size_t      count = 0;
+  cem.view<ViewPos>(exclude<ViewUnused>, optional<ViewUnused>)
+    .each([&](const ViewPos&, const ViewUnused* u) {
+      EXPECT_EQ(u, nullptr);
+      ++count;
+    });
+  EXPECT_EQ(count, size_t{10});
+  EXPECT_TRUE(cem.view<ViewPos>(exclude<ViewUnused>)
+                .contains(snowflake::Entity{3}));
+}
+
+#endif // SNOWFLAKE_TESTS_ECS_VIEW_HPP